@@ -45,6 +45,10 @@ namespace mediapipe {
 //   }
 // }
 //
+// For long files, output_chunk_samples outputs fewer, larger packets, and
+// num_threads decodes segments of the file in parallel (see
+// AudioDecoderOptions).
+//
 // TODO: support decoding multiple streams.
 class AudioDecoderCalculator : public CalculatorBase {
  public:
@@ -12,12 +12,24 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cmath>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
 #include "absl/flags/flag.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/framework/tool/test_util.h"
@@ -147,5 +159,213 @@ TEST(AudioDecoderCalculatorTest, TestAAC) {
               std::ceil(44100.0 * 2 / 1024));
 }
 
+absl::StatusOr<std::vector<Packet>> DecodeAudio(const std::string& path,
+                                                const std::string& options) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+      absl::Substitute(R"pb(
+                         calculator: "AudioDecoderCalculator"
+                         input_side_packet: "INPUT_FILE_PATH:input_file_path"
+                         output_stream: "AUDIO:audio"
+                         node_options {
+                           [type.googleapis.com/mediapipe.AudioDecoderOptions]:
+                           { $0 }
+                         })pb",
+                       options)));
+  runner.MutableSidePackets()->Tag("INPUT_FILE_PATH") =
+      MakePacket<std::string>(path);
+  MP_RETURN_IF_ERROR(runner.Run());
+  return runner.Outputs().Tag("AUDIO").packets;
+}
+
+std::string TestFilePath(const std::string& name) {
+  return file::JoinPath(GetTestDataDir(kTestPackageRoot), name);
+}
+
+Matrix ConcatenateAudio(const std::vector<Packet>& packets) {
+  int num_samples = 0;
+  for (const Packet& packet : packets) {
+    num_samples += packet.Get<Matrix>().cols();
+  }
+  Matrix audio(packets.empty() ? 0 : packets[0].Get<Matrix>().rows(),
+               num_samples);
+  int sample = 0;
+  for (const Packet& packet : packets) {
+    const Matrix& samples = packet.Get<Matrix>();
+    audio.middleCols(sample, samples.cols()) = samples;
+    sample += samples.cols();
+  }
+  return audio;
+}
+
+// Expects the timestamps of @packets to be those of their first sample, the
+// samples being contiguous and starting at @first_sample.
+void ExpectContiguousTimestamps(const std::vector<Packet>& packets,
+                                int sample_rate, int64 first_sample) {
+  int64 sample = first_sample;
+  for (const Packet& packet : packets) {
+    EXPECT_EQ(packet.Timestamp(),
+              Timestamp(std::llround(sample * 1e6 / sample_rate)));
+    sample += packet.Get<Matrix>().cols();
+  }
+}
+
+TEST(AudioDecoderCalculatorTest, TestChunkedOutput) {
+  const std::string path =
+      TestFilePath("sine_wave_1k_44100_mono_2_sec_wav.audio");
+  auto frames_or = DecodeAudio(path, "audio_stream { stream_index: 0 }");
+  MP_ASSERT_OK(frames_or);
+  auto chunks_or = DecodeAudio(
+      path, "audio_stream { stream_index: 0 output_chunk_samples: 4096 }");
+  MP_ASSERT_OK(chunks_or);
+  const std::vector<Packet>& chunks = chunks_or.value();
+
+  ASSERT_EQ(frames_or.value()[0].Timestamp(), Timestamp(0));
+  const Matrix expected = ConcatenateAudio(frames_or.value());
+  ASSERT_EQ(chunks.size(), (expected.cols() + 4095) / 4096);
+  for (int i = 0; i + 1 < chunks.size(); ++i) {
+    EXPECT_EQ(chunks[i].Get<Matrix>().cols(), 4096);
+  }
+  ExpectContiguousTimestamps(chunks, 44100, 0);
+  EXPECT_EQ(ConcatenateAudio(chunks), expected);
+}
+
+TEST(AudioDecoderCalculatorTest, TestChunkedOutputIsCutAtStartAndEndTimes) {
+  const std::string path =
+      TestFilePath("sine_wave_1k_44100_mono_2_sec_wav.audio");
+  auto frames_or = DecodeAudio(path, "audio_stream { stream_index: 0 }");
+  MP_ASSERT_OK(frames_or);
+  auto chunks_or = DecodeAudio(path, R"pb(
+    audio_stream { stream_index: 0 output_chunk_samples: 4096 }
+    start_time: 0.5
+    end_time: 1.5
+  )pb");
+  MP_ASSERT_OK(chunks_or);
+
+  // Samples 22050 to 66150, the end time being inclusive.
+  const Matrix expected =
+      ConcatenateAudio(frames_or.value()).middleCols(22050, 44101);
+  ExpectContiguousTimestamps(chunks_or.value(), 44100, 22050);
+  EXPECT_EQ(ConcatenateAudio(chunks_or.value()), expected);
+}
+
+struct ParallelDecodingTestCase {
+  std::string options;
+  // The first sample of the whole file expected, and the number of samples,
+  // -1 for all the remaining ones.
+  int first_sample;
+  int num_samples;
+};
+
+class AudioDecoderCalculatorParallelTest
+    : public testing::TestWithParam<ParallelDecodingTestCase> {};
+
+TEST_P(AudioDecoderCalculatorParallelTest, MatchesSequentialDecoding) {
+  const std::string path =
+      TestFilePath("sine_wave_1k_48000_stereo_2_sec_wav.audio");
+  auto sequential_or = DecodeAudio(path, "audio_stream { stream_index: 0 }");
+  MP_ASSERT_OK(sequential_or);
+  // Segments of 0.3 seconds, cut within decoded frames.
+  auto parallel_or =
+      DecodeAudio(path, absl::StrCat(GetParam().options,
+                                     " num_threads: 3 segment_duration: 0.3"));
+  MP_ASSERT_OK(parallel_or);
+
+  ASSERT_EQ(sequential_or.value()[0].Timestamp(), Timestamp(0));
+  const Matrix audio = ConcatenateAudio(sequential_or.value());
+  const int num_samples = GetParam().num_samples >= 0
+                              ? GetParam().num_samples
+                              : audio.cols() - GetParam().first_sample;
+  ExpectContiguousTimestamps(parallel_or.value(), 48000,
+                             GetParam().first_sample);
+  EXPECT_EQ(ConcatenateAudio(parallel_or.value()),
+            audio.middleCols(GetParam().first_sample, num_samples));
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AudioDecoderCalculatorParallelTests, AudioDecoderCalculatorParallelTest,
+    testing::ValuesIn(std::vector<ParallelDecodingTestCase>{
+        {"audio_stream { stream_index: 0 }", 0, -1},
+        {"audio_stream { stream_index: 0 } start_time: 0.25 end_time: 1.75",
+         12000, 72001},
+        {"audio_stream { stream_index: 0 output_chunk_samples: 1000 } "
+         "start_time: 0.25",
+         12000, -1}}));
+
+// Returns the path of a copy of the test file @name, repeated @repetitions
+// times: long files to benchmark decoding with.
+std::string ScaledUpTestFile(const std::string& name, int repetitions) {
+  std::string contents;
+  CHECK(file::GetContents(TestFilePath(name), &contents).ok());
+  std::string scaled_up;
+  if (contents.compare(0, 4, "RIFF") == 0) {
+    // Repeats the data chunk of the WAV file, and updates its size and that
+    // of the RIFF chunk.
+    auto load32 = [&contents](int position) {
+      return static_cast<uint32>(static_cast<uint8>(contents[position])) |
+             static_cast<uint32>(static_cast<uint8>(contents[position + 1]))
+                 << 8 |
+             static_cast<uint32>(static_cast<uint8>(contents[position + 2]))
+                 << 16 |
+             static_cast<uint32>(static_cast<uint8>(contents[position + 3]))
+                 << 24;
+    };
+    auto store32 = [&scaled_up](int position, uint32 value) {
+      for (int i = 0; i < 4; ++i) {
+        scaled_up[position + i] = static_cast<char>(value >> (8 * i));
+      }
+    };
+    int position = 12;
+    while (contents.compare(position, 4, "data") != 0) {
+      position += 8 + load32(position + 4);
+      CHECK_LT(position + 8, contents.size());
+    }
+    const uint32 data_size = load32(position + 4);
+    scaled_up = contents.substr(0, position + 8);
+    for (int i = 0; i < repetitions; ++i) {
+      scaled_up.append(contents, position + 8, data_size);
+    }
+    store32(4, scaled_up.size() - 8);
+    store32(position + 4, data_size * repetitions);
+  } else {
+    // ADTS streams can be concatenated.
+    for (int i = 0; i < repetitions; ++i) {
+      scaled_up.append(contents);
+    }
+  }
+  const std::string path = file::JoinPath(
+      getenv("TEST_TMPDIR"), absl::StrCat(repetitions, "x_", name));
+  CHECK(file::SetContents(path, scaled_up).ok());
+  return path;
+}
+
+// Args: test file (0 for WAV, 1 for AAC), number of threads, and output chunk
+// size (0 for none).
+void BM_DecodeLongAudio(benchmark::State& state) {
+  // 5 minutes.
+  const std::string path = ScaledUpTestFile(
+      state.range(0) == 0 ? "sine_wave_1k_48000_stereo_2_sec_wav.audio"
+                          : "sine_wave_1k_44100_stereo_2_sec_aac.audio",
+      150);
+  const std::string options = absl::Substitute(
+      "audio_stream { stream_index: 0 output_chunk_samples: $0 } "
+      "num_threads: $1 segment_duration: 30",
+      state.range(2), state.range(1));
+  int64 num_samples = 0;
+  for (auto _ : state) {
+    auto packets_or = DecodeAudio(path, options);
+    CHECK(packets_or.ok());
+    num_samples = ConcatenateAudio(packets_or.value()).cols();
+  }
+  state.SetItemsProcessed(state.iterations() * num_samples);
+}
+
+BENCHMARK(BM_DecodeLongAudio)
+    ->Args({0, 1, 0})
+    ->Args({0, 1, 48000})
+    ->Args({0, 4, 48000})
+    ->Args({1, 1, 0})
+    ->Args({1, 1, 44100})
+    ->Args({1, 4, 44100});
+
 }  // namespace
 }  // namespace mediapipe
@@ -19,20 +19,22 @@
 // commonly used as acoustic features in speech and other audio tasks.
 // Both calculators expect as input the SQUARED_MAGNITUDE-domain outputs
 // from the MediaPipe SpectrogramCalculator object.
+// Unlike the audio/dsp classes, which convert each frame to double, both
+// calculators compute in float: their outputs are within 1e-5 (Mel spectra)
+// and 1e-4 (MFCCs) of the audio/dsp ones, relative to values above 1.
 #include <memory>
 #include <vector>
 
-#include "Eigen/Core"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "absl/strings/substitute.h"
-#include "audio/dsp/mfcc/mel_filterbank.h"
-#include "audio/dsp/mfcc/mfcc.h"
 #include "mediapipe/calculators/audio/mfcc_mel_calculators.pb.h"
+#include "mediapipe/calculators/audio/mfcc_mel_utils.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
-#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/util/time_series_util.h"
 
@@ -59,7 +61,7 @@ std::string PortableDebugString(const TimeSeriesHeader& header) {
 // Abstract base class for Calculators that transform feature vectors on a
 // frame-by-frame basis.
 // Subclasses must override pure virtual methods ConfigureTransform and
-// TransformFrame.
+// TransformFrames.
 // Input and output MediaPipe packets are matrices with one column per frame,
 // and one row per feature dimension.  Each input packet results in an
 // output packet with the same number of columns (but differing numbers of
@@ -93,10 +95,11 @@ class FramewiseTransformCalculatorBase : public CalculatorBase {
   virtual absl::Status ConfigureTransform(const TimeSeriesHeader& header,
                                           CalculatorContext* cc) = 0;
 
-  // Takes a vector<double> corresponding to an input frame, and
-  // perform the specific transformation to produce an output frame.
-  virtual void TransformFrame(const std::vector<double>& input,
-                              std::vector<double>* output) const = 0;
+  // Takes a matrix of input frames, one per column, and performs the
+  // specific transformation to produce the matrix of the output frames.
+  // Transforming all the frames of a packet at once lets the transforms use
+  // matrix products rather than per-frame loops.
+  virtual void TransformFrames(const Matrix& input, Matrix* output) = 0;
 
  private:
   int num_output_channels_;
@@ -120,35 +123,17 @@ absl::Status FramewiseTransformCalculatorBase::Open(CalculatorContext* cc) {
 
 absl::Status FramewiseTransformCalculatorBase::Process(CalculatorContext* cc) {
   const Matrix& input = cc->Inputs().Index(0).Get<Matrix>();
-  const int num_frames = input.cols();
-  std::unique_ptr<Matrix> output(new Matrix(num_output_channels_, num_frames));
-  // The main work here is converting each column of the float Matrix
-  // into a vector of doubles, which is what our target functions from
-  // dsp_core consume, and doing the reverse with their output.
-  std::vector<double> input_frame(input.rows());
-  std::vector<double> output_frame(num_output_channels_);
-
-  for (int frame = 0; frame < num_frames; ++frame) {
-    // Copy input from Eigen::Matrix column to vector<float>.
-    Eigen::Map<Eigen::MatrixXd> input_frame_map(&input_frame[0],
-                                                input_frame.size(), 1);
-    input_frame_map = input.col(frame).cast<double>();
-
-    // Perform the actual transformation.
-    TransformFrame(input_frame, &output_frame);
-
-    // Copy output from vector<float> to Eigen::Vector.
-    CHECK_EQ(output_frame.size(), num_output_channels_);
-    Eigen::Map<const Eigen::MatrixXd> output_frame_map(&output_frame[0],
-                                                       output_frame.size(), 1);
-    output->col(frame) = output_frame_map.cast<float>();
-  }
+  auto output = absl::make_unique<Matrix>();
+  TransformFrames(input, output.get());
+  RET_CHECK_EQ(output->rows(), num_output_channels_);
+  RET_CHECK_EQ(output->cols(), input.cols());
   cc->Outputs().Index(0).Add(output.release(), cc->InputTimestamp());
 
   return absl::OkStatus();
 }
 
-// Calculator wrapper around the dsp/mfcc/mfcc.cc routine.
+// Calculator wrapper around BatchedMfcc, the batched, single precision
+// implementation of the dsp/mfcc/mfcc.cc routine.
 // Take frames of squared-magnitude spectra from the SpectrogramCalculator
 // and convert them into Mel Frequency Cepstral Coefficients.
 //
@@ -178,17 +163,8 @@ class MfccCalculator : public FramewiseTransformCalculatorBase {
   absl::Status ConfigureTransform(const TimeSeriesHeader& header,
                                   CalculatorContext* cc) override {
     MfccCalculatorOptions mfcc_options = cc->Options<MfccCalculatorOptions>();
-    mfcc_.reset(new audio_dsp::Mfcc());
     int input_length = header.num_channels();
-    // Set up the parameters to the Mfcc object.
     set_num_output_channels(mfcc_options.mfcc_count());
-    mfcc_->set_dct_coefficient_count(num_output_channels());
-    mfcc_->set_upper_frequency_limit(
-        mfcc_options.mel_spectrum_params().max_frequency_hertz());
-    mfcc_->set_lower_frequency_limit(
-        mfcc_options.mel_spectrum_params().min_frequency_hertz());
-    mfcc_->set_filterbank_channel_count(
-        mfcc_options.mel_spectrum_params().channel_count());
     // An upstream calculator (such as SpectrogramCalculator) must store
     // the sample rate of its input audio waveform in the TimeSeries Header.
     // audio_dsp::MelFilterBank needs to know this to
@@ -198,29 +174,28 @@ class MfccCalculator : public FramewiseTransformCalculatorBase {
           absl::StrCat("No audio_sample_rate in input TimeSeriesHeader ",
                        PortableDebugString(header)));
     }
-    // Now we can initialize the Mfcc object.
-    bool initialized =
-        mfcc_->Initialize(input_length, header.audio_sample_rate());
-
-    if (initialized) {
-      return absl::OkStatus();
-    } else {
-      return absl::Status(absl::StatusCode::kInternal,
-                          "Mfcc::Initialize returned uninitialized");
-    }
+    ASSIGN_OR_RETURN(
+        mfcc_,
+        BatchedMfcc::Create(
+            input_length, header.audio_sample_rate(),
+            mfcc_options.mel_spectrum_params().channel_count(),
+            mfcc_options.mel_spectrum_params().min_frequency_hertz(),
+            mfcc_options.mel_spectrum_params().max_frequency_hertz(),
+            num_output_channels()));
+    return absl::OkStatus();
   }
 
-  void TransformFrame(const std::vector<double>& input,
-                      std::vector<double>* output) const override {
+  void TransformFrames(const Matrix& input, Matrix* output) override {
     mfcc_->Compute(input, output);
   }
 
  private:
-  std::unique_ptr<audio_dsp::Mfcc> mfcc_;
+  std::unique_ptr<BatchedMfcc> mfcc_;
 };
 REGISTER_CALCULATOR(MfccCalculator);
 
-// Calculator wrapper around the dsp/mfcc/mel_filterbank.cc routine.
+// Calculator wrapper around BatchedMelFilterbank, the batched, single
+// precision implementation of the dsp/mfcc/mel_filterbank.cc routine.
 // Take frames of squared-magnitude spectra from the SpectrogramCalculator
 // and convert them into Mel-warped (linear-magnitude) spectra.
 // Note: This code computes a mel-frequency filterbank, using a simple
@@ -237,7 +212,6 @@ class MelSpectrumCalculator : public FramewiseTransformCalculatorBase {
                                   CalculatorContext* cc) override {
     MelSpectrumCalculatorOptions mel_spectrum_options =
         cc->Options<MelSpectrumCalculatorOptions>();
-    mel_filterbank_.reset(new audio_dsp::MelFilterbank());
     int input_length = header.num_channels();
     set_num_output_channels(mel_spectrum_options.channel_count());
     // An upstream calculator (such as SpectrogramCalculator) must store
@@ -249,26 +223,21 @@ class MelSpectrumCalculator : public FramewiseTransformCalculatorBase {
           absl::StrCat("No audio_sample_rate in input TimeSeriesHeader ",
                        PortableDebugString(header)));
     }
-    bool initialized = mel_filterbank_->Initialize(
-        input_length, header.audio_sample_rate(), num_output_channels(),
-        mel_spectrum_options.min_frequency_hertz(),
-        mel_spectrum_options.max_frequency_hertz());
-
-    if (initialized) {
-      return absl::OkStatus();
-    } else {
-      return absl::Status(absl::StatusCode::kInternal,
-                          "mfcc::Initialize returned uninitialized");
-    }
+    ASSIGN_OR_RETURN(mel_filterbank_,
+                     BatchedMelFilterbank::Create(
+                         input_length, header.audio_sample_rate(),
+                         num_output_channels(),
+                         mel_spectrum_options.min_frequency_hertz(),
+                         mel_spectrum_options.max_frequency_hertz()));
+    return absl::OkStatus();
   }
 
-  void TransformFrame(const std::vector<double>& input,
-                      std::vector<double>* output) const override {
+  void TransformFrames(const Matrix& input, Matrix* output) override {
     mel_filterbank_->Compute(input, output);
   }
 
  private:
-  std::unique_ptr<audio_dsp::MelFilterbank> mel_filterbank_;
+  std::unique_ptr<BatchedMelFilterbank> mel_filterbank_;
 };
 REGISTER_CALCULATOR(MelSpectrumCalculator);
 
@@ -13,7 +13,13 @@
 // limitations under the License.
 #include <vector>
 
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "Eigen/Core"
+#include "audio/dsp/mfcc/mel_filterbank.h"
+#include "audio/dsp/mfcc/mfcc.h"
 #include "mediapipe/calculators/audio/mfcc_mel_calculators.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
@@ -99,6 +105,34 @@ class FramewiseTransformCalculatorTest
     }
   }
 
+  // Checks that each output frame is within @tolerance, relative to values
+  // above 1, of the frame computed from the input by @transform, an
+  // audio_dsp::MelFilterbank or audio_dsp::Mfcc working in double precision.
+  template <typename Transform>
+  void ExpectOutputNear(const Transform& transform, float tolerance) {
+    const auto& input_packets = this->input().packets;
+    const auto& output_packets = this->output().packets;
+    ASSERT_EQ(output_packets.size(), input_packets.size());
+    std::vector<double> input_frame;
+    std::vector<double> expected_frame;
+    for (int i = 0; i < input_packets.size(); ++i) {
+      const Matrix& input = input_packets[i].template Get<Matrix>();
+      const Matrix& output = output_packets[i].template Get<Matrix>();
+      ASSERT_EQ(output.cols(), input.cols());
+      for (int frame = 0; frame < input.cols(); ++frame) {
+        input_frame.assign(input.col(frame).data(),
+                           input.col(frame).data() + input.rows());
+        transform.Compute(input_frame, &expected_frame);
+        ASSERT_EQ(output.rows(), expected_frame.size());
+        for (int row = 0; row < output.rows(); ++row) {
+          EXPECT_NEAR(output(row, frame), expected_frame[row],
+                      tolerance * std::max(1.0, std::abs(expected_frame[row])))
+              << "at (" << row << ", " << frame << ") of packet " << i;
+        }
+      }
+    }
+  }
+
   // Allows SetupRandomInputPackets() to inform CheckResults() about how
   // big the packets are supposed to be.
   int num_samples_per_packet_;
@@ -116,6 +150,23 @@ TEST_F(MfccCalculatorTest, AudioSampleRateFromInputHeader) {
 
   CheckResults(options_.mfcc_count());
 }
+TEST_F(MfccCalculatorTest, MatchesAudioDspWithinFloatPrecision) {
+  audio_sample_rate_ = kAudioSampleRate;
+  SetupGraphAndHeader();
+  SetupRandomInputPackets();
+
+  MP_ASSERT_OK(Run());
+
+  const MelSpectrumCalculatorOptions& mel_options =
+      options_.mel_spectrum_params();
+  audio_dsp::Mfcc mfcc;
+  mfcc.set_filterbank_channel_count(mel_options.channel_count());
+  mfcc.set_lower_frequency_limit(mel_options.min_frequency_hertz());
+  mfcc.set_upper_frequency_limit(mel_options.max_frequency_hertz());
+  mfcc.set_dct_coefficient_count(options_.mfcc_count());
+  ASSERT_TRUE(mfcc.Initialize(num_input_channels_, kAudioSampleRate));
+  ExpectOutputNear(mfcc, 1e-4);
+}
 TEST_F(MfccCalculatorTest, NoAudioSampleRate) {
   // Leave audio_sample_rate_ == kUnset, so it is not present in the
   // input TimeSeriesHeader; expect failure.
@@ -138,6 +189,19 @@ TEST_F(MelSpectrumCalculatorTest, AudioSampleRateFromInputHeader) {
 
   CheckResults(options_.channel_count());
 }
+TEST_F(MelSpectrumCalculatorTest, MatchesAudioDspWithinFloatPrecision) {
+  audio_sample_rate_ = kAudioSampleRate;
+  SetupGraphAndHeader();
+  SetupRandomInputPackets();
+
+  MP_ASSERT_OK(Run());
+
+  audio_dsp::MelFilterbank mel_filterbank;
+  ASSERT_TRUE(mel_filterbank.Initialize(
+      num_input_channels_, kAudioSampleRate, options_.channel_count(),
+      options_.min_frequency_hertz(), options_.max_frequency_hertz()));
+  ExpectOutputNear(mel_filterbank, 1e-5);
+}
 TEST_F(MelSpectrumCalculatorTest, NoAudioSampleRate) {
   // Leave audio_sample_rate_ == kUnset, so it is not present in the
   // input TimeSeriesHeader; expect failure.
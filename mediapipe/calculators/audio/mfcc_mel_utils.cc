@@ -0,0 +1,159 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/audio/mfcc_mel_utils.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Eigen/Core"
+#include "absl/memory/memory.h"
+#include "absl/strings/substitute.h"
+#include "audio/dsp/mfcc/mel_filterbank.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+absl::StatusOr<std::unique_ptr<BatchedMelFilterbank>>
+BatchedMelFilterbank::Create(int input_length, double input_sample_rate,
+                             int channel_count, double min_frequency_hertz,
+                             double max_frequency_hertz) {
+  audio_dsp::MelFilterbank mel_filterbank;
+  if (!mel_filterbank.Initialize(input_length, input_sample_rate,
+                                 channel_count, min_frequency_hertz,
+                                 max_frequency_hertz)) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "MelFilterbank::Initialize failed with input_length: $0, "
+        "input_sample_rate: $1, channel_count: $2, min_frequency_hertz: $3, "
+        "max_frequency_hertz: $4",
+        input_length, input_sample_rate, channel_count, min_frequency_hertz,
+        max_frequency_hertz));
+  }
+
+  // Gets the weights of the filterbank, bin by bin: the Mel spectrum of a
+  // unit impulse at a bin is the column of the weights matrix of this bin.
+  Eigen::MatrixXd weights(channel_count, input_length);
+  std::vector<double> impulse(input_length, 0.0);
+  std::vector<double> column;
+  for (int bin = 0; bin < input_length; ++bin) {
+    impulse[bin] = 1.0;
+    mel_filterbank.Compute(impulse, &column);
+    RET_CHECK_EQ(column.size(), channel_count);
+    weights.col(bin) = Eigen::Map<const Eigen::VectorXd>(column.data(),
+                                                         channel_count);
+    impulse[bin] = 0.0;
+  }
+
+  auto batched_mel_filterbank = absl::WrapUnique(new BatchedMelFilterbank());
+  batched_mel_filterbank->input_length_ = input_length;
+  std::vector<int>& first_bins = batched_mel_filterbank->first_bins_;
+  std::vector<int>& row_offsets = batched_mel_filterbank->row_offsets_;
+  std::vector<float>& values = batched_mel_filterbank->weights_;
+  int first_bin = input_length;
+  int end_bin = 0;
+  row_offsets.push_back(0);
+  for (int channel = 0; channel < channel_count; ++channel) {
+    int begin = 0;
+    while (begin < input_length && weights(channel, begin) == 0.0) {
+      ++begin;
+    }
+    int end = input_length;
+    while (end > begin && weights(channel, end - 1) == 0.0) {
+      --end;
+    }
+    if (begin < end) {
+      first_bin = std::min(first_bin, begin);
+      end_bin = std::max(end_bin, end);
+    }
+    // -1 for rows of channels always zero, fixed up below.
+    first_bins.push_back(begin < end ? begin : -1);
+    for (int bin = begin; bin < end; ++bin) {
+      values.push_back(weights(channel, bin));
+    }
+    row_offsets.push_back(values.size());
+  }
+  if (first_bin >= end_bin) {
+    // All channels are always zero.
+    first_bin = 0;
+    end_bin = 0;
+  }
+  // The bins are relative to the magnitudes computed.
+  for (int& bin : first_bins) {
+    bin = bin < 0 ? 0 : bin - first_bin;
+  }
+  batched_mel_filterbank->first_bin_ = first_bin;
+  batched_mel_filterbank->num_bins_ = end_bin - first_bin;
+  return batched_mel_filterbank;
+}
+
+void BatchedMelFilterbank::Compute(const Matrix& squared_magnitudes,
+                                   Matrix* mel_spectra) {
+  CHECK_EQ(squared_magnitudes.rows(), input_length_);
+  const int num_frames = squared_magnitudes.cols();
+  const int num_channels = channel_count();
+  mel_spectra->resize(num_channels, num_frames);
+  magnitudes_ =
+      squared_magnitudes.middleRows(first_bin_, num_bins_).array().sqrt();
+  for (int frame = 0; frame < num_frames; ++frame) {
+    const float* magnitudes = magnitudes_.col(frame).data();
+    float* mel_spectrum = mel_spectra->col(frame).data();
+    for (int channel = 0; channel < num_channels; ++channel) {
+      const int offset = row_offsets_[channel];
+      const int size = row_offsets_[channel + 1] - offset;
+      mel_spectrum[channel] =
+          Eigen::Map<const Eigen::VectorXf>(&weights_[offset], size)
+              .dot(Eigen::Map<const Eigen::VectorXf>(
+                  magnitudes + first_bins_[channel], size));
+    }
+  }
+}
+
+absl::StatusOr<std::unique_ptr<BatchedMfcc>> BatchedMfcc::Create(
+    int input_length, double input_sample_rate, int channel_count,
+    double min_frequency_hertz, double max_frequency_hertz, int mfcc_count) {
+  if (mfcc_count < 1 || mfcc_count > channel_count) {
+    return absl::InvalidArgumentError(
+        absl::Substitute("mfcc_count must be in [1, $0], got $1",
+                         channel_count, mfcc_count));
+  }
+  auto batched_mfcc = absl::WrapUnique(new BatchedMfcc());
+  ASSIGN_OR_RETURN(batched_mfcc->mel_filterbank_,
+                   BatchedMelFilterbank::Create(
+                       input_length, input_sample_rate, channel_count,
+                       min_frequency_hertz, max_frequency_hertz));
+  // The DCT-II basis of audio_dsp::MfccDct.
+  Matrix& dct = batched_mfcc->dct_;
+  dct.resize(mfcc_count, channel_count);
+  const double normalization = std::sqrt(2.0 / channel_count);
+  for (int i = 0; i < mfcc_count; ++i) {
+    for (int j = 0; j < channel_count; ++j) {
+      dct(i, j) =
+          normalization * std::cos(M_PI * i * (j + 0.5) / channel_count);
+    }
+  }
+  return batched_mfcc;
+}
+
+void BatchedMfcc::Compute(const Matrix& squared_magnitudes, Matrix* mfccs) {
+  mel_filterbank_->Compute(squared_magnitudes, &log_mel_spectra_);
+  // As audio_dsp::Mfcc, floors the Mel spectra so that silent frames have
+  // finite coefficients.
+  constexpr float kLogFloor = 1e-12f;
+  log_mel_spectra_ = log_mel_spectra_.array().max(kLogFloor).log();
+  mfccs->noalias() = dct_ * log_mel_spectra_;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,107 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Float implementations of audio_dsp::MelFilterbank and audio_dsp::Mfcc
+// transforming whole matrices of frames at once.
+#ifndef MEDIAPIPE_CALCULATORS_AUDIO_MFCC_MEL_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_AUDIO_MFCC_MEL_UTILS_H_
+
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Computes Mel spectra from squared magnitude spectra, as
+// audio_dsp::MelFilterbank does, for all the frames of a matrix.
+//
+// The weights of the triangular filters are taken from
+// audio_dsp::MelFilterbank, and stored as a sparse matrix in compressed
+// sparse row format: each Mel channel only weighs the few spectrum bins
+// between the centers of its neighbors. As these bins are contiguous, only
+// the first bin of each row is stored.
+//
+// Computes in float, where audio_dsp::MelFilterbank computes in double.
+//
+// Not thread-safe: the magnitudes are computed into a buffer of the object.
+class BatchedMelFilterbank {
+ public:
+  // Returns an error if audio_dsp::MelFilterbank::Initialize fails with the
+  // same arguments.
+  static absl::StatusOr<std::unique_ptr<BatchedMelFilterbank>> Create(
+      int input_length, double input_sample_rate, int channel_count,
+      double min_frequency_hertz, double max_frequency_hertz);
+
+  int input_length() const { return input_length_; }
+  int channel_count() const { return first_bins_.size(); }
+
+  // Computes into the columns of @mel_spectra the Mel spectra of the squared
+  // magnitude spectra in the columns of @squared_magnitudes, which has
+  // input_length() rows. @mel_spectra is resized to channel_count() rows.
+  void Compute(const Matrix& squared_magnitudes, Matrix* mel_spectra);
+
+ private:
+  BatchedMelFilterbank() = default;
+
+  int input_length_ = 0;
+  // The bins weighed by any channel: [first_bin_, first_bin_ + num_bins_).
+  int first_bin_ = 0;
+  int num_bins_ = 0;
+  // Channel c weighs bins first_bins_[c] and following with the weights
+  // weights_[row_offsets_[c]] to weights_[row_offsets_[c + 1] - 1].
+  std::vector<int> first_bins_;
+  std::vector<int> row_offsets_;
+  std::vector<float> weights_;
+
+  // The magnitudes of the bins weighed.
+  Matrix magnitudes_;
+};
+
+// Computes Mel Frequency Cepstral Coefficients from squared magnitude
+// spectra, as audio_dsp::Mfcc does, for all the frames of a matrix: Mel
+// spectra from BatchedMelFilterbank, whose floored logarithms are projected
+// on the DCT-II basis of audio_dsp::MfccDct by a matrix product, in float
+// rather than double.
+//
+// Not thread-safe, as BatchedMelFilterbank.
+class BatchedMfcc {
+ public:
+  // Returns an error if audio_dsp::Mfcc::Initialize fails with the same
+  // parameters.
+  static absl::StatusOr<std::unique_ptr<BatchedMfcc>> Create(
+      int input_length, double input_sample_rate, int channel_count,
+      double min_frequency_hertz, double max_frequency_hertz, int mfcc_count);
+
+  int mfcc_count() const { return dct_.rows(); }
+
+  // Computes into the columns of @mfccs the MFCCs of the squared magnitude
+  // spectra in the columns of @squared_magnitudes. @mfccs is resized to
+  // mfcc_count() rows.
+  void Compute(const Matrix& squared_magnitudes, Matrix* mfccs);
+
+ private:
+  BatchedMfcc() = default;
+
+  std::unique_ptr<BatchedMelFilterbank> mel_filterbank_;
+  // mfcc_count x channel_count DCT-II basis.
+  Matrix dct_;
+  // The log Mel spectra of the frames.
+  Matrix log_mel_spectra_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_AUDIO_MFCC_MEL_UTILS_H_
@@ -0,0 +1,205 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/audio/mfcc_mel_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "audio/dsp/mfcc/mel_filterbank.h"
+#include "audio/dsp/mfcc/mfcc.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kNumFrames = 100;
+
+// Returns squared magnitude spectra, the last frame being silent.
+Matrix MakeSquaredMagnitudes(int input_length, int num_frames) {
+  Matrix squared_magnitudes = Matrix::Random(input_length, num_frames);
+  squared_magnitudes = squared_magnitudes.array().square();
+  squared_magnitudes.col(num_frames - 1).setZero();
+  return squared_magnitudes;
+}
+
+// Computes the transform of each column of @input with @transform, an
+// audio_dsp::MelFilterbank or audio_dsp::Mfcc.
+template <typename Transform>
+Matrix ComputePerFrame(const Transform& transform, const Matrix& input) {
+  std::vector<double> input_frame(input.rows());
+  std::vector<double> output_frame;
+  Matrix output;
+  for (int frame = 0; frame < input.cols(); ++frame) {
+    for (int i = 0; i < input.rows(); ++i) {
+      input_frame[i] = input(i, frame);
+    }
+    transform.Compute(input_frame, &output_frame);
+    if (frame == 0) {
+      output.resize(output_frame.size(), input.cols());
+    }
+    for (int i = 0; i < output_frame.size(); ++i) {
+      output(i, frame) = output_frame[i];
+    }
+  }
+  return output;
+}
+
+void ExpectNear(const Matrix& actual, const Matrix& expected,
+                float tolerance) {
+  ASSERT_EQ(actual.rows(), expected.rows());
+  ASSERT_EQ(actual.cols(), expected.cols());
+  for (int frame = 0; frame < expected.cols(); ++frame) {
+    for (int i = 0; i < expected.rows(); ++i) {
+      EXPECT_NEAR(actual(i, frame), expected(i, frame),
+                  tolerance * std::max(1.0f, std::abs(expected(i, frame))))
+          << "at (" << i << ", " << frame << ")";
+    }
+  }
+}
+
+struct MelParams {
+  int input_length;
+  double sample_rate;
+  int channel_count;
+  double min_frequency_hertz;
+  double max_frequency_hertz;
+};
+
+class BatchedMfccMelTest : public testing::TestWithParam<MelParams> {};
+
+TEST_P(BatchedMfccMelTest, MelFilterbankMatchesAudioDsp) {
+  const MelParams& params = GetParam();
+  audio_dsp::MelFilterbank mel_filterbank;
+  ASSERT_TRUE(mel_filterbank.Initialize(
+      params.input_length, params.sample_rate, params.channel_count,
+      params.min_frequency_hertz, params.max_frequency_hertz));
+  auto batched_or = BatchedMelFilterbank::Create(
+      params.input_length, params.sample_rate, params.channel_count,
+      params.min_frequency_hertz, params.max_frequency_hertz);
+  MP_ASSERT_OK(batched_or);
+  EXPECT_EQ(batched_or.value()->channel_count(), params.channel_count);
+
+  const Matrix input = MakeSquaredMagnitudes(params.input_length, kNumFrames);
+  Matrix output;
+  batched_or.value()->Compute(input, &output);
+  ExpectNear(output, ComputePerFrame(mel_filterbank, input), 1e-5);
+}
+
+TEST_P(BatchedMfccMelTest, MfccMatchesAudioDsp) {
+  const MelParams& params = GetParam();
+  constexpr int kMfccCount = 13;
+  audio_dsp::Mfcc mfcc;
+  mfcc.set_filterbank_channel_count(params.channel_count);
+  mfcc.set_lower_frequency_limit(params.min_frequency_hertz);
+  mfcc.set_upper_frequency_limit(params.max_frequency_hertz);
+  mfcc.set_dct_coefficient_count(kMfccCount);
+  ASSERT_TRUE(mfcc.Initialize(params.input_length, params.sample_rate));
+  auto batched_or = BatchedMfcc::Create(
+      params.input_length, params.sample_rate, params.channel_count,
+      params.min_frequency_hertz, params.max_frequency_hertz, kMfccCount);
+  MP_ASSERT_OK(batched_or);
+  EXPECT_EQ(batched_or.value()->mfcc_count(), kMfccCount);
+
+  const Matrix input = MakeSquaredMagnitudes(params.input_length, kNumFrames);
+  Matrix output;
+  batched_or.value()->Compute(input, &output);
+  // The silent frame has large coefficients, from the floor of the logarithm.
+  ExpectNear(output, ComputePerFrame(mfcc, input), 1e-4);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    BatchedMfccMelTests, BatchedMfccMelTest,
+    testing::Values(MelParams{257, 16000.0, 40, 125.0, 7500.0},
+                    MelParams{513, 16000.0, 64, 60.0, 7800.0},
+                    MelParams{129, 8800.0, 20, 125.0, 3800.0},
+                    // More channels than bins: some channels are always zero.
+                    MelParams{65, 8000.0, 40, 20.0, 4000.0}));
+
+TEST(BatchedMfccMelTest, CreateFailsOnInvalidParameters) {
+  EXPECT_FALSE(BatchedMelFilterbank::Create(257, 16000.0, 40, 7500.0, 125.0)
+                   .ok());
+  EXPECT_FALSE(BatchedMelFilterbank::Create(257, 16000.0, 0, 125.0, 7500.0)
+                   .ok());
+  EXPECT_FALSE(BatchedMfcc::Create(257, 16000.0, 40, 125.0, 7500.0, 0).ok());
+  EXPECT_FALSE(BatchedMfcc::Create(257, 16000.0, 40, 125.0, 7500.0, 41).ok());
+}
+
+// Benchmarks of the typical 40 channel configuration of speech features on
+// 16 kHz audio, with spectra of 25 ms (257 bins) or 50 ms (513 bins) frames.
+// Arg: input length.
+
+void BM_MelFilterbankPerFrame(benchmark::State& state) {
+  audio_dsp::MelFilterbank mel_filterbank;
+  CHECK(mel_filterbank.Initialize(state.range(0), 16000.0, 40, 125.0, 7500.0));
+  const Matrix input = MakeSquaredMagnitudes(state.range(0), kNumFrames);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComputePerFrame(mel_filterbank, input));
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+BENCHMARK(BM_MelFilterbankPerFrame)->Arg(257)->Arg(513);
+
+void BM_BatchedMelFilterbank(benchmark::State& state) {
+  auto mel_filterbank_or =
+      BatchedMelFilterbank::Create(state.range(0), 16000.0, 40, 125.0, 7500.0);
+  CHECK(mel_filterbank_or.ok());
+  const Matrix input = MakeSquaredMagnitudes(state.range(0), kNumFrames);
+  Matrix output;
+  for (auto _ : state) {
+    mel_filterbank_or.value()->Compute(input, &output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+BENCHMARK(BM_BatchedMelFilterbank)->Arg(257)->Arg(513);
+
+void BM_MfccPerFrame(benchmark::State& state) {
+  audio_dsp::Mfcc mfcc;
+  mfcc.set_filterbank_channel_count(40);
+  mfcc.set_lower_frequency_limit(125.0);
+  mfcc.set_upper_frequency_limit(7500.0);
+  mfcc.set_dct_coefficient_count(13);
+  CHECK(mfcc.Initialize(state.range(0), 16000.0));
+  const Matrix input = MakeSquaredMagnitudes(state.range(0), kNumFrames);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(ComputePerFrame(mfcc, input));
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+BENCHMARK(BM_MfccPerFrame)->Arg(257)->Arg(513);
+
+void BM_BatchedMfcc(benchmark::State& state) {
+  auto mfcc_or =
+      BatchedMfcc::Create(state.range(0), 16000.0, 40, 125.0, 7500.0, 13);
+  CHECK(mfcc_or.ok());
+  const Matrix input = MakeSquaredMagnitudes(state.range(0), kNumFrames);
+  Matrix output;
+  for (auto _ : state) {
+    mfcc_or.value()->Compute(input, &output);
+    benchmark::DoNotOptimize(output.data());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+BENCHMARK(BM_BatchedMfcc)->Arg(257)->Arg(513);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,240 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/audio/polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/substitute.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+namespace {
+
+// Sets @numerator / @denominator to the last convergent of the continued
+// fraction of @value whose denominator is at most @max_denominator.
+void RationalApproximation(double value, int max_denominator,
+                           int64* numerator, int64* denominator) {
+  // The two previous convergents.
+  int64 h0 = 0, h1 = 1;
+  int64 k0 = 1, k1 = 0;
+  double x = value;
+  while (x < 1e9) {
+    const int64 a = static_cast<int64>(std::floor(x));
+    const int64 h2 = a * h1 + h0;
+    const int64 k2 = a * k1 + k0;
+    if (k2 > max_denominator) {
+      break;
+    }
+    h0 = h1;
+    h1 = h2;
+    k0 = k1;
+    k1 = k2;
+    const double fraction = x - a;
+    if (fraction < 1e-9) {
+      break;
+    }
+    x = 1.0 / fraction;
+  }
+  *numerator = h1;
+  *denominator = k1;
+}
+
+// The modified Bessel function of the first kind of order 0, from its power
+// series.
+double BesselI0(double x) {
+  const double y = 0.25 * x * x;
+  double term = 1.0;
+  double sum = 1.0;
+  for (int k = 1; term > 1e-12 * sum; ++k) {
+    term *= y / (static_cast<double>(k) * k);
+    sum += term;
+  }
+  return sum;
+}
+
+}  // namespace
+
+absl::StatusOr<std::unique_ptr<PolyphaseResampler>> PolyphaseResampler::Create(
+    double input_sample_rate, double output_sample_rate, int num_channels,
+    const PolyphaseResamplerParams& params) {
+  if (!(input_sample_rate > 0) || !(output_sample_rate > 0) ||
+      num_channels < 1) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Invalid input_sample_rate: $0, output_sample_rate: $1 or "
+        "num_channels: $2",
+        input_sample_rate, output_sample_rate, num_channels));
+  }
+  if (!(params.filter_radius_factor > 0) ||
+      !(params.cutoff_proportion > 0 && params.cutoff_proportion <= 1) ||
+      !(params.kaiser_beta >= 0) || params.max_denominator < 1) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Invalid filter_radius_factor: $0, cutoff_proportion: $1, "
+        "kaiser_beta: $2 or max_denominator: $3",
+        params.filter_radius_factor, params.cutoff_proportion,
+        params.kaiser_beta, params.max_denominator));
+  }
+
+  // The output samples are every downsampling_factor / upsampling_factor
+  // input samples.
+  int64 downsampling_factor;
+  int64 upsampling_factor;
+  RationalApproximation(input_sample_rate / output_sample_rate,
+                        params.max_denominator, &downsampling_factor,
+                        &upsampling_factor);
+  if (downsampling_factor < 1 ||
+      downsampling_factor > std::numeric_limits<int>::max()) {
+    return absl::InvalidArgumentError(absl::Substitute(
+        "Cannot resample from $0 Hz to $1 Hz with at most $2 phases",
+        input_sample_rate, output_sample_rate, params.max_denominator));
+  }
+
+  // The filter, in units of input samples, low-passes at the lower of the
+  // Nyquist frequencies, and spans filter_radius_factor periods of the lower
+  // sample rate on each side.
+  const double rate_ratio =
+      std::min(1.0, static_cast<double>(upsampling_factor) /
+                        downsampling_factor);
+  const double radius = params.filter_radius_factor / rate_ratio;
+  const double cutoff = params.cutoff_proportion * rate_ratio;
+  const int half_taps = static_cast<int>(std::ceil(radius));
+  const int num_taps = 2 * half_taps;
+  const double window_normalization = 1.0 / BesselI0(params.kaiser_beta);
+
+  auto resampler = absl::WrapUnique(new PolyphaseResampler());
+  resampler->num_channels_ = num_channels;
+  resampler->downsampling_factor_ = downsampling_factor;
+  resampler->lookahead_ = params.fixed_latency ? 0 : half_taps;
+  Eigen::MatrixXf& coefficients = resampler->coefficients_;
+  coefficients.resize(num_taps, upsampling_factor);
+  for (int phase = 0; phase < upsampling_factor; ++phase) {
+    // Tap j weighs the input sample half_taps - 1 - j before the output
+    // sample, whatever the lookahead.
+    const double offset = static_cast<double>(phase) / upsampling_factor;
+    double sum = 0.0;
+    for (int j = 0; j < num_taps; ++j) {
+      const double x = offset + half_taps - 1 - j;
+      double tap = 0.0;
+      if (std::abs(x) < radius) {
+        const double u = x / radius;
+        const double window =
+            BesselI0(params.kaiser_beta * std::sqrt(1.0 - u * u)) *
+            window_normalization;
+        const double sinc_argument = M_PI * cutoff * x;
+        const double sinc = sinc_argument == 0.0
+                                ? 1.0
+                                : std::sin(sinc_argument) / sinc_argument;
+        tap = cutoff * sinc * window;
+      }
+      coefficients(j, phase) = tap;
+      sum += tap;
+    }
+    // Normalizes the gain of each phase, so that constant signals have no
+    // ripple at the phase rate.
+    if (sum > 0.0) {
+      coefficients.col(phase) /= sum;
+    }
+  }
+  resampler->Reset();
+  return resampler;
+}
+
+void PolyphaseResampler::ProcessSamples(const Matrix& input, Matrix* output) {
+  CHECK_EQ(input.rows(), num_channels_);
+  BufferSamples(&input, input.cols());
+  OutputSamples(output);
+}
+
+void PolyphaseResampler::Flush(Matrix* output) {
+  BufferSamples(nullptr, lookahead_);
+  OutputSamples(output);
+  Reset();
+}
+
+void PolyphaseResampler::Reset() {
+  // The zeros before the signal, up to the first tap of the first output.
+  buffer_start_ = lookahead_ - num_taps() + 1;
+  num_buffered_ = 0;
+  BufferSamples(nullptr, -buffer_start_);
+  next_base_ = 0;
+  next_phase_ = 0;
+}
+
+void PolyphaseResampler::BufferSamples(const Matrix* input, int num_samples) {
+  const int size = num_buffered_ + num_samples;
+  if (size > buffer_.rows()) {
+    buffer_.conservativeResize(std::max<int>(size, 2 * buffer_.rows()),
+                               num_channels_);
+  }
+  if (input) {
+    // Deinterleaves the channels.
+    buffer_.middleRows(num_buffered_, num_samples) = input->transpose();
+  } else {
+    buffer_.middleRows(num_buffered_, num_samples).setZero();
+  }
+  num_buffered_ = size;
+}
+
+void PolyphaseResampler::OutputSamples(Matrix* output) {
+  const int num_phases = upsampling_factor();
+  const int taps = num_taps();
+  // The outputs at t input samples are output once the input sample
+  // floor(t) + lookahead_ is buffered, that is for
+  // t < end_base = buffer_start_ + num_buffered_ - lookahead_.
+  const int64 end_base = buffer_start_ + num_buffered_ - lookahead_;
+  const int64 num_remaining_phases =
+      (end_base - next_base_) * num_phases - next_phase_;
+  const int64 num_outputs =
+      num_remaining_phases > 0
+          ? (num_remaining_phases + downsampling_factor_ - 1) /
+                downsampling_factor_
+          : 0;
+  output->resize(num_channels_, num_outputs);
+
+  const int base_step = downsampling_factor_ / num_phases;
+  const int phase_step = downsampling_factor_ % num_phases;
+  for (int64 i = 0; i < num_outputs; ++i) {
+    const int first = next_base_ + lookahead_ - taps + 1 - buffer_start_;
+    const auto coefficients = coefficients_.col(next_phase_);
+    for (int channel = 0; channel < num_channels_; ++channel) {
+      (*output)(channel, i) =
+          buffer_.col(channel).segment(first, taps).dot(coefficients);
+    }
+    next_base_ += base_step;
+    next_phase_ += phase_step;
+    if (next_phase_ >= num_phases) {
+      next_phase_ -= num_phases;
+      ++next_base_;
+    }
+  }
+
+  // Discards the samples before the first tap of the next output.
+  const int64 first_needed = next_base_ + lookahead_ - taps + 1 - buffer_start_;
+  const int num_discarded =
+      std::min<int64>(std::max<int64>(first_needed, 0), num_buffered_);
+  if (num_discarded > 0) {
+    for (int channel = 0; channel < num_channels_; ++channel) {
+      float* samples = buffer_.col(channel).data();
+      std::copy(samples + num_discarded, samples + num_buffered_, samples);
+    }
+    buffer_start_ += num_discarded;
+    num_buffered_ -= num_discarded;
+  }
+}
+
+}  // namespace mediapipe
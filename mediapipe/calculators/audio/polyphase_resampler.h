@@ -0,0 +1,128 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_AUDIO_POLYPHASE_RESAMPLER_H_
+#define MEDIAPIPE_CALCULATORS_AUDIO_POLYPHASE_RESAMPLER_H_
+
+#include <memory>
+
+#include "Eigen/Core"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/statusor.h"
+
+namespace mediapipe {
+
+// Parameters of the Kaiser windowed sinc filter of PolyphaseResampler. The
+// defaults are those of audio_dsp::QResamplerParams.
+struct PolyphaseResamplerParams {
+  // Radius of the filter in units of the lower of the input and output
+  // sample periods. The filter has about 2 * filter_radius_factor taps per
+  // output sample when upsampling, more when downsampling.
+  double filter_radius_factor = 5.0;
+  // Cutoff frequency of the anti-aliasing filter, as a proportion of the
+  // lower of the input and output Nyquist frequencies.
+  double cutoff_proportion = 0.9;
+  // The Kaiser beta parameter of the window of the filter.
+  double kaiser_beta = 5.658;
+  // The ratio of the input and output sample rates is approximated by a
+  // rational whose denominator, the number of phases of the filter, is at
+  // most max_denominator.
+  int max_denominator = 2000;
+  // If false, the output signal is aligned with the input signal, so that
+  // the outputs need input samples up to the filter radius ahead of them, and
+  // the last ones are output by Flush().
+  // If true, the output signal is delayed by delay_samples() input samples,
+  // so that each output is computed as soon as the input sample at its time
+  // is received: after n input samples, ceil(n * output_sample_rate /
+  // input_sample_rate) samples have been output, whatever the packets, and
+  // Flush() outputs nothing.
+  bool fixed_latency = false;
+};
+
+// Resamples multichannel signals by a rational factor with a polyphase FIR
+// filter: for each of the phases of the output samples relative to the input
+// samples, the taps of the filter are precomputed, so that each output sample
+// of each channel is a dot product of a window of input samples with the taps
+// of its phase.
+//
+// The channels are buffered in planar layout, so that the dot products run
+// over contiguous samples and are vectorized by Eigen whatever the number of
+// channels.
+//
+// Not thread-safe.
+class PolyphaseResampler {
+ public:
+  // Returns an error if the sample rates, the number of channels or the
+  // parameters are invalid.
+  static absl::StatusOr<std::unique_ptr<PolyphaseResampler>> Create(
+      double input_sample_rate, double output_sample_rate, int num_channels,
+      const PolyphaseResamplerParams& params = {});
+
+  int num_channels() const { return num_channels_; }
+  // The number of taps of the filter of each phase.
+  int num_taps() const { return coefficients_.rows(); }
+  // The resampling factor is upsampling_factor() / downsampling_factor().
+  int upsampling_factor() const { return coefficients_.cols(); }
+  int downsampling_factor() const { return downsampling_factor_; }
+  // The delay of the output signal, in input samples: 0 unless
+  // params.fixed_latency.
+  int delay_samples() const { return num_taps() / 2 - lookahead_; }
+
+  // Resamples @input, whose columns are the samples of num_channels()
+  // channels, and sets @output to the resulting samples. The samples
+  // depending on future input samples are output by the following calls.
+  void ProcessSamples(const Matrix& input, Matrix* output);
+
+  // Sets @output to the remaining samples, as if the input was followed by
+  // zeros, and resets the resampler.
+  void Flush(Matrix* output);
+
+  // Resets the resampler to its initial state, forgetting past samples.
+  void Reset();
+
+ private:
+  PolyphaseResampler() = default;
+
+  // Appends @num_samples samples to the buffer, zeros if @input is null.
+  void BufferSamples(const Matrix* input, int num_samples);
+  // Computes into @output the samples whose input samples are all buffered,
+  // and discards the buffered samples no longer needed.
+  void OutputSamples(Matrix* output);
+
+  int num_channels_ = 0;
+  int downsampling_factor_ = 1;
+  // The taps of an output sample at time t in input samples run over the
+  // input samples floor(t) + lookahead_ - num_taps() + 1 to
+  // floor(t) + lookahead_: num_taps() / 2, or 0 if params.fixed_latency.
+  int lookahead_ = 0;
+  // The taps of phase p, for the output samples at p / upsampling_factor()
+  // past an input sample, in column p.
+  Eigen::MatrixXf coefficients_;
+
+  // The buffered input samples, one channel per column, the first one being
+  // input sample buffer_start_ (negative for the zeros initially buffered).
+  Eigen::MatrixXf buffer_;
+  int num_buffered_ = 0;
+  int64 buffer_start_ = 0;
+
+  // The next output sample is at input time next_base_ +
+  // next_phase_ / upsampling_factor().
+  int64 next_base_ = 0;
+  int next_phase_ = 0;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_AUDIO_POLYPHASE_RESAMPLER_H_
@@ -0,0 +1,322 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/audio/polyphase_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "audio/dsp/resampler_q.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr double kToneFrequency = 1000.0;
+constexpr double kToneAmplitude = 0.5;
+
+// Returns @num_samples samples of a tone in @num_channels channels, of
+// opposite phases in odd channels.
+Matrix MakeTone(double sample_rate, int num_channels, int num_samples) {
+  Matrix tone(num_channels, num_samples);
+  for (int i = 0; i < num_samples; ++i) {
+    const float sample = kToneAmplitude * std::sin(2 * M_PI * kToneFrequency *
+                                                   i / sample_rate);
+    for (int channel = 0; channel < num_channels; ++channel) {
+      tone(channel, i) = channel % 2 == 0 ? sample : -sample;
+    }
+  }
+  return tone;
+}
+
+// Returns the signal-to-noise ratio in dB of @resampled, the first channel
+// of MakeTone() resampled to @sample_rate with a delay of @delay seconds,
+// ignoring the samples near its ends affected by the zeros around the tone.
+double ToneSnr(const std::vector<float>& resampled, double sample_rate,
+               double delay) {
+  const int kMargin = 0.01 * sample_rate;
+  double signal_energy = 0.0;
+  double noise_energy = 0.0;
+  for (int i = kMargin; i + kMargin < resampled.size(); ++i) {
+    const double expected =
+        kToneAmplitude *
+        std::sin(2 * M_PI * kToneFrequency * (i / sample_rate - delay));
+    signal_energy += expected * expected;
+    noise_energy += (resampled[i] - expected) * (resampled[i] - expected);
+  }
+  return 10.0 * std::log10(signal_energy / noise_energy);
+}
+
+// Resamples @input with @resampler in packets of @packet_size samples, and
+// returns the concatenated output including the flushed samples.
+Matrix ResampleInPackets(PolyphaseResampler* resampler, const Matrix& input,
+                         int packet_size, std::vector<int>* output_sizes) {
+  std::vector<Matrix> outputs;
+  int num_output_samples = 0;
+  for (int i = 0; i < input.cols(); i += packet_size) {
+    outputs.emplace_back();
+    resampler->ProcessSamples(
+        input.middleCols(i, std::min<int>(packet_size, input.cols() - i)),
+        &outputs.back());
+    num_output_samples += outputs.back().cols();
+    if (output_sizes) {
+      output_sizes->push_back(num_output_samples);
+    }
+  }
+  outputs.emplace_back();
+  resampler->Flush(&outputs.back());
+  num_output_samples += outputs.back().cols();
+  Matrix output(input.rows(), num_output_samples);
+  int column = 0;
+  for (const Matrix& samples : outputs) {
+    output.middleCols(column, samples.cols()) = samples;
+    column += samples.cols();
+  }
+  return output;
+}
+
+std::vector<float> Row(const Matrix& matrix, int row) {
+  std::vector<float> samples(matrix.cols());
+  for (int i = 0; i < matrix.cols(); ++i) {
+    samples[i] = matrix(row, i);
+  }
+  return samples;
+}
+
+struct ResamplingTestCase {
+  double input_sample_rate;
+  double output_sample_rate;
+  PolyphaseResamplerParams params;
+  double min_snr;
+};
+
+class PolyphaseResamplerTest
+    : public testing::TestWithParam<ResamplingTestCase> {};
+
+TEST_P(PolyphaseResamplerTest, ResamplesTones) {
+  const ResamplingTestCase& test_case = GetParam();
+  auto resampler_or = PolyphaseResampler::Create(
+      test_case.input_sample_rate, test_case.output_sample_rate,
+      /*num_channels=*/2, test_case.params);
+  MP_ASSERT_OK(resampler_or);
+  PolyphaseResampler* resampler = resampler_or.value().get();
+
+  // One second in packets of 10 ms.
+  const int num_samples = test_case.input_sample_rate;
+  const Matrix input =
+      MakeTone(test_case.input_sample_rate, /*num_channels=*/2, num_samples);
+  std::vector<int> output_sizes;
+  const Matrix output =
+      ResampleInPackets(resampler, input, num_samples / 100, &output_sizes);
+
+  EXPECT_EQ(output.cols(),
+            std::ceil(static_cast<double>(num_samples) *
+                      resampler->upsampling_factor() /
+                      resampler->downsampling_factor()));
+  const double delay =
+      resampler->delay_samples() / test_case.input_sample_rate;
+  EXPECT_GT(ToneSnr(Row(output, 0), test_case.output_sample_rate, delay),
+            test_case.min_snr);
+  // The channels are resampled independently.
+  EXPECT_EQ(output.row(1), -output.row(0));
+
+  if (test_case.params.fixed_latency) {
+    // All the samples are output as soon as possible.
+    for (int i = 0; i < output_sizes.size(); ++i) {
+      EXPECT_EQ(output_sizes[i],
+                std::ceil(static_cast<double>(num_samples / 100 * (i + 1)) *
+                          resampler->upsampling_factor() /
+                          resampler->downsampling_factor()));
+    }
+  }
+}
+
+PolyphaseResamplerParams LowQuality(bool fixed_latency) {
+  PolyphaseResamplerParams params;
+  params.filter_radius_factor = 3.0;
+  params.cutoff_proportion = 0.8;
+  params.kaiser_beta = 4.0;
+  params.fixed_latency = fixed_latency;
+  return params;
+}
+
+PolyphaseResamplerParams MediumQuality(bool fixed_latency) {
+  PolyphaseResamplerParams params;
+  params.fixed_latency = fixed_latency;
+  return params;
+}
+
+PolyphaseResamplerParams HighQuality(bool fixed_latency) {
+  PolyphaseResamplerParams params;
+  params.filter_radius_factor = 12.0;
+  params.cutoff_proportion = 0.94;
+  params.kaiser_beta = 9.0;
+  params.fixed_latency = fixed_latency;
+  return params;
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    PolyphaseResamplerTests, PolyphaseResamplerTest,
+    testing::ValuesIn(std::vector<ResamplingTestCase>{
+        {48000.0, 16000.0, LowQuality(false), 38.0},
+        {48000.0, 16000.0, MediumQuality(false), 50.0},
+        {48000.0, 16000.0, HighQuality(false), 85.0},
+        {44100.0, 16000.0, MediumQuality(false), 50.0},
+        {44100.0, 16000.0, MediumQuality(true), 50.0},
+        {16000.0, 44100.0, MediumQuality(false), 50.0},
+        {16000.0, 48000.0, LowQuality(true), 38.0},
+        {16000.0, 48000.0, HighQuality(true), 85.0},
+        {8000.0, 22050.0, HighQuality(false), 85.0}}));
+
+TEST(PolyphaseResamplerTest, OutputDoesNotDependOnPacketSizes) {
+  auto resampler_or = PolyphaseResampler::Create(44100.0, 16000.0, 1);
+  MP_ASSERT_OK(resampler_or);
+  const Matrix input = MakeTone(44100.0, /*num_channels=*/1, 4410);
+  const Matrix expected =
+      ResampleInPackets(resampler_or.value().get(), input, 4410, nullptr);
+  for (int packet_size : {1, 7, 441, 1000}) {
+    const Matrix output = ResampleInPackets(resampler_or.value().get(), input,
+                                            packet_size, nullptr);
+    ASSERT_EQ(output.cols(), expected.cols());
+    for (int i = 0; i < expected.cols(); ++i) {
+      EXPECT_FLOAT_EQ(output(0, i), expected(0, i));
+    }
+  }
+}
+
+TEST(PolyphaseResamplerTest, FixedLatencyDelaysOutput) {
+  PolyphaseResamplerParams params;
+  params.fixed_latency = true;
+  auto fixed_latency_or = PolyphaseResampler::Create(16000.0, 48000.0, 1,
+                                                     params);
+  MP_ASSERT_OK(fixed_latency_or);
+  auto aligned_or = PolyphaseResampler::Create(16000.0, 48000.0, 1);
+  MP_ASSERT_OK(aligned_or);
+  // The delay is a whole number of output samples.
+  const int delay = fixed_latency_or.value()->delay_samples() * 3;
+  ASSERT_GT(delay, 0);
+  EXPECT_EQ(aligned_or.value()->delay_samples(), 0);
+
+  const Matrix input = MakeTone(16000.0, /*num_channels=*/1, 1600);
+  const Matrix fixed_latency_output = ResampleInPackets(
+      fixed_latency_or.value().get(), input, 160, nullptr);
+  const Matrix aligned_output =
+      ResampleInPackets(aligned_or.value().get(), input, 160, nullptr);
+  ASSERT_EQ(fixed_latency_output.cols(), aligned_output.cols());
+  for (int i = delay; i < aligned_output.cols(); ++i) {
+    EXPECT_FLOAT_EQ(fixed_latency_output(0, i), aligned_output(0, i - delay));
+  }
+}
+
+TEST(PolyphaseResamplerTest, CreateFailsOnInvalidArguments) {
+  EXPECT_FALSE(PolyphaseResampler::Create(0.0, 16000.0, 1).ok());
+  EXPECT_FALSE(PolyphaseResampler::Create(16000.0, -1.0, 1).ok());
+  EXPECT_FALSE(PolyphaseResampler::Create(16000.0, 8000.0, 0).ok());
+  PolyphaseResamplerParams params;
+  params.cutoff_proportion = 1.5;
+  EXPECT_FALSE(PolyphaseResampler::Create(16000.0, 8000.0, 1, params).ok());
+  // Too large a factor for the number of phases.
+  params = PolyphaseResamplerParams();
+  params.max_denominator = 10;
+  EXPECT_FALSE(PolyphaseResampler::Create(1.0, 100.0, 1, params).ok());
+}
+
+// Benchmarks of streaming resampling of one second of a tone in packets of
+// 10 ms, also reporting the signal-to-noise ratio of the output.
+// Args: input and output sample rates, number of channels, and filter
+// quality for PolyphaseResampler (0 to 2 for low to high).
+
+void BM_PolyphaseResampler(benchmark::State& state) {
+  const double input_sample_rate = state.range(0);
+  const double output_sample_rate = state.range(1);
+  const int num_channels = state.range(2);
+  const PolyphaseResamplerParams params =
+      state.range(3) == 0   ? LowQuality(false)
+      : state.range(3) == 1 ? MediumQuality(false)
+                            : HighQuality(false);
+  auto resampler_or = PolyphaseResampler::Create(
+      input_sample_rate, output_sample_rate, num_channels, params);
+  CHECK(resampler_or.ok());
+  const Matrix input =
+      MakeTone(input_sample_rate, num_channels, input_sample_rate);
+  Matrix output;
+  for (auto _ : state) {
+    output = ResampleInPackets(resampler_or.value().get(), input,
+                               input_sample_rate / 100, nullptr);
+  }
+  state.SetItemsProcessed(state.iterations() * input.cols() * num_channels);
+  state.counters["snr_db"] = ToneSnr(Row(output, 0), output_sample_rate,
+                                     /*delay=*/0.0);
+}
+BENCHMARK(BM_PolyphaseResampler)
+    ->Args({48000, 16000, 1, 1})
+    ->Args({48000, 16000, 2, 1})
+    ->Args({44100, 16000, 1, 0})
+    ->Args({44100, 16000, 1, 1})
+    ->Args({44100, 16000, 1, 2})
+    ->Args({44100, 16000, 2, 1})
+    ->Args({16000, 48000, 1, 1});
+
+void BM_QResampler(benchmark::State& state) {
+  const double input_sample_rate = state.range(0);
+  const double output_sample_rate = state.range(1);
+  const int num_channels = state.range(2);
+  audio_dsp::QResamplerParams params;
+  params.max_denominator = 2000;
+  audio_dsp::QResampler<float> resampler(input_sample_rate, output_sample_rate,
+                                         num_channels, params);
+  CHECK(resampler.Valid());
+  const Matrix input =
+      MakeTone(input_sample_rate, num_channels, input_sample_rate);
+  const int packet_size = input_sample_rate / 100;
+  Matrix output;
+  for (auto _ : state) {
+    std::vector<Matrix> outputs;
+    int num_output_samples = 0;
+    for (int i = 0; i < input.cols(); i += packet_size) {
+      outputs.emplace_back(num_channels, 0);
+      resampler.ProcessSamples(Matrix(input.middleCols(i, packet_size)),
+                               &outputs.back());
+      num_output_samples += outputs.back().cols();
+    }
+    outputs.emplace_back(num_channels, 0);
+    resampler.Flush(&outputs.back());
+    num_output_samples += outputs.back().cols();
+    output.resize(num_channels, num_output_samples);
+    int column = 0;
+    for (const Matrix& samples : outputs) {
+      output.middleCols(column, samples.cols()) = samples;
+      column += samples.cols();
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * input.cols() * num_channels);
+  state.counters["snr_db"] = ToneSnr(Row(output, 0), output_sample_rate,
+                                     /*delay=*/0.0);
+}
+BENCHMARK(BM_QResampler)
+    ->Args({48000, 16000, 1})
+    ->Args({48000, 16000, 2})
+    ->Args({44100, 16000, 1})
+    ->Args({44100, 16000, 2})
+    ->Args({16000, 48000, 1});
+
+}  // namespace
+}  // namespace mediapipe
@@ -17,6 +17,7 @@
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.h"
 
 #include "audio/dsp/resampler_q.h"
+#include "mediapipe/framework/port/ret_check.h"
 
 using audio_dsp::Resampler;
 
@@ -71,7 +72,15 @@ absl::Status RationalFactorResampleCalculator::Open(CalculatorContext* cc) {
   num_channels_ = input_header.num_channels();
 
   // Don't create resamplers for pass-thru (sample rates are equal).
-  if (source_sample_rate_ != target_sample_rate_) {
+  if (source_sample_rate_ != target_sample_rate_ &&
+      resample_options.resampler_type() ==
+          RationalFactorResampleCalculatorOptions::POLYPHASE) {
+    ASSIGN_OR_RETURN(
+        polyphase_resampler_,
+        PolyphaseResampler::Create(
+            source_sample_rate_, target_sample_rate_, num_channels_,
+            PolyphaseResamplerParamsFromOptions(resample_options)));
+  } else if (source_sample_rate_ != target_sample_rate_) {
     resampler_.resize(num_channels_);
     for (auto& r : resampler_) {
       r = ResamplerFromOptions(source_sample_rate_, target_sample_rate_,
@@ -116,7 +125,14 @@ absl::Status RationalFactorResampleCalculator::ProcessInternal(
 
   cumulative_input_samples_ += input_frame.cols();
   std::unique_ptr<Matrix> output_frame(new Matrix(num_channels_, 0));
-  if (resampler_.empty()) {
+  if (polyphase_resampler_) {
+    RET_CHECK_EQ(input_frame.rows(), num_channels_);
+    if (should_flush) {
+      polyphase_resampler_->Flush(output_frame.get());
+    } else {
+      polyphase_resampler_->ProcessSamples(input_frame, output_frame.get());
+    }
+  } else if (resampler_.empty()) {
     // Sample rates were same for input and output; pass-thru.
     *output_frame = input_frame;
   } else {
@@ -185,6 +201,35 @@ RationalFactorResampleCalculator::ResamplerFromOptions(
   return resampler;
 }
 
+// static
+PolyphaseResamplerParams
+RationalFactorResampleCalculator::PolyphaseResamplerParamsFromOptions(
+    const RationalFactorResampleCalculatorOptions& options) {
+  using PolyphaseOptions =
+      RationalFactorResampleCalculatorOptions::PolyphaseResamplerOptions;
+  const auto& polyphase_options = options.polyphase_resampler_options();
+  PolyphaseResamplerParams params;
+  switch (polyphase_options.filter_quality()) {
+    case PolyphaseOptions::LOW:
+      params.filter_radius_factor = 3.0;
+      params.cutoff_proportion = 0.8;
+      params.kaiser_beta = 4.0;
+      break;
+    case PolyphaseOptions::MEDIUM:
+      // The defaults.
+      break;
+    case PolyphaseOptions::HIGH:
+      params.filter_radius_factor = 12.0;
+      params.cutoff_proportion = 0.94;
+      params.kaiser_beta = 9.0;
+      break;
+  }
+  // As for QResampler.
+  params.max_denominator = 2000;
+  params.fixed_latency = polyphase_options.fixed_latency();
+  return params;
+}
+
 REGISTER_CALCULATOR(RationalFactorResampleCalculator);
 
 }  // namespace mediapipe
@@ -22,6 +22,7 @@
 #include "Eigen/Core"
 #include "absl/strings/str_cat.h"
 #include "audio/dsp/resampler.h"
+#include "mediapipe/calculators/audio/polyphase_resampler.h"
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
@@ -38,7 +39,8 @@ namespace mediapipe {
 // a varying number of samples per frame.
 //
 // NOTE: This calculator uses QResampler, despite the name, which supersedes
-// RationalFactorResampler.
+// RationalFactorResampler, or PolyphaseResampler if so specified by
+// resampler_type.
 class RationalFactorResampleCalculator : public CalculatorBase {
  public:
   struct TestAccess;
@@ -72,6 +74,11 @@ class RationalFactorResampleCalculator : public CalculatorBase {
       const double source_sample_rate, const double target_sample_rate,
       const RationalFactorResampleCalculatorOptions& options);
 
+  // Returns the PolyphaseResampler parameters specified by the
+  // RationalFactorResampleCalculatorOptions proto.
+  static PolyphaseResamplerParams PolyphaseResamplerParamsFromOptions(
+      const RationalFactorResampleCalculatorOptions& options);
+
   // Does Timestamp bookkeeping and resampling common to Process() and
   // Close().  Returns FAIL if the resampler state becomes
   // inconsistent.
@@ -92,6 +99,8 @@ class RationalFactorResampleCalculator : public CalculatorBase {
   bool check_inconsistent_timestamps_;
   int num_channels_;
   std::vector<std::unique_ptr<ResamplerType>> resampler_;
+  // Resamples all the channels instead of resampler_ if set.
+  std::unique_ptr<PolyphaseResampler> polyphase_resampler_;
 };
 
 // Test-only access to RationalFactorResampleCalculator methods.
@@ -102,6 +111,11 @@ struct RationalFactorResampleCalculator::TestAccess {
     return RationalFactorResampleCalculator::ResamplerFromOptions(
         source_sample_rate, target_sample_rate, options);
   }
+  static PolyphaseResamplerParams PolyphaseResamplerParamsFromOptions(
+      const RationalFactorResampleCalculatorOptions& options) {
+    return RationalFactorResampleCalculator::
+        PolyphaseResamplerParamsFromOptions(options);
+  }
 };
 
 }  // namespace mediapipe
@@ -22,6 +22,7 @@
 
 #include "Eigen/Core"
 #include "audio/dsp/signal_vector_util.h"
+#include "mediapipe/calculators/audio/polyphase_resampler.h"
 #include "mediapipe/calculators/audio/rational_factor_resample_calculator.pb.h"
 #include "mediapipe/framework//tool/validate_type.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -169,6 +170,39 @@ class RationalFactorResampleCalculatorTest
     }
   }
 
+  // Checks that output values from the calculator are consistent with
+  // resampling the entire signal at once with a PolyphaseResampler.
+  void CheckPolyphaseOutputValues(double output_sample_rate) {
+    auto verification_resampler_or = PolyphaseResampler::Create(
+        input_sample_rate_, output_sample_rate, num_input_channels_,
+        RationalFactorResampleCalculator::TestAccess::
+            PolyphaseResamplerParamsFromOptions(options_));
+    MP_ASSERT_OK(verification_resampler_or);
+    Matrix resampled;
+    Matrix flushed;
+    verification_resampler_or.value()->ProcessSamples(
+        concatenated_input_samples_, &resampled);
+    verification_resampler_or.value()->Flush(&flushed);
+
+    for (int i = 0; i < num_input_channels_; ++i) {
+      std::vector<float> expected_resampled_data;
+      for (const Matrix* samples : {&resampled, &flushed}) {
+        for (int j = 0; j < samples->cols(); ++j) {
+          expected_resampled_data.push_back((*samples)(i, j));
+        }
+      }
+      std::vector<float> actual_resampled_data;
+      for (const Packet& packet : output().packets) {
+        Matrix output_frame_row = packet.Get<Matrix>().row(i);
+        actual_resampled_data.insert(
+            actual_resampled_data.end(), &output_frame_row(0),
+            &output_frame_row(0) + output_frame_row.cols());
+      }
+      EXPECT_EQ(expected_resampled_data.size(), actual_resampled_data.size());
+      ExpectVectorMostlyFloatEq(expected_resampled_data, actual_resampled_data);
+    }
+  }
+
   void CheckOutputHeaders(double output_sample_rate) {
     const TimeSeriesHeader& output_header =
         output().header.Get<TimeSeriesHeader>();
@@ -224,6 +258,56 @@ TEST_F(RationalFactorResampleCalculatorTest, UsesRationalFactorResampler) {
   CheckOutput(kUpsampleRate);
 }
 
+TEST_F(RationalFactorResampleCalculatorTest, PolyphaseUpsample) {
+  const double kUpsampleRate = input_sample_rate_ * 1.9;
+  options_.set_resampler_type(
+      RationalFactorResampleCalculatorOptions::POLYPHASE);
+  MP_ASSERT_OK(Run(kUpsampleRate));
+  CheckOutputLength(kUpsampleRate);
+  CheckOutputPacketTimestamps(kUpsampleRate);
+  CheckPolyphaseOutputValues(kUpsampleRate);
+  CheckOutputHeaders(kUpsampleRate);
+}
+
+TEST_F(RationalFactorResampleCalculatorTest, PolyphaseDownsample) {
+  const double kDownsampleRate = input_sample_rate_ / 1.9;
+  options_.set_resampler_type(
+      RationalFactorResampleCalculatorOptions::POLYPHASE);
+  options_.mutable_polyphase_resampler_options()->set_filter_quality(
+      RationalFactorResampleCalculatorOptions::PolyphaseResamplerOptions::
+          HIGH);
+  MP_ASSERT_OK(Run(kDownsampleRate));
+  CheckOutputLength(kDownsampleRate);
+  CheckOutputPacketTimestamps(kDownsampleRate);
+  CheckPolyphaseOutputValues(kDownsampleRate);
+  CheckOutputHeaders(kDownsampleRate);
+}
+
+TEST_F(RationalFactorResampleCalculatorTest,
+       PolyphaseFixedLatencyFollowsInputPackets) {
+  const double kUpsampleRate = input_sample_rate_ * 1.9;
+  options_.set_resampler_type(
+      RationalFactorResampleCalculatorOptions::POLYPHASE);
+  options_.mutable_polyphase_resampler_options()->set_fixed_latency(true);
+  MP_ASSERT_OK(Run(kUpsampleRate));
+  CheckPolyphaseOutputValues(kUpsampleRate);
+
+  // Each input packet of 10 * (i + 1) samples results in an output packet of
+  // 19 * (i + 1) samples with the same timestamp, and none is output at Close.
+  ASSERT_EQ(output().packets.size(), 5);
+  int num_input_samples = 0;
+  for (int i = 0; i < 5; ++i) {
+    const Packet& packet = output().packets[i];
+    EXPECT_EQ(packet.Get<Matrix>().cols(), 19 * (i + 1));
+    EXPECT_NEAR(packet.Timestamp().Value(),
+                kInitialTimestampOffsetMilliseconds +
+                    num_input_samples / input_sample_rate_ *
+                        Timestamp::kTimestampUnitsPerSecond,
+                1);
+    num_input_samples += 10 * (i + 1);
+  }
+}
+
 TEST_F(RationalFactorResampleCalculatorTest, PassthroughIfSampleRateUnchanged) {
   const double kUpsampleRate = input_sample_rate_;
   MP_ASSERT_OK(Run(kUpsampleRate));
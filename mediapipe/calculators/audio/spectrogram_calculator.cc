@@ -16,25 +16,181 @@
 #include <math.h>
 
 #include <complex>
+#include <cstring>
 #include <deque>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
+#include "absl/status/statusor.h"
 #include "absl/strings/string_view.h"
+#include "audio/dsp/number_util.h"
 #include "audio/dsp/spectrogram/spectrogram.h"
 #include "audio/dsp/window_functions.h"
 #include "mediapipe/calculators/audio/spectrogram_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_builder.h"
 #include "mediapipe/util/time_series_util.h"
+#include "pffft.h"
 
 namespace mediapipe {
 
 namespace {
 constexpr char kFrameDurationTag[] = "FRAME_DURATION";
 constexpr char kFrameOverlapTag[] = "FRAME_OVERLAP";
+
+// Computes the spectrograms of all the channels of a time series with pffft,
+// framed and zero-padded as audio_dsp::Spectrogram does for a single channel:
+// frames of window.size() samples every step_length samples, transformed
+// with an FFT of the smallest power of two length holding a frame.
+//
+// Each frame of all channels is computed before the next, from a single
+// buffer of the input samples, and written directly into the output matrices.
+class MultichannelSpectrogram {
+ public:
+  static absl::StatusOr<std::unique_ptr<MultichannelSpectrogram>> Create(
+      const std::vector<double>& window, int step_length, int num_channels) {
+    const int window_length = window.size();
+    RET_CHECK_GT(window_length, 0);
+    RET_CHECK_GT(step_length, 0);
+    // Unlike audio_dsp::Spectrogram, frames must not skip samples: only the
+    // samples from the start of the next frame on are buffered.
+    RET_CHECK_LE(step_length, window_length)
+        << "The PFFFT engine requires frame_overlap_seconds >= 0.";
+    const int fft_length = audio_dsp::NextPowerOfTwo(window_length);
+    // pffft only supports real transforms of multiples of 32 samples.
+    RET_CHECK_GE(fft_length, 32)
+        << "Frame of " << window_length << " samples too short for pffft.";
+    PFFFT_Setup* fft_setup = pffft_new_setup(fft_length, PFFFT_REAL);
+    RET_CHECK(fft_setup) << "pffft does not support an FFT of length "
+                         << fft_length;
+    return std::unique_ptr<MultichannelSpectrogram>(new MultichannelSpectrogram(
+        window, step_length, num_channels, fft_length, fft_setup));
+  }
+
+  ~MultichannelSpectrogram() { pffft_destroy_setup(fft_setup_); }
+
+  // Number of frequency bins of the output, fft_length / 2 + 1.
+  int output_frequency_channels() const { return fft_length_ / 2 + 1; }
+
+  // Appends @input, a num_channels x num_samples Matrix, to the buffered
+  // samples, and computes all the frames completed. The caller checks that
+  // @input has num_channels rows. Unless there are none,
+  // @output gets one output_frequency_channels() x num_frames matrix per
+  // channel: squared magnitudes, or complex values. Returns the number of
+  // frames.
+  template <class OutputMatrixType>
+  int ComputeSpectrogram(const Matrix& input,
+                         std::vector<OutputMatrixType>* output) {
+    const int num_input_samples = input.cols();
+    if (num_samples_ + num_input_samples > samples_.cols()) {
+      samples_.conservativeResize(Eigen::NoChange,
+                                  num_samples_ + num_input_samples);
+    }
+    samples_.middleCols(num_samples_, num_input_samples) = input;
+    num_samples_ += num_input_samples;
+
+    output->clear();
+    if (num_samples_ < window_length_) return 0;
+    const int num_frames = (num_samples_ - window_length_) / step_length_ + 1;
+    output->reserve(num_channels_);
+    for (int channel = 0; channel < num_channels_; ++channel) {
+      output->emplace_back(output_frequency_channels(), num_frames);
+    }
+    for (int frame = 0; frame < num_frames; ++frame) {
+      for (int channel = 0; channel < num_channels_; ++channel) {
+        TransformFrame(channel, frame * step_length_);
+        StoreFrame((*output)[channel].col(frame).data());
+      }
+    }
+
+    // Keeps the samples from the start of the next frame on.
+    const int consumed_samples = num_frames * step_length_;
+    num_samples_ -= consumed_samples;
+    std::memmove(samples_.data(),
+                 samples_.data() + consumed_samples * num_channels_,
+                 num_samples_ * num_channels_ * sizeof(float));
+    return num_frames;
+  }
+
+ private:
+  MultichannelSpectrogram(const std::vector<double>& window, int step_length,
+                          int num_channels, int fft_length,
+                          PFFFT_Setup* fft_setup)
+      : window_length_(window.size()),
+        step_length_(step_length),
+        num_channels_(num_channels),
+        fft_length_(fft_length),
+        fft_setup_(fft_setup),
+        window_(Eigen::Map<const Eigen::ArrayXd>(window.data(), window.size())
+                    .cast<float>()),
+        samples_(num_channels, 2 * window.size()),
+        num_samples_(0),
+        // Zero-padded past the window once and for all.
+        fft_input_(fft_length, 0.0f),
+        fft_output_(fft_length),
+        fft_work_(fft_length) {}
+
+  // Windows the frame of @channel starting at buffered sample @start, and
+  // transforms it into fft_output_.
+  void TransformFrame(int channel, int start) {
+    Eigen::Map<Eigen::ArrayXf>(fft_input_.data(), window_length_) =
+        samples_.block(channel, start, 1, window_length_)
+            .transpose()
+            .array() *
+        window_;
+    pffft_transform_ordered(fft_setup_, fft_input_.data(), fft_output_.data(),
+                            fft_work_.data(), PFFFT_FORWARD);
+  }
+
+  // Stores the squared magnitudes of fft_output_ into @column. pffft packs
+  // the real Nyquist value in place of the imaginary DC value.
+  void StoreFrame(float* column) const {
+    const int half_length = fft_length_ / 2;
+    column[0] = fft_output_[0] * fft_output_[0];
+    column[half_length] = fft_output_[1] * fft_output_[1];
+    Eigen::Map<Eigen::ArrayXf>(column + 1, half_length - 1) =
+        Eigen::Map<const Eigen::Array<float, 2, Eigen::Dynamic>>(
+            fft_output_.data() + 2, 2, half_length - 1)
+            .square()
+            .colwise()
+            .sum()
+            .transpose();
+  }
+
+  // Stores the complex values of fft_output_ into @column, conjugated to
+  // follow the sign convention of audio_dsp::Spectrogram.
+  void StoreFrame(std::complex<float>* column) const {
+    const int half_length = fft_length_ / 2;
+    column[0] = std::complex<float>(fft_output_[0], 0.0f);
+    column[half_length] = std::complex<float>(fft_output_[1], 0.0f);
+    for (int i = 1; i < half_length; ++i) {
+      column[i] =
+          std::complex<float>(fft_output_[2 * i], -fft_output_[2 * i + 1]);
+    }
+  }
+
+  const int window_length_;
+  const int step_length_;
+  const int num_channels_;
+  const int fft_length_;
+  PFFFT_Setup* const fft_setup_;
+  const Eigen::ArrayXf window_;
+  // The buffered input samples, from the start of the next frame on, in the
+  // first num_samples_ columns.
+  Matrix samples_;
+  int num_samples_;
+  // pffft requires 16 byte aligned buffers.
+  std::vector<float, Eigen::aligned_allocator<float>> fft_input_;
+  std::vector<float, Eigen::aligned_allocator<float>> fft_output_;
+  std::vector<float, Eigen::aligned_allocator<float>> fft_work_;
+};
+
 }  // namespace
 // MediaPipe Calculator for computing the "spectrogram" (short-time Fourier
 // transform squared-magnitude, by default) of a multichannel input
@@ -65,6 +221,9 @@ constexpr char kFrameOverlapTag[] = "FRAME_OVERLAP";
 // rounded to the nearest integer number of samples.  Conseqently, all output
 // frames will be based on the same number of input samples, and each
 // analysis frame will advance from its predecessor by the same time step.
+//
+// With fft_engine set to PFFFT, the frames of all the channels are computed
+// together with pffft instead of one audio_dsp::Spectrogram per channel.
 class SpectrogramCalculator : public CalculatorBase {
  public:
   static absl::Status GetContract(CalculatorContract* cc) {
@@ -198,6 +357,8 @@ class SpectrogramCalculator : public CalculatorBase {
   bool allow_multichannel_input_;
   // Vector of Spectrogram objects, one for each channel.
   std::vector<std::unique_ptr<audio_dsp::Spectrogram>> spectrogram_generators_;
+  // Replaces spectrogram_generators_ with the PFFFT engine.
+  std::unique_ptr<MultichannelSpectrogram> multichannel_spectrogram_;
   // Fixed scale factor applied to output values (regardless of type).
   double output_scale_;
 
@@ -284,14 +445,22 @@ absl::Status SpectrogramCalculator::Open(CalculatorContext* cc) {
 
   // Propagate settings down to the actual Spectrogram object.
   spectrogram_generators_.clear();
-  for (int i = 0; i < num_input_channels_; i++) {
-    spectrogram_generators_.push_back(
-        std::unique_ptr<audio_dsp::Spectrogram>(new audio_dsp::Spectrogram()));
-    spectrogram_generators_[i]->Initialize(window, frame_step_samples());
+  multichannel_spectrogram_.reset();
+  if (spectrogram_options.fft_engine() == SpectrogramCalculatorOptions::PFFFT) {
+    ASSIGN_OR_RETURN(multichannel_spectrogram_,
+                     MultichannelSpectrogram::Create(
+                         window, frame_step_samples(), num_input_channels_));
+    num_output_channels_ =
+        multichannel_spectrogram_->output_frequency_channels();
+  } else {
+    for (int i = 0; i < num_input_channels_; i++) {
+      spectrogram_generators_.push_back(std::unique_ptr<audio_dsp::Spectrogram>(
+          new audio_dsp::Spectrogram()));
+      spectrogram_generators_[i]->Initialize(window, frame_step_samples());
+    }
+    num_output_channels_ =
+        spectrogram_generators_[0]->output_frequency_channels();
   }
-
-  num_output_channels_ =
-      spectrogram_generators_[0]->output_frequency_channels();
   std::unique_ptr<TimeSeriesHeader> output_header(
       new TimeSeriesHeader(input_header));
   // Store the actual sample rate of the input audio in the TimeSeriesHeader
@@ -340,7 +509,10 @@ absl::Status SpectrogramCalculator::Process(CalculatorContext* cc) {
 
   const Matrix& input_stream = cc->Inputs().Index(0).Get<Matrix>();
   if (input_stream.rows() != num_input_channels_) {
-    // TODO: return an error.
+    return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Number of input channels " << input_stream.rows()
+           << " doesn't match the " << num_input_channels_
+           << " channels of the input header.";
   }
 
   cumulative_input_samples_ += input_stream.cols();
@@ -357,9 +529,19 @@ absl::Status SpectrogramCalculator::ProcessVectorToOutput(
       new std::vector<OutputMatrixType>());
   std::vector<std::vector<typename OutputMatrixType::Scalar>> output_vectors;
 
+  int num_output_time_frames = 0;
+  if (multichannel_spectrogram_) {
+    // Compute the spectrograms of all the channels at once, then
+    // post-process them.
+    num_output_time_frames = multichannel_spectrogram_->ComputeSpectrogram(
+        input_stream, spectrogram_matrices.get());
+    for (OutputMatrixType& output_frames : *spectrogram_matrices) {
+      output_frames = output_scale_ * postprocess_output_fn(output_frames);
+    }
+  }
+
   // Compute a spectrogram for each channel.
-  int num_output_time_frames;
-  for (int channel = 0; channel < input_stream.rows(); ++channel) {
+  for (int channel = 0; channel < spectrogram_generators_.size(); ++channel) {
     output_vectors.clear();
 
     // Copy one row (channel) of the input matrix into the std::vector.
@@ -408,11 +590,11 @@ absl::Status SpectrogramCalculator::ProcessVectorToOutput(
                                  CurrentOutputTimestamp(cc));
     } else {
       cc->Outputs().Index(0).Add(
-          new OutputMatrixType(spectrogram_matrices->at(0)),
+          new OutputMatrixType(std::move(spectrogram_matrices->at(0))),
           CurrentOutputTimestamp(cc));
     }
-    cumulative_completed_frames_ += output_vectors.size();
-    last_completed_frames_ = output_vectors.size();
+    cumulative_completed_frames_ += num_output_time_frames;
+    last_completed_frames_ = num_output_time_frames;
     if (!use_local_timestamp_) {
       // In non-local timestamp mode the timestamp of the next packet will be
       // equal to CumulativeOutputTimestamp(). Inform the framework about this
@@ -16,12 +16,14 @@
 
 #include <cmath>
 #include <complex>
+#include <cstdlib>
 #include <memory>
 #include <numeric>
 #include <string>
 #include <vector>
 
 #include "Eigen/Core"
+#include "absl/status/statusor.h"
 #include "audio/dsp/number_util.h"
 #include "mediapipe/calculators/audio/spectrogram_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -33,6 +35,7 @@
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/util/time_series_test_util.h"
 
 namespace mediapipe {
@@ -846,6 +849,154 @@ TEST_F(SpectrogramCalculatorTest,
   }
 }
 
+// Runs a SpectrogramCalculator with @options on packets of @packet_sizes
+// samples of @num_channels channels of noise at 16 kHz, and returns its output
+// packets. The noise only depends on the packet sizes.
+absl::StatusOr<std::vector<Packet>> RunSpectrogram(
+    const SpectrogramCalculatorOptions& options, int num_channels,
+    const std::vector<int>& packet_sizes) {
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("SpectrogramCalculator");
+  node_config.add_input_stream("input_audio");
+  node_config.add_output_stream("output_spectrogram");
+  *node_config.mutable_options()->MutableExtension(
+      SpectrogramCalculatorOptions::ext) = options;
+  CalculatorRunner runner(node_config);
+  TimeSeriesHeader* header = new TimeSeriesHeader();
+  header->set_sample_rate(16000.0);
+  header->set_num_channels(num_channels);
+  runner.MutableInputs()->Index(0).header = Adopt(header);
+  std::srand(0);
+  int64 num_samples = 0;
+  for (int packet_size : packet_sizes) {
+    runner.MutableInputs()->Index(0).packets.push_back(
+        Adopt(new Matrix(Matrix::Random(num_channels, packet_size)))
+            .At(Timestamp(num_samples * 1000000 / 16000)));
+    num_samples += packet_size;
+  }
+  MP_RETURN_IF_ERROR(runner.Run());
+  return runner.Outputs().Index(0).packets;
+}
+
+// Expects the multichannel spectrograms in @actual and @expected to be equal,
+// but for float rounding.
+template <class OutputMatrixType>
+void ExpectSameSpectrograms(const Packet& actual, const Packet& expected) {
+  EXPECT_EQ(actual.Timestamp(), expected.Timestamp());
+  const auto& actual_matrices = actual.Get<std::vector<OutputMatrixType>>();
+  const auto& expected_matrices = expected.Get<std::vector<OutputMatrixType>>();
+  ASSERT_EQ(actual_matrices.size(), expected_matrices.size());
+  for (int channel = 0; channel < actual_matrices.size(); ++channel) {
+    ASSERT_EQ(actual_matrices[channel].rows(),
+              expected_matrices[channel].rows());
+    ASSERT_EQ(actual_matrices[channel].cols(),
+              expected_matrices[channel].cols());
+    EXPECT_TRUE(
+        actual_matrices[channel].isApprox(expected_matrices[channel], 1e-4f))
+        << "Channel " << channel;
+  }
+}
+
+class SpectrogramCalculatorFftEngineTest
+    : public testing::TestWithParam<SpectrogramCalculatorOptions::OutputType> {
+};
+
+TEST_P(SpectrogramCalculatorFftEngineTest, PffftMatchesAudioDsp) {
+  SpectrogramCalculatorOptions options;
+  options.set_frame_duration_seconds(0.025);
+  options.set_frame_overlap_seconds(0.015);
+  options.set_allow_multichannel_input(true);
+  options.set_output_type(GetParam());
+  options.set_output_scale(0.5);
+  // Packets shorter and longer than a frame, and a padded final packet.
+  const std::vector<int> packet_sizes = {100, 700, 30, 1600, 333};
+  const int num_channels = 3;
+  auto expected = RunSpectrogram(options, num_channels, packet_sizes);
+  MP_ASSERT_OK(expected);
+  options.set_fft_engine(SpectrogramCalculatorOptions::PFFFT);
+  auto actual = RunSpectrogram(options, num_channels, packet_sizes);
+  MP_ASSERT_OK(actual);
+
+  ASSERT_EQ(actual.value().size(), expected.value().size());
+  for (int i = 0; i < actual.value().size(); ++i) {
+    if (GetParam() == SpectrogramCalculatorOptions::COMPLEX) {
+      ExpectSameSpectrograms<Eigen::MatrixXcf>(actual.value()[i],
+                                               expected.value()[i]);
+    } else {
+      ExpectSameSpectrograms<Matrix>(actual.value()[i], expected.value()[i]);
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    SpectrogramCalculatorFftEngineTests, SpectrogramCalculatorFftEngineTest,
+    testing::Values(SpectrogramCalculatorOptions::SQUARED_MAGNITUDE,
+                    SpectrogramCalculatorOptions::LINEAR_MAGNITUDE,
+                    SpectrogramCalculatorOptions::DECIBELS,
+                    SpectrogramCalculatorOptions::COMPLEX));
+
+TEST_F(SpectrogramCalculatorTest, PffftSquaredMagnitudeOutputLooksRight) {
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(60.0 / input_sample_rate_);
+  options_.set_fft_engine(SpectrogramCalculatorOptions::PFFFT);
+  const std::vector<int> input_packet_sizes = {140, 40, 500};
+
+  InitializeGraph();
+  FillInputHeader();
+  SetupConstantInputPackets(input_packet_sizes);
+
+  MP_ASSERT_OK(Run());
+
+  CheckOutputHeadersAndTimestamps();
+  EXPECT_NEAR(output().packets[0].Get<Matrix>()(0, 0),
+              expected_dc_squared_magnitude_,
+              1e-5 * expected_dc_squared_magnitude_);
+}
+
+TEST_F(SpectrogramCalculatorTest, PffftFailsOnTooShortFrames) {
+  // An FFT of 16 samples.
+  options_.set_frame_duration_seconds(10.0 / input_sample_rate_);
+  options_.set_fft_engine(SpectrogramCalculatorOptions::PFFFT);
+
+  InitializeGraph();
+  FillInputHeader();
+  SetupConstantInputPackets({100});
+
+  EXPECT_FALSE(Run().ok());
+}
+
+TEST_F(SpectrogramCalculatorTest, PffftFailsOnNegativeOverlap) {
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(-20.0 / input_sample_rate_);
+  options_.set_fft_engine(SpectrogramCalculatorOptions::PFFFT);
+
+  InitializeGraph();
+  FillInputHeader();
+  SetupConstantInputPackets({500});
+
+  auto status = Run();
+  ASSERT_FALSE(status.ok());
+  EXPECT_THAT(status.message(),
+              testing::HasSubstr("frame_overlap_seconds >= 0"));
+}
+
+TEST_F(SpectrogramCalculatorTest, PffftFailsOnChannelCountMismatch) {
+  options_.set_frame_duration_seconds(100.0 / input_sample_rate_);
+  options_.set_fft_engine(SpectrogramCalculatorOptions::PFFFT);
+  options_.set_allow_multichannel_input(true);
+  num_input_channels_ = 2;
+
+  InitializeGraph();
+  FillInputHeader();
+  AppendInputPacket(new Matrix(Matrix::Ones(3, 500)),
+                    kInitialTimestampOffsetMicroseconds);
+
+  auto status = Run();
+  ASSERT_FALSE(status.ok());
+  EXPECT_THAT(status.message(),
+              testing::HasSubstr("doesn't match the 2 channels"));
+}
+
 void BM_ProcessDC(benchmark::State& state) {
   CalculatorGraphConfig::Node node_config;
   node_config.set_calculator("SpectrogramCalculator");
@@ -891,5 +1042,55 @@ void BM_ProcessDC(benchmark::State& state) {
 
 BENCHMARK(BM_ProcessDC);
 
+// Args: FFT engine, number of channels, sample rate.
+void BM_MultichannelSpectrogram(benchmark::State& state) {
+  const int num_channels = state.range(1);
+  const double sample_rate = state.range(2);
+  CalculatorGraphConfig::Node node_config;
+  node_config.set_calculator("SpectrogramCalculator");
+  node_config.add_input_stream("input_audio");
+  node_config.add_output_stream("output_spectrogram");
+  SpectrogramCalculatorOptions* options =
+      node_config.mutable_options()->MutableExtension(
+          SpectrogramCalculatorOptions::ext);
+  options->set_frame_duration_seconds(0.025);
+  options->set_frame_overlap_seconds(0.015);
+  options->set_allow_multichannel_input(true);
+  options->set_fft_engine(
+      static_cast<SpectrogramCalculatorOptions::FftEngine>(state.range(0)));
+
+  // 10 seconds of audio, in packets of 100 ms.
+  const int packet_size_samples = sample_rate / 10;
+  const int num_packets = 100;
+  const Matrix samples = Matrix::Random(num_channels, packet_size_samples);
+  for (auto _ : state) {
+    CalculatorRunner runner(node_config);
+    TimeSeriesHeader* header = new TimeSeriesHeader();
+    header->set_sample_rate(sample_rate);
+    header->set_num_channels(num_channels);
+    runner.MutableInputs()->Index(0).header = Adopt(header);
+    for (int i = 0; i < num_packets; ++i) {
+      runner.MutableInputs()->Index(0).packets.push_back(
+          MakePacket<Matrix>(samples).At(Timestamp(i * 100000)));
+    }
+    ASSERT_TRUE(runner.Run().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * num_packets *
+                          packet_size_samples * num_channels);
+}
+
+void MultichannelSpectrogramArgs(benchmark::internal::Benchmark* benchmark) {
+  for (int engine : {SpectrogramCalculatorOptions::AUDIO_DSP,
+                     SpectrogramCalculatorOptions::PFFFT}) {
+    for (int num_channels : {1, 2, 8}) {
+      for (int sample_rate : {16000, 48000}) {
+        benchmark->Args({engine, num_channels, sample_rate});
+      }
+    }
+  }
+}
+
+BENCHMARK(BM_MultichannelSpectrogram)->Apply(MultichannelSpectrogramArgs);
+
 }  // anonymous namespace
 }  // namespace mediapipe
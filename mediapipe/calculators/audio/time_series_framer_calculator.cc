@@ -15,9 +15,10 @@
 // Defines TimeSeriesFramerCalculator.
 #include <math.h>
 
-#include <deque>
+#include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "Eigen/Core"
 #include "audio/dsp/window_functions.h"
@@ -93,6 +94,17 @@ class TimeSeriesFramerCalculator : public CalculatorBase {
   // Constructs and emits framed output packets.
   void FrameOutput(CalculatorContext* cc);
 
+  // Column of buffer_ holding buffered sample @i, 0 being the oldest.
+  int BufferColumn(int i) const { return (buffer_start_ + i) % buffer_.cols(); }
+  // Reallocates buffer_ to hold at least @min_capacity samples.
+  void GrowBuffer(int min_capacity);
+  // Drops the @count oldest buffered samples.
+  void DropSamples(int count);
+  // Copies @count buffered samples, from sample @first, into the columns of
+  // @output starting at @column, multiplied by the window if @windowed.
+  void CopySamples(int first, int count, int column, bool windowed,
+                   Matrix* output) const;
+
   Timestamp CurrentOutputTimestamp() {
     if (use_local_timestamp_) {
       return current_timestamp_;
@@ -144,9 +156,15 @@ class TimeSeriesFramerCalculator : public CalculatorBase {
   Timestamp current_timestamp_;
   int num_channels_;
 
-  // Each entry in this deque consists of a single sample, i.e. a
-  // single column vector, and its timestamp.
-  std::deque<std::pair<Matrix, Timestamp>> sample_buffer_;
+  // Circular buffer of the input samples, one per column, so that framing
+  // copies blocks of columns instead of allocating a vector per sample.
+  // Buffered sample i, 0 being the oldest, is in column BufferColumn(i).
+  Matrix buffer_;
+  int buffer_start_;
+  int buffer_size_;
+  // Timestamps of the samples in buffer_, in the same columns. Only kept if
+  // use_local_timestamp_.
+  std::vector<Timestamp> buffer_timestamps_;
 
   bool use_window_;
   Matrix window_;
@@ -157,42 +175,86 @@ REGISTER_CALCULATOR(TimeSeriesFramerCalculator);
 
 void TimeSeriesFramerCalculator::EnqueueInput(CalculatorContext* cc) {
   const Matrix& input_frame = cc->Inputs().Index(0).Get<Matrix>();
+  const int num_samples = input_frame.cols();
+  if (buffer_size_ + num_samples > buffer_.cols()) {
+    GrowBuffer(buffer_size_ + num_samples);
+  }
+  // Copies the input in at most two blocks, before and after the end of
+  // buffer_.
+  for (int i = 0; i < num_samples;) {
+    const int column = BufferColumn(buffer_size_);
+    const int count =
+        std::min<int>(num_samples - i, buffer_.cols() - column);
+    buffer_.middleCols(column, count) = input_frame.middleCols(i, count);
+    if (use_local_timestamp_) {
+      for (int j = 0; j < count; ++j) {
+        buffer_timestamps_[column + j] =
+            CurrentSampleTimestamp(cc->InputTimestamp(), i + j);
+      }
+    }
+    i += count;
+    buffer_size_ += count;
+  }
+}
 
-  for (int i = 0; i < input_frame.cols(); ++i) {
-    sample_buffer_.emplace_back(std::make_pair(
-        input_frame.col(i), CurrentSampleTimestamp(cc->InputTimestamp(), i)));
+void TimeSeriesFramerCalculator::GrowBuffer(int min_capacity) {
+  const int capacity =
+      std::max<int>(min_capacity, 2 * static_cast<int>(buffer_.cols()));
+  Matrix buffer(num_channels_, capacity);
+  CopySamples(0, buffer_size_, 0, /*windowed=*/false, &buffer);
+  if (use_local_timestamp_) {
+    std::vector<Timestamp> timestamps(capacity);
+    for (int i = 0; i < buffer_size_; ++i) {
+      timestamps[i] = buffer_timestamps_[BufferColumn(i)];
+    }
+    buffer_timestamps_.swap(timestamps);
   }
+  buffer_.swap(buffer);
+  buffer_start_ = 0;
 }
 
-void TimeSeriesFramerCalculator::FrameOutput(CalculatorContext* cc) {
-  while (sample_buffer_.size() >=
-         frame_duration_samples_ + samples_still_to_drop_) {
-    while (samples_still_to_drop_ > 0) {
-      sample_buffer_.pop_front();
-      --samples_still_to_drop_;
+void TimeSeriesFramerCalculator::DropSamples(int count) {
+  buffer_start_ = BufferColumn(count);
+  buffer_size_ -= count;
+}
+
+void TimeSeriesFramerCalculator::CopySamples(int first, int count, int column,
+                                             bool windowed,
+                                             Matrix* output) const {
+  while (count > 0) {
+    const int source = BufferColumn(first);
+    const int block = std::min<int>(count, buffer_.cols() - source);
+    if (windowed) {
+      output->middleCols(column, block) =
+          buffer_.middleCols(source, block)
+              .cwiseProduct(window_.middleCols(column, block));
+    } else {
+      output->middleCols(column, block) = buffer_.middleCols(source, block);
     }
+    first += block;
+    column += block;
+    count -= block;
+  }
+}
+
+void TimeSeriesFramerCalculator::FrameOutput(CalculatorContext* cc) {
+  while (buffer_size_ >= frame_duration_samples_ + samples_still_to_drop_) {
+    DropSamples(samples_still_to_drop_);
+    samples_still_to_drop_ = 0;
     const int frame_step_samples = next_frame_step_samples();
     std::unique_ptr<Matrix> output_frame(
         new Matrix(num_channels_, frame_duration_samples_));
-    for (int i = 0; i < std::min(frame_step_samples, frame_duration_samples_);
-         ++i) {
-      output_frame->col(i) = sample_buffer_.front().first;
-      current_timestamp_ = sample_buffer_.front().second;
-      sample_buffer_.pop_front();
+    CopySamples(0, frame_duration_samples_, 0, use_window_,
+                output_frame.get());
+    if (use_local_timestamp_) {
+      current_timestamp_ =
+          buffer_timestamps_[BufferColumn(frame_duration_samples_ - 1)];
     }
-    const int frame_overlap_samples =
-        frame_duration_samples_ - frame_step_samples;
-    if (frame_overlap_samples > 0) {
-      for (int i = 0; i < frame_overlap_samples; ++i) {
-        output_frame->col(i + frame_step_samples) = sample_buffer_[i].first;
-        current_timestamp_ = sample_buffer_[i].second;
-      }
+    if (frame_step_samples < frame_duration_samples_) {
+      DropSamples(frame_step_samples);
     } else {
-      samples_still_to_drop_ = -frame_overlap_samples;
-    }
-
-    if (use_window_) {
-      *output_frame = (output_frame->array() * window_.array()).matrix();
+      DropSamples(frame_duration_samples_);
+      samples_still_to_drop_ = frame_step_samples - frame_duration_samples_;
     }
 
     cc->Outputs().Index(0).Add(output_frame.release(),
@@ -221,16 +283,15 @@ absl::Status TimeSeriesFramerCalculator::Process(CalculatorContext* cc) {
 }
 
 absl::Status TimeSeriesFramerCalculator::Close(CalculatorContext* cc) {
-  while (samples_still_to_drop_ > 0 && !sample_buffer_.empty()) {
-    sample_buffer_.pop_front();
-    --samples_still_to_drop_;
-  }
-  if (!sample_buffer_.empty() && pad_final_packet_) {
+  const int dropped_samples = std::min(samples_still_to_drop_, buffer_size_);
+  DropSamples(dropped_samples);
+  samples_still_to_drop_ -= dropped_samples;
+  if (buffer_size_ > 0 && pad_final_packet_) {
     std::unique_ptr<Matrix> output_frame(new Matrix);
     output_frame->setZero(num_channels_, frame_duration_samples_);
-    for (int i = 0; i < sample_buffer_.size(); ++i) {
-      output_frame->col(i) = sample_buffer_[i].first;
-      current_timestamp_ = sample_buffer_[i].second;
+    CopySamples(0, buffer_size_, 0, /*windowed=*/false, output_frame.get());
+    if (use_local_timestamp_) {
+      current_timestamp_ = buffer_timestamps_[BufferColumn(buffer_size_ - 1)];
     }
 
     cc->Outputs().Index(0).Add(output_frame.release(),
@@ -319,6 +380,12 @@ absl::Status TimeSeriesFramerCalculator::Open(CalculatorContext* cc) {
   }
   use_local_timestamp_ = framer_options.use_local_timestamp();
 
+  // Room for two frames: grows with the size of the input packets.
+  buffer_.resize(num_channels_, 2 * frame_duration_samples_);
+  buffer_start_ = 0;
+  buffer_size_ = 0;
+  if (use_local_timestamp_) buffer_timestamps_.resize(buffer_.cols());
+
   return absl::OkStatus();
 }
 
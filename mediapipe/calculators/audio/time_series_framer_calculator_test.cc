@@ -22,12 +22,16 @@
 #include "audio/dsp/window_functions.h"
 #include "mediapipe/calculators/audio/time_series_framer_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "absl/memory/memory.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/util/time_series_test_util.h"
 
@@ -326,6 +330,21 @@ TEST_F(TimeSeriesFramerCalculatorTest, VariableFrameSkip) {
   CheckOutput();
 }
 
+TEST_F(TimeSeriesFramerCalculatorTest, ShortOverlappingFramesHannWindow) {
+  // Frames of 16 samples with a step of 5 samples, from input packets of up
+  // to 200 samples, so that the buffered samples wrap around and the buffer
+  // grows several times.
+  options_.set_frame_duration_seconds(16.0 / input_sample_rate_);
+  options_.set_frame_overlap_seconds(11.0 / input_sample_rate_);
+  options_.set_window_function(TimeSeriesFramerCalculatorOptions::HANN);
+  // The final packet is not windowed.
+  options_.set_pad_final_packet(false);
+  MP_ASSERT_OK(Run());
+  // floor((1100 - 16) / 5) + 1 = 217 packets.
+  EXPECT_EQ(output().packets.size(), 217);
+  CheckOutput();
+}
+
 TEST_F(TimeSeriesFramerCalculatorTest, NoFinalPacketPadding) {
   options_.set_frame_duration_seconds(98.5 / input_sample_rate_);
   options_.set_pad_final_packet(false);
@@ -481,5 +500,44 @@ TEST_F(TimeSeriesFramerCalculatorTimestampingTest, UseCumulativeTimeStamp) {
   CheckOutputTimestamps();
 }
 
+// Frames 10 s of 8 channel audio at 48 kHz, in packets of 10 ms, into Hann
+// windowed frames of 25 ms every 10 ms.
+void BM_FrameAudio(benchmark::State& state) {
+  constexpr double kSampleRate = 48000.0;
+  constexpr int kNumChannels = 8;
+  constexpr int kPacketSamples = 480;
+  constexpr int kNumPackets = 1000;
+  const Matrix samples = Matrix::Random(kNumChannels, kPacketSamples);
+  for (auto _ : state) {
+    CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+        R"pb(
+          calculator: "TimeSeriesFramerCalculator"
+          input_stream: "samples"
+          output_stream: "frames"
+          options {
+            [mediapipe.TimeSeriesFramerCalculatorOptions.ext] {
+              frame_duration_seconds: 0.025
+              frame_overlap_seconds: 0.015
+              window_function: HANN
+            }
+          }
+        )pb"));
+    auto header = absl::make_unique<TimeSeriesHeader>();
+    header->set_sample_rate(kSampleRate);
+    header->set_num_channels(kNumChannels);
+    runner.MutableInputs()->Index(0).header = Adopt(header.release());
+    for (int i = 0; i < kNumPackets; ++i) {
+      runner.MutableInputs()->Index(0).packets.push_back(
+          MakePacket<Matrix>(samples).At(Timestamp(
+              round(i * kPacketSamples / kSampleRate *
+                    Timestamp::kTimestampUnitsPerSecond))));
+    }
+    CHECK(runner.Run().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPackets * kPacketSamples);
+}
+
+BENCHMARK(BM_FrameAudio);
+
 }  // namespace
 }  // namespace mediapipe
@@ -0,0 +1,261 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Defines VoiceActivityDetectionCalculator.
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "Eigen/Core"
+#include "audio/dsp/number_util.h"
+#include "mediapipe/calculators/audio/voice_activity_detection_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/time_series_util.h"
+#include "pffft.h"
+
+namespace mediapipe {
+
+namespace {
+constexpr char kAudioTag[] = "AUDIO";
+constexpr char kTensorsTag[] = "TENSORS";
+constexpr char kVoiceActivityTag[] = "VOICE_ACTIVITY";
+}  // namespace
+
+// Detects the packets of an audio stream with voice activity, cheaply enough
+// to gate a model running on the stream, e.g. with a GateCalculator, so that
+// it is skipped on silence and background noise.
+//
+// The channels of each packet are averaged, as
+// AverageTimeSeriesAcrossChannelsCalculator does, and the packet is analyzed
+// in sub-frames of sub_frame_duration_seconds. A sub-frame has voice activity
+// if both:
+// - its energy, the stabilized log of its mean squared sample as
+//   StabilizedLogCalculator computes it, in decibels relative to full scale,
+//   is at least energy_threshold_db, and
+// - the spectral flatness of its Hann windowed power spectrum is at most
+//   max_spectral_flatness, which tells harmonic sounds such as voiced speech
+//   from noise. The FFT is only run on the sub-frames loud enough, so that
+//   silence costs about one multiply-add per sample.
+// A packet has voice activity if any of its sub-frames has, or if one of the
+// hangover_packets previous packets has. Packets shorter than a sub-frame are
+// analyzed as a single sub-frame.
+//
+// Inputs (exactly one of):
+//   AUDIO - Matrix
+//     A time series with a TimeSeriesHeader, one channel per row.
+//   TENSORS - std::vector<Tensor>
+//     The audio frames output by AudioToTensorCalculator, without fft_size:
+//     a single float tensor of shape [num_channels, num_samples] with
+//     interleaved channels. Requires the sample_rate option.
+//
+// Outputs:
+//   VOICE_ACTIVITY - bool
+//     Whether the input packet has voice activity, at its timestamp.
+//
+// Example config:
+// node {
+//   calculator: "VoiceActivityDetectionCalculator"
+//   input_stream: "TENSORS:audio_tensors"
+//   output_stream: "VOICE_ACTIVITY:voice_activity"
+//   options {
+//     [mediapipe.VoiceActivityDetectionCalculatorOptions.ext] {
+//       sample_rate: 16000
+//       energy_threshold_db: -45
+//     }
+//   }
+// }
+class VoiceActivityDetectionCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    RET_CHECK(cc->Inputs().HasTag(kAudioTag) ^ cc->Inputs().HasTag(kTensorsTag))
+        << "Exactly one of the AUDIO and TENSORS input streams must be "
+           "connected.";
+    if (cc->Inputs().HasTag(kAudioTag)) {
+      cc->Inputs().Tag(kAudioTag).Set<Matrix>(
+          // Input stream with TimeSeriesHeader.
+      );
+    } else {
+      cc->Inputs().Tag(kTensorsTag).Set<std::vector<Tensor>>();
+    }
+    cc->Outputs().Tag(kVoiceActivityTag).Set<bool>();
+    return absl::OkStatus();
+  }
+
+  ~VoiceActivityDetectionCalculator() override {
+    if (fft_setup_) {
+      pffft_destroy_setup(fft_setup_);
+    }
+  }
+
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  // Returns whether the mono @samples have voice activity.
+  bool HasVoiceActivity(const Eigen::Ref<const Eigen::RowVectorXf>& samples);
+  // Returns the spectral flatness of the sub-frame @samples.
+  float SpectralFlatness(const Eigen::Ref<const Eigen::RowVectorXf>& samples);
+
+  int sub_frame_length_;
+  // The energy threshold, as a mean squared sample.
+  float min_mean_square_;
+  float stabilizer_;
+  float max_spectral_flatness_;
+  int hangover_packets_;
+  int remaining_hangover_packets_ = 0;
+
+  PFFFT_Setup* fft_setup_ = nullptr;
+  int fft_length_ = 0;
+  Eigen::ArrayXf window_;
+  Eigen::RowVectorXf mono_samples_;
+  // pffft requires 16 byte aligned buffers.
+  std::vector<float, Eigen::aligned_allocator<float>> fft_input_;
+  std::vector<float, Eigen::aligned_allocator<float>> fft_output_;
+  std::vector<float, Eigen::aligned_allocator<float>> fft_work_;
+  Eigen::ArrayXf power_spectrum_;
+};
+REGISTER_CALCULATOR(VoiceActivityDetectionCalculator);
+
+absl::Status VoiceActivityDetectionCalculator::Open(CalculatorContext* cc) {
+  const auto& options = cc->Options<VoiceActivityDetectionCalculatorOptions>();
+  double sample_rate;
+  if (cc->Inputs().HasTag(kAudioTag)) {
+    TimeSeriesHeader input_header;
+    MP_RETURN_IF_ERROR(time_series_util::FillTimeSeriesHeaderIfValid(
+        cc->Inputs().Tag(kAudioTag).Header(), &input_header));
+    sample_rate = input_header.sample_rate();
+  } else {
+    RET_CHECK(options.has_sample_rate())
+        << "sample_rate must be set with the TENSORS input stream.";
+    sample_rate = options.sample_rate();
+  }
+  RET_CHECK_GT(sample_rate, 0.0);
+  sub_frame_length_ =
+      std::round(options.sub_frame_duration_seconds() * sample_rate);
+  RET_CHECK_GT(sub_frame_length_, 0)
+      << "Invalid sub_frame_duration_seconds: "
+      << options.sub_frame_duration_seconds();
+  stabilizer_ = options.stabilizer();
+  RET_CHECK_GT(stabilizer_, 0.0f);
+  // 10 * log10(mean_square + stabilizer) >= energy_threshold_db.
+  min_mean_square_ =
+      std::pow(10.0f, options.energy_threshold_db() / 10.0f) - stabilizer_;
+  max_spectral_flatness_ = options.max_spectral_flatness();
+  hangover_packets_ = options.hangover_packets();
+  RET_CHECK_GE(hangover_packets_, 0);
+
+  if (max_spectral_flatness_ < 1.0f) {
+    // pffft only supports real transforms of multiples of 32 samples.
+    fft_length_ = audio_dsp::NextPowerOfTwo(std::max(sub_frame_length_, 32));
+    fft_setup_ = pffft_new_setup(fft_length_, PFFFT_REAL);
+    RET_CHECK(fft_setup_) << "pffft does not support an FFT of length "
+                          << fft_length_;
+    // Zero-padded past the sub-frame by SpectralFlatness().
+    fft_input_.resize(fft_length_);
+    fft_output_.resize(fft_length_);
+    fft_work_.resize(fft_length_);
+  }
+
+  cc->SetOffset(0);
+  return absl::OkStatus();
+}
+
+absl::Status VoiceActivityDetectionCalculator::Process(CalculatorContext* cc) {
+  if (cc->Inputs().HasTag(kAudioTag)) {
+    const Matrix& input = cc->Inputs().Tag(kAudioTag).Get<Matrix>();
+    mono_samples_ = input.colwise().mean();
+  } else {
+    const auto& tensors =
+        cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
+    RET_CHECK_EQ(tensors.size(), 1);
+    const Tensor& tensor = tensors[0];
+    RET_CHECK(tensor.element_type() == Tensor::ElementType::kFloat32);
+    RET_CHECK_EQ(tensor.shape().dims.size(), 2)
+        << "Expected audio frames of shape [num_channels, num_samples].";
+    auto view = tensor.GetCpuReadView();
+    mono_samples_ = Eigen::Map<const Matrix>(view.buffer<float>(),
+                                             tensor.shape().dims[0],
+                                             tensor.shape().dims[1])
+                        .colwise()
+                        .mean();
+  }
+  bool voice_activity = HasVoiceActivity(mono_samples_);
+  if (voice_activity) {
+    remaining_hangover_packets_ = hangover_packets_;
+  } else if (remaining_hangover_packets_ > 0) {
+    --remaining_hangover_packets_;
+    voice_activity = true;
+  }
+  cc->Outputs()
+      .Tag(kVoiceActivityTag)
+      .AddPacket(MakePacket<bool>(voice_activity).At(cc->InputTimestamp()));
+  return absl::OkStatus();
+}
+
+bool VoiceActivityDetectionCalculator::HasVoiceActivity(
+    const Eigen::Ref<const Eigen::RowVectorXf>& samples) {
+  const int num_samples = samples.size();
+  if (num_samples == 0) {
+    return false;
+  }
+  const int length = std::min(sub_frame_length_, num_samples);
+  for (int start = 0; start + length <= num_samples; start += length) {
+    const auto sub_frame = samples.segment(start, length);
+    if (sub_frame.squaredNorm() < min_mean_square_ * length) {
+      continue;
+    }
+    if (!fft_setup_ || SpectralFlatness(sub_frame) <= max_spectral_flatness_) {
+      return true;
+    }
+  }
+  return false;
+}
+
+float VoiceActivityDetectionCalculator::SpectralFlatness(
+    const Eigen::Ref<const Eigen::RowVectorXf>& samples) {
+  const int length = samples.size();
+  if (window_.size() != length) {
+    // Periodic Hann window, which only changes for the short packets.
+    const float phase_step = 2.0 * M_PI / length;
+    window_ =
+        0.5f -
+        0.5f * (Eigen::ArrayXf::LinSpaced(length, 0, length - 1) * phase_step)
+                   .cos();
+  }
+  Eigen::Map<Eigen::ArrayXf>(fft_input_.data(), length) =
+      samples.transpose().array() * window_;
+  std::fill(fft_input_.begin() + length, fft_input_.end(), 0.0f);
+  pffft_transform_ordered(fft_setup_, fft_input_.data(), fft_output_.data(),
+                          fft_work_.data(), PFFFT_FORWARD);
+  // The power of the bins between DC and Nyquist, which pffft packs first.
+  const int num_bins = fft_length_ / 2 - 1;
+  power_spectrum_ = Eigen::Map<const Eigen::Array<float, 2, Eigen::Dynamic>>(
+                        fft_output_.data() + 2, 2, num_bins)
+                        .square()
+                        .colwise()
+                        .sum()
+                        .transpose() +
+                    stabilizer_;
+  const float log_geometric_mean = power_spectrum_.log().mean();
+  return std::exp(log_geometric_mean) / power_spectrum_.mean();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,217 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Eigen/Core"
+#include "absl/strings/substitute.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr double kSampleRate = 16000.0;
+// 0.1 second packets.
+constexpr int kPacketSamples = 1600;
+
+// Returns @num_samples of a voiced speech like signal: the harmonics of
+// @pitch_hertz up to 4 kHz, decaying as 1 / k, at about -21 dBFS.
+Matrix HarmonicSignal(int num_channels, int num_samples, double pitch_hertz) {
+  Matrix signal = Matrix::Zero(num_channels, num_samples);
+  for (int k = 1; k * pitch_hertz < 4000.0; ++k) {
+    const double phase = 0.7 * k;
+    for (int i = 0; i < num_samples; ++i) {
+      signal.col(i).array() += static_cast<float>(
+          0.1 / k *
+          std::sin(2 * M_PI * pitch_hertz * k * i / kSampleRate + phase));
+    }
+  }
+  return signal;
+}
+
+// Returns white noise of standard deviation @scale.
+Matrix WhiteNoise(int num_channels, int num_samples, float scale) {
+  // Uniform noise has the standard deviation of its range / sqrt(12).
+  return Matrix::Random(num_channels, num_samples) * (scale * std::sqrt(3.0f));
+}
+
+CalculatorGraphConfig::Node MakeNodeConfig(const std::string& input_tag,
+                                           const std::string& options) {
+  return ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+      R"pb(
+        calculator: "VoiceActivityDetectionCalculator"
+        input_stream: "$0:input"
+        output_stream: "VOICE_ACTIVITY:voice_activity"
+        options {
+          [mediapipe.VoiceActivityDetectionCalculatorOptions.ext] { $1 }
+        }
+      )pb",
+      input_tag, options));
+}
+
+// Runs the calculator on the AUDIO packets @inputs, 0.1 second apart, and
+// returns the voice activity of each.
+std::vector<bool> RunOnAudio(const std::vector<Matrix>& inputs,
+                             const std::string& options = "") {
+  CalculatorRunner runner(MakeNodeConfig("AUDIO", options));
+  TimeSeriesHeader header;
+  header.set_sample_rate(kSampleRate);
+  header.set_num_channels(inputs[0].rows());
+  runner.MutableInputs()->Tag("AUDIO").header =
+      MakePacket<TimeSeriesHeader>(header);
+  for (int i = 0; i < inputs.size(); ++i) {
+    runner.MutableInputs()->Tag("AUDIO").packets.push_back(
+        MakePacket<Matrix>(inputs[i]).At(Timestamp(i * 100000)));
+  }
+  MP_EXPECT_OK(runner.Run());
+  std::vector<bool> voice_activity;
+  for (const Packet& packet :
+       runner.Outputs().Tag("VOICE_ACTIVITY").packets) {
+    voice_activity.push_back(packet.Get<bool>());
+  }
+  return voice_activity;
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, DetectsHarmonicSignal) {
+  EXPECT_THAT(
+      RunOnAudio({HarmonicSignal(1, kPacketSamples, 120.0),
+                  HarmonicSignal(1, kPacketSamples, 220.0),
+                  // Speech in 40 dB lower background noise.
+                  HarmonicSignal(1, kPacketSamples, 150.0) +
+                      WhiteNoise(1, kPacketSamples, 0.001f)}),
+      testing::ElementsAre(true, true, true));
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, RejectsSilence) {
+  EXPECT_THAT(RunOnAudio({Matrix::Zero(1, kPacketSamples),
+                          // -70 dBFS.
+                          WhiteNoise(1, kPacketSamples, 0.0003f)}),
+              testing::ElementsAre(false, false));
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, RejectsLoudNoiseByFlatness) {
+  const std::vector<Matrix> inputs = {WhiteNoise(1, kPacketSamples, 0.1f)};
+  EXPECT_THAT(RunOnAudio(inputs), testing::ElementsAre(false));
+  EXPECT_THAT(RunOnAudio(inputs, "max_spectral_flatness: 1"),
+              testing::ElementsAre(true));
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, EnergyThreshold) {
+  // About -21 dBFS.
+  const std::vector<Matrix> inputs = {HarmonicSignal(1, kPacketSamples, 120.0)};
+  EXPECT_THAT(RunOnAudio(inputs, "energy_threshold_db: -30"),
+              testing::ElementsAre(true));
+  EXPECT_THAT(RunOnAudio(inputs, "energy_threshold_db: -15"),
+              testing::ElementsAre(false));
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, DetectsShortBurst) {
+  // A single voiced sub-frame in silence.
+  Matrix input = Matrix::Zero(1, kPacketSamples);
+  input.middleCols(960, 320) = HarmonicSignal(1, 320, 150.0);
+  EXPECT_THAT(RunOnAudio({input}), testing::ElementsAre(true));
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, HangoverPackets) {
+  const Matrix voice = HarmonicSignal(1, kPacketSamples, 150.0);
+  const Matrix silence = Matrix::Zero(1, kPacketSamples);
+  EXPECT_THAT(RunOnAudio({voice, silence, silence, silence, voice, silence},
+                         "hangover_packets: 2"),
+              testing::ElementsAre(true, true, true, false, true, true));
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, TensorsMatchAudio) {
+  constexpr int kNumChannels = 2;
+  std::vector<Matrix> inputs = {
+      HarmonicSignal(kNumChannels, kPacketSamples, 150.0),
+      Matrix::Zero(kNumChannels, kPacketSamples),
+      WhiteNoise(kNumChannels, kPacketSamples, 0.1f)};
+  // Voice in a single channel, at half the level once averaged.
+  inputs.push_back(Matrix::Zero(kNumChannels, kPacketSamples));
+  inputs.back().row(1) = 2 * HarmonicSignal(1, kPacketSamples, 150.0);
+
+  CalculatorRunner runner(MakeNodeConfig("TENSORS", "sample_rate: 16000"));
+  for (int i = 0; i < inputs.size(); ++i) {
+    // The column major samples are interleaved, as in the tensors of
+    // AudioToTensorCalculator.
+    Tensor tensor(Tensor::ElementType::kFloat32,
+                  Tensor::Shape({kNumChannels, kPacketSamples}));
+    std::memcpy(tensor.GetCpuWriteView().buffer<float>(), inputs[i].data(),
+                inputs[i].size() * sizeof(float));
+    std::vector<Tensor> tensors;
+    tensors.push_back(std::move(tensor));
+    runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+        MakePacket<std::vector<Tensor>>(std::move(tensors))
+            .At(Timestamp(i * 100000)));
+  }
+  MP_ASSERT_OK(runner.Run());
+  const auto& packets = runner.Outputs().Tag("VOICE_ACTIVITY").packets;
+  ASSERT_EQ(packets.size(), inputs.size());
+  const std::vector<bool> expected = RunOnAudio(inputs);
+  EXPECT_THAT(expected, testing::ElementsAre(true, false, false, true));
+  for (int i = 0; i < packets.size(); ++i) {
+    EXPECT_EQ(packets[i].Timestamp(), Timestamp(i * 100000));
+    EXPECT_EQ(packets[i].Get<bool>(), expected[i]) << "at packet " << i;
+  }
+}
+
+TEST(VoiceActivityDetectionCalculatorTest, TensorsRequireSampleRate) {
+  CalculatorRunner runner(MakeNodeConfig("TENSORS", ""));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+// Analyzes 1 second packets, as those of an audio classifier, for 60
+// seconds. Arg: the percentage of packets with voice, the others being
+// silence at -70 dBFS.
+void BM_VoiceActivityDetection(benchmark::State& state) {
+  constexpr int kNumPackets = 60;
+  const int num_voiced_packets = kNumPackets * state.range(0) / 100;
+  const Matrix voice = HarmonicSignal(1, 16000, 150.0);
+  const Matrix silence = WhiteNoise(1, 16000, 0.0003f);
+  TimeSeriesHeader header;
+  header.set_sample_rate(kSampleRate);
+  header.set_num_channels(1);
+  for (auto _ : state) {
+    state.PauseTiming();
+    CalculatorRunner runner(MakeNodeConfig("AUDIO", ""));
+    runner.MutableInputs()->Tag("AUDIO").header =
+        MakePacket<TimeSeriesHeader>(header);
+    for (int i = 0; i < kNumPackets; ++i) {
+      runner.MutableInputs()->Tag("AUDIO").packets.push_back(
+          MakePacket<Matrix>(i < num_voiced_packets ? voice : silence)
+              .At(Timestamp(i * 1000000)));
+    }
+    state.ResumeTiming();
+    CHECK(runner.Run().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPackets * 16000);
+}
+BENCHMARK(BM_VoiceActivityDetection)->Arg(0)->Arg(20)->Arg(100);
+
+}  // namespace
+}  // namespace mediapipe
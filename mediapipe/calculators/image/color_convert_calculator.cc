@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -83,6 +84,9 @@ class ColorConvertCalculator : public CalculatorBase {
 
   absl::Status Open(CalculatorContext* cc) override {
     cc->SetOffset(TimestampDiff(0));
+    if (cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+      buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
+    }
     return absl::OkStatus();
   }
 
@@ -96,6 +100,9 @@ class ColorConvertCalculator : public CalculatorBase {
                                 ImageFormat::Format output_format,
                                 int open_cv_convert_code,
                                 CalculatorContext* cc);
+
+  // Allocates the output frames, if provided by the graph.
+  CpuImageBufferPool* buffer_pool_ = nullptr;
 };
 
 REGISTER_CALCULATOR(ColorConvertCalculator);
@@ -138,6 +145,7 @@ absl::Status ColorConvertCalculator::GetContract(CalculatorContract* cc) {
     cc->Outputs().Tag(kBgraOutTag).Set<ImageFrame>();
   }
 
+  cc->UseService(kCpuImageBufferPoolService).Optional();
   return absl::OkStatus();
 }
 
@@ -147,8 +155,8 @@ absl::Status ColorConvertCalculator::ConvertAndOutput(
     CalculatorContext* cc) {
   const cv::Mat& input_mat =
       formats::MatView(&cc->Inputs().Tag(input_tag).Get<ImageFrame>());
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(output_format, input_mat.cols, input_mat.rows));
+  std::unique_ptr<ImageFrame> output_frame =
+      NewImageFrame(buffer_pool_, output_format, input_mat.cols, input_mat.rows);
   cv::Mat output_mat = formats::MatView(output_frame.get());
   cv::cvtColor(input_mat, output_mat, open_cv_convert_code);
 
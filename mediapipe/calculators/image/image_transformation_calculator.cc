@@ -12,8 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+
 #include "mediapipe/calculators/image/image_transformation_calculator.pb.h"
+#include "mediapipe/calculators/image/image_transformation_utils.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/video_stream_header.h"
@@ -22,6 +26,7 @@
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/framework/timestamp.h"
 #include "mediapipe/gpu/scale_mode.pb.h"
 
@@ -100,6 +105,84 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
       return default_mode;
   }
 }
+
+// Applies @transformation with one OpenCV operation per step, for the images
+// that image_transformation::TransformImage doesn't support.
+void TransformImageWithOpenCv(
+    const ImageFrame& input,
+    const image_transformation::Transformation& transformation,
+    ImageFrame* output) {
+  const bool scale = transformation.scaled_width != input.Width() ||
+                     transformation.scaled_height != input.Height();
+  const bool pad =
+      transformation.canvas_width != transformation.scaled_width ||
+      transformation.canvas_height != transformation.scaled_height;
+  const bool rotate = transformation.rotate_around_center ||
+                      transformation.rotation_degrees == 90 ||
+                      transformation.rotation_degrees == 180 ||
+                      transformation.rotation_degrees == 270;
+  const bool flip =
+      transformation.flip_horizontally || transformation.flip_vertically;
+
+  // The last step writes to the output frame directly.
+  const cv::Mat input_mat = formats::MatView(&input);
+  cv::Mat output_mat = formats::MatView(output);
+  if (!scale && !pad && !rotate && !flip) {
+    input_mat.copyTo(output_mat);
+    return;
+  }
+
+  cv::Mat scaled_mat = input_mat;
+  if (scale) {
+    if (!pad && !rotate && !flip) scaled_mat = output_mat;
+    cv::resize(input_mat, scaled_mat,
+               cv::Size(transformation.scaled_width,
+                        transformation.scaled_height),
+               0, 0,
+               transformation.area_interpolation ? cv::INTER_AREA
+                                                 : cv::INTER_LINEAR);
+  }
+
+  cv::Mat canvas_mat = scaled_mat;
+  if (pad) {
+    if (!rotate && !flip) canvas_mat = output_mat;
+    const int bottom = transformation.canvas_height -
+                       transformation.scaled_height - transformation.pad_top;
+    const int right = transformation.canvas_width -
+                      transformation.scaled_width - transformation.pad_left;
+    cv::copyMakeBorder(scaled_mat, canvas_mat, transformation.pad_top, bottom,
+                       transformation.pad_left, right,
+                       transformation.replicate_padding ? cv::BORDER_REPLICATE
+                                                        : cv::BORDER_CONSTANT);
+  }
+
+  cv::Mat rotated_mat = canvas_mat;
+  if (rotate) {
+    if (!flip) rotated_mat = output_mat;
+    if (transformation.rotate_around_center) {
+      cv::Point2f src_center(canvas_mat.cols / 2.0, canvas_mat.rows / 2.0);
+      cv::Mat rotation_mat = cv::getRotationMatrix2D(
+          src_center, transformation.rotation_degrees, 1.0);
+      cv::warpAffine(canvas_mat, rotated_mat, rotation_mat,
+                     cv::Size(transformation.output_width,
+                              transformation.output_height));
+    } else if (transformation.rotation_degrees == 90) {
+      cv::rotate(canvas_mat, rotated_mat, cv::ROTATE_90_COUNTERCLOCKWISE);
+    } else if (transformation.rotation_degrees == 180) {
+      cv::rotate(canvas_mat, rotated_mat, cv::ROTATE_180);
+    } else {
+      cv::rotate(canvas_mat, rotated_mat, cv::ROTATE_90_CLOCKWISE);
+    }
+  }
+
+  if (flip) {
+    const int flip_code =
+        transformation.flip_horizontally && transformation.flip_vertically
+            ? -1
+            : transformation.flip_horizontally;
+    cv::flip(rotated_mat, output_mat, flip_code);
+  }
+}
 }  // namespace
 
 // Scales, rotates, and flips images horizontally or vertically.
@@ -168,6 +251,10 @@ mediapipe::ScaleMode_Mode ParseScaleMode(
 //   rotation_mode - (optional) Rotation in multiples of 90 degrees.
 //   flip_vertically, flip_horizontally - (optional) flip about x or y axis.
 //   scale_mode - (optional) Stretch, Fit, or Fill and Crop
+//   use_fused_cpu_transform - (optional) Transform 8-bit CPU images in a
+//     single pass rather than with OpenCV.
+//   cpu_num_threads - (optional) Number of threads the fused CPU path is split
+//     between.
 //
 // Note: To enable horizontal or vertical flipping, specify them in the
 // calculator options. Flipping is applied after rotation.
@@ -206,6 +293,11 @@ class ImageTransformationCalculator : public CalculatorBase {
   bool flip_vertically_ = false;
 
   bool use_gpu_ = false;
+  // Splits the fused CPU path between cpu_num_threads threads, if more than
+  // one.
+  std::unique_ptr<ThreadPool> thread_pool_;
+  // Allocates the CPU outputs, if provided by the graph.
+  CpuImageBufferPool* buffer_pool_ = nullptr;
 #if !MEDIAPIPE_DISABLE_GPU
   GlCalculatorHelper gpu_helper_;
   std::unique_ptr<QuadRenderer> rgb_renderer_;
@@ -228,6 +320,7 @@ absl::Status ImageTransformationCalculator::GetContract(
     RET_CHECK(cc->Outputs().HasTag(kImageFrameTag));
     cc->Inputs().Tag(kImageFrameTag).Set<ImageFrame>();
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+    cc->UseService(kCpuImageBufferPoolService).Optional();
   }
 #if !MEDIAPIPE_DISABLE_GPU
   if (cc->Inputs().HasTag(kGpuBufferTag)) {
@@ -338,6 +431,16 @@ absl::Status ImageTransformationCalculator::Open(CalculatorContext* cc) {
 
   scale_mode_ = ParseScaleMode(options_.scale_mode(), DEFAULT_SCALE_MODE);
 
+  if (!use_gpu_ && options_.use_fused_cpu_transform() &&
+      options_.cpu_num_threads() > 1) {
+    thread_pool_ = absl::make_unique<ThreadPool>("ImageTransformationCpu",
+                                                 options_.cpu_num_threads());
+    thread_pool_->StartWorkers();
+  }
+  if (!use_gpu_ && cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+    buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
+  }
+
   if (use_gpu_) {
 #if !MEDIAPIPE_DISABLE_GPU
     // Let the helper access the GL context information.
@@ -438,56 +541,47 @@ absl::Status ImageTransformationCalculator::Close(CalculatorContext* cc) {
 }
 
 absl::Status ImageTransformationCalculator::RenderCpu(CalculatorContext* cc) {
-  cv::Mat input_mat;
-  mediapipe::ImageFormat::Format format;
-
   const auto& input = cc->Inputs().Tag(kImageFrameTag).Get<ImageFrame>();
-  input_mat = formats::MatView(&input);
-  format = input.Format();
-
-  const int input_width = input_mat.cols;
-  const int input_height = input_mat.rows;
+  const int input_width = input.Width();
+  const int input_height = input.Height();
   int output_width;
   int output_height;
   ComputeOutputDimensions(input_width, input_height, &output_width,
                           &output_height);
 
+  image_transformation::Transformation transformation;
+  transformation.scaled_width = input_width;
+  transformation.scaled_height = input_height;
   if (output_width_ > 0 && output_height_ > 0) {
-    cv::Mat scaled_mat;
     if (scale_mode_ == mediapipe::ScaleMode_Mode_STRETCH) {
-      int scale_flag =
-          input_mat.cols > output_width_ && input_mat.rows > output_height_
-              ? cv::INTER_AREA
-              : cv::INTER_LINEAR;
-      cv::resize(input_mat, scaled_mat, cv::Size(output_width_, output_height_),
-                 0, 0, scale_flag);
+      transformation.scaled_width = output_width_;
+      transformation.scaled_height = output_height_;
+      transformation.area_interpolation =
+          input_width > output_width_ && input_height > output_height_;
     } else {
       const float scale =
           std::min(static_cast<float>(output_width_) / input_width,
                    static_cast<float>(output_height_) / input_height);
-      const int target_width = std::round(input_width * scale);
-      const int target_height = std::round(input_height * scale);
-      int scale_flag = scale < 1.0f ? cv::INTER_AREA : cv::INTER_LINEAR;
+      transformation.scaled_width = std::round(input_width * scale);
+      transformation.scaled_height = std::round(input_height * scale);
+      transformation.area_interpolation = scale < 1.0f;
       if (scale_mode_ == mediapipe::ScaleMode_Mode_FIT) {
-        cv::Mat intermediate_mat;
-        cv::resize(input_mat, intermediate_mat,
-                   cv::Size(target_width, target_height), 0, 0, scale_flag);
-        const int top = (output_height_ - target_height) / 2;
-        const int bottom = output_height_ - target_height - top;
-        const int left = (output_width_ - target_width) / 2;
-        const int right = output_width_ - target_width - left;
-        cv::copyMakeBorder(intermediate_mat, scaled_mat, top, bottom, left,
-                           right,
-                           options_.constant_padding() ? cv::BORDER_CONSTANT
-                                                       : cv::BORDER_REPLICATE);
+        transformation.canvas_width = output_width_;
+        transformation.canvas_height = output_height_;
+        transformation.pad_left =
+            (output_width_ - transformation.scaled_width) / 2;
+        transformation.pad_top =
+            (output_height_ - transformation.scaled_height) / 2;
+        transformation.replicate_padding = !options_.constant_padding();
       } else {
-        cv::resize(input_mat, scaled_mat, cv::Size(target_width, target_height),
-                   0, 0, scale_flag);
-        output_width = target_width;
-        output_height = target_height;
+        output_width = transformation.scaled_width;
+        output_height = transformation.scaled_height;
       }
     }
-    input_mat = scaled_mat;
+  }
+  if (transformation.canvas_width == 0) {
+    transformation.canvas_width = transformation.scaled_width;
+    transformation.canvas_height = transformation.scaled_height;
   }
 
   if (cc->Outputs().HasTag("LETTERBOX_PADDING")) {
@@ -499,44 +593,26 @@ absl::Status ImageTransformationCalculator::RenderCpu(CalculatorContext* cc) {
         .Add(padding.release(), cc->InputTimestamp());
   }
 
-  cv::Mat rotated_mat;
-  cv::Size rotated_size(output_width, output_height);
-  if (input_mat.size() == rotated_size) {
-    const int angle = RotationModeToDegrees(rotation_);
-    cv::Point2f src_center(input_mat.cols / 2.0, input_mat.rows / 2.0);
-    cv::Mat rotation_mat = cv::getRotationMatrix2D(src_center, angle, 1.0);
-    cv::warpAffine(input_mat, rotated_mat, rotation_mat, rotated_size);
-  } else {
-    switch (rotation_) {
-      case mediapipe::RotationMode_Mode_UNKNOWN:
-      case mediapipe::RotationMode_Mode_ROTATION_0:
-        rotated_mat = input_mat;
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_90:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_90_COUNTERCLOCKWISE);
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_180:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_180);
-        break;
-      case mediapipe::RotationMode_Mode_ROTATION_270:
-        cv::rotate(input_mat, rotated_mat, cv::ROTATE_90_CLOCKWISE);
-        break;
-    }
-  }
-
-  cv::Mat flipped_mat;
-  if (flip_horizontally_ || flip_vertically_) {
-    const int flip_code =
-        flip_horizontally_ && flip_vertically_ ? -1 : flip_horizontally_;
-    cv::flip(rotated_mat, flipped_mat, flip_code);
+  transformation.rotation_degrees = RotationModeToDegrees(rotation_);
+  // A canvas that already has the output size is rotated around its center.
+  transformation.rotate_around_center =
+      transformation.canvas_width == output_width &&
+      transformation.canvas_height == output_height;
+  transformation.output_width = output_width;
+  transformation.output_height = output_height;
+  transformation.flip_horizontally = flip_horizontally_;
+  transformation.flip_vertically = flip_vertically_;
+
+  auto output_frame =
+      NewImageFrame(buffer_pool_, input.Format(), output_width, output_height);
+  if (options_.use_fused_cpu_transform() &&
+      image_transformation::IsTransformationSupported(input, transformation)) {
+    // Scales, pads, rotates and flips in a single pass over the output.
+    MP_RETURN_IF_ERROR(image_transformation::TransformImage(
+        input, transformation, thread_pool_.get(), output_frame.get()));
   } else {
-    flipped_mat = rotated_mat;
+    TransformImageWithOpenCv(input, transformation, output_frame.get());
   }
-
-  std::unique_ptr<ImageFrame> output_frame(
-      new ImageFrame(format, output_width, output_height));
-  cv::Mat output_mat = formats::MatView(output_frame.get());
-  flipped_mat.copyTo(output_mat);
   cc->Outputs()
       .Tag(kImageFrameTag)
       .Add(output_frame.release(), cc->InputTimestamp());
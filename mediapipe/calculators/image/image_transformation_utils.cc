@@ -0,0 +1,375 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/image_transformation_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace image_transformation {
+namespace {
+
+// Output tiles are square blocks of kTileSize pixels, so that the input pixels
+// a tile reads stay in cache whatever the rotation.
+constexpr int kTileSize = 64;
+
+// Interpolation weights are fixed point numbers with kWeightBits fractional
+// bits; the weights of an output pixel, products of a horizontal and a
+// vertical weight, have twice as many.
+constexpr int kWeightBits = 11;
+constexpr int kWeightOne = 1 << kWeightBits;
+constexpr int kProductBits = 2 * kWeightBits;
+constexpr int kProductRounding = 1 << (kProductBits - 1);
+
+// Interpolation taps along one axis: scaled pixel i is interpolated from
+// input pixels [first[i], first[i] + count(i)) with weights
+// weights[offset[i]...], which sum up to kWeightOne.
+struct AxisTaps {
+  std::vector<int> first;
+  std::vector<int> offset;
+  std::vector<int> weights;
+
+  int count(int i) const { return offset[i + 1] - offset[i]; }
+
+  void Add(int first_index, const std::vector<double>& tap_weights) {
+    if (offset.empty()) offset.push_back(0);
+    // Rounds each weight, then assigns the rounding error to the largest one
+    // so that weights sum up to exactly kWeightOne.
+    int sum = 0;
+    int largest = 0;
+    for (int t = 0; t < tap_weights.size(); ++t) {
+      const int weight = std::lround(tap_weights[t] * kWeightOne);
+      weights.push_back(weight);
+      sum += weight;
+      if (weight > weights[offset.back() + largest]) largest = t;
+    }
+    weights[offset.back() + largest] += kWeightOne - sum;
+    first.push_back(first_index);
+    offset.push_back(weights.size());
+  }
+};
+
+// Matches cv::resize with INTER_LINEAR: pixel centers are aligned, and
+// positions are clamped to the input.
+AxisTaps ComputeLinearTaps(int input_size, int scaled_size) {
+  AxisTaps taps;
+  const double scale = static_cast<double>(input_size) / scaled_size;
+  for (int i = 0; i < scaled_size; ++i) {
+    const double position = (i + 0.5) * scale - 0.5;
+    int index = std::floor(position);
+    double fraction = position - index;
+    if (index < 0) {
+      index = 0;
+      fraction = 0.0;
+    }
+    if (index >= input_size - 1) {
+      index = input_size - 1;
+      fraction = 0.0;
+    }
+    if (fraction * kWeightOne < 0.5) {
+      taps.Add(index, {1.0});
+    } else {
+      taps.Add(index, {1.0 - fraction, fraction});
+    }
+  }
+  return taps;
+}
+
+// Matches cv::resize with INTER_AREA when downscaling: each scaled pixel is
+// the average of the input pixels it covers, weighted by coverage.
+AxisTaps ComputeAreaTaps(int input_size, int scaled_size) {
+  if (scaled_size >= input_size) {
+    return ComputeLinearTaps(input_size, scaled_size);
+  }
+  AxisTaps taps;
+  const double scale = static_cast<double>(input_size) / scaled_size;
+  std::vector<double> tap_weights;
+  for (int i = 0; i < scaled_size; ++i) {
+    const double begin = i * scale;
+    const double end = std::min((i + 1) * scale, double{input_size});
+    const int first = std::floor(begin);
+    const int last = std::min<int>(std::ceil(end), input_size);
+    tap_weights.clear();
+    for (int j = first; j < last; ++j) {
+      const double coverage = std::min(end, j + 1.0) - std::max(begin, 1.0 * j);
+      tap_weights.push_back(coverage / scale);
+    }
+    taps.Add(first, tap_weights);
+  }
+  return taps;
+}
+
+// Maps output pixel (u, v) to canvas pixel (x, y):
+//   x = x0 + x_du * u + x_dv * v
+//   y = y0 + y_du * u + y_dv * v
+// Flips and rotations by multiples of 90 degrees only permute pixels, so all
+// coefficients are integers, and x_du, x_dv, y_du, y_dv are in {-1, 0, 1}.
+struct PixelMapping {
+  int x0;
+  int x_du;
+  int x_dv;
+  int y0;
+  int y_du;
+  int y_dv;
+};
+
+int NormalizedRotation(int degrees) { return ((degrees % 360) + 360) % 360; }
+
+PixelMapping GetPixelMapping(const Transformation& t) {
+  // Rotated image pixel (ox, oy) from output pixel (u, v):
+  //   ox = ox0 + ox_du * u, oy = oy0 + oy_dv * v.
+  const int ox0 = t.flip_horizontally ? t.output_width - 1 : 0;
+  const int ox_du = t.flip_horizontally ? -1 : 1;
+  const int oy0 = t.flip_vertically ? t.output_height - 1 : 0;
+  const int oy_dv = t.flip_vertically ? -1 : 1;
+
+  // Canvas pixel (x, y) from rotated image pixel (ox, oy):
+  //   x = a + a_x * ox + a_y * oy, y = b + b_x * ox + b_y * oy.
+  const int w = t.canvas_width;
+  const int h = t.canvas_height;
+  int a = 0, a_x = 1, a_y = 0, b = 0, b_x = 0, b_y = 1;
+  switch (NormalizedRotation(t.rotation_degrees)) {
+    case 90:
+      // cv::warpAffine rotates around (w / 2, h / 2), cv::rotate as a whole.
+      a = t.rotate_around_center ? (w + h) / 2 : w - 1;
+      a_x = 0;
+      a_y = -1;
+      b = t.rotate_around_center ? -(w - h) / 2 : 0;
+      b_x = 1;
+      b_y = 0;
+      break;
+    case 180:
+      a = t.rotate_around_center ? w : w - 1;
+      a_x = -1;
+      b = t.rotate_around_center ? h : h - 1;
+      b_y = -1;
+      break;
+    case 270:
+      a = t.rotate_around_center ? (w - h) / 2 : 0;
+      a_x = 0;
+      a_y = 1;
+      b = t.rotate_around_center ? (w + h) / 2 : h - 1;
+      b_x = -1;
+      b_y = 0;
+      break;
+    default:
+      break;
+  }
+  return {a + a_x * ox0 + a_y * oy0, a_x * ox_du, a_y * oy_dv,
+          b + b_x * ox0 + b_y * oy0, b_x * ox_du, b_y * oy_dv};
+}
+
+struct TransformContext {
+  const Transformation* transformation;
+  PixelMapping mapping;
+  AxisTaps x_taps;
+  AxisTaps y_taps;
+  const uint8_t* input;
+  int input_stride;
+  uint8_t* output;
+  int output_stride;
+};
+
+// Computes the output pixels [u_begin, u_end) x [v_begin, v_end).
+// kUnscaled: the scaled image is the input itself.
+template <int kChannels, bool kUnscaled>
+void TransformTile(const TransformContext& context, int u_begin, int u_end,
+                   int v_begin, int v_end) {
+  const Transformation& t = *context.transformation;
+  const PixelMapping& m = context.mapping;
+  const AxisTaps& x_taps = context.x_taps;
+  const AxisTaps& y_taps = context.y_taps;
+  for (int v = v_begin; v < v_end; ++v) {
+    int x = m.x0 + m.x_du * u_begin + m.x_dv * v;
+    int y = m.y0 + m.y_du * u_begin + m.y_dv * v;
+    uint8_t* out = context.output + v * context.output_stride +
+                   u_begin * kChannels;
+    for (int u = u_begin; u < u_end;
+         ++u, x += m.x_du, y += m.y_du, out += kChannels) {
+      // Only rotations around the center may leave the canvas.
+      int sx = x - t.pad_left;
+      int sy = y - t.pad_top;
+      bool is_black = x < 0 || y < 0 || x >= t.canvas_width ||
+                      y >= t.canvas_height;
+      if (!is_black && (sx < 0 || sy < 0 || sx >= t.scaled_width ||
+                        sy >= t.scaled_height)) {
+        // Padding.
+        if (t.replicate_padding) {
+          sx = std::min(std::max(sx, 0), t.scaled_width - 1);
+          sy = std::min(std::max(sy, 0), t.scaled_height - 1);
+        } else {
+          is_black = true;
+        }
+      }
+      if (is_black) {
+        for (int c = 0; c < kChannels; ++c) out[c] = 0;
+        continue;
+      }
+
+      if (kUnscaled) {
+        const uint8_t* pixel =
+            context.input + sy * context.input_stride + sx * kChannels;
+        for (int c = 0; c < kChannels; ++c) out[c] = pixel[c];
+        continue;
+      }
+
+      int sum[kChannels] = {};
+      const int* y_weights = &y_taps.weights[y_taps.offset[sy]];
+      const int* x_weights = &x_taps.weights[x_taps.offset[sx]];
+      const int y_count = y_taps.count(sy);
+      const int x_count = x_taps.count(sx);
+      const uint8_t* row = context.input +
+                           y_taps.first[sy] * context.input_stride +
+                           x_taps.first[sx] * kChannels;
+      for (int j = 0; j < y_count; ++j, row += context.input_stride) {
+        int row_sum[kChannels] = {};
+        const uint8_t* pixel = row;
+        for (int i = 0; i < x_count; ++i, pixel += kChannels) {
+          for (int c = 0; c < kChannels; ++c) {
+            row_sum[c] += x_weights[i] * pixel[c];
+          }
+        }
+        for (int c = 0; c < kChannels; ++c) {
+          sum[c] += y_weights[j] * row_sum[c];
+        }
+      }
+      for (int c = 0; c < kChannels; ++c) {
+        out[c] = static_cast<uint8_t>((sum[c] + kProductRounding) >>
+                                      kProductBits);
+      }
+    }
+  }
+}
+
+template <int kChannels>
+void TransformTiles(const TransformContext& context, bool unscaled,
+                    int tile_begin, int tile_end) {
+  const Transformation& t = *context.transformation;
+  const int tiles_per_row = (t.output_width + kTileSize - 1) / kTileSize;
+  for (int tile = tile_begin; tile < tile_end; ++tile) {
+    const int u_begin = (tile % tiles_per_row) * kTileSize;
+    const int v_begin = (tile / tiles_per_row) * kTileSize;
+    const int u_end = std::min(u_begin + kTileSize, t.output_width);
+    const int v_end = std::min(v_begin + kTileSize, t.output_height);
+    if (unscaled) {
+      TransformTile<kChannels, true>(context, u_begin, u_end, v_begin, v_end);
+    } else {
+      TransformTile<kChannels, false>(context, u_begin, u_end, v_begin,
+                                      v_end);
+    }
+  }
+}
+
+void TransformTiles(const TransformContext& context, int channels,
+                    bool unscaled, int tile_begin, int tile_end) {
+  switch (channels) {
+    case 1:
+      TransformTiles<1>(context, unscaled, tile_begin, tile_end);
+      break;
+    case 2:
+      TransformTiles<2>(context, unscaled, tile_begin, tile_end);
+      break;
+    case 3:
+      TransformTiles<3>(context, unscaled, tile_begin, tile_end);
+      break;
+    case 4:
+      TransformTiles<4>(context, unscaled, tile_begin, tile_end);
+      break;
+  }
+}
+
+}  // namespace
+
+bool IsTransformationSupported(const ImageFrame& input,
+                               const Transformation& transformation) {
+  if (input.ByteDepth() != 1 || input.NumberOfChannels() < 1 ||
+      input.NumberOfChannels() > 4) {
+    return false;
+  }
+  const int rotation = NormalizedRotation(transformation.rotation_degrees);
+  if (rotation % 90 != 0) return false;
+  // Rotating by 90 degrees around (w / 2, h / 2) maps pixels to half pixels
+  // when w and h have different parities.
+  if (transformation.rotate_around_center && rotation % 180 != 0 &&
+      (transformation.canvas_width - transformation.canvas_height) % 2 != 0) {
+    return false;
+  }
+  return true;
+}
+
+absl::Status TransformImage(const ImageFrame& input,
+                            const Transformation& transformation,
+                            ThreadPool* thread_pool, ImageFrame* output) {
+  RET_CHECK(IsTransformationSupported(input, transformation));
+  RET_CHECK_EQ(output->Width(), transformation.output_width);
+  RET_CHECK_EQ(output->Height(), transformation.output_height);
+  RET_CHECK_EQ(output->Format(), input.Format());
+  RET_CHECK_GT(transformation.scaled_width, 0);
+  RET_CHECK_GT(transformation.scaled_height, 0);
+
+  TransformContext context;
+  context.transformation = &transformation;
+  context.mapping = GetPixelMapping(transformation);
+  const bool unscaled = transformation.scaled_width == input.Width() &&
+                        transformation.scaled_height == input.Height();
+  if (!unscaled) {
+    if (transformation.area_interpolation) {
+      context.x_taps =
+          ComputeAreaTaps(input.Width(), transformation.scaled_width);
+      context.y_taps =
+          ComputeAreaTaps(input.Height(), transformation.scaled_height);
+    } else {
+      context.x_taps =
+          ComputeLinearTaps(input.Width(), transformation.scaled_width);
+      context.y_taps =
+          ComputeLinearTaps(input.Height(), transformation.scaled_height);
+    }
+  }
+  context.input = input.PixelData();
+  context.input_stride = input.WidthStep();
+  context.output = output->MutablePixelData();
+  context.output_stride = output->WidthStep();
+
+  const int channels = input.NumberOfChannels();
+  const int num_tiles =
+      ((transformation.output_width + kTileSize - 1) / kTileSize) *
+      ((transformation.output_height + kTileSize - 1) / kTileSize);
+  const int num_chunks =
+      thread_pool ? std::min(thread_pool->num_threads(), num_tiles) : 1;
+  if (num_chunks <= 1) {
+    TransformTiles(context, channels, unscaled, 0, num_tiles);
+    return absl::OkStatus();
+  }
+  absl::BlockingCounter counter(num_chunks);
+  for (int i = 0; i < num_chunks; ++i) {
+    const int tile_begin = num_tiles * i / num_chunks;
+    const int tile_end = num_tiles * (i + 1) / num_chunks;
+    thread_pool->Schedule(
+        [&context, &counter, channels, unscaled, tile_begin, tile_end]() {
+          TransformTiles(context, channels, unscaled, tile_begin, tile_end);
+          counter.DecrementCount();
+        });
+  }
+  counter.Wait();
+  return absl::OkStatus();
+}
+
+}  // namespace image_transformation
+}  // namespace mediapipe
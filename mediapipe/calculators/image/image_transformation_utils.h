@@ -0,0 +1,82 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Fused CPU implementation of the transformations of
+// ImageTransformationCalculator.
+#ifndef MEDIAPIPE_CALCULATORS_IMAGE_IMAGE_TRANSFORMATION_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_IMAGE_IMAGE_TRANSFORMATION_UTILS_H_
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace image_transformation {
+
+// Geometry of the transformations, applied in this order:
+// 1. The input is scaled to scaled_width x scaled_height.
+// 2. The scaled image is placed at (pad_left, pad_top) of a canvas of
+//    canvas_width x canvas_height, the rest of which is padded.
+// 3. The canvas is rotated counterclockwise by rotation_degrees into an image
+//    of output_width x output_height.
+// 4. The rotated image is flipped.
+struct Transformation {
+  int scaled_width = 0;
+  int scaled_height = 0;
+  // Scales with area interpolation (cv::INTER_AREA) if true, bilinear
+  // interpolation (cv::INTER_LINEAR) otherwise.
+  bool area_interpolation = false;
+
+  int canvas_width = 0;
+  int canvas_height = 0;
+  int pad_left = 0;
+  int pad_top = 0;
+  // Pads with black (cv::BORDER_CONSTANT) if false, replicates the edges of
+  // the scaled image (cv::BORDER_REPLICATE) if true.
+  bool replicate_padding = false;
+
+  // A multiple of 90.
+  int rotation_degrees = 0;
+  // If true, the canvas is rotated around its center while keeping its size,
+  // as cv::warpAffine does, and areas not covered by it are black. Otherwise,
+  // it is rotated as a whole, as cv::rotate does.
+  bool rotate_around_center = false;
+  int output_width = 0;
+  int output_height = 0;
+
+  bool flip_horizontally = false;
+  bool flip_vertically = false;
+};
+
+// Returns true if TransformImage supports @input and @transformation: 8-bit
+// images with 1 to 4 channels, and rotations mapping pixels to pixels (i.e.
+// not rotations by 90 degrees around the center of a canvas whose width and
+// height have different parities).
+bool IsTransformationSupported(const ImageFrame& input,
+                               const Transformation& transformation);
+
+// Computes @output, of transformation.output_width x
+// transformation.output_height and of the same format as @input, in a single
+// pass over its pixels: each output pixel is mapped back through the flip,
+// rotation and padding, and interpolated from the input. The output is
+// processed in tiles, which are split between the threads of @thread_pool if
+// not null.
+absl::Status TransformImage(const ImageFrame& input,
+                            const Transformation& transformation,
+                            ThreadPool* thread_pool, ImageFrame* output);
+
+}  // namespace image_transformation
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IMAGE_IMAGE_TRANSFORMATION_UTILS_H_
@@ -0,0 +1,244 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/image_transformation_utils.h"
+
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace image_transformation {
+namespace {
+
+std::unique_ptr<ImageFrame> MakeTestImage(ImageFormat::Format format,
+                                          int width, int height) {
+  auto image = absl::make_unique<ImageFrame>(format, width, height);
+  cv::Mat mat = formats::MatView(image.get());
+  const int channels = image->NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = mat.ptr<uint8_t>(y);
+    for (int x = 0; x < width * channels; ++x) {
+      row[x] = static_cast<uint8_t>(127.5f +
+                                    127.5f * std::sin(x * 0.13f + y * 0.07f));
+    }
+  }
+  return image;
+}
+
+// Reference implementation: one OpenCV operation per step, as
+// ImageTransformationCalculator used to do.
+cv::Mat ReferenceTransform(const ImageFrame& input, const Transformation& t) {
+  cv::Mat mat = formats::MatView(&input);
+  cv::Mat scaled;
+  cv::resize(mat, scaled, cv::Size(t.scaled_width, t.scaled_height), 0, 0,
+             t.area_interpolation ? cv::INTER_AREA : cv::INTER_LINEAR);
+  cv::Mat canvas;
+  cv::copyMakeBorder(
+      scaled, canvas, t.pad_top, t.canvas_height - t.scaled_height - t.pad_top,
+      t.pad_left, t.canvas_width - t.scaled_width - t.pad_left,
+      t.replicate_padding ? cv::BORDER_REPLICATE : cv::BORDER_CONSTANT);
+  cv::Mat rotated;
+  if (t.rotate_around_center) {
+    cv::Mat rotation = cv::getRotationMatrix2D(
+        cv::Point2f(canvas.cols / 2.0, canvas.rows / 2.0), t.rotation_degrees,
+        1.0);
+    cv::warpAffine(canvas, rotated, rotation,
+                   cv::Size(t.output_width, t.output_height));
+  } else if (t.rotation_degrees == 90) {
+    cv::rotate(canvas, rotated, cv::ROTATE_90_COUNTERCLOCKWISE);
+  } else if (t.rotation_degrees == 180) {
+    cv::rotate(canvas, rotated, cv::ROTATE_180);
+  } else if (t.rotation_degrees == 270) {
+    cv::rotate(canvas, rotated, cv::ROTATE_90_CLOCKWISE);
+  } else {
+    rotated = canvas;
+  }
+  if (!t.flip_horizontally && !t.flip_vertically) return rotated;
+  cv::Mat flipped;
+  cv::flip(rotated, flipped,
+           t.flip_horizontally && t.flip_vertically ? -1
+                                                    : t.flip_horizontally);
+  return flipped;
+}
+
+struct TransformTestCase {
+  std::string name;
+  ImageFormat::Format format;
+  int input_width;
+  int input_height;
+  Transformation transformation;
+};
+
+Transformation MakeTransformation(int scaled_width, int scaled_height,
+                                  bool area_interpolation, int canvas_width,
+                                  int canvas_height, bool replicate_padding,
+                                  int rotation_degrees,
+                                  bool rotate_around_center, bool flip_h,
+                                  bool flip_v) {
+  Transformation t;
+  t.scaled_width = scaled_width;
+  t.scaled_height = scaled_height;
+  t.area_interpolation = area_interpolation;
+  t.canvas_width = canvas_width;
+  t.canvas_height = canvas_height;
+  t.pad_left = (canvas_width - scaled_width) / 2;
+  t.pad_top = (canvas_height - scaled_height) / 2;
+  t.replicate_padding = replicate_padding;
+  t.rotation_degrees = rotation_degrees;
+  t.rotate_around_center = rotate_around_center;
+  const bool swap = !rotate_around_center && rotation_degrees % 180 != 0;
+  t.output_width = swap ? canvas_height : canvas_width;
+  t.output_height = swap ? canvas_width : canvas_height;
+  t.flip_horizontally = flip_h;
+  t.flip_vertically = flip_v;
+  return t;
+}
+
+class TransformImageTest : public testing::TestWithParam<TransformTestCase> {};
+
+TEST_P(TransformImageTest, MatchesOpenCv) {
+  const TransformTestCase& test_case = GetParam();
+  const auto input = MakeTestImage(test_case.format, test_case.input_width,
+                                   test_case.input_height);
+  const Transformation& t = test_case.transformation;
+  ASSERT_TRUE(IsTransformationSupported(*input, t));
+  const cv::Mat expected = ReferenceTransform(*input, t);
+
+  for (int num_threads : {1, 3}) {
+    ImageFrame output(test_case.format, t.output_width, t.output_height);
+    ThreadPool thread_pool("TransformImageTest", num_threads);
+    thread_pool.StartWorkers();
+    MP_ASSERT_OK(TransformImage(*input, t,
+                                num_threads > 1 ? &thread_pool : nullptr,
+                                &output));
+    const cv::Mat actual = formats::MatView(&output);
+    ASSERT_EQ(actual.rows, expected.rows);
+    ASSERT_EQ(actual.cols, expected.cols);
+    const int row_size = actual.cols * actual.channels();
+    for (int y = 0; y < actual.rows; ++y) {
+      for (int x = 0; x < row_size; ++x) {
+        // Interpolated values may differ by one rounding step.
+        ASSERT_NEAR(actual.ptr<uint8_t>(y)[x], expected.ptr<uint8_t>(y)[x], 1)
+            << "at (" << x / actual.channels() << ", " << y << ") with "
+            << num_threads << " threads";
+      }
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    TransformImageTests, TransformImageTest,
+    testing::ValuesIn<TransformTestCase>({
+        {"RotateOnly", ImageFormat::SRGB, 70, 50,
+         MakeTransformation(70, 50, false, 70, 50, false, 90, false, false,
+                            false)},
+        {"Rotate180AroundCenter", ImageFormat::SRGBA, 70, 50,
+         MakeTransformation(70, 50, false, 70, 50, false, 180, true, false,
+                            false)},
+        {"FlipOnly", ImageFormat::GRAY8, 33, 21,
+         MakeTransformation(33, 21, false, 33, 21, false, 0, false, true,
+                            true)},
+        {"StretchDownArea", ImageFormat::SRGB, 160, 120,
+         MakeTransformation(64, 40, true, 64, 40, false, 0, true, false,
+                            false)},
+        {"StretchUpLinear", ImageFormat::SRGBA, 40, 30,
+         MakeTransformation(100, 64, false, 100, 64, false, 270, false, true,
+                            false)},
+        {"FitConstantPadding", ImageFormat::SRGB, 160, 90,
+         MakeTransformation(80, 45, true, 80, 80, false, 90, true, false,
+                            true)},
+        {"FitReplicatePadding", ImageFormat::SRGBA, 90, 160,
+         MakeTransformation(45, 80, true, 96, 80, true, 0, true, true,
+                            false)},
+        {"FillAndCrop", ImageFormat::SRGB, 100, 60,
+         MakeTransformation(63, 38, true, 63, 38, false, 270, false, false,
+                            false)},
+    }),
+    [](const testing::TestParamInfo<TransformImageTest::ParamType>& info) {
+      return info.param.name;
+    });
+
+TEST(TransformationSupportTest, RejectsNonByteImages) {
+  ImageFrame input(ImageFormat::VEC32F1, 16, 16);
+  EXPECT_FALSE(IsTransformationSupported(
+      input, MakeTransformation(16, 16, false, 16, 16, false, 0, false, false,
+                                false)));
+}
+
+TEST(TransformationSupportTest, RejectsHalfPixelRotations) {
+  ImageFrame input(ImageFormat::SRGB, 16, 15);
+  EXPECT_FALSE(IsTransformationSupported(
+      input, MakeTransformation(16, 15, false, 16, 15, false, 90, true, false,
+                                false)));
+}
+
+// 4K landscape frame to 1080p portrait.
+constexpr int kBenchmarkInputWidth = 3840;
+constexpr int kBenchmarkInputHeight = 2160;
+
+Transformation BenchmarkTransformation() {
+  return MakeTransformation(1920, 1080, true, 1920, 1080, false, 90, false,
+                            false, false);
+}
+
+void BM_OpenCvTransform(benchmark::State& state) {
+  const auto input = MakeTestImage(ImageFormat::SRGB, kBenchmarkInputWidth,
+                                   kBenchmarkInputHeight);
+  const Transformation t = BenchmarkTransformation();
+  ImageFrame output(ImageFormat::SRGB, t.output_width, t.output_height);
+  cv::Mat output_mat = formats::MatView(&output);
+  for (auto _ : state) {
+    ReferenceTransform(*input, t).copyTo(output_mat);
+    benchmark::DoNotOptimize(output.PixelData());
+  }
+}
+
+BENCHMARK(BM_OpenCvTransform);
+
+// Arg: number of threads.
+void BM_FusedTransform(benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const auto input = MakeTestImage(ImageFormat::SRGB, kBenchmarkInputWidth,
+                                   kBenchmarkInputHeight);
+  const Transformation t = BenchmarkTransformation();
+  ImageFrame output(ImageFormat::SRGB, t.output_width, t.output_height);
+  ThreadPool thread_pool("BM_FusedTransform", num_threads);
+  thread_pool.StartWorkers();
+  for (auto _ : state) {
+    CHECK(TransformImage(*input, t, num_threads > 1 ? &thread_pool : nullptr,
+                         &output)
+              .ok());
+    benchmark::DoNotOptimize(output.PixelData());
+  }
+}
+
+BENCHMARK(BM_FusedTransform)->Arg(1)->Arg(2)->Arg(4);
+
+}  // namespace
+}  // namespace image_transformation
+}  // namespace mediapipe
@@ -0,0 +1,151 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/calculators/image/mask_compositing_calculator.pb.h"
+#include "mediapipe/calculators/image/mask_compositing_utils.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/util/color.pb.h"
+
+namespace mediapipe {
+
+namespace {
+constexpr char kImageTag[] = "IMAGE";
+constexpr char kMaskTag[] = "MASK";
+constexpr char kBackgroundTag[] = "BACKGROUND";
+}  // namespace
+
+// Composites an image with a segmentation mask on the CPU: temporal
+// smoothing, recoloring and blending over a background in a single pass over
+// the image, replacing a chain of SegmentationSmoothingCalculator,
+// RecolorCalculator and MaskOverlayCalculator.
+//
+// The mask may be smaller than the image (e.g. the output of a segmentation
+// model): it is upsampled with bilinear interpolation while compositing. The
+// smoothed mask of the previous frame is kept by the calculator, so no
+// loopback stream is needed.
+//
+// Inputs:
+//   IMAGE: An ImageFrame in ImageFormat::SRGB or SRGBA.
+//   MASK: An ImageFrame mask in ImageFormat::VEC32F1 or GRAY8, of any size.
+//     The image is passed through if the mask is missing.
+//   BACKGROUND (optional): An ImageFrame of the size and format of IMAGE,
+//     kept where the mask is 0.
+//
+// Output:
+//   IMAGE: An ImageFrame of the size and format of IMAGE.
+//
+// Options:
+//   combine_with_previous_ratio: Amount of the previous mask to blend in.
+//   color: Color blended into the image where the mask is set.
+//
+// Usage example:
+//  node {
+//    calculator: "MaskCompositingCalculator"
+//    input_stream: "IMAGE:input_image"
+//    input_stream: "MASK:segmentation_mask"
+//    input_stream: "BACKGROUND:background_image"
+//    output_stream: "IMAGE:output_image"
+//    options: {
+//      [mediapipe.MaskCompositingCalculatorOptions.ext] {
+//        combine_with_previous_ratio: 0.9
+//        color { r: 0 g: 0 b: 255 }
+//      }
+//    }
+//  }
+class MaskCompositingCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  std::unique_ptr<MaskCompositor> compositor_;
+  // Allocates the outputs, if provided by the graph.
+  CpuImageBufferPool* buffer_pool_ = nullptr;
+};
+REGISTER_CALCULATOR(MaskCompositingCalculator);
+
+// static
+absl::Status MaskCompositingCalculator::GetContract(CalculatorContract* cc) {
+  cc->Inputs().Tag(kImageTag).Set<ImageFrame>();
+  cc->Inputs().Tag(kMaskTag).Set<ImageFrame>();
+  if (cc->Inputs().HasTag(kBackgroundTag)) {
+    cc->Inputs().Tag(kBackgroundTag).Set<ImageFrame>();
+  }
+  cc->Outputs().Tag(kImageTag).Set<ImageFrame>();
+  cc->UseService(kCpuImageBufferPoolService).Optional();
+  return absl::OkStatus();
+}
+
+absl::Status MaskCompositingCalculator::Open(CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+
+  const auto& options = cc->Options<MaskCompositingCalculatorOptions>();
+  RET_CHECK_GE(options.combine_with_previous_ratio(), 0.0f);
+  RET_CHECK_LE(options.combine_with_previous_ratio(), 1.0f);
+  MaskCompositor::Options compositor_options;
+  compositor_options.combine_with_previous_ratio =
+      options.combine_with_previous_ratio();
+  compositor_options.recolor = options.has_color();
+  if (options.has_color()) {
+    compositor_options.color[0] = options.color().r();
+    compositor_options.color[1] = options.color().g();
+    compositor_options.color[2] = options.color().b();
+  }
+  compositor_options.adjust_with_luminance = options.adjust_with_luminance();
+  compositor_options.invert_mask = options.invert_mask();
+  compositor_ = absl::make_unique<MaskCompositor>(compositor_options);
+
+  if (cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+    buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status MaskCompositingCalculator::Process(CalculatorContext* cc) {
+  if (cc->Inputs().Tag(kImageTag).IsEmpty()) {
+    return absl::OkStatus();
+  }
+  if (cc->Inputs().Tag(kMaskTag).IsEmpty()) {
+    cc->Outputs().Tag(kImageTag).AddPacket(cc->Inputs().Tag(kImageTag).Value());
+    return absl::OkStatus();
+  }
+
+  const auto& image = cc->Inputs().Tag(kImageTag).Get<ImageFrame>();
+  const auto& mask = cc->Inputs().Tag(kMaskTag).Get<ImageFrame>();
+  const ImageFrame* background = nullptr;
+  if (cc->Inputs().HasTag(kBackgroundTag) &&
+      !cc->Inputs().Tag(kBackgroundTag).IsEmpty()) {
+    background = &cc->Inputs().Tag(kBackgroundTag).Get<ImageFrame>();
+  }
+
+  auto output = NewImageFrame(buffer_pool_, image.Format(), image.Width(),
+                              image.Height());
+  MP_RETURN_IF_ERROR(
+      compositor_->Composite(image, mask, background, output.get()));
+  cc->Outputs()
+      .Tag(kImageTag)
+      .Add(output.release(), cc->InputTimestamp());
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
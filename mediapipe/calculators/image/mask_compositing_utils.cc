@@ -0,0 +1,264 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/mask_compositing_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/port/ret_check.h"
+
+namespace mediapipe {
+namespace {
+
+// Blends @new_value with @previous_value by the uncertainty of @new_value, as
+// SegmentationSmoothingCalculator does.
+inline float SmoothMaskValue(float previous_value, float new_value,
+                             float combine_with_previous_ratio) {
+  // Polynomial approximation of the squared uncertainty of p = new_value,
+  // 1 - (1 - H(p))^2 with H(p) the binary entropy, as a function of
+  // (p - 0.5)^2.
+  const float c1 = 5.68842;
+  const float c2 = -0.748699;
+  const float c3 = -57.8051;
+  const float c4 = 291.309;
+  const float c5 = -624.717;
+  const float t = new_value - 0.5f;
+  const float x = t * t;
+  const float uncertainty =
+      1.0f - std::min(1.0f, x * (c1 + x * (c2 + x * (c3 + x * (c4 + x * c5)))));
+  return new_value + (previous_value - new_value) *
+                         (uncertainty * combine_with_previous_ratio);
+}
+
+// Row compositing kernels, specialized for each combination of options so
+// that the inner loops have no branches.
+using RowCompositor = void (*)(const uint8* image, const uint8* background,
+                               const float* weights, const float* mix_values,
+                               const float* color, int width, uint8* output);
+
+template <int kChannels, bool kRecolor, bool kBlend>
+void CompositeRow(const uint8* image, const uint8* background,
+                  const float* weights, const float* mix_values,
+                  const float* color, int width, uint8* output) {
+  for (int x = 0; x < width; ++x) {
+    const int i = x * kChannels;
+    for (int c = 0; c < 3; ++c) {
+      float value = image[i + c];
+      if (kRecolor) value += (color[c] - value) * mix_values[x];
+      if (kBlend) {
+        const float back = background[i + c];
+        value = back + (value - back) * weights[x];
+      }
+      // Values stay in [0, 255]: rounds by truncation.
+      output[i + c] = static_cast<uint8>(value + 0.5f);
+    }
+    if (kChannels == 4) output[i + 3] = image[i + 3];
+  }
+}
+
+template <int kChannels>
+RowCompositor SelectRowCompositor(bool recolor, bool blend) {
+  if (recolor) {
+    return blend ? &CompositeRow<kChannels, true, true>
+                 : &CompositeRow<kChannels, true, false>;
+  }
+  return blend ? &CompositeRow<kChannels, false, true>
+               : &CompositeRow<kChannels, false, false>;
+}
+
+// Recoloring amount of each pixel of @image, as RecolorCalculator computes
+// it.
+template <int kChannels>
+void ComputeMixValues(const uint8* image, const float* weights, int width,
+                      bool adjust_with_luminance, float* mix_values) {
+  if (!adjust_with_luminance) {
+    std::copy(weights, weights + width, mix_values);
+    return;
+  }
+  for (int x = 0; x < width; ++x) {
+    const uint8* pixel = image + x * kChannels;
+    const float luminance =
+        (pixel[0] * 0.299f + pixel[1] * 0.587f + pixel[2] * 0.114f) *
+        (1.0f / 255.0f);
+    mix_values[x] = weights[x] * luminance;
+  }
+}
+
+}  // namespace
+
+MaskCompositor::MaskCompositor(const Options& options) : options_(options) {}
+
+void MaskCompositor::Reset() { previous_mask_.reset(); }
+
+absl::Status MaskCompositor::Composite(const ImageFrame& image,
+                                       const ImageFrame& mask,
+                                       const ImageFrame* background,
+                                       ImageFrame* output) {
+  RET_CHECK(image.Format() == ImageFormat::SRGB ||
+            image.Format() == ImageFormat::SRGBA)
+      << "Unsupported image format: " << image.Format();
+  RET_CHECK(mask.Format() == ImageFormat::VEC32F1 ||
+            mask.Format() == ImageFormat::GRAY8)
+      << "Unsupported mask format: " << mask.Format();
+  RET_CHECK(mask.Width() > 0 && mask.Height() > 0);
+  if (background) {
+    RET_CHECK_EQ(background->Format(), image.Format());
+    RET_CHECK_EQ(background->Width(), image.Width());
+    RET_CHECK_EQ(background->Height(), image.Height());
+  }
+  RET_CHECK_EQ(output->Format(), image.Format());
+  RET_CHECK_EQ(output->Width(), image.Width());
+  RET_CHECK_EQ(output->Height(), image.Height());
+
+  const int width = image.Width();
+  const int height = image.Height();
+  const int channels = image.NumberOfChannels();
+
+  // The previous mask is only used if it has the size of the current one.
+  auto has_mask_size = [&mask](const std::unique_ptr<ImageFrame>& frame) {
+    return frame && frame->Width() == mask.Width() &&
+           frame->Height() == mask.Height();
+  };
+  if (!has_mask_size(previous_mask_)) previous_mask_.reset();
+  if (!has_mask_size(smoothed_mask_)) {
+    smoothed_mask_ = absl::make_unique<ImageFrame>(
+        ImageFormat::VEC32F1, mask.Width(), mask.Height());
+  }
+  smoothed_rows_ = 0;
+
+  // Matches cv::resize with INTER_LINEAR: pixel centers are aligned, and
+  // positions are clamped to the mask.
+  auto compute_tap = [](int input_size, int output_size, int i) {
+    const double position =
+        (i + 0.5) * input_size / static_cast<double>(output_size) - 0.5;
+    LinearTap tap;
+    tap.first = std::floor(position);
+    tap.fraction = position - tap.first;
+    if (tap.first < 0) {
+      tap.first = 0;
+      tap.fraction = 0.0f;
+    }
+    if (tap.first >= input_size - 1) {
+      tap.first = input_size - 1;
+      tap.fraction = 0.0f;
+    }
+    tap.second = std::min(tap.first + 1, input_size - 1);
+    return tap;
+  };
+  if (static_cast<int>(column_taps_.size()) != width ||
+      column_taps_mask_width_ != mask.Width()) {
+    column_taps_.resize(width);
+    for (int x = 0; x < width; ++x) {
+      column_taps_[x] = compute_tap(mask.Width(), width, x);
+    }
+    column_taps_mask_width_ = mask.Width();
+    weights_.resize(width);
+    mix_values_.resize(width);
+  }
+
+  const float color[3] = {static_cast<float>(options_.color[0]),
+                          static_cast<float>(options_.color[1]),
+                          static_cast<float>(options_.color[2])};
+  const RowCompositor composite_row =
+      channels == 4
+          ? SelectRowCompositor<4>(options_.recolor, background != nullptr)
+          : SelectRowCompositor<3>(options_.recolor, background != nullptr);
+
+  for (int y = 0; y < height; ++y) {
+    // Upsamples the mask.
+    const LinearTap row_tap = compute_tap(mask.Height(), height, y);
+    const float* top = SmoothedMaskRow(mask, row_tap.first);
+    const float* bottom = SmoothedMaskRow(mask, row_tap.second);
+    float* weights = weights_.data();
+    for (int x = 0; x < width; ++x) {
+      const LinearTap& tap = column_taps_[x];
+      const float top_value =
+          top[tap.first] + (top[tap.second] - top[tap.first]) * tap.fraction;
+      const float bottom_value =
+          bottom[tap.first] +
+          (bottom[tap.second] - bottom[tap.first]) * tap.fraction;
+      const float weight =
+          top_value + (bottom_value - top_value) * row_tap.fraction;
+      weights[x] = std::min(std::max(weight, 0.0f), 1.0f);
+    }
+    if (options_.invert_mask) {
+      for (int x = 0; x < width; ++x) weights[x] = 1.0f - weights[x];
+    }
+
+    const uint8* image_row = image.PixelData() + y * image.WidthStep();
+    if (options_.recolor) {
+      if (channels == 4) {
+        ComputeMixValues<4>(image_row, weights, width,
+                            options_.adjust_with_luminance,
+                            mix_values_.data());
+      } else {
+        ComputeMixValues<3>(image_row, weights, width,
+                            options_.adjust_with_luminance,
+                            mix_values_.data());
+      }
+    }
+    composite_row(
+        image_row,
+        background ? background->PixelData() + y * background->WidthStep()
+                   : nullptr,
+        weights, mix_values_.data(), color, width,
+        output->MutablePixelData() + y * output->WidthStep());
+  }
+
+  if (options_.combine_with_previous_ratio > 0.0f) {
+    // Smooths the rows the image didn't need, and keeps the smoothed mask for
+    // the next frame.
+    SmoothedMaskRow(mask, mask.Height() - 1);
+    std::swap(previous_mask_, smoothed_mask_);
+  }
+  return absl::OkStatus();
+}
+
+const float* MaskCompositor::SmoothedMaskRow(const ImageFrame& mask, int y) {
+  const float ratio = options_.combine_with_previous_ratio;
+  if (ratio <= 0.0f && mask.Format() == ImageFormat::VEC32F1) {
+    return reinterpret_cast<const float*>(mask.PixelData() +
+                                          y * mask.WidthStep());
+  }
+  const int width = mask.Width();
+  for (; smoothed_rows_ <= y; ++smoothed_rows_) {
+    const int row = smoothed_rows_;
+    float* smoothed = reinterpret_cast<float*>(
+        smoothed_mask_->MutablePixelData() + row * smoothed_mask_->WidthStep());
+    const uint8* mask_row = mask.PixelData() + row * mask.WidthStep();
+    if (mask.Format() == ImageFormat::GRAY8) {
+      for (int x = 0; x < width; ++x) {
+        smoothed[x] = mask_row[x] * (1.0f / 255.0f);
+      }
+    } else {
+      const float* values = reinterpret_cast<const float*>(mask_row);
+      std::copy(values, values + width, smoothed);
+    }
+    if (previous_mask_ && ratio > 0.0f) {
+      const float* previous = reinterpret_cast<const float*>(
+          previous_mask_->PixelData() + row * previous_mask_->WidthStep());
+      for (int x = 0; x < width; ++x) {
+        smoothed[x] = SmoothMaskValue(previous[x], smoothed[x], ratio);
+      }
+    }
+  }
+  return reinterpret_cast<const float*>(smoothed_mask_->PixelData() +
+                                        y * smoothed_mask_->WidthStep());
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,107 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// Fused CPU implementation of the segmentation mask post-processing of
+// SegmentationSmoothingCalculator, RecolorCalculator and
+// MaskOverlayCalculator.
+#ifndef MEDIAPIPE_CALCULATORS_IMAGE_MASK_COMPOSITING_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_IMAGE_MASK_COMPOSITING_UTILS_H_
+
+#include <memory>
+#include <vector>
+
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status.h"
+
+namespace mediapipe {
+
+// Composites images with segmentation masks, in a single pass over the
+// pixels of the image:
+// 1. The mask is blended with the smoothed mask of the previous frame, as
+//    SegmentationSmoothingCalculator does.
+// 2. The smoothed mask is upsampled to the size of the image with bilinear
+//    interpolation (as cv::resize does), and inverted if requested.
+// 3. The image is recolored where the mask is set, as RecolorCalculator
+//    does.
+// 4. The result is blended over the background where the mask is set, as
+//    MaskOverlayCalculator does.
+// Each step runs on a row of the mask or of the image at a time, so that no
+// intermediate frame is allocated. Mask rows are smoothed when first needed.
+//
+// Not thread-safe: the smoothed mask is kept from one call to the next.
+class MaskCompositor {
+ public:
+  struct Options {
+    // Amount of the previous mask blended into uncertain mask values, see
+    // SegmentationSmoothingCalculatorOptions. 0 disables smoothing.
+    float combine_with_previous_ratio = 0.0f;
+
+    // Recolors the image with @color (RGB) if true.
+    bool recolor = false;
+    uint8 color[3] = {0, 0, 0};
+    // Whether the luminance of the image scales the recoloring, see
+    // RecolorCalculatorOptions.
+    bool adjust_with_luminance = true;
+
+    // Swaps the meaning of mask values for foreground/background.
+    bool invert_mask = false;
+  };
+
+  explicit MaskCompositor(const Options& options);
+
+  // Writes to @output, of the size and format of @image, the composition of
+  // @image with @mask, and over @background if not null. @image and
+  // @background are SRGB or SRGBA images of the same size and format; the
+  // alpha channel of @image is copied. @mask is a VEC32F1 or GRAY8 mask of
+  // any size, with values in [0, 1] or [0, 255].
+  absl::Status Composite(const ImageFrame& image, const ImageFrame& mask,
+                         const ImageFrame* background, ImageFrame* output);
+
+  // Forgets the mask of the previous frame, e.g. after a scene cut.
+  void Reset();
+
+ private:
+  // Bilinear interpolation from input pixels @first and @second.
+  struct LinearTap {
+    int first;
+    int second;
+    float fraction;
+  };
+
+  // Returns row @y of the smoothed mask, computing it and all the rows above
+  // it if needed.
+  const float* SmoothedMaskRow(const ImageFrame& mask, int y);
+
+  const Options options_;
+
+  // Smoothed mask of the current and previous frames, at the mask size.
+  std::unique_ptr<ImageFrame> smoothed_mask_;
+  std::unique_ptr<ImageFrame> previous_mask_;
+  // Number of rows of smoothed_mask_ computed for the current frame.
+  int smoothed_rows_ = 0;
+
+  // Interpolation of the mask for each column of the image, kept as long as
+  // the sizes of the mask and image don't change.
+  std::vector<LinearTap> column_taps_;
+  int column_taps_mask_width_ = 0;
+
+  // Mask weight and recoloring amount of each pixel of the current row.
+  std::vector<float> weights_;
+  std::vector<float> mix_values_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_IMAGE_MASK_COMPOSITING_UTILS_H_
@@ -0,0 +1,315 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/image/mask_compositing_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+std::unique_ptr<ImageFrame> MakeTestImage(ImageFormat::Format format,
+                                          int width, int height, float phase) {
+  auto image = absl::make_unique<ImageFrame>(format, width, height);
+  cv::Mat mat = formats::MatView(image.get());
+  const int channels = image->NumberOfChannels();
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = mat.ptr<uint8_t>(y);
+    for (int x = 0; x < width * channels; ++x) {
+      row[x] = static_cast<uint8_t>(
+          127.5f + 127.5f * std::sin(x * 0.13f + y * 0.07f + phase));
+    }
+  }
+  return image;
+}
+
+// A blob whose border moves with @phase, with uncertain values around it.
+std::unique_ptr<ImageFrame> MakeTestMask(int width, int height, float phase) {
+  auto mask =
+      absl::make_unique<ImageFrame>(ImageFormat::VEC32F1, width, height);
+  cv::Mat mat = formats::MatView(mask.get());
+  for (int y = 0; y < height; ++y) {
+    float* row = mat.ptr<float>(y);
+    for (int x = 0; x < width; ++x) {
+      const float dx = (x + 0.5f) / width - 0.5f;
+      const float dy = (y + 0.5f) / height - 0.5f;
+      const float distance = std::sqrt(dx * dx + dy * dy);
+      row[x] = 1.0f / (1.0f + std::exp((distance - 0.3f - 0.05f * phase) *
+                                       20.0f));
+    }
+  }
+  return mask;
+}
+
+// Reference implementation: one pass per step over full frames, as the chain
+// of SegmentationSmoothingCalculator, RecolorCalculator and
+// MaskOverlayCalculator does. Returns the smoothed mask in @smoothed_mask.
+cv::Mat ReferenceComposite(const cv::Mat& image, const cv::Mat& mask,
+                           const cv::Mat& previous_mask,
+                           const cv::Mat* background,
+                           const MaskCompositor::Options& options,
+                           cv::Mat* smoothed_mask) {
+  // SegmentationSmoothingCalculator.
+  mask.copyTo(*smoothed_mask);
+  if (!previous_mask.empty()) {
+    for (int y = 0; y < mask.rows; ++y) {
+      for (int x = 0; x < mask.cols; ++x) {
+        const float new_value = mask.at<float>(y, x);
+        const float t = new_value - 0.5f;
+        const float s = t * t;
+        const float uncertainty =
+            1.0f - std::min(1.0f, s * (5.68842f +
+                                       s * (-0.748699f +
+                                            s * (-57.8051f +
+                                                 s * (291.309f +
+                                                      s * -624.717f)))));
+        smoothed_mask->at<float>(y, x) =
+            new_value + (previous_mask.at<float>(y, x) - new_value) *
+                            (uncertainty * options.combine_with_previous_ratio);
+      }
+    }
+  }
+  cv::Mat weights;
+  cv::resize(*smoothed_mask, weights, image.size());
+  if (options.invert_mask) weights = 1.0 - weights;
+
+  // RecolorCalculator.
+  const int channels = image.channels();
+  cv::Mat recolored = image.clone();
+  if (options.recolor) {
+    for (int y = 0; y < image.rows; ++y) {
+      for (int x = 0; x < image.cols; ++x) {
+        const uint8_t* pixel = image.ptr<uint8_t>(y) + x * channels;
+        const float luminance =
+            options.adjust_with_luminance
+                ? (pixel[0] * 0.299 + pixel[1] * 0.587 + pixel[2] * 0.114) /
+                      255
+                : 1.0f;
+        const float mix_value = weights.at<float>(y, x) * luminance;
+        uint8_t* output = recolored.ptr<uint8_t>(y) + x * channels;
+        for (int c = 0; c < 3; ++c) {
+          output[c] = cv::saturate_cast<uchar>(pixel[c] * (1.0 - mix_value) +
+                                               options.color[c] * mix_value);
+        }
+      }
+    }
+  }
+  if (!background) return recolored;
+
+  // MaskOverlayCalculator.
+  cv::Mat output = recolored.clone();
+  for (int y = 0; y < image.rows; ++y) {
+    for (int x = 0; x < image.cols; ++x) {
+      const float weight = weights.at<float>(y, x);
+      for (int c = 0; c < 3; ++c) {
+        const int i = x * channels + c;
+        output.ptr<uint8_t>(y)[i] = cv::saturate_cast<uchar>(
+            background->ptr<uint8_t>(y)[i] * (1.0f - weight) +
+            recolored.ptr<uint8_t>(y)[i] * weight);
+      }
+    }
+  }
+  return output;
+}
+
+// Composites @num_frames frames with the fused and reference implementations,
+// and checks that they match up to the rounding of intermediate images.
+void ExpectMatchesReference(ImageFormat::Format format, int width, int height,
+                            int mask_width, int mask_height, bool gray_mask,
+                            bool with_background,
+                            const MaskCompositor::Options& options,
+                            int num_frames) {
+  MaskCompositor compositor(options);
+  cv::Mat previous_mask;
+  for (int i = 0; i < num_frames; ++i) {
+    const auto image = MakeTestImage(format, width, height, i);
+    const auto background = MakeTestImage(format, width, height, i + 2.0f);
+    auto mask = MakeTestMask(mask_width, mask_height, i);
+    // Kept by the reference, after @mask may be replaced.
+    cv::Mat mask_mat = formats::MatView(mask.get()).clone();
+    if (gray_mask) {
+      auto gray = absl::make_unique<ImageFrame>(ImageFormat::GRAY8, mask_width,
+                                                mask_height);
+      cv::Mat gray_mat = formats::MatView(gray.get());
+      mask_mat.convertTo(gray_mat, CV_8U, 255.0);
+      // The reference works on the quantized mask.
+      gray_mat.convertTo(mask_mat, CV_32F, 1.0 / 255.0);
+      mask = std::move(gray);
+    }
+
+    ImageFrame output(format, width, height);
+    MP_ASSERT_OK(compositor.Composite(
+        *image, *mask, with_background ? background.get() : nullptr, &output));
+
+    const cv::Mat background_mat = formats::MatView(background.get());
+    cv::Mat smoothed_mask;
+    const cv::Mat expected = ReferenceComposite(
+        formats::MatView(image.get()), mask_mat,
+        options.combine_with_previous_ratio > 0 ? previous_mask : cv::Mat(),
+        with_background ? &background_mat : nullptr, options, &smoothed_mask);
+    previous_mask = smoothed_mask;
+
+    const cv::Mat actual = formats::MatView(&output);
+    ASSERT_EQ(actual.type(), expected.type());
+    EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 1.0) << "frame " << i;
+  }
+}
+
+MaskCompositor::Options RecolorOptions() {
+  MaskCompositor::Options options;
+  options.recolor = true;
+  options.color[0] = 20;
+  options.color[1] = 80;
+  options.color[2] = 240;
+  return options;
+}
+
+TEST(MaskCompositorTest, RecolorsLikeRecolorCalculator) {
+  ExpectMatchesReference(ImageFormat::SRGB, 203, 141, 203, 141,
+                         /*gray_mask=*/false, /*with_background=*/false,
+                         RecolorOptions(), /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, RecolorsWithoutLuminanceAndInvertedMask) {
+  MaskCompositor::Options options = RecolorOptions();
+  options.adjust_with_luminance = false;
+  options.invert_mask = true;
+  ExpectMatchesReference(ImageFormat::SRGB, 203, 141, 203, 141,
+                         /*gray_mask=*/false, /*with_background=*/false,
+                         options, /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, BlendsOverBackground) {
+  MaskCompositor::Options options;
+  ExpectMatchesReference(ImageFormat::SRGB, 203, 141, 203, 141,
+                         /*gray_mask=*/false, /*with_background=*/true,
+                         options, /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, UpsamplesLowResolutionMask) {
+  ExpectMatchesReference(ImageFormat::SRGB, 320, 240, 64, 48,
+                         /*gray_mask=*/false, /*with_background=*/true,
+                         RecolorOptions(), /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, DownsamplesHighResolutionMask) {
+  ExpectMatchesReference(ImageFormat::SRGB, 100, 75, 256, 256,
+                         /*gray_mask=*/false, /*with_background=*/true,
+                         RecolorOptions(), /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, SupportsGrayMask) {
+  ExpectMatchesReference(ImageFormat::SRGB, 320, 240, 64, 48,
+                         /*gray_mask=*/true, /*with_background=*/true,
+                         RecolorOptions(), /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, SmoothsWithPreviousMask) {
+  MaskCompositor::Options options = RecolorOptions();
+  options.combine_with_previous_ratio = 0.9f;
+  ExpectMatchesReference(ImageFormat::SRGB, 320, 240, 64, 48,
+                         /*gray_mask=*/false, /*with_background=*/true,
+                         options, /*num_frames=*/4);
+}
+
+TEST(MaskCompositorTest, SmoothsMaskRowsNotUsedByTheImage) {
+  MaskCompositor::Options options = RecolorOptions();
+  options.combine_with_previous_ratio = 0.9f;
+  ExpectMatchesReference(ImageFormat::SRGB, 50, 40, 256, 256,
+                         /*gray_mask=*/true, /*with_background=*/false,
+                         options, /*num_frames=*/3);
+}
+
+TEST(MaskCompositorTest, KeepsAlpha) {
+  ExpectMatchesReference(ImageFormat::SRGBA, 203, 141, 64, 48,
+                         /*gray_mask=*/false, /*with_background=*/true,
+                         RecolorOptions(), /*num_frames=*/1);
+}
+
+TEST(MaskCompositorTest, RejectsBackgroundOfAnotherSize) {
+  MaskCompositor compositor(RecolorOptions());
+  const auto image = MakeTestImage(ImageFormat::SRGB, 64, 48, 0);
+  const auto background = MakeTestImage(ImageFormat::SRGB, 32, 48, 0);
+  const auto mask = MakeTestMask(64, 48, 0);
+  ImageFrame output(ImageFormat::SRGB, 64, 48);
+  EXPECT_FALSE(
+      compositor.Composite(*image, *mask, background.get(), &output).ok());
+}
+
+constexpr int kBenchmarkWidth = 1920;
+constexpr int kBenchmarkHeight = 1080;
+constexpr int kBenchmarkMaskSize = 256;
+
+MaskCompositor::Options BenchmarkOptions() {
+  MaskCompositor::Options options = RecolorOptions();
+  options.combine_with_previous_ratio = 0.9f;
+  return options;
+}
+
+void BM_ChainedCompositing(benchmark::State& state) {
+  const auto image = MakeTestImage(ImageFormat::SRGB, kBenchmarkWidth,
+                                   kBenchmarkHeight, 0);
+  const auto background = MakeTestImage(ImageFormat::SRGB, kBenchmarkWidth,
+                                        kBenchmarkHeight, 2);
+  const auto mask = MakeTestMask(kBenchmarkMaskSize, kBenchmarkMaskSize, 0);
+  const cv::Mat image_mat = formats::MatView(image.get());
+  const cv::Mat background_mat = formats::MatView(background.get());
+  const cv::Mat mask_mat = formats::MatView(mask.get());
+  const MaskCompositor::Options options = BenchmarkOptions();
+  cv::Mat previous_mask = mask_mat.clone();
+  for (auto _ : state) {
+    cv::Mat smoothed_mask;
+    cv::Mat output = ReferenceComposite(image_mat, mask_mat, previous_mask,
+                                        &background_mat, options,
+                                        &smoothed_mask);
+    previous_mask = smoothed_mask;
+    benchmark::DoNotOptimize(output.data);
+  }
+}
+
+BENCHMARK(BM_ChainedCompositing);
+
+void BM_FusedCompositing(benchmark::State& state) {
+  const auto image = MakeTestImage(ImageFormat::SRGB, kBenchmarkWidth,
+                                   kBenchmarkHeight, 0);
+  const auto background = MakeTestImage(ImageFormat::SRGB, kBenchmarkWidth,
+                                        kBenchmarkHeight, 2);
+  const auto mask = MakeTestMask(kBenchmarkMaskSize, kBenchmarkMaskSize, 0);
+  MaskCompositor compositor(BenchmarkOptions());
+  ImageFrame output(ImageFormat::SRGB, kBenchmarkWidth, kBenchmarkHeight);
+  for (auto _ : state) {
+    CHECK(compositor.Composite(*image, *mask, background.get(), &output).ok());
+    benchmark::DoNotOptimize(output.PixelData());
+  }
+}
+
+BENCHMARK(BM_FusedCompositing);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,298 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/calculators/image/opencv_batched_image_decoder_calculator.pb.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
+#include "mediapipe/framework/formats/image.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kEncodedImagesTag[] = "ENCODED_IMAGES";
+constexpr char kImagesTag[] = "IMAGES";
+
+// Reads the size and number of color components of a JPEG image from its
+// frame header. Returns false if @contents is not a JPEG image.
+bool ReadJpegHeader(const std::string& contents, int* width, int* height,
+                    int* components) {
+  const auto* data = reinterpret_cast<const uint8*>(contents.data());
+  const size_t size = contents.size();
+  if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) return false;
+  size_t position = 2;
+  while (position + 4 <= size) {
+    if (data[position] != 0xFF) return false;
+    const uint8 marker = data[position + 1];
+    if (marker == 0xFF) {
+      // Fill byte.
+      ++position;
+      continue;
+    }
+    if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+      // Markers without a segment.
+      position += 2;
+      continue;
+    }
+    // Start of scan, or end of image, before any frame header.
+    if (marker == 0xDA || marker == 0xD9) return false;
+    // SOF0 to SOF15, except for DHT, JPG and DAC.
+    if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 &&
+        marker != 0xC8 && marker != 0xCC) {
+      if (position + 10 > size) return false;
+      *height = (data[position + 5] << 8) | data[position + 6];
+      *width = (data[position + 7] << 8) | data[position + 8];
+      *components = data[position + 9];
+      return true;
+    }
+    const int length = (data[position + 2] << 8) | data[position + 3];
+    position += 2 + length;
+  }
+  return false;
+}
+
+// Returns the largest scale, among 8, 4 and 2, an image of @width x @height
+// can be reduced by while still covering @target_width x @target_height in
+// either orientation, or 1.
+int ReducedScale(int width, int height, int target_width, int target_height) {
+  const int short_side = std::min(width, height);
+  const int long_side = std::max(width, height);
+  const int target_short_side = std::min(target_width, target_height);
+  const int target_long_side = std::max(target_width, target_height);
+  for (int scale : {8, 4, 2}) {
+    // libjpeg rounds reduced sizes up.
+    if ((short_side + scale - 1) / scale >= target_short_side &&
+        (long_side + scale - 1) / scale >= target_long_side) {
+      return scale;
+    }
+  }
+  return 1;
+}
+
+}  // namespace
+
+// Decodes a batch of encoded images (JPEG, PNG, or any format supported by
+// OpenCV), in parallel, into images allocated from the CPU image buffer pool
+// of the graph if it provides one. Grayscale images are decoded as GRAY8,
+// color images as SRGB, and color images with alpha as SRGBA, as
+// OpenCvEncodedImageToImageFrameCalculator does.
+//
+// Each thread reuses its own decoding buffer from one image to the next, so
+// that only the output images are allocated. When the size the images are
+// going to be scaled to is known, JPEG images are decoded at a reduced size,
+// which skips most of the inverse DCT.
+//
+// Inputs:
+//   ENCODED_IMAGES: A std::vector<std::string> of encoded images.
+//
+// Outputs:
+//   IMAGES: A std::vector<Image> of the decoded images, in the same order.
+//
+// Example config:
+// node {
+//   calculator: "OpenCvBatchedImageDecoderCalculator"
+//   input_stream: "ENCODED_IMAGES:encoded_images"
+//   output_stream: "IMAGES:images"
+//   options: {
+//     [mediapipe.OpenCvBatchedImageDecoderCalculatorOptions.ext] {
+//       num_threads: 4
+//       target_width: 224
+//       target_height: 224
+//     }
+//   }
+// }
+class OpenCvBatchedImageDecoderCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc);
+  absl::Status Open(CalculatorContext* cc) override;
+  absl::Status Process(CalculatorContext* cc) override;
+
+ private:
+  // Returns the cv::imdecode flags to decode @contents with.
+  int DecodeFlags(const std::string& contents) const;
+
+  // Decodes @contents into @image, using @decoded as decoding buffer.
+  absl::Status DecodeImage(const std::string& contents, cv::Mat* decoded,
+                           Image* image) const;
+
+  OpenCvBatchedImageDecoderCalculatorOptions options_;
+  // Allocates the output images, if provided by the graph.
+  CpuImageBufferPool* buffer_pool_ = nullptr;
+  // Decodes the images of a batch, if num_threads > 1.
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+REGISTER_CALCULATOR(OpenCvBatchedImageDecoderCalculator);
+
+// static
+absl::Status OpenCvBatchedImageDecoderCalculator::GetContract(
+    CalculatorContract* cc) {
+  cc->Inputs().Tag(kEncodedImagesTag).Set<std::vector<std::string>>();
+  cc->Outputs().Tag(kImagesTag).Set<std::vector<Image>>();
+  cc->UseService(kCpuImageBufferPoolService).Optional();
+  return absl::OkStatus();
+}
+
+absl::Status OpenCvBatchedImageDecoderCalculator::Open(CalculatorContext* cc) {
+  cc->SetOffset(TimestampDiff(0));
+  options_ = cc->Options<OpenCvBatchedImageDecoderCalculatorOptions>();
+  RET_CHECK_GE(options_.num_threads(), 1);
+  RET_CHECK_GE(options_.target_width(), 0);
+  RET_CHECK_GE(options_.target_height(), 0);
+  if (options_.num_threads() > 1) {
+    thread_pool_ = absl::make_unique<ThreadPool>("OpenCvBatchedImageDecoder",
+                                                 options_.num_threads());
+    thread_pool_->StartWorkers();
+  }
+  if (cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+    buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
+  }
+  return absl::OkStatus();
+}
+
+absl::Status OpenCvBatchedImageDecoderCalculator::Process(
+    CalculatorContext* cc) {
+  const auto& encoded_images =
+      cc->Inputs().Tag(kEncodedImagesTag).Get<std::vector<std::string>>();
+  const int num_images = encoded_images.size();
+  auto images = absl::make_unique<std::vector<Image>>(num_images);
+  std::vector<absl::Status> statuses(num_images);
+
+  // Images are handed out one at a time, as their decoding times vary.
+  std::atomic<int> next_image(0);
+  auto decode_images = [&]() {
+    cv::Mat decoded;
+    for (int i = next_image++; i < num_images; i = next_image++) {
+      statuses[i] = DecodeImage(encoded_images[i], &decoded, &(*images)[i]);
+    }
+  };
+  const int num_tasks =
+      thread_pool_ ? std::min(thread_pool_->num_threads(), num_images) : 1;
+  if (num_tasks <= 1) {
+    decode_images();
+  } else {
+    absl::BlockingCounter counter(num_tasks);
+    for (int i = 0; i < num_tasks; ++i) {
+      thread_pool_->Schedule([&decode_images, &counter]() {
+        decode_images();
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+
+  for (int i = 0; i < num_images; ++i) {
+    if (!statuses[i].ok()) {
+      return mediapipe::StatusBuilder(std::move(statuses[i]), MEDIAPIPE_LOC)
+                 .SetPrepend()
+             << "Image " << i << " of the batch: ";
+    }
+  }
+  cc->Outputs().Tag(kImagesTag).Add(images.release(), cc->InputTimestamp());
+  return absl::OkStatus();
+}
+
+int OpenCvBatchedImageDecoderCalculator::DecodeFlags(
+    const std::string& contents) const {
+  // As OpenCvEncodedImageToImageFrameCalculator: as permissive as possible,
+  // applying the EXIF orientation only if requested.
+  const int flags = options_.apply_orientation_from_exif_data()
+                        ? cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH
+                        : cv::IMREAD_UNCHANGED;
+  int width, height, components;
+  if (options_.target_width() == 0 || options_.target_height() == 0 ||
+      !ReadJpegHeader(contents, &width, &height, &components)) {
+    return flags;
+  }
+  const bool gray = components == 1;
+  int reduced_flags;
+  switch (ReducedScale(width, height, options_.target_width(),
+                       options_.target_height())) {
+    case 8:
+      reduced_flags =
+          gray ? cv::IMREAD_REDUCED_GRAYSCALE_8 : cv::IMREAD_REDUCED_COLOR_8;
+      break;
+    case 4:
+      reduced_flags =
+          gray ? cv::IMREAD_REDUCED_GRAYSCALE_4 : cv::IMREAD_REDUCED_COLOR_4;
+      break;
+    case 2:
+      reduced_flags =
+          gray ? cv::IMREAD_REDUCED_GRAYSCALE_2 : cv::IMREAD_REDUCED_COLOR_2;
+      break;
+    default:
+      return flags;
+  }
+  if (!options_.apply_orientation_from_exif_data()) {
+    reduced_flags |= cv::IMREAD_IGNORE_ORIENTATION;
+  }
+  return reduced_flags;
+}
+
+absl::Status OpenCvBatchedImageDecoderCalculator::DecodeImage(
+    const std::string& contents, cv::Mat* decoded, Image* image) const {
+  // Decodes from the string without copying it, into the buffer of the
+  // previous image, which is reused if the images have the same size.
+  const cv::Mat buffer(1, static_cast<int>(contents.size()), CV_8U,
+                       const_cast<char*>(contents.data()));
+  cv::imdecode(buffer, DecodeFlags(contents), decoded);
+  RET_CHECK(!decoded->empty()) << "Failed to decode the image.";
+  RET_CHECK_EQ(decoded->depth(), CV_8U) << "Unsupported image depth.";
+
+  std::unique_ptr<ImageFrame> frame;
+  switch (decoded->channels()) {
+    case 1:
+      frame = NewImageFrame(buffer_pool_, ImageFormat::GRAY8, decoded->cols,
+                            decoded->rows,
+                            ImageFrame::kGlDefaultAlignmentBoundary);
+      decoded->copyTo(formats::MatView(frame.get()));
+      break;
+    case 3:
+      frame = NewImageFrame(buffer_pool_, ImageFormat::SRGB, decoded->cols,
+                            decoded->rows,
+                            ImageFrame::kGlDefaultAlignmentBoundary);
+      cv::cvtColor(*decoded, formats::MatView(frame.get()), cv::COLOR_BGR2RGB);
+      break;
+    case 4:
+      frame = NewImageFrame(buffer_pool_, ImageFormat::SRGBA, decoded->cols,
+                            decoded->rows,
+                            ImageFrame::kGlDefaultAlignmentBoundary);
+      cv::cvtColor(*decoded, formats::MatView(frame.get()),
+                   cv::COLOR_BGRA2RGBA);
+      break;
+    default:
+      return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
+             << "Unsupported number of channels: " << decoded->channels();
+  }
+  *image = Image(std::move(frame));
+  return absl::OkStatus();
+}
+
+}  // namespace mediapipe
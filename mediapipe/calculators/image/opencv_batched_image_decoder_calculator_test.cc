@@ -0,0 +1,223 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/substitute.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/image.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/file_helpers.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgcodecs_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+
+namespace {
+
+constexpr char kTestImagePath[] =
+    "/mediapipe/calculators/image/testdata/dino.jpg";
+
+std::string ReadTestImage() {
+  std::string contents;
+  CHECK(file::GetContents(file::JoinPath("./", kTestImagePath), &contents)
+            .ok());
+  return contents;
+}
+
+std::string Encode(const std::string& extension, const cv::Mat& mat) {
+  std::vector<uchar> buffer;
+  cv::imencode(extension, mat, buffer);
+  return std::string(buffer.begin(), buffer.end());
+}
+
+// The test image as a color JPEG, a grayscale JPEG and a PNG with alpha.
+std::vector<std::string> MakeEncodedImages() {
+  const std::string jpeg = ReadTestImage();
+  const cv::Mat bgr = cv::imdecode(
+      cv::Mat(1, jpeg.size(), CV_8U, const_cast<char*>(jpeg.data())),
+      cv::IMREAD_COLOR);
+  cv::Mat gray;
+  cv::cvtColor(bgr, gray, cv::COLOR_BGR2GRAY);
+  cv::Mat bgra;
+  cv::cvtColor(bgr, bgra, cv::COLOR_BGR2BGRA);
+  return {jpeg, Encode(".jpg", gray), Encode(".png", bgra)};
+}
+
+absl::StatusOr<std::vector<Image>> DecodeImages(
+    const std::vector<std::string>& encoded_images,
+    const std::string& options) {
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+      absl::Substitute(R"pb(
+                         calculator: "OpenCvBatchedImageDecoderCalculator"
+                         input_stream: "ENCODED_IMAGES:encoded_images"
+                         output_stream: "IMAGES:images"
+                         options {
+                           [mediapipe.OpenCvBatchedImageDecoderCalculatorOptions
+                                .ext] { $0 }
+                         }
+                       )pb",
+                       options)));
+  runner.MutableInputs()
+      ->Tag("ENCODED_IMAGES")
+      .packets.push_back(MakePacket<std::vector<std::string>>(encoded_images)
+                             .At(Timestamp(0)));
+  MP_RETURN_IF_ERROR(runner.Run());
+  const std::vector<Packet>& packets = runner.Outputs().Tag("IMAGES").packets;
+  RET_CHECK_EQ(packets.size(), 1);
+  return packets[0].Get<std::vector<Image>>();
+}
+
+// Expects @image to be @expected, decoded by OpenCV (in BGR order).
+void ExpectSameImage(const Image& image, const cv::Mat& expected) {
+  const cv::Mat view = formats::MatView(image.GetImageFrameSharedPtr().get());
+  ASSERT_EQ(view.size(), expected.size());
+  ASSERT_EQ(view.type(), expected.type());
+  cv::Mat actual = view;
+  if (view.channels() == 3) {
+    cv::cvtColor(view, actual, cv::COLOR_RGB2BGR);
+  } else if (view.channels() == 4) {
+    cv::cvtColor(view, actual, cv::COLOR_RGBA2BGRA);
+  }
+  EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0);
+}
+
+cv::Mat OpenCvDecode(const std::string& contents, int flags) {
+  return cv::imdecode(
+      cv::Mat(1, contents.size(), CV_8U, const_cast<char*>(contents.data())),
+      flags);
+}
+
+class OpenCvBatchedImageDecoderThreadsTest
+    : public testing::TestWithParam<int> {};
+
+TEST_P(OpenCvBatchedImageDecoderThreadsTest, DecodesImages) {
+  const std::vector<std::string> encoded_images = MakeEncodedImages();
+  // Images of different formats, interleaved so that threads decode all of
+  // them.
+  std::vector<std::string> batch;
+  for (int i = 0; i < 4; ++i) {
+    batch.insert(batch.end(), encoded_images.begin(), encoded_images.end());
+  }
+  auto images_or =
+      DecodeImages(batch, absl::StrCat("num_threads: ", GetParam()));
+  MP_ASSERT_OK(images_or);
+  const std::vector<Image>& images = images_or.value();
+  ASSERT_EQ(images.size(), batch.size());
+  for (int i = 0; i < batch.size(); ++i) {
+    ExpectSameImage(images[i], OpenCvDecode(batch[i], cv::IMREAD_UNCHANGED));
+  }
+  EXPECT_EQ(images[0].image_format(), ImageFormat::SRGB);
+  EXPECT_EQ(images[1].image_format(), ImageFormat::GRAY8);
+  EXPECT_EQ(images[2].image_format(), ImageFormat::SRGBA);
+}
+
+INSTANTIATE_TEST_SUITE_P(OpenCvBatchedImageDecoderThreadsTests,
+                         OpenCvBatchedImageDecoderThreadsTest,
+                         testing::Values(1, 3));
+
+TEST(OpenCvBatchedImageDecoderCalculatorTest, DecodesEmptyBatch) {
+  auto images_or = DecodeImages({}, "num_threads: 2");
+  MP_ASSERT_OK(images_or);
+  EXPECT_TRUE(images_or.value().empty());
+}
+
+TEST(OpenCvBatchedImageDecoderCalculatorTest, ReducesJpegToTargetSize) {
+  const std::vector<std::string> encoded_images = MakeEncodedImages();
+  const cv::Mat full_size =
+      OpenCvDecode(encoded_images[0], cv::IMREAD_UNCHANGED);
+  // A quarter of the image size, in the other orientation.
+  const int target_width = full_size.rows / 4;
+  const int target_height = full_size.cols / 4;
+  auto images_or = DecodeImages(
+      encoded_images, absl::Substitute("target_width: $0 target_height: $1",
+                                       target_width, target_height));
+  MP_ASSERT_OK(images_or);
+  const std::vector<Image>& images = images_or.value();
+  ASSERT_EQ(images.size(), 3);
+  ExpectSameImage(images[0], OpenCvDecode(encoded_images[0],
+                                          cv::IMREAD_REDUCED_COLOR_4 |
+                                              cv::IMREAD_IGNORE_ORIENTATION));
+  ExpectSameImage(
+      images[1],
+      OpenCvDecode(encoded_images[1], cv::IMREAD_REDUCED_GRAYSCALE_4 |
+                                          cv::IMREAD_IGNORE_ORIENTATION));
+  // Only JPEG images are reduced.
+  ExpectSameImage(images[2],
+                  OpenCvDecode(encoded_images[2], cv::IMREAD_UNCHANGED));
+}
+
+TEST(OpenCvBatchedImageDecoderCalculatorTest, FailsOnInvalidImage) {
+  std::vector<std::string> encoded_images = MakeEncodedImages();
+  encoded_images[1] = "not an image";
+  EXPECT_FALSE(DecodeImages(encoded_images, "num_threads: 2").ok());
+}
+
+constexpr int kBenchmarkBatchSize = 32;
+
+void BM_DecodeImagesOneByOne(benchmark::State& state) {
+  const std::string contents = ReadTestImage();
+  for (auto _ : state) {
+    CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+        R"pb(
+          calculator: "OpenCvEncodedImageToImageFrameCalculator"
+          input_stream: "encoded_image"
+          output_stream: "image_frame"
+        )pb"));
+    for (int i = 0; i < kBenchmarkBatchSize; ++i) {
+      runner.MutableInputs()->Index(0).packets.push_back(
+          MakePacket<std::string>(contents).At(Timestamp(i)));
+    }
+    CHECK(runner.Run().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kBenchmarkBatchSize);
+}
+
+BENCHMARK(BM_DecodeImagesOneByOne);
+
+// Args: number of threads, target size (0 for none).
+void BM_DecodeImageBatch(benchmark::State& state) {
+  const std::vector<std::string> batch(kBenchmarkBatchSize, ReadTestImage());
+  std::string options = absl::StrCat("num_threads: ", state.range(0));
+  if (state.range(1) > 0) {
+    absl::StrAppend(&options, " target_width: ", state.range(1),
+                    " target_height: ", state.range(1));
+  }
+  for (auto _ : state) {
+    CHECK(DecodeImages(batch, options).ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kBenchmarkBatchSize);
+}
+
+BENCHMARK(BM_DecodeImageBatch)
+    ->Args({1, 0})
+    ->Args({4, 0})
+    ->Args({1, 224})
+    ->Args({4, 224});
+
+}  // namespace
+}  // namespace mediapipe
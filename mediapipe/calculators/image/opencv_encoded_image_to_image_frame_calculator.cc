@@ -23,8 +23,8 @@
 namespace mediapipe {
 
 // Takes in an encoded image string, decodes it by OpenCV, and converts to an
-// ImageFrame. Note that this calculator only supports grayscale and RGB images
-// for now.
+// ImageFrame. Note that this calculator only supports 8-bit grayscale, RGB and
+// RGBA images for now.
 //
 // Example config:
 // node {
@@ -72,29 +72,39 @@ absl::Status OpenCvEncodedImageToImageFrameCalculator::Process(
     // Return the loaded image as-is
     decoded_mat = cv::imdecode(contents_vector, cv::IMREAD_UNCHANGED);
   }
-  ImageFormat::Format image_format = ImageFormat::UNKNOWN;
-  cv::Mat output_mat;
+  // Both reading modes keep the bit depth of the encoded image.
+  if (decoded_mat.depth() != CV_8U) {
+    return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
+           << "Unsupported image depth: " << decoded_mat.depth()
+           << ", only 8-bit images are supported.";
+  }
+  // Color images are converted straight into the output frame, and grayscale
+  // ones are handed over without a copy when their rows are aligned.
+  std::unique_ptr<ImageFrame> output_frame;
   switch (decoded_mat.channels()) {
     case 1:
-      image_format = ImageFormat::GRAY8;
-      output_mat = decoded_mat;
+      output_frame = formats::MatToImageFrame(
+          ImageFormat::GRAY8, decoded_mat,
+          ImageFrame::kGlDefaultAlignmentBoundary);
       break;
     case 3:
-      image_format = ImageFormat::SRGB;
-      cv::cvtColor(decoded_mat, output_mat, cv::COLOR_BGR2RGB);
+      output_frame = absl::make_unique<ImageFrame>(
+          ImageFormat::SRGB, decoded_mat.size().width,
+          decoded_mat.size().height, ImageFrame::kGlDefaultAlignmentBoundary);
+      cv::cvtColor(decoded_mat, formats::MatView(output_frame.get()),
+                   cv::COLOR_BGR2RGB);
       break;
     case 4:
-      image_format = ImageFormat::SRGBA;
-      cv::cvtColor(decoded_mat, output_mat, cv::COLOR_BGR2RGBA);
+      output_frame = absl::make_unique<ImageFrame>(
+          ImageFormat::SRGBA, decoded_mat.size().width,
+          decoded_mat.size().height, ImageFrame::kGlDefaultAlignmentBoundary);
+      cv::cvtColor(decoded_mat, formats::MatView(output_frame.get()),
+                   cv::COLOR_BGR2RGBA);
       break;
     default:
       return mediapipe::FailedPreconditionErrorBuilder(MEDIAPIPE_LOC)
              << "Unsupported number of channels: " << decoded_mat.channels();
   }
-  std::unique_ptr<ImageFrame> output_frame = absl::make_unique<ImageFrame>(
-      image_format, decoded_mat.size().width, decoded_mat.size().height,
-      ImageFrame::kGlDefaultAlignmentBoundary);
-  output_mat.copyTo(formats::MatView(output_frame.get()));
   cc->Outputs().Index(0).Add(output_frame.release(), cc->InputTimestamp());
   return absl::OkStatus();
 }
@@ -102,5 +102,27 @@ TEST(OpenCvEncodedImageToImageFrameCalculatorTest, TestGrayscaleJpeg) {
   EXPECT_LE(max_val, 10);
 }
 
+TEST(OpenCvEncodedImageToImageFrameCalculatorTest, Test16BitGrayscalePngFails) {
+  cv::Mat input_mat(16, 16, CV_16UC1, cv::Scalar(1000));
+  std::vector<uchar> encode_buffer;
+  ASSERT_TRUE(cv::imencode(".png", input_mat, encode_buffer));
+  Packet input_packet = MakePacket<std::string>(std::string(absl::string_view(
+      reinterpret_cast<const char*>(&encode_buffer[0]), encode_buffer.size())));
+
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+        calculator: "OpenCvEncodedImageToImageFrameCalculator"
+        input_stream: "encoded_image"
+        output_stream: "image_frame"
+      )pb");
+  CalculatorRunner runner(node_config);
+  runner.MutableInputs()->Index(0).packets.push_back(
+      input_packet.At(Timestamp(0)));
+  auto status = runner.Run();
+  ASSERT_FALSE(status.ok());
+  EXPECT_THAT(status.message(),
+              testing::HasSubstr("only 8-bit images are supported"));
+}
+
 }  // namespace
 }  // namespace mediapipe
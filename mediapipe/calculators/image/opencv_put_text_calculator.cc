@@ -47,9 +47,8 @@ absl::Status OpenCvPutTextCalculator::Process(CalculatorContext* cc) {
   cv::Mat mat = cv::Mat::zeros(640, 640, CV_8UC4);
   cv::putText(mat, text_content, cv::Point(15, 70), cv::FONT_HERSHEY_PLAIN, 3,
               cv::Scalar(255, 255, 0, 255), 4);
-  std::unique_ptr<ImageFrame> output_frame = absl::make_unique<ImageFrame>(
-      ImageFormat::SRGBA, mat.size().width, mat.size().height);
-  mat.copyTo(formats::MatView(output_frame.get()));
+  std::unique_ptr<ImageFrame> output_frame =
+      formats::MatToImageFrame(ImageFormat::SRGBA, mat);
   cc->Outputs().Index(0).Add(output_frame.release(), cc->InputTimestamp());
   return absl::OkStatus();
 }
@@ -16,6 +16,7 @@
 
 #include "mediapipe/calculators/image/recolor_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
@@ -117,6 +118,8 @@ class RecolorCalculator : public CalculatorBase {
   mediapipe::RecolorCalculatorOptions::MaskChannel mask_channel_;
 
   bool use_gpu_ = false;
+  // Allocates the CPU outputs, if provided by the graph.
+  CpuImageBufferPool* buffer_pool_ = nullptr;
   bool invert_mask_ = false;
   bool adjust_with_luminance_ = false;
 #if !MEDIAPIPE_DISABLE_GPU
@@ -161,6 +164,7 @@ absl::Status RecolorCalculator::GetContract(CalculatorContract* cc) {
 #endif  // !MEDIAPIPE_DISABLE_GPU
   if (cc->Outputs().HasTag(kImageFrameTag)) {
     cc->Outputs().Tag(kImageFrameTag).Set<ImageFrame>();
+    cc->UseService(kCpuImageBufferPoolService).Optional();
   }
 
   // Confirm only one of the input streams is present.
@@ -187,6 +191,8 @@ absl::Status RecolorCalculator::Open(CalculatorContext* cc) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(gpu_helper_.Open(cc));
 #endif  // !MEDIAPIPE_DISABLE_GPU
+  } else if (cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+    buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
   }
 
   MP_RETURN_IF_ERROR(LoadOptions(cc));
@@ -252,8 +258,8 @@ absl::Status RecolorCalculator::RenderCpu(CalculatorContext* cc) {
   cv::resize(mask_mat, mask_full, input_mat.size());
   const cv::Vec3b recolor = {color_[0], color_[1], color_[2]};
 
-  auto output_img = absl::make_unique<ImageFrame>(
-      input_img.Format(), input_mat.cols, input_mat.rows);
+  auto output_img = NewImageFrame(buffer_pool_, input_img.Format(),
+                                  input_mat.cols, input_mat.rows);
   cv::Mat output_mat = mediapipe::formats::MatView(output_img.get());
 
   const int invert_mask = invert_mask_ ? 1 : 0;
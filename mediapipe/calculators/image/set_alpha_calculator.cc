@@ -17,6 +17,7 @@
 #include "mediapipe/calculators/image/set_alpha_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/calculator_options.pb.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
@@ -106,6 +107,8 @@ class SetAlphaCalculator : public CalculatorBase {
 
   bool use_gpu_ = false;
   bool gpu_initialized_ = false;
+  // Allocates the CPU outputs, if provided by the graph.
+  CpuImageBufferPool* buffer_pool_ = nullptr;
 #if !MEDIAPIPE_DISABLE_GPU
   mediapipe::GlCalculatorHelper gpu_helper_;
   GLuint program_ = 0;
@@ -158,6 +161,7 @@ absl::Status SetAlphaCalculator::GetContract(CalculatorContract* cc) {
 #endif  // !MEDIAPIPE_DISABLE_GPU
   if (cc->Outputs().HasTag(kOutputFrameTag)) {
     cc->Outputs().Tag(kOutputFrameTag).Set<ImageFrame>();
+    cc->UseService(kCpuImageBufferPoolService).Optional();
   }
 
   if (use_gpu) {
@@ -197,6 +201,9 @@ absl::Status SetAlphaCalculator::Open(CalculatorContext* cc) {
     MP_RETURN_IF_ERROR(gpu_helper_.Open(cc));
 #endif
   }  //  !MEDIAPIPE_DISABLE_GPU
+  if (!use_gpu_ && cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+    buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
+  }
 
   return absl::OkStatus();
 }
@@ -244,8 +251,8 @@ absl::Status SetAlphaCalculator::RenderCpu(CalculatorContext* cc) {
   }
 
   // Setup destination image
-  auto output_frame = absl::make_unique<ImageFrame>(
-      ImageFormat::SRGBA, input_mat.cols, input_mat.rows);
+  auto output_frame = NewImageFrame(buffer_pool_, ImageFormat::SRGBA,
+                                    input_mat.cols, input_mat.rows);
   cv::Mat output_mat = mediapipe::formats::MatView(output_frame.get());
 
   const bool has_alpha_mask = cc->Inputs().HasTag(kInputAlphaTag) &&
@@ -198,7 +198,14 @@ class AudioToTensorCalculator : public Node {
   audio_dsp::QResamplerParams params_;
   // A QResampler instance to resample an audio stream.
   std::unique_ptr<audio_dsp::QResampler<float>> resampler_;
+  // In the streaming mode, the samples not consumed yet are the
+  // num_buffered_samples_ columns of sample_buffer_ from first_buffered_sample_
+  // on. New samples are appended after them, and the buffered samples are only
+  // moved back to the start of sample_buffer_ when it runs out of space, so
+  // that every frame is contiguous and copied once, into its tensor.
   Matrix sample_buffer_;
+  int first_buffered_sample_ = 0;
+  int num_buffered_samples_ = 0;
   int processed_buffer_cols_ = 0;
 
   // The internal state of the FFT library.
@@ -215,15 +222,21 @@ class AudioToTensorCalculator : public Node {
                                        const Matrix& input);
 
   absl::Status SetupStreamingResampler(double input_sample_rate_);
-  void AppendToSampleBuffer(Matrix buffer_to_append);
+  // Makes room for @num_samples more samples after the buffered ones, and
+  // returns the block of sample_buffer_ they go into.
+  Matrix::ColsBlockXpr ReserveSampleBuffer(int num_samples);
+  void AppendToSampleBuffer(const Matrix& buffer_to_append);
   void AppendZerosToSampleBuffer(int num_samples);
+  // The samples buffered in the streaming mode.
+  Eigen::Ref<const Matrix> BufferedSamples() const {
+    return sample_buffer_.middleCols(first_buffered_sample_,
+                                     num_buffered_samples_);
+  }
 
-  absl::StatusOr<std::vector<Tensor>> ConvertToTensor(
-      const Matrix& block, std::vector<int> tensor_dims);
-  absl::Status OutputTensor(const Matrix& block, Timestamp timestamp,
-                            CalculatorContext* cc);
-  absl::Status ProcessBuffer(const Matrix& buffer, bool should_flush,
-                             CalculatorContext* cc);
+  absl::Status OutputTensor(const Eigen::Ref<const Matrix>& block,
+                            Timestamp timestamp, CalculatorContext* cc);
+  absl::Status ProcessBuffer(const Eigen::Ref<const Matrix>& buffer,
+                             bool should_flush, CalculatorContext* cc);
 };
 
 absl::Status AudioToTensorCalculator::UpdateContract(CalculatorContract* cc) {
@@ -269,8 +282,8 @@ absl::Status AudioToTensorCalculator::Open(CalculatorContext* cc) {
   stream_mode_ = options.stream_mode();
   if (stream_mode_) {
     check_inconsistent_timestamps_ = options.check_inconsistent_timestamps();
-    sample_buffer_.resize(num_channels_, Eigen::NoChange);
   }
+  sample_buffer_.resize(num_channels_, 0);
   padding_samples_before_ = options.padding_samples_before();
   padding_samples_after_ = options.padding_samples_after();
   flush_mode_ = options.flush_mode();
@@ -354,7 +367,8 @@ absl::Status AudioToTensorCalculator::Close(CalculatorContext* cc) {
     AppendToSampleBuffer(std::move(resampled_buffer));
   }
   AppendZerosToSampleBuffer(padding_samples_after_);
-  MP_RETURN_IF_ERROR(ProcessBuffer(sample_buffer_, /*should_flush=*/true, cc));
+  MP_RETURN_IF_ERROR(
+      ProcessBuffer(BufferedSamples(), /*should_flush=*/true, cc));
   if (fft_state_) {
     pffft_destroy_setup(fft_state_);
   }
@@ -386,23 +400,16 @@ absl::Status AudioToTensorCalculator::ProcessStreamingData(
   if (resampler_) {
     Matrix resampled_buffer(num_channels_, 0);
     resampler_->ProcessSamples(input_buffer, &resampled_buffer);
-    AppendToSampleBuffer(std::move(resampled_buffer));
+    AppendToSampleBuffer(resampled_buffer);
   } else {
-    // Tries to consume the input matrix first to avoid extra data copy.
-    auto status_or_matrix = kAudioIn(cc).packet().Consume<Matrix>();
-    if (status_or_matrix.ok()) {
-      Matrix local_matrix(num_channels_, 0);
-      local_matrix.swap(*status_or_matrix.value());
-      AppendToSampleBuffer(std::move(local_matrix));
-    } else {
-      AppendToSampleBuffer(input_buffer);
-    }
+    AppendToSampleBuffer(input_buffer);
   }
 
-  MP_RETURN_IF_ERROR(ProcessBuffer(sample_buffer_, /*should_flush=*/false, cc));
+  MP_RETURN_IF_ERROR(
+      ProcessBuffer(BufferedSamples(), /*should_flush=*/false, cc));
   // Removes the processed samples from the global sample buffer.
-  sample_buffer_ = Matrix(sample_buffer_.rightCols(sample_buffer_.cols() -
-                                                   processed_buffer_cols_ - 1));
+  first_buffered_sample_ += processed_buffer_cols_ + 1;
+  num_buffered_samples_ -= processed_buffer_cols_ + 1;
   return absl::OkStatus();
 }
 
@@ -440,51 +447,65 @@ absl::Status AudioToTensorCalculator::SetupStreamingResampler(
   return absl::OkStatus();
 }
 
+Matrix::ColsBlockXpr AudioToTensorCalculator::ReserveSampleBuffer(
+    int num_samples) {
+  const int num_samples_needed = num_buffered_samples_ + num_samples;
+  if (first_buffered_sample_ + num_samples_needed > sample_buffer_.cols()) {
+    if (num_samples_needed <= sample_buffer_.cols()) {
+      // Moves the buffered samples back to the start of the buffer.
+      std::memmove(sample_buffer_.data(),
+                   sample_buffer_.data() +
+                       static_cast<size_t>(first_buffered_sample_) *
+                           num_channels_,
+                   static_cast<size_t>(num_buffered_samples_) * num_channels_ *
+                       sizeof(float));
+    } else {
+      // Room for a few frames, so that the buffered samples are rarely moved.
+      Matrix buffer(num_channels_,
+                    std::max<int>({num_samples_needed,
+                                   2 * static_cast<int>(sample_buffer_.cols()),
+                                   4 * (num_samples_ + frame_step_)}));
+      buffer.leftCols(num_buffered_samples_) = BufferedSamples();
+      sample_buffer_.swap(buffer);
+    }
+    first_buffered_sample_ = 0;
+  }
+  num_buffered_samples_ += num_samples;
+  return sample_buffer_.middleCols(
+      first_buffered_sample_ + num_buffered_samples_ - num_samples,
+      num_samples);
+}
+
 void AudioToTensorCalculator::AppendZerosToSampleBuffer(int num_samples) {
   CHECK_GE(num_samples, 0);  // Ensured by `UpdateContract`.
   if (num_samples == 0) {
     return;
   }
-  sample_buffer_.conservativeResize(Eigen::NoChange,
-                                    sample_buffer_.cols() + num_samples);
-  sample_buffer_.rightCols(num_samples).setZero();
-}
-
-void AudioToTensorCalculator::AppendToSampleBuffer(Matrix buffer_to_append) {
-  sample_buffer_.conservativeResize(
-      Eigen::NoChange, sample_buffer_.cols() + buffer_to_append.cols());
-  sample_buffer_.rightCols(buffer_to_append.cols()).swap(buffer_to_append);
+  ReserveSampleBuffer(num_samples).setZero();
 }
 
-absl::StatusOr<std::vector<Tensor>> AudioToTensorCalculator::ConvertToTensor(
-    const Matrix& block, std::vector<int> tensor_dims) {
-  Tensor tensor(Tensor::ElementType::kFloat32, Tensor::Shape(tensor_dims));
-  auto buffer_view = tensor.GetCpuWriteView();
-  int total_size = 1;
-  for (int dim : tensor_dims) {
-    total_size *= dim;
-  }
-  if (block.size() < total_size) {
-    std::memset(buffer_view.buffer<float>(), 0, tensor.bytes());
-  }
-  std::memcpy(buffer_view.buffer<float>(), block.data(),
-              block.size() * sizeof(float));
-  std::vector<Tensor> tensor_vector;
-  tensor_vector.push_back(std::move(tensor));
-  return tensor_vector;
+void AudioToTensorCalculator::AppendToSampleBuffer(
+    const Matrix& buffer_to_append) {
+  if (buffer_to_append.cols() == 0) {
+    return;
+  }
+  ReserveSampleBuffer(buffer_to_append.cols()) = buffer_to_append;
 }
 
-absl::Status AudioToTensorCalculator::OutputTensor(const Matrix& block,
-                                                   Timestamp timestamp,
-                                                   CalculatorContext* cc) {
+absl::Status AudioToTensorCalculator::OutputTensor(
+    const Eigen::Ref<const Matrix>& block, Timestamp timestamp,
+    CalculatorContext* cc) {
+  // The columns of the block are contiguous: it spans all the channels.
+  const int block_size = block.size();
   std::vector<Tensor> output_tensor;
   if (fft_state_) {
-    Eigen::VectorXf time_series_data =
-        Eigen::VectorXf::Map(block.data(), block.size());
-    //  Window on input audio prior to FFT.
-    std::transform(time_series_data.begin(), time_series_data.end(),
-                   fft_window_.begin(), fft_input_buffer_.begin(),
-                   std::multiplies<float>());
+    //  Window on input audio prior to FFT, zero-padded to the FFT size.
+    const int fft_input_size = std::min(block_size, fft_size_);
+    Eigen::Map<Eigen::ArrayXf>(fft_input_buffer_.data(), fft_input_size) =
+        Eigen::Map<const Eigen::ArrayXf>(block.data(), fft_input_size) *
+        Eigen::Map<const Eigen::ArrayXf>(fft_window_.data(), fft_input_size);
+    std::fill(fft_input_buffer_.begin() + fft_input_size,
+              fft_input_buffer_.end(), 0.0f);
     pffft_transform_ordered(fft_state_, fft_input_buffer_.data(),
                             fft_output_.data(), fft_workplace_.data(),
                             PFFFT_FORWARD);
@@ -492,25 +513,34 @@ absl::Status AudioToTensorCalculator::OutputTensor(const Matrix& block,
       kDcAndNyquistOut(cc).Send(std::make_pair(fft_output_[0], fft_output_[1]),
                                 timestamp);
     }
-    Matrix fft_output_matrix =
-        Eigen::Map<const Matrix>(fft_output_.data() + 2, 1, fft_size_ - 2);
-    fft_output_matrix.conservativeResize(Eigen::NoChange, fft_size_);
+    Tensor tensor(Tensor::ElementType::kFloat32,
+                  Tensor::Shape({2, fft_size_ / 2}));
+    auto buffer_view = tensor.GetCpuWriteView();
+    float* buffer = buffer_view.buffer<float>();
+    std::memcpy(buffer, fft_output_.data() + 2,
+                (fft_size_ - 2) * sizeof(float));
     // The last two elements are the DFT Nyquist values.
-    fft_output_matrix(fft_size_ - 2) = fft_output_[1];  // Nyquist real part
-    fft_output_matrix(fft_size_ - 1) = 0.0f;            // Nyquist imagery part
-    ASSIGN_OR_RETURN(output_tensor,
-                     ConvertToTensor(fft_output_matrix, {2, fft_size_ / 2}));
+    buffer[fft_size_ - 2] = fft_output_[1];  // Nyquist real part
+    buffer[fft_size_ - 1] = 0.0f;            // Nyquist imagery part
+    output_tensor.push_back(std::move(tensor));
   } else {
-    ASSIGN_OR_RETURN(output_tensor,
-                     ConvertToTensor(block, {num_channels_, num_samples_}));
+    Tensor tensor(Tensor::ElementType::kFloat32,
+                  Tensor::Shape({num_channels_, num_samples_}));
+    auto buffer_view = tensor.GetCpuWriteView();
+    float* buffer = buffer_view.buffer<float>();
+    std::memcpy(buffer, block.data(), block_size * sizeof(float));
+    // Zero-pads the last frame.
+    std::fill(buffer + block_size, buffer + num_channels_ * num_samples_,
+              0.0f);
+    output_tensor.push_back(std::move(tensor));
   }
   kTensorsOut(cc).Send(std::move(output_tensor), timestamp);
   return absl::OkStatus();
 }
 
-absl::Status AudioToTensorCalculator::ProcessBuffer(const Matrix& buffer,
-                                                    bool should_flush,
-                                                    CalculatorContext* cc) {
+absl::Status AudioToTensorCalculator::ProcessBuffer(
+    const Eigen::Ref<const Matrix>& buffer, bool should_flush,
+    CalculatorContext* cc) {
   const bool should_flush_at_timestamp_max =
       stream_mode_ && should_flush &&
       flush_mode_ == Options::ENTIRE_TAIL_AT_TIMESTAMP_MAX;
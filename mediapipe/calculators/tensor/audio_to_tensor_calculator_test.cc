@@ -16,15 +16,20 @@
 #include <string>
 #include <vector>
 
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "audio/dsp/resampler_q.h"
 #include "mediapipe/calculators/tensor/audio_to_tensor_calculator.pb.h"
 #include "mediapipe/framework/api2/packet.h"
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/framework/timestamp.h"
@@ -464,6 +469,23 @@ TEST_F(AudioToTensorCalculatorStreamingModeTest, OutputOverlappingFp32Tensors) {
   CloseGraph();
 }
 
+TEST_F(AudioToTensorCalculatorStreamingModeTest,
+       OutputLargeOverlappingTensorsFromSmallPackets) {
+  // Input packets much smaller than the frames, so that the buffered samples
+  // are moved back to the start of the sample buffer several times.
+  SetInputBufferNumSamplesPerChannel(7);
+  SetNumIterations(100);
+  Run(/*num_samples=*/64, /*num_overlapping_samples=*/48,
+      /*resampling_factor=*/1.0f);
+  // 40 frames of the 700 samples, and the remaining 60 samples at close.
+  CheckTensorsOutputPackets(
+      /*sample_offset=*/32,
+      /*num_packets=*/41,
+      /*timestamp_interval=*/1600,
+      /*output_last_at_close=*/true);
+  CloseGraph();
+}
+
 TEST_F(AudioToTensorCalculatorStreamingModeTest, Downsampling) {
   SetInputBufferNumSamplesPerChannel(1000);
   Run(/*num_samples=*/256, /*num_overlapping_samples=*/0,
@@ -663,5 +685,59 @@ TEST_F(AudioToTensorCalculatorFftTest, TestImpulseSignal) {
   CloseGraph();
 }
 
+// Keyword spotting style streaming: 10 s of 16 kHz mono audio, in packets of
+// 10 ms, into overlapping windows.
+// Args: samples per window, overlapping samples per window, FFT size (0 for
+// none).
+void BM_StreamingAudioToTensor(benchmark::State& state) {
+  constexpr double kSampleRate = 16000;
+  constexpr int kPacketSamples = 160;
+  constexpr int kNumPackets = 1000;
+  std::string options = absl::Substitute(
+      "num_channels: 1 num_samples: $0 num_overlapping_samples: $1 "
+      "target_sample_rate: $2 stream_mode: true",
+      state.range(0), state.range(1), kSampleRate);
+  if (state.range(2) > 0) {
+    absl::StrAppend(&options, " fft_size: ", state.range(2));
+  }
+  const auto node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::Substitute(
+          R"pb(
+            calculator: "AudioToTensorCalculator"
+            input_stream: "AUDIO:audio"
+            output_stream: "TENSORS:tensors"
+            options {
+              [mediapipe.AudioToTensorCalculatorOptions.ext] { $0 }
+            }
+          )pb",
+          options));
+  const Matrix samples = Matrix::Random(1, kPacketSamples);
+  for (auto _ : state) {
+    CalculatorRunner runner(node_config);
+    auto header = std::make_unique<TimeSeriesHeader>();
+    header->set_sample_rate(kSampleRate);
+    header->set_num_channels(1);
+    runner.MutableInputs()->Tag("AUDIO").header = Adopt(header.release());
+    for (int i = 0; i < kNumPackets; ++i) {
+      runner.MutableInputs()->Tag("AUDIO").packets.push_back(
+          MakePacket<Matrix>(samples).At(Timestamp(i * 10000)));
+    }
+    CHECK(runner.Run().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumPackets * kPacketSamples);
+  // Average processing time of an input packet.
+  state.counters["packet_latency"] = benchmark::Counter(
+      kNumPackets, benchmark::Counter::kIsIterationInvariantRate |
+                       benchmark::Counter::kInvert);
+}
+
+BENCHMARK(BM_StreamingAudioToTensor)
+    // 1 s windows every 20 ms.
+    ->Args({16000, 15680, 0})
+    // 1 s windows every 100 ms.
+    ->Args({16000, 14400, 0})
+    // 25 ms frames every 10 ms, with a 512 bin FFT.
+    ->Args({400, 240, 512});
+
 }  // namespace
 }  // namespace mediapipe
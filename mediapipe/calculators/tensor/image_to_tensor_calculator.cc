@@ -25,11 +25,13 @@
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/rect.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/gpu/gpu_buffer_storage_yuv_image.h"
 #include "mediapipe/gpu/gpu_origin.pb.h"
 
 #if !MEDIAPIPE_DISABLE_OPENCV
@@ -67,7 +69,8 @@ using GpuBuffer = mediapipe::GpuBuffer;
 // Inputs:
 //   IMAGE - Image[ImageFormat::SRGB / SRGBA, GpuBufferFormat::kBGRA32] or
 //           ImageFrame [ImageFormat::SRGB/SRGBA] (for backward compatibility
-//           with existing graphs that use IMAGE for ImageFrame input)
+//           with existing graphs that use IMAGE for ImageFrame input) or
+//           YUVImage [8-bit NV12/NV21/I420/YV12]
 //   IMAGE_GPU - GpuBuffer [GpuBufferFormat::kBGRA32]
 //     Image to extract from.
 //
@@ -76,6 +79,8 @@ using GpuBuffer = mediapipe::GpuBuffer;
 //   - IMAGE input of type Image is processed on GPU if the data is already on
 //     GPU (i.e., Image::UsesGpu() returns true), or otherwise processed on CPU.
 //   - IMAGE input of type ImageFrame is always processed on CPU.
+//   - IMAGE input of type YUVImage (or Image backed by one) is always
+//     processed on CPU, converting to RGB only the pixels sampled from the ROI.
 //   - IMAGE_GPU input (of type GpuBuffer) is always processed on GPU.
 //
 //   NORM_RECT - NormalizedRect @Optional
@@ -118,6 +123,10 @@ using GpuBuffer = mediapipe::GpuBuffer;
 //         min: 0.0
 //         max: 1.0
 //       }
+//       # Optional, for quantized models on CPU:
+//       # output_tensor_quantization {
+//       #   scale: 0.003921569 zero_point: -128 element_type: INT8
+//       # }
 //       # gpu_origin: CONVENTIONAL # or TOP_LEFT
 //     }
 //   }
@@ -125,7 +134,8 @@ using GpuBuffer = mediapipe::GpuBuffer;
 class ImageToTensorCalculator : public Node {
  public:
   static constexpr Input<
-      OneOf<mediapipe::Image, mediapipe::ImageFrame>>::Optional kIn{"IMAGE"};
+      OneOf<mediapipe::Image, mediapipe::ImageFrame, mediapipe::YUVImage>>::
+      Optional kIn{"IMAGE"};
   static constexpr Input<GpuBuffer>::Optional kInGpu{"IMAGE_GPU"};
   static constexpr Input<mediapipe::NormalizedRect>::Optional kInNormRect{
       "NORM_RECT"};
@@ -150,6 +160,13 @@ class ImageToTensorCalculator : public Node {
                    options.output_tensor_float_range().max())
           << "Valid output float tensor range is required.";
     }
+    if (options.has_output_tensor_quantization()) {
+      RET_CHECK(options.has_output_tensor_float_range())
+          << "Output tensor quantization requires output_tensor_float_range.";
+      MP_RETURN_IF_ERROR(ValidateQuantization(
+          options.output_tensor_float_range(),
+          options.output_tensor_quantization()));
+    }
     if (options.has_output_tensor_uint_range()) {
       RET_CHECK_LT(options.output_tensor_uint_range().min(),
                    options.output_tensor_uint_range().max())
@@ -213,6 +230,18 @@ class ImageToTensorCalculator : public Node {
       range_min_ = options_.output_tensor_float_range().min();
       range_max_ = options_.output_tensor_float_range().max();
     }
+    if (options_.has_output_tensor_quantization()) {
+      // Fold quantization into the value range transformation, so that the
+      // converter writes quantized values directly.
+      const auto& quantization = options_.output_tensor_quantization();
+      quantization_parameters_ = Tensor::QuantizationParameters(
+          quantization.scale(), quantization.zero_point());
+      range_min_ =
+          range_min_ / quantization.scale() + quantization.zero_point();
+      range_max_ =
+          range_max_ / quantization.scale() + quantization.zero_point();
+      is_float_output_ = false;
+    }
     return absl::OkStatus();
   }
 
@@ -292,10 +321,57 @@ class ImageToTensorCalculator : public Node {
     }
   }
 
+  // Checks that the float range, once quantized, and the zero point fit in the
+  // range of the quantized element type.
+  static absl::Status ValidateQuantization(
+      const ImageToTensorCalculatorOptions::FloatRange& float_range,
+      const ImageToTensorCalculatorOptions::QuantizationParameters&
+          quantization) {
+    RET_CHECK_GT(quantization.scale(), 0.0f)
+        << "Valid output tensor quantization scale is required.";
+    float type_min;
+    float type_max;
+    switch (quantization.element_type()) {
+      case ImageToTensorCalculatorOptions::QuantizationParameters::UINT8:
+        type_min = 0.0f;
+        type_max = 255.0f;
+        break;
+      case ImageToTensorCalculatorOptions::QuantizationParameters::INT8:
+        type_min = -128.0f;
+        type_max = 127.0f;
+        break;
+      default:
+        return absl::InvalidArgumentError(
+            "Output tensor quantization requires an element_type.");
+    }
+    RET_CHECK(quantization.zero_point() >= type_min &&
+              quantization.zero_point() <= type_max)
+        << "Output tensor quantization zero_point " << quantization.zero_point()
+        << " is out of the range of its element_type.";
+    // Values are rounded to the nearest integer, allow half a step.
+    const float quantized_min =
+        float_range.min() / quantization.scale() + quantization.zero_point();
+    const float quantized_max =
+        float_range.max() / quantization.scale() + quantization.zero_point();
+    RET_CHECK(quantized_min >= type_min - 0.5f &&
+              quantized_max <= type_max + 0.5f)
+        << "Output tensor float range [" << float_range.min() << ", "
+        << float_range.max() << "] is quantized to [" << quantized_min << ", "
+        << quantized_max << "], out of the range of its element_type.";
+    return absl::OkStatus();
+  }
+
   Tensor::ElementType GetOutputTensorType() {
     if (is_float_output_) {
       return Tensor::ElementType::kFloat32;
     }
+    if (options_.has_output_tensor_quantization()) {
+      return options_.output_tensor_quantization().element_type() ==
+                     ImageToTensorCalculatorOptions::QuantizationParameters::
+                         INT8
+                 ? Tensor::ElementType::kInt8
+                 : Tensor::ElementType::kUInt8;
+    }
     if (range_min_ < 0) {
       return Tensor::ElementType::kInt8;
     } else {
@@ -315,6 +391,12 @@ class ImageToTensorCalculator : public Node {
             return std::make_shared<const mediapipe::Image>(
                 std::const_pointer_cast<mediapipe::ImageFrame>(
                     SharedPtrWithPacket<mediapipe::ImageFrame>(packet)));
+          },
+          [&packet](const mediapipe::YUVImage&) {
+            return std::make_shared<const mediapipe::Image>(
+                std::make_shared<GpuBufferStorageYuvImage>(
+                    std::const_pointer_cast<mediapipe::YUVImage>(
+                        SharedPtrWithPacket<mediapipe::YUVImage>(packet))));
           });
     } else {  // if (kInGpu(cc).IsConnected())
 #if !MEDIAPIPE_DISABLE_GPU
@@ -366,7 +448,10 @@ class ImageToTensorCalculator : public Node {
 #if !MEDIAPIPE_DISABLE_OPENCV
         ASSIGN_OR_RETURN(
             cpu_converter_,
-            CreateOpenCvConverter(cc, GetBorderMode(), GetOutputTensorType()));
+            CreateOpenCvConverter(cc, GetBorderMode(), GetOutputTensorType(),
+                                  quantization_parameters_,
+                                  options_.cpu_num_threads(),
+                                  options_.use_fused_cpu_warp()));
 #else
         LOG(FATAL) << "Cannot create image to tensor opencv converter since "
                       "MEDIAPIPE_DISABLE_OPENCV is defined.";
@@ -384,6 +469,7 @@ class ImageToTensorCalculator : public Node {
   bool is_float_output_ = false;
   float range_min_ = 0.0f;
   float range_max_ = 1.0f;
+  Tensor::QuantizationParameters quantization_parameters_;
 };
 
 MEDIAPIPE_REGISTER_NODE(ImageToTensorCalculator);
@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include <cmath>
+#include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/flags/flag.h"
@@ -62,7 +64,8 @@ void RunTestWithInputImagePacket(const Packet& input_image_packet,
                                  int tensor_height, bool keep_aspect,
                                  absl::optional<BorderMode> border_mode,
                                  const mediapipe::NormalizedRect& roi,
-                                 bool output_int_tensor) {
+                                 bool output_int_tensor,
+                                 bool use_fused_cpu_warp) {
   std::string border_mode_str;
   if (border_mode) {
     switch (*border_mode) {
@@ -114,6 +117,7 @@ void RunTestWithInputImagePacket(const Packet& input_image_packet,
               keep_aspect_ratio: $2
               $3 # output range
               $4 # border mode
+              use_fused_cpu_warp: $5
             }
           }
         }
@@ -122,7 +126,8 @@ void RunTestWithInputImagePacket(const Packet& input_image_packet,
                        /*$1=*/tensor_height,
                        /*$2=*/keep_aspect ? "true" : "false",
                        /*$3=*/output_tensor_range,
-                       /*$4=*/border_mode_str));
+                       /*$4=*/border_mode_str,
+                       /*$5=*/use_fused_cpu_warp ? "true" : "false"));
 
   std::vector<Packet> output_packets;
   tool::AddVectorSink("tensor", &graph_config, &output_packets);
@@ -209,7 +214,8 @@ void RunTest(cv::Mat input, cv::Mat expected_result,
              std::vector<std::pair<int, int>> int_ranges, int tensor_width,
              int tensor_height, bool keep_aspect,
              absl::optional<BorderMode> border_mode,
-             const mediapipe::NormalizedRect& roi) {
+             const mediapipe::NormalizedRect& roi,
+             bool use_fused_cpu_warp = false) {
   for (auto input_type : kInputTypesToTest) {
     for (auto float_range : float_ranges) {
       RunTestWithInputImagePacket(
@@ -217,7 +223,7 @@ void RunTest(cv::Mat input, cv::Mat expected_result,
                                                : MakeImagePacket(input),
           expected_result, float_range.first, float_range.second, tensor_width,
           tensor_height, keep_aspect, border_mode, roi,
-          /*output_int_tensor=*/false);
+          /*output_int_tensor=*/false, use_fused_cpu_warp);
     }
     for (auto int_range : int_ranges) {
       RunTestWithInputImagePacket(
@@ -225,7 +231,7 @@ void RunTest(cv::Mat input, cv::Mat expected_result,
                                                : MakeImagePacket(input),
           expected_result, int_range.first, int_range.second, tensor_width,
           tensor_height, keep_aspect, border_mode, roi,
-          /*output_int_tensor=*/true);
+          /*output_int_tensor=*/true, use_fused_cpu_warp);
     }
   }
 }
@@ -340,6 +346,25 @@ TEST(ImageToTensorCalculatorTest, MediumSubRectWithRotationBorderZero) {
           BorderMode::kZero, roi);
 }
 
+TEST(ImageToTensorCalculatorTest, MediumSubRectWithRotationFusedCpuWarp) {
+  mediapipe::NormalizedRect roi;
+  roi.set_x_center(0.65f);
+  roi.set_y_center(0.4f);
+  roi.set_width(0.5f);
+  roi.set_height(0.5f);
+  roi.set_rotation(M_PI * -45.0f / 180.0f);
+  RunTest(
+      GetRgb("/mediapipe/calculators/"
+             "tensor/testdata/image_to_tensor/input.jpg"),
+      GetRgb(
+          "/mediapipe/calculators/"
+          "tensor/testdata/image_to_tensor/medium_sub_rect_with_rotation.png"),
+      /*float_ranges=*/{{-1.0f, 1.0f}},
+      /*int_ranges=*/{{0, 255}, {-128, 127}},
+      /*tensor_width=*/256, /*tensor_height=*/256, /*keep_aspect=*/false,
+      BorderMode::kReplicate, roi, /*use_fused_cpu_warp=*/true);
+}
+
 TEST(ImageToTensorCalculatorTest, LargeSubRect) {
   mediapipe::NormalizedRect roi;
   roi.set_x_center(0.5f);
@@ -482,5 +507,97 @@ TEST(ImageToTensorCalculatorTest, NoOpExceptRangeBorderZero) {
           BorderMode::kZero, roi);
 }
 
+TEST(ImageToTensorCalculatorTest, NoOpExceptRangeQuantizedFloatRange) {
+  auto graph_config = mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "input_image"
+    node {
+      calculator: "ImageToTensorCalculator"
+      input_stream: "IMAGE:input_image"
+      output_stream: "TENSORS:tensor"
+      options {
+        [mediapipe.ImageToTensorCalculatorOptions.ext] {
+          output_tensor_width: 64
+          output_tensor_height: 128
+          keep_aspect_ratio: true
+          output_tensor_float_range { min: 0.0 max: 1.0 }
+          output_tensor_quantization {
+            scale: 0.003921569
+            zero_point: -128
+            element_type: INT8
+          }
+        }
+      }
+    }
+  )");
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor", &graph_config, &output_packets);
+
+  CalculatorGraph graph;
+  MP_ASSERT_OK(graph.Initialize(graph_config));
+  MP_ASSERT_OK(graph.StartRun({}));
+  cv::Mat input = GetRgba(
+      "/mediapipe/calculators/tensor/testdata/image_to_tensor/input.jpg");
+  MP_ASSERT_OK(
+      graph.AddPacketToInputStream("input_image", MakeImagePacket(input)));
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+  ASSERT_THAT(output_packets, testing::SizeIs(1));
+
+  // The [0, 1] range is folded into the quantization, so the tensor is int8
+  // and dequantizes back to the expected [0, 1] values.
+  const Tensor& tensor = output_packets[0].Get<std::vector<Tensor>>()[0];
+  ASSERT_EQ(tensor.element_type(), Tensor::ElementType::kInt8);
+  EXPECT_FLOAT_EQ(tensor.quantization_parameters().scale, 0.003921569f);
+  EXPECT_EQ(tensor.quantization_parameters().zero_point, -128);
+  auto view = tensor.GetCpuReadView();
+  cv::Mat tensor_mat(128, 64, CV_8SC3, const_cast<int8*>(view.buffer<int8>()));
+  cv::Mat result_rgb;
+  tensor_mat.convertTo(result_rgb, CV_8UC3, /*alpha=*/1.0, /*beta=*/128.0);
+
+  cv::Mat expected_result =
+      GetRgb("/mediapipe/calculators/"
+             "tensor/testdata/image_to_tensor/noop_except_range.png");
+  cv::Mat diff;
+  cv::absdiff(result_rgb, expected_result, diff);
+  double max_val;
+  cv::minMaxLoc(diff, nullptr, &max_val);
+  EXPECT_LE(max_val, 5);
+
+  MP_ASSERT_OK(graph.CloseInputStream("input_image"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+TEST(ImageToTensorCalculatorTest, QuantizationMustMatchElementType) {
+  // The [0, 1] range is quantized to [0, 255] by these parameters.
+  const std::string kQuantization =
+      "scale: 0.003921569 zero_point: 0 element_type: ";
+  for (const auto& [element_type, ok] :
+       std::vector<std::pair<std::string, bool>>{{"UINT8", true},
+                                                 {"INT8", false},
+                                                 {"ELEMENT_TYPE_UNSPECIFIED",
+                                                  false}}) {
+    auto graph_config =
+        mediapipe::ParseTextProtoOrDie<CalculatorGraphConfig>(absl::Substitute(
+            R"(
+              input_stream: "input_image"
+              node {
+                calculator: "ImageToTensorCalculator"
+                input_stream: "IMAGE:input_image"
+                output_stream: "TENSORS:tensor"
+                options {
+                  [mediapipe.ImageToTensorCalculatorOptions.ext] {
+                    output_tensor_width: 64
+                    output_tensor_height: 128
+                    output_tensor_float_range { min: 0.0 max: 1.0 }
+                    output_tensor_quantization { $0$1 }
+                  }
+                }
+              }
+            )",
+            kQuantization, element_type));
+    CalculatorGraph graph;
+    EXPECT_EQ(graph.Initialize(graph_config).ok(), ok) << element_type;
+  }
+}
+
 }  // namespace
 }  // namespace mediapipe
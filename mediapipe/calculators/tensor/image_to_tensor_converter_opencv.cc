@@ -14,49 +14,95 @@
 
 #include "mediapipe/calculators/tensor/image_to_tensor_converter_opencv.h"
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
 
+#include "absl/synchronization/blocking_counter.h"
+#include "libyuv/video_common.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
 #include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_warp_utils.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_opencv.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/formats/yuv_image.h"
 #include "mediapipe/framework/port/canonical_errors.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/gpu/gpu_buffer_storage_yuv_image.h"
 
 namespace mediapipe {
 
 namespace {
 
+// Minimum number of output rows worth handing to a separate thread.
+constexpr int kMinRowsPerChunk = 16;
+
+// Describes the planes of an 8-bit 4:2:0 YUVImage for the fused kernel.
+absl::StatusOr<WarpSourceYuvImage> GetWarpSourceYuvImage(
+    const YUVImage& yuv_image) {
+  RET_CHECK_EQ(yuv_image.bit_depth(), 8)
+      << "Only 8-bit YUVImage is supported.";
+  WarpSourceYuvImage image;
+  image.y = yuv_image.data(0);
+  image.y_row_stride = yuv_image.stride(0);
+  image.width = yuv_image.width();
+  image.height = yuv_image.height();
+  switch (yuv_image.fourcc()) {
+    case libyuv::FOURCC_NV12:
+      image.u = yuv_image.data(1);
+      image.v = yuv_image.data(1) + 1;
+      image.uv_row_stride = yuv_image.stride(1);
+      image.uv_pixel_stride = 2;
+      break;
+    case libyuv::FOURCC_NV21:
+      image.v = yuv_image.data(1);
+      image.u = yuv_image.data(1) + 1;
+      image.uv_row_stride = yuv_image.stride(1);
+      image.uv_pixel_stride = 2;
+      break;
+    case libyuv::FOURCC_I420:
+    case libyuv::FOURCC_YV12: {
+      RET_CHECK_EQ(yuv_image.stride(1), yuv_image.stride(2))
+          << "U and V planes must have the same stride.";
+      const bool is_i420 = yuv_image.fourcc() == libyuv::FOURCC_I420;
+      image.u = yuv_image.data(is_i420 ? 1 : 2);
+      image.v = yuv_image.data(is_i420 ? 2 : 1);
+      image.uv_row_stride = yuv_image.stride(1);
+      image.uv_pixel_stride = 1;
+      break;
+    }
+    default:
+      return InvalidArgumentError(
+          absl::StrCat("Unsupported YUVImage fourcc: ", yuv_image.fourcc()));
+  }
+  image.coefficients = GetYuvToRgbCoefficients(
+      yuv_image.matrix_coefficients() ==
+          YUVImage::COLOR_MATRIX_COEFFICIENTS_BT709,
+      yuv_image.full_range());
+  return image;
+}
+
 class OpenCvProcessor : public ImageToTensorConverter {
  public:
-  OpenCvProcessor(BorderMode border_mode, Tensor::ElementType tensor_type)
-      : tensor_type_(tensor_type) {
-    switch (border_mode) {
-      case BorderMode::kReplicate:
-        border_mode_ = cv::BORDER_REPLICATE;
-        break;
-      case BorderMode::kZero:
-        border_mode_ = cv::BORDER_CONSTANT;
-        break;
-    }
-    switch (tensor_type_) {
-      case Tensor::ElementType::kInt8:
-        mat_type_ = CV_8SC3;
-        break;
-      case Tensor::ElementType::kFloat32:
-        mat_type_ = CV_32FC3;
-        break;
-      case Tensor::ElementType::kUInt8:
-        mat_type_ = CV_8UC3;
-        break;
-      default:
-        mat_type_ = -1;
+  OpenCvProcessor(
+      BorderMode border_mode, Tensor::ElementType tensor_type,
+      const Tensor::QuantizationParameters& quantization_parameters,
+      int num_threads, bool use_fused_warp)
+      : border_mode_(border_mode),
+        tensor_type_(tensor_type),
+        quantization_parameters_(quantization_parameters),
+        use_fused_warp_(use_fused_warp) {
+    if (num_threads > 1) {
+      thread_pool_ =
+          absl::make_unique<ThreadPool>("ImageToTensorCpu", num_threads);
+      thread_pool_->StartWorkers();
     }
   }
 
@@ -64,35 +110,74 @@ class OpenCvProcessor : public ImageToTensorConverter {
                                  const RotatedRect& roi,
                                  const Size& output_dims, float range_min,
                                  float range_max) override {
+    // YUV images are converted to RGB by the kernel, only for the sampled
+    // pixels, rather than as a whole beforehand.
+    if (auto yuv_storage =
+            input.internal_storage<GpuBufferStorageYuvImage>()) {
+      ASSIGN_OR_RETURN(const WarpSourceYuvImage image,
+                       GetWarpSourceYuvImage(*yuv_storage->yuv_image()));
+      return ConvertImage(image, roi, output_dims, range_min, range_max);
+    }
     if (input.image_format() != mediapipe::ImageFormat::SRGB &&
         input.image_format() != mediapipe::ImageFormat::SRGBA) {
       return InvalidArgumentError(
-          absl::StrCat("Only RGBA/RGB formats are supported, passed format: ",
+          absl::StrCat("Only RGBA/RGB/YUV formats are supported, passed "
+                       "format: ",
                        static_cast<uint32_t>(input.image_format())));
     }
     auto src = mediapipe::formats::MatView(&input);
+    if (!use_fused_warp_) {
+      return ConvertWithOpenCv(*src, roi, output_dims, range_min, range_max);
+    }
+    const WarpSourceImage image = {src->data, src->cols, src->rows,
+                                   src->channels(),
+                                   static_cast<int>(src->step)};
+    return ConvertImage(image, roi, output_dims, range_min, range_max);
+  }
+
+ private:
+  // Warps the ROI into an intermediate image with cv::warpPerspective, then
+  // maps its values to the output range into the tensor with convertTo.
+  absl::StatusOr<Tensor> ConvertWithOpenCv(const cv::Mat& src,
+                                           const RotatedRect& roi,
+                                           const Size& output_dims,
+                                           float range_min, float range_max) {
+    int mat_type;
+    switch (tensor_type_) {
+      case Tensor::ElementType::kInt8:
+        mat_type = CV_8SC3;
+        break;
+      case Tensor::ElementType::kFloat32:
+        mat_type = CV_32FC3;
+        break;
+      case Tensor::ElementType::kUInt8:
+        mat_type = CV_8UC3;
+        break;
+      default:
+        return InvalidArgumentError(
+            absl::StrCat("Unsupported tensor type: ", tensor_type_));
+    }
 
     constexpr int kNumChannels = 3;
-    Tensor tensor(tensor_type_, Tensor::Shape{1, output_dims.height,
-                                              output_dims.width, kNumChannels});
+    Tensor tensor(tensor_type_,
+                  Tensor::Shape{1, output_dims.height, output_dims.width,
+                                kNumChannels},
+                  quantization_parameters_);
     auto buffer_view = tensor.GetCpuWriteView();
     cv::Mat dst;
     switch (tensor_type_) {
       case Tensor::ElementType::kInt8:
-        dst = cv::Mat(output_dims.height, output_dims.width, mat_type_,
+        dst = cv::Mat(output_dims.height, output_dims.width, mat_type,
                       buffer_view.buffer<int8>());
         break;
       case Tensor::ElementType::kFloat32:
-        dst = cv::Mat(output_dims.height, output_dims.width, mat_type_,
+        dst = cv::Mat(output_dims.height, output_dims.width, mat_type,
                       buffer_view.buffer<float>());
         break;
-      case Tensor::ElementType::kUInt8:
-        dst = cv::Mat(output_dims.height, output_dims.width, mat_type_,
+      default:
+        dst = cv::Mat(output_dims.height, output_dims.width, mat_type,
                       buffer_view.buffer<uint8>());
         break;
-      default:
-        return InvalidArgumentError(
-            absl::StrCat("Unsupported tensor type: ", tensor_type_));
     }
 
     const cv::RotatedRect rotated_rect(cv::Point2f(roi.center_x, roi.center_y),
@@ -114,10 +199,12 @@ class OpenCvProcessor : public ImageToTensorConverter {
     cv::Mat projection_matrix =
         cv::getPerspectiveTransform(src_points, dst_points);
     cv::Mat transformed;
-    cv::warpPerspective(*src, transformed, projection_matrix,
+    cv::warpPerspective(src, transformed, projection_matrix,
                         cv::Size(dst_width, dst_height),
                         /*flags=*/cv::INTER_LINEAR,
-                        /*borderMode=*/border_mode_);
+                        /*borderMode=*/border_mode_ == BorderMode::kReplicate
+                            ? cv::BORDER_REPLICATE
+                            : cv::BORDER_CONSTANT);
 
     if (transformed.channels() > kNumChannels) {
       cv::Mat proper_channels_mat;
@@ -131,21 +218,95 @@ class OpenCvProcessor : public ImageToTensorConverter {
         auto transform,
         GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
                                     range_min, range_max));
-    transformed.convertTo(dst, mat_type_, transform.scale, transform.offset);
+    transformed.convertTo(dst, mat_type, transform.scale, transform.offset);
     return tensor;
   }
 
- private:
-  enum cv::BorderTypes border_mode_;
+  // SourceImage is WarpSourceImage or WarpSourceYuvImage.
+  template <typename SourceImage>
+  absl::StatusOr<Tensor> ConvertImage(const SourceImage& image,
+                                      const RotatedRect& roi,
+                                      const Size& output_dims, float range_min,
+                                      float range_max) {
+    constexpr float kInputImageRangeMin = 0.0f;
+    constexpr float kInputImageRangeMax = 255.0f;
+    ASSIGN_OR_RETURN(
+        auto transform,
+        GetValueRangeTransformation(kInputImageRangeMin, kInputImageRangeMax,
+                                    range_min, range_max));
+
+    constexpr int kNumChannels = 3;
+    Tensor tensor(tensor_type_,
+                  Tensor::Shape{1, output_dims.height, output_dims.width,
+                                kNumChannels},
+                  quantization_parameters_);
+    auto buffer_view = tensor.GetCpuWriteView();
+    // Samples the ROI, maps values to the output range and writes them into
+    // the tensor buffer in a single pass.
+    switch (tensor_type_) {
+      case Tensor::ElementType::kInt8:
+        WarpRoi(image, roi, transform, output_dims,
+                buffer_view.buffer<int8>());
+        break;
+      case Tensor::ElementType::kFloat32:
+        WarpRoi(image, roi, transform, output_dims,
+                buffer_view.buffer<float>());
+        break;
+      case Tensor::ElementType::kUInt8:
+        WarpRoi(image, roi, transform, output_dims,
+                buffer_view.buffer<uint8>());
+        break;
+      default:
+        return InvalidArgumentError(
+            absl::StrCat("Unsupported tensor type: ", tensor_type_));
+    }
+    return tensor;
+  }
+
+  template <typename SourceImage, typename T>
+  void WarpRoi(const SourceImage& image, const RotatedRect& roi,
+               const ValueTransformation& transform, const Size& output_dims,
+               T* output) {
+    auto compute_rows = [&](int row_begin, int row_end) {
+      WarpRoiToTensorRows(image, roi, border_mode_, transform,
+                          output_dims.width, output_dims.height, row_begin,
+                          row_end, output);
+    };
+
+    const int num_chunks =
+        thread_pool_ ? std::min(thread_pool_->num_threads(),
+                                output_dims.height / kMinRowsPerChunk)
+                     : 1;
+    if (num_chunks <= 1) {
+      compute_rows(0, output_dims.height);
+      return;
+    }
+    absl::BlockingCounter counter(num_chunks);
+    for (int i = 0; i < num_chunks; ++i) {
+      const int row_begin = output_dims.height * i / num_chunks;
+      const int row_end = output_dims.height * (i + 1) / num_chunks;
+      thread_pool_->Schedule([&compute_rows, &counter, row_begin, row_end]() {
+        compute_rows(row_begin, row_end);
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+  }
+
+  BorderMode border_mode_;
   Tensor::ElementType tensor_type_;
-  int mat_type_;
+  Tensor::QuantizationParameters quantization_parameters_;
+  bool use_fused_warp_;
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 }  // namespace
 
 absl::StatusOr<std::unique_ptr<ImageToTensorConverter>> CreateOpenCvConverter(
     CalculatorContext* cc, BorderMode border_mode,
-    Tensor::ElementType tensor_type) {
+    Tensor::ElementType tensor_type,
+    const Tensor::QuantizationParameters& quantization_parameters,
+    int num_threads, bool use_fused_warp) {
   if (tensor_type != Tensor::ElementType::kInt8 &&
       tensor_type != Tensor::ElementType::kFloat32 &&
       tensor_type != Tensor::ElementType::kUInt8) {
@@ -153,7 +314,9 @@ absl::StatusOr<std::unique_ptr<ImageToTensorConverter>> CreateOpenCvConverter(
         "Tensor type is currently not supported by OpenCvProcessor, type: ",
         tensor_type));
   }
-  return absl::make_unique<OpenCvProcessor>(border_mode, tensor_type);
+  return absl::make_unique<OpenCvProcessor>(border_mode, tensor_type,
+                                            quantization_parameters,
+                                            num_threads, use_fused_warp);
 }
 
 }  // namespace mediapipe
@@ -23,10 +23,20 @@
 
 namespace mediapipe {
 
-// Creates OpenCV image-to-tensor converter.
+// Creates OpenCV image-to-tensor converter. Accepts SRGB/SRGBA images, and
+// images backed by an 8-bit 4:2:0 YUVImage, which are converted to RGB only
+// for the pixels sampled from the ROI.
+// @quantization_parameters are attached to the uint8/int8 output tensors.
+// @num_threads - number of threads the output tensor rows are split between,
+//   with the fused kernel.
+// @use_fused_warp - whether SRGB/SRGBA images are converted with the fused
+//   kernel of image_to_tensor_warp_utils rather than cv::warpPerspective and
+//   convertTo. YUV images are always converted with the fused kernel.
 absl::StatusOr<std::unique_ptr<ImageToTensorConverter>> CreateOpenCvConverter(
     CalculatorContext* cc, BorderMode border_mode,
-    Tensor::ElementType tensor_type);
+    Tensor::ElementType tensor_type,
+    const Tensor::QuantizationParameters& quantization_parameters = {},
+    int num_threads = 1, bool use_fused_warp = false);
 
 }  // namespace mediapipe
 
@@ -0,0 +1,410 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_warp_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace mediapipe {
+namespace {
+
+// Sample positions are stepped along output rows in fixed point with
+// kPositionBits fractional bits, then rounded to 1/kSubpixelSteps of a pixel
+// before interpolation, as cv::warpPerspective does (INTER_TAB_SIZE).
+constexpr int kPositionBits = 16;
+constexpr int kSubpixelBits = 5;
+constexpr int kSubpixelSteps = 1 << kSubpixelBits;
+constexpr int kSubpixelShift = kPositionBits - kSubpixelBits;
+
+constexpr int kNumOutputChannels = 3;
+
+template <typename T>
+inline T ConvertValue(float value);
+
+template <>
+inline float ConvertValue<float>(float value) {
+  return value;
+}
+
+// Integer conversions saturate, then round to nearest. Rounding is done by
+// truncating a non-negative value, which is much cheaper than std::lrint.
+template <>
+inline int8_t ConvertValue<int8_t>(float value) {
+  value = std::min(std::max(value, -128.0f), 127.0f);
+  return static_cast<int8_t>(static_cast<int>(value + 128.5f) - 128);
+}
+
+template <>
+inline uint8_t ConvertValue<uint8_t>(float value) {
+  value = std::min(std::max(value, 0.0f), 255.0f);
+  return static_cast<uint8_t>(static_cast<int>(value + 0.5f));
+}
+
+inline int64_t ToFixedPoint(double position) {
+  return std::llround(position * (1 << kPositionBits));
+}
+
+// Bilinear weights of the four taps around a sample, in fixed point: they
+// sum up to kWeightOne.
+constexpr int kWeightOne = kSubpixelSteps * kSubpixelSteps;
+
+struct TapWeights {
+  int top_left;
+  int top_right;
+  int bottom_left;
+  int bottom_right;
+};
+
+inline TapWeights GetTapWeights(int fx, int fy) {
+  return {(kSubpixelSteps - fx) * (kSubpixelSteps - fy),
+          fx * (kSubpixelSteps - fy), (kSubpixelSteps - fx) * fy, fx * fy};
+}
+
+// Slow path of the bilinear sampling, for samples having at least one tap
+// outside of the image.
+template <int kChannels, bool kReplicate>
+void SampleOutside(const WarpSourceImage& image, int64_t x0, int64_t y0,
+                   const TapWeights& weights, int* value) {
+  const int tap_weights[4] = {weights.top_left, weights.top_right,
+                              weights.bottom_left, weights.bottom_right};
+  for (int c = 0; c < kChannels; ++c) value[c] = 0;
+  for (int i = 0; i < 4; ++i) {
+    int64_t x = x0 + (i & 1);
+    int64_t y = y0 + (i >> 1);
+    if (kReplicate) {
+      x = std::min<int64_t>(std::max<int64_t>(x, 0), image.width - 1);
+      y = std::min<int64_t>(std::max<int64_t>(y, 0), image.height - 1);
+    } else if (x < 0 || y < 0 || x >= image.width || y >= image.height) {
+      continue;
+    }
+    const uint8_t* pixel = image.data + y * image.row_stride + x * kChannels;
+    for (int c = 0; c < kChannels; ++c) value[c] += tap_weights[i] * pixel[c];
+  }
+}
+
+// Maps output pixels to source positions, i.e. the inverse of the perspective
+// transform mapping the ROI corners to the output corners:
+//   x = cx + (u / W - 0.5) * w * cos(r) - (v / H - 0.5) * h * sin(r)
+//   y = cy + (u / W - 0.5) * w * sin(r) + (v / H - 0.5) * h * cos(r)
+class SamplePositions {
+ public:
+  SamplePositions(const RotatedRect& roi, int output_width,
+                  int output_height) {
+    const double cos_r = std::cos(roi.rotation);
+    const double sin_r = std::sin(roi.rotation);
+    dx_dv_ = -roi.height * sin_r / output_height;
+    dy_dv_ = roi.height * cos_r / output_height;
+    x_origin_ =
+        roi.center_x - 0.5 * roi.width * cos_r + 0.5 * roi.height * sin_r;
+    y_origin_ =
+        roi.center_y - 0.5 * roi.width * sin_r - 0.5 * roi.height * cos_r;
+    dx_du_ = ToFixedPoint(roi.width * cos_r / output_width);
+    dy_du_ = ToFixedPoint(roi.width * sin_r / output_width);
+  }
+
+  // Fixed point position of the first pixel of output row @v, biased so that
+  // dropping the extra fractional bits rounds to nearest.
+  int64_t RowX(int v) const {
+    return ToFixedPoint(x_origin_ + v * dx_dv_) + kSubpixelRounding;
+  }
+  int64_t RowY(int v) const {
+    return ToFixedPoint(y_origin_ + v * dy_dv_) + kSubpixelRounding;
+  }
+
+  // Fixed point steps between horizontally adjacent output pixels.
+  int64_t dx_du() const { return dx_du_; }
+  int64_t dy_du() const { return dy_du_; }
+
+ private:
+  static constexpr int64_t kSubpixelRounding = int64_t{1}
+                                               << (kSubpixelShift - 1);
+
+  double dx_dv_;
+  double dy_dv_;
+  double x_origin_;
+  double y_origin_;
+  int64_t dx_du_;
+  int64_t dy_du_;
+};
+
+template <typename T, int kChannels, bool kReplicate>
+void WarpRows(const WarpSourceImage& image, const RotatedRect& roi,
+              const ValueTransformation& transform, int output_width,
+              int output_height, int row_begin, int row_end, T* output) {
+  const SamplePositions positions(roi, output_width, output_height);
+  const int64_t dx_du = positions.dx_du();
+  const int64_t dy_du = positions.dy_du();
+
+  // Interpolated values are kWeightOne times the sampled ones: folds the
+  // normalization into the range mapping.
+  const float scale = transform.scale / kWeightOne;
+  const float offset = transform.offset;
+  const uint8_t* data = image.data;
+  const int last_x = image.width - 1;
+  const int last_y = image.height - 1;
+  const int stride = image.row_stride;
+  for (int v = row_begin; v < row_end; ++v) {
+    int64_t x_position = positions.RowX(v);
+    int64_t y_position = positions.RowY(v);
+    T* out = output + static_cast<int64_t>(v) * output_width *
+                          kNumOutputChannels;
+    for (int u = 0; u < output_width; ++u, out += kNumOutputChannels,
+             x_position += dx_du, y_position += dy_du) {
+      const int64_t x = x_position >> kSubpixelShift;
+      const int64_t y = y_position >> kSubpixelShift;
+      const int64_t x0 = x >> kSubpixelBits;
+      const int64_t y0 = y >> kSubpixelBits;
+      const TapWeights weights = GetTapWeights(x & (kSubpixelSteps - 1),
+                                               y & (kSubpixelSteps - 1));
+
+      int value[kChannels];
+      if (x0 >= 0 && y0 >= 0 && x0 < last_x && y0 < last_y) {
+        // All four taps are inside of the image.
+        const uint8_t* top = data + y0 * stride + x0 * kChannels;
+        const uint8_t* bottom = top + stride;
+        for (int c = 0; c < kChannels; ++c) {
+          value[c] = top[c] * weights.top_left +
+                     top[c + kChannels] * weights.top_right +
+                     bottom[c] * weights.bottom_left +
+                     bottom[c + kChannels] * weights.bottom_right;
+        }
+      } else {
+        SampleOutside<kChannels, kReplicate>(image, x0, y0, weights, value);
+      }
+      for (int c = 0; c < kNumOutputChannels; ++c) {
+        out[c] = ConvertValue<T>(value[c] * scale + offset);
+      }
+    }
+  }
+}
+
+template <typename T>
+void WarpRowsForImage(const WarpSourceImage& image, const RotatedRect& roi,
+                      BorderMode border_mode,
+                      const ValueTransformation& transform, int output_width,
+                      int output_height, int row_begin, int row_end,
+                      T* output) {
+  const bool replicate = border_mode == BorderMode::kReplicate;
+  if (image.channels == 4) {
+    if (replicate) {
+      WarpRows<T, 4, true>(image, roi, transform, output_width, output_height,
+                           row_begin, row_end, output);
+    } else {
+      WarpRows<T, 4, false>(image, roi, transform, output_width,
+                            output_height, row_begin, row_end, output);
+    }
+  } else {
+    if (replicate) {
+      WarpRows<T, 3, true>(image, roi, transform, output_width, output_height,
+                           row_begin, row_end, output);
+    } else {
+      WarpRows<T, 3, false>(image, roi, transform, output_width,
+                            output_height, row_begin, row_end, output);
+    }
+  }
+}
+
+// Returns the bilinear interpolation, times kWeightOne, of a plane of 8-bit
+// samples spaced by @pixel_stride bytes, at the sub-pixel position (x, y).
+// Samples outside of the plane are replicated from its edges, or read as
+// @border_value.
+template <bool kReplicate>
+inline int SamplePlane(const uint8_t* plane, int row_stride, int pixel_stride,
+                       int width, int height, int64_t x, int64_t y,
+                       int border_value) {
+  const int64_t x0 = x >> kSubpixelBits;
+  const int64_t y0 = y >> kSubpixelBits;
+  const TapWeights weights =
+      GetTapWeights(x & (kSubpixelSteps - 1), y & (kSubpixelSteps - 1));
+  if (x0 >= 0 && y0 >= 0 && x0 < width - 1 && y0 < height - 1) {
+    const uint8_t* top = plane + y0 * row_stride + x0 * pixel_stride;
+    const uint8_t* bottom = top + row_stride;
+    return top[0] * weights.top_left + top[pixel_stride] * weights.top_right +
+           bottom[0] * weights.bottom_left +
+           bottom[pixel_stride] * weights.bottom_right;
+  }
+  const int tap_weights[4] = {weights.top_left, weights.top_right,
+                              weights.bottom_left, weights.bottom_right};
+  int value = 0;
+  for (int i = 0; i < 4; ++i) {
+    int64_t tap_x = x0 + (i & 1);
+    int64_t tap_y = y0 + (i >> 1);
+    if (kReplicate) {
+      tap_x = std::min<int64_t>(std::max<int64_t>(tap_x, 0), width - 1);
+      tap_y = std::min<int64_t>(std::max<int64_t>(tap_y, 0), height - 1);
+    } else if (tap_x < 0 || tap_y < 0 || tap_x >= width || tap_y >= height) {
+      value += tap_weights[i] * border_value;
+      continue;
+    }
+    value += tap_weights[i] * plane[tap_y * row_stride + tap_x * pixel_stride];
+  }
+  return value;
+}
+
+inline float ClampColor(float value) {
+  return std::min(std::max(value, 0.0f), 255.0f);
+}
+
+template <typename T, bool kReplicate>
+void WarpYuvRows(const WarpSourceYuvImage& image, const RotatedRect& roi,
+                 const ValueTransformation& transform, int output_width,
+                 int output_height, int row_begin, int row_end, T* output) {
+  const SamplePositions positions(roi, output_width, output_height);
+  const int64_t dx_du = positions.dx_du();
+  const int64_t dy_du = positions.dy_du();
+
+  const int uv_width = (image.width + 1) / 2;
+  const int uv_height = (image.height + 1) / 2;
+  // Zero border: the YUV values of black, so that blending with them matches
+  // blending with black in RGB.
+  const int black_y = static_cast<int>(image.coefficients.y_offset);
+  constexpr int kBlackUv = 128;
+
+  // Interpolated values are kWeightOne times the sampled ones: folds the
+  // normalization into the color conversion.
+  const YuvToRgbCoefficients& coefficients = image.coefficients;
+  const float y_scale = coefficients.y_scale / kWeightOne;
+  const float y_offset = coefficients.y_offset * kWeightOne;
+  const float uv_scale = 1.0f / kWeightOne;
+  const float uv_offset = 128.0f * kWeightOne;
+  for (int v = row_begin; v < row_end; ++v) {
+    int64_t x_position = positions.RowX(v);
+    int64_t y_position = positions.RowY(v);
+    T* out = output + static_cast<int64_t>(v) * output_width *
+                          kNumOutputChannels;
+    for (int u = 0; u < output_width; ++u, out += kNumOutputChannels,
+             x_position += dx_du, y_position += dy_du) {
+      const int64_t x = x_position >> kSubpixelShift;
+      const int64_t y = y_position >> kSubpixelShift;
+      // Chroma samples are centered between luma samples (as in JPEG), i.e.
+      // at luma position 2 * x_uv + 0.5.
+      const int64_t x_uv = (x - kSubpixelSteps / 2) >> 1;
+      const int64_t y_uv = (y - kSubpixelSteps / 2) >> 1;
+
+      const float luma =
+          y_scale * (SamplePlane<kReplicate>(image.y, image.y_row_stride, 1,
+                                             image.width, image.height, x, y,
+                                             black_y) -
+                     y_offset);
+      const float cb =
+          uv_scale * (SamplePlane<kReplicate>(image.u, image.uv_row_stride,
+                                              image.uv_pixel_stride, uv_width,
+                                              uv_height, x_uv, y_uv, kBlackUv) -
+                      uv_offset);
+      const float cr =
+          uv_scale * (SamplePlane<kReplicate>(image.v, image.uv_row_stride,
+                                              image.uv_pixel_stride, uv_width,
+                                              uv_height, x_uv, y_uv, kBlackUv) -
+                      uv_offset);
+      const float r = ClampColor(luma + coefficients.r_v * cr);
+      const float g =
+          ClampColor(luma + coefficients.g_u * cb + coefficients.g_v * cr);
+      const float b = ClampColor(luma + coefficients.b_u * cb);
+      out[0] = ConvertValue<T>(r * transform.scale + transform.offset);
+      out[1] = ConvertValue<T>(g * transform.scale + transform.offset);
+      out[2] = ConvertValue<T>(b * transform.scale + transform.offset);
+    }
+  }
+}
+
+template <typename T>
+void WarpRowsForYuvImage(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, T* output) {
+  if (border_mode == BorderMode::kReplicate) {
+    WarpYuvRows<T, true>(image, roi, transform, output_width, output_height,
+                         row_begin, row_end, output);
+  } else {
+    WarpYuvRows<T, false>(image, roi, transform, output_width, output_height,
+                          row_begin, row_end, output);
+  }
+}
+
+}  // namespace
+
+void WarpRoiToTensorRows(const WarpSourceImage& image, const RotatedRect& roi,
+                         BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, float* output) {
+  WarpRowsForImage(image, roi, border_mode, transform, output_width,
+                   output_height, row_begin, row_end, output);
+}
+
+void WarpRoiToTensorRows(const WarpSourceImage& image, const RotatedRect& roi,
+                         BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, int8_t* output) {
+  WarpRowsForImage(image, roi, border_mode, transform, output_width,
+                   output_height, row_begin, row_end, output);
+}
+
+void WarpRoiToTensorRows(const WarpSourceImage& image, const RotatedRect& roi,
+                         BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, uint8_t* output) {
+  WarpRowsForImage(image, roi, border_mode, transform, output_width,
+                   output_height, row_begin, row_end, output);
+}
+
+YuvToRgbCoefficients GetYuvToRgbCoefficients(bool bt709, bool full_range) {
+  // Luma weights of red and blue.
+  const float kr = bt709 ? 0.2126f : 0.299f;
+  const float kb = bt709 ? 0.0722f : 0.114f;
+  const float kg = 1.0f - kr - kb;
+  // Video range maps Y to [16, 235] and U, V to [16, 240].
+  const float y_scale = full_range ? 1.0f : 255.0f / 219.0f;
+  const float uv_scale = full_range ? 1.0f : 255.0f / 224.0f;
+  return {y_scale,
+          full_range ? 0.0f : 16.0f,
+          uv_scale * 2.0f * (1.0f - kr),
+          -uv_scale * 2.0f * (1.0f - kb) * kb / kg,
+          -uv_scale * 2.0f * (1.0f - kr) * kr / kg,
+          uv_scale * 2.0f * (1.0f - kb)};
+}
+
+void WarpRoiToTensorRows(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, float* output) {
+  WarpRowsForYuvImage(image, roi, border_mode, transform, output_width,
+                      output_height, row_begin, row_end, output);
+}
+
+void WarpRoiToTensorRows(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, int8_t* output) {
+  WarpRowsForYuvImage(image, roi, border_mode, transform, output_width,
+                      output_height, row_begin, row_end, output);
+}
+
+void WarpRoiToTensorRows(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, uint8_t* output) {
+  WarpRowsForYuvImage(image, roi, border_mode, transform, output_width,
+                      output_height, row_begin, row_end, output);
+}
+
+}  // namespace mediapipe
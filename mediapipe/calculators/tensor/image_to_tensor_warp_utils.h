@@ -0,0 +1,123 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_WARP_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_WARP_UTILS_H_
+
+#include <cstdint>
+
+#include "mediapipe/calculators/tensor/image_to_tensor_converter.h"
+#include "mediapipe/calculators/tensor/image_to_tensor_utils.h"
+
+namespace mediapipe {
+
+// Describes an interleaved 8-bit RGB or RGBA image.
+struct WarpSourceImage {
+  const uint8_t* data;
+  int width;
+  int height;
+  // 3 or 4. Only the first three channels are sampled.
+  int channels;
+  // Expressed in bytes.
+  int row_stride;
+};
+
+// Coefficients of an 8-bit YUV to RGB conversion:
+//   r = y_scale * (y - y_offset) + r_v * (v - 128)
+//   g = y_scale * (y - y_offset) + g_u * (u - 128) + g_v * (v - 128)
+//   b = y_scale * (y - y_offset) + b_u * (u - 128)
+struct YuvToRgbCoefficients {
+  float y_scale;
+  float y_offset;
+  float r_v;
+  float g_u;
+  float g_v;
+  float b_u;
+};
+
+// Returns the coefficients of the BT.601 or BT.709 conversion, for video range
+// (Y in [16, 235]) or full range YUV.
+YuvToRgbCoefficients GetYuvToRgbCoefficients(bool bt709, bool full_range);
+
+// Describes an 8-bit YUV 4:2:0 image: a full resolution Y plane, and U and V
+// planes subsampled by 2 in both directions, either planar (I420, YV12) or
+// interleaved (NV12, NV21).
+struct WarpSourceYuvImage {
+  const uint8_t* y;
+  const uint8_t* u;
+  const uint8_t* v;
+  // Expressed in bytes.
+  int y_row_stride;
+  int uv_row_stride;
+  // Distance in bytes between horizontally adjacent U (or V) samples: 1 for
+  // planar formats, 2 for interleaved ones.
+  int uv_pixel_stride;
+  int width;
+  int height;
+  YuvToRgbCoefficients coefficients;
+};
+
+// Fused CPU image-to-tensor kernel: bilinearly samples the rotated @roi of
+// @image (matching cv::warpPerspective with INTER_LINEAR, as used by the
+// OpenCV converter), maps each sampled value v to
+// v * transform.scale + transform.offset, and writes it as RGB to rows
+// [row_begin, row_end) of an HWC tensor of @output_width x @output_height
+// elements, in a single pass.
+//
+// Samples outside of @image are replicated from its edges or read as 0,
+// depending on @border_mode. Integer outputs are rounded to nearest and
+// saturated. Disjoint row ranges may be computed concurrently.
+void WarpRoiToTensorRows(const WarpSourceImage& image, const RotatedRect& roi,
+                         BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, float* output);
+
+void WarpRoiToTensorRows(const WarpSourceImage& image, const RotatedRect& roi,
+                         BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, int8_t* output);
+
+void WarpRoiToTensorRows(const WarpSourceImage& image, const RotatedRect& roi,
+                         BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, uint8_t* output);
+
+// Same as above, for YUV images: the Y, U and V planes are sampled
+// independently (chroma at its own, subsampled resolution), and only sampled
+// pixels are converted to RGB. Samples outside of the image are replicated or
+// black, depending on @border_mode.
+void WarpRoiToTensorRows(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, float* output);
+
+void WarpRoiToTensorRows(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, int8_t* output);
+
+void WarpRoiToTensorRows(const WarpSourceYuvImage& image,
+                         const RotatedRect& roi, BorderMode border_mode,
+                         const ValueTransformation& transform,
+                         int output_width, int output_height, int row_begin,
+                         int row_end, uint8_t* output);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_IMAGE_TO_TENSOR_WARP_UTILS_H_
@@ -0,0 +1,417 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/image_to_tensor_warp_utils.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "libyuv/convert_argb.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace {
+
+// Smooth enough for samples to be insensitive to the exact sub-pixel rounding
+// of positions, with every channel holding different values.
+cv::Mat MakeTestImage(int width, int height, int channels) {
+  cv::Mat image(height, width, CV_8UC(channels));
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      uint8_t* pixel = image.ptr<uint8_t>(y, x);
+      for (int c = 0; c < channels; ++c) {
+        pixel[c] = static_cast<uint8_t>(
+            127.5f + 127.5f * std::sin(x * 0.05f + c) * std::cos(y * 0.07f));
+      }
+    }
+  }
+  return image;
+}
+
+WarpSourceImage GetSourceImage(const cv::Mat& image) {
+  return {image.data, image.cols, image.rows, image.channels(),
+          static_cast<int>(image.step)};
+}
+
+// Reference implementation: the previous OpenCV converter path, i.e.
+// cv::warpPerspective into an intermediate image, followed by a channel
+// conversion and cv::Mat::convertTo.
+cv::Mat ReferenceTensor(const cv::Mat& image, const RotatedRect& roi,
+                        BorderMode border_mode,
+                        const ValueTransformation& transform,
+                        int output_width, int output_height, int mat_type) {
+  const cv::RotatedRect rotated_rect(cv::Point2f(roi.center_x, roi.center_y),
+                                     cv::Size2f(roi.width, roi.height),
+                                     roi.rotation * 180.f / M_PI);
+  cv::Mat src_points;
+  cv::boxPoints(rotated_rect, src_points);
+  const float dst_width = output_width;
+  const float dst_height = output_height;
+  /* clang-format off */
+  float dst_corners[8] = {0.0f,      dst_height,
+                          0.0f,      0.0f,
+                          dst_width, 0.0f,
+                          dst_width, dst_height};
+  /* clang-format on */
+  cv::Mat dst_points = cv::Mat(4, 2, CV_32F, dst_corners);
+  cv::Mat projection_matrix =
+      cv::getPerspectiveTransform(src_points, dst_points);
+  cv::Mat transformed;
+  cv::warpPerspective(image, transformed, projection_matrix,
+                      cv::Size(output_width, output_height),
+                      /*flags=*/cv::INTER_LINEAR,
+                      /*borderMode=*/border_mode == BorderMode::kReplicate
+                          ? cv::BORDER_REPLICATE
+                          : cv::BORDER_CONSTANT);
+  if (transformed.channels() > 3) {
+    cv::Mat rgb;
+    cv::cvtColor(transformed, rgb, cv::COLOR_RGBA2RGB);
+    transformed = rgb;
+  }
+  cv::Mat output;
+  transformed.convertTo(output, mat_type, transform.scale, transform.offset);
+  return output;
+}
+
+struct WarpTestCase {
+  int channels;
+  RotatedRect roi;
+  int output_width;
+  int output_height;
+  BorderMode border_mode;
+};
+
+class FusedWarpTest : public testing::TestWithParam<WarpTestCase> {};
+
+// Output values may differ from the reference by one step of the input
+// (sub-pixel rounding) plus one rounding step of the output.
+template <typename T>
+void ExpectMatchesReference(const WarpTestCase& test_case,
+                            const ValueTransformation& transform,
+                            int mat_type, float max_diff) {
+  const cv::Mat image = MakeTestImage(160, 120, test_case.channels);
+  const cv::Mat expected =
+      ReferenceTensor(image, test_case.roi, test_case.border_mode, transform,
+                      test_case.output_width, test_case.output_height,
+                      mat_type);
+
+  std::vector<T> output(test_case.output_width * test_case.output_height * 3);
+  // Compute in two uneven chunks to exercise row ranges.
+  const int split = test_case.output_height / 3;
+  WarpRoiToTensorRows(GetSourceImage(image), test_case.roi,
+                      test_case.border_mode, transform,
+                      test_case.output_width, test_case.output_height, 0,
+                      split, output.data());
+  WarpRoiToTensorRows(GetSourceImage(image), test_case.roi,
+                      test_case.border_mode, transform,
+                      test_case.output_width, test_case.output_height, split,
+                      test_case.output_height, output.data());
+
+  for (int y = 0; y < test_case.output_height; ++y) {
+    const T* expected_row = expected.ptr<T>(y);
+    for (int x = 0; x < test_case.output_width * 3; ++x) {
+      ASSERT_NEAR(output[y * test_case.output_width * 3 + x],
+                  expected_row[x], max_diff)
+          << "at (" << x / 3 << ", " << y << "), channel " << x % 3;
+    }
+  }
+}
+
+TEST_P(FusedWarpTest, MatchesOpenCvFloat) {
+  const ValueTransformation transform = {2.0f / 255.0f, -1.0f};
+  ExpectMatchesReference<float>(GetParam(), transform, CV_32FC3,
+                                2.0f * transform.scale);
+}
+
+TEST_P(FusedWarpTest, MatchesOpenCvInt8) {
+  ExpectMatchesReference<int8_t>(GetParam(), {1.0f, -128.0f}, CV_8SC3, 2.0f);
+}
+
+TEST_P(FusedWarpTest, MatchesOpenCvUint8) {
+  ExpectMatchesReference<uint8_t>(GetParam(), {1.0f, 0.0f}, CV_8UC3, 2.0f);
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    FusedWarpTests, FusedWarpTest,
+    testing::ValuesIn<WarpTestCase>({
+        {3, {80.0f, 60.0f, 160.0f, 120.0f, 0.0f}, 64, 48, BorderMode::kZero},
+        {3, {70.0f, 50.0f, 60.0f, 80.0f, 0.3f}, 37, 29, BorderMode::kZero},
+        {4, {90.0f, 40.0f, 100.0f, 70.0f, -1.2f}, 50, 50,
+         BorderMode::kReplicate},
+        {4, {20.0f, 100.0f, 90.0f, 90.0f, M_PI / 2}, 32, 64,
+         BorderMode::kZero},
+        {3, {150.0f, 10.0f, 200.0f, 150.0f, -M_PI / 4}, 48, 48,
+         BorderMode::kReplicate},
+        {3, {80.0f, 60.0f, 30.0f, 20.0f, 0.7f}, 96, 64,
+         BorderMode::kReplicate},
+    }));
+
+TEST(FusedWarpBorderTest, SamplesOutsideOfImageAreZeroOrReplicated) {
+  cv::Mat image(2, 2, CV_8UC3, cv::Scalar(100, 150, 200));
+  // The ROI is far to the left of the image.
+  const RotatedRect roi = {-50.0f, 1.0f, 10.0f, 10.0f, 0.0f};
+  std::vector<uint8_t> output(4 * 4 * 3);
+  WarpRoiToTensorRows(GetSourceImage(image), roi, BorderMode::kZero,
+                      {1.0f, 10.0f}, 4, 4, 0, 4, output.data());
+  for (uint8_t value : output) EXPECT_EQ(value, 10);
+
+  WarpRoiToTensorRows(GetSourceImage(image), roi, BorderMode::kReplicate,
+                      {1.0f, 10.0f}, 4, 4, 0, 4, output.data());
+  for (size_t i = 0; i < output.size(); i += 3) {
+    EXPECT_EQ(output[i], 110);
+    EXPECT_EQ(output[i + 1], 160);
+    EXPECT_EQ(output[i + 2], 210);
+  }
+}
+
+// Y, U and V planes of an 8-bit, video range YUV 4:2:0 image. Chroma varies
+// slowly, so that the reference (which upsamples chroma with nearest
+// neighbor) and the kernel (which interpolates it) closely agree.
+struct YuvPlanes {
+  int width;
+  int height;
+  cv::Mat y;
+  cv::Mat u;
+  cv::Mat v;
+};
+
+YuvPlanes MakeTestYuvPlanes(int width, int height) {
+  YuvPlanes planes = {width, height, cv::Mat(height, width, CV_8UC1),
+                      cv::Mat(height / 2, width / 2, CV_8UC1),
+                      cv::Mat(height / 2, width / 2, CV_8UC1)};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      planes.y.at<uint8_t>(y, x) = static_cast<uint8_t>(
+          125.5f + 109.5f * std::sin(x * 0.05f) * std::cos(y * 0.07f));
+    }
+  }
+  for (int y = 0; y < height / 2; ++y) {
+    for (int x = 0; x < width / 2; ++x) {
+      planes.u.at<uint8_t>(y, x) =
+          static_cast<uint8_t>(128.0f + 60.0f * std::sin(x * 0.03f + 1.0f));
+      planes.v.at<uint8_t>(y, x) =
+          static_cast<uint8_t>(128.0f + 60.0f * std::cos(y * 0.04f));
+    }
+  }
+  return planes;
+}
+
+// Interleaves the chroma planes, U first.
+cv::Mat MakeNv12(const YuvPlanes& planes) {
+  cv::Mat nv12(planes.height * 3 / 2, planes.width, CV_8UC1);
+  planes.y.copyTo(nv12.rowRange(0, planes.height));
+  for (int y = 0; y < planes.height / 2; ++y) {
+    uint8_t* uv = nv12.ptr<uint8_t>(planes.height + y);
+    for (int x = 0; x < planes.width / 2; ++x) {
+      uv[2 * x] = planes.u.at<uint8_t>(y, x);
+      uv[2 * x + 1] = planes.v.at<uint8_t>(y, x);
+    }
+  }
+  return nv12;
+}
+
+WarpSourceYuvImage GetSourceNv12Image(const cv::Mat& nv12, int width,
+                                      int height) {
+  const uint8_t* uv = nv12.ptr<uint8_t>(height);
+  return {nv12.data,
+          uv,
+          uv + 1,
+          static_cast<int>(nv12.step),
+          static_cast<int>(nv12.step),
+          /*uv_pixel_stride=*/2,
+          width,
+          height,
+          GetYuvToRgbCoefficients(/*bt709=*/false, /*full_range=*/false)};
+}
+
+TEST(FusedYuvWarpTest, MatchesFullFrameConversionThenWarp) {
+  const YuvPlanes planes = MakeTestYuvPlanes(160, 120);
+  const cv::Mat nv12 = MakeNv12(planes);
+  // OpenCV converts with BT.601 video range coefficients.
+  cv::Mat rgb;
+  cv::cvtColor(nv12, rgb, cv::COLOR_YUV2RGB_NV12);
+
+  const RotatedRect roi = {70.0f, 50.0f, 60.0f, 80.0f, 0.3f};
+  const ValueTransformation transform = {1.0f, 0.0f};
+  constexpr int kOutputSize = 48;
+  std::vector<uint8_t> expected(kOutputSize * kOutputSize * 3);
+  WarpRoiToTensorRows(GetSourceImage(rgb), roi, BorderMode::kReplicate,
+                      transform, kOutputSize, kOutputSize, 0, kOutputSize,
+                      expected.data());
+  std::vector<uint8_t> output(kOutputSize * kOutputSize * 3);
+  WarpRoiToTensorRows(GetSourceNv12Image(nv12, planes.width, planes.height),
+                      roi, BorderMode::kReplicate, transform, kOutputSize,
+                      kOutputSize, 0, kOutputSize, output.data());
+  for (size_t i = 0; i < output.size(); ++i) {
+    ASSERT_NEAR(output[i], expected[i], 4) << "at " << i;
+  }
+}
+
+TEST(FusedYuvWarpTest, PlanarAndInterleavedChromaMatch) {
+  const YuvPlanes planes = MakeTestYuvPlanes(64, 48);
+  const cv::Mat nv12 = MakeNv12(planes);
+  const WarpSourceYuvImage interleaved =
+      GetSourceNv12Image(nv12, planes.width, planes.height);
+  WarpSourceYuvImage planar = interleaved;
+  planar.u = planes.u.data;
+  planar.v = planes.v.data;
+  planar.uv_row_stride = static_cast<int>(planes.u.step);
+  planar.uv_pixel_stride = 1;
+
+  const RotatedRect roi = {30.0f, 20.0f, 80.0f, 40.0f, -0.5f};
+  const ValueTransformation transform = {2.0f / 255.0f, -1.0f};
+  std::vector<float> expected(32 * 32 * 3);
+  std::vector<float> output(32 * 32 * 3);
+  WarpRoiToTensorRows(interleaved, roi, BorderMode::kZero, transform, 32, 32,
+                      0, 32, expected.data());
+  WarpRoiToTensorRows(planar, roi, BorderMode::kZero, transform, 32, 32, 0, 32,
+                      output.data());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(FusedYuvWarpTest, SamplesOutsideOfImageAreBlack) {
+  const YuvPlanes planes = MakeTestYuvPlanes(16, 16);
+  const cv::Mat nv12 = MakeNv12(planes);
+  const RotatedRect roi = {-50.0f, 1.0f, 10.0f, 10.0f, 0.0f};
+  std::vector<uint8_t> output(4 * 4 * 3);
+  WarpRoiToTensorRows(GetSourceNv12Image(nv12, planes.width, planes.height),
+                      roi, BorderMode::kZero, {1.0f, 10.0f}, 4, 4, 0, 4,
+                      output.data());
+  for (uint8_t value : output) EXPECT_EQ(value, 10);
+}
+
+TEST(YuvToRgbCoefficientsTest, VideoRangeBt601) {
+  const YuvToRgbCoefficients coefficients =
+      GetYuvToRgbCoefficients(/*bt709=*/false, /*full_range=*/false);
+  EXPECT_NEAR(coefficients.y_scale, 1.164f, 1e-3f);
+  EXPECT_EQ(coefficients.y_offset, 16.0f);
+  EXPECT_NEAR(coefficients.r_v, 1.596f, 1e-3f);
+  EXPECT_NEAR(coefficients.g_u, -0.392f, 1e-3f);
+  EXPECT_NEAR(coefficients.g_v, -0.813f, 1e-3f);
+  EXPECT_NEAR(coefficients.b_u, 2.017f, 1e-3f);
+}
+
+// 1080p input, as a typical camera frame.
+constexpr int kBenchmarkImageWidth = 1920;
+constexpr int kBenchmarkImageHeight = 1080;
+
+// A slightly rotated, square ROI around a face or a hand.
+RotatedRect BenchmarkRoi() { return {960.0f, 540.0f, 700.0f, 700.0f, 0.2f}; }
+
+constexpr ValueTransformation kBenchmarkTransform = {2.0f / 255.0f, -1.0f};
+
+// Arg: output tensor size.
+void BM_OpenCvWarpThenConvert(benchmark::State& state) {
+  const int size = state.range(0);
+  const cv::Mat image =
+      MakeTestImage(kBenchmarkImageWidth, kBenchmarkImageHeight, 4);
+  for (auto _ : state) {
+    cv::Mat output =
+        ReferenceTensor(image, BenchmarkRoi(), BorderMode::kReplicate,
+                        kBenchmarkTransform, size, size, CV_32FC3);
+    benchmark::DoNotOptimize(output.data);
+  }
+}
+
+BENCHMARK(BM_OpenCvWarpThenConvert)->Arg(192)->Arg(256);
+
+// Args: output tensor size, number of threads the rows are split between.
+void BM_FusedWarp(benchmark::State& state) {
+  const int size = state.range(0);
+  const int num_threads = state.range(1);
+  const cv::Mat image =
+      MakeTestImage(kBenchmarkImageWidth, kBenchmarkImageHeight, 4);
+  const WarpSourceImage source = GetSourceImage(image);
+  std::vector<float> output(size * size * 3);
+  ThreadPool thread_pool("BM_FusedWarp", num_threads);
+  thread_pool.StartWorkers();
+  for (auto _ : state) {
+    if (num_threads == 1) {
+      WarpRoiToTensorRows(source, BenchmarkRoi(), BorderMode::kReplicate,
+                          kBenchmarkTransform, size, size, 0, size,
+                          output.data());
+    } else {
+      absl::BlockingCounter counter(num_threads);
+      for (int i = 0; i < num_threads; ++i) {
+        const int row_begin = size * i / num_threads;
+        const int row_end = size * (i + 1) / num_threads;
+        thread_pool.Schedule([&, row_begin, row_end]() {
+          WarpRoiToTensorRows(source, BenchmarkRoi(), BorderMode::kReplicate,
+                              kBenchmarkTransform, size, size, row_begin,
+                              row_end, output.data());
+          counter.DecrementCount();
+        });
+      }
+      counter.Wait();
+    }
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+
+BENCHMARK(BM_FusedWarp)
+    ->Args({192, 1})
+    ->Args({256, 1})
+    ->Args({192, 2})
+    ->Args({256, 2})
+    ->Args({256, 4});
+
+// NV12 camera frame to a 256x256 float tensor, converting the whole frame to
+// RGB first, as when reading the ImageFrame view of a YUV Image.
+void BM_Nv12FullFrameConversionThenWarp(benchmark::State& state) {
+  const YuvPlanes planes =
+      MakeTestYuvPlanes(kBenchmarkImageWidth, kBenchmarkImageHeight);
+  const cv::Mat nv12 = MakeNv12(planes);
+  const uint8_t* uv = nv12.ptr<uint8_t>(kBenchmarkImageHeight);
+  constexpr int kSize = 256;
+  std::vector<float> output(kSize * kSize * 3);
+  for (auto _ : state) {
+    cv::Mat rgb(kBenchmarkImageHeight, kBenchmarkImageWidth, CV_8UC3);
+    libyuv::NV12ToRAW(nv12.data, nv12.step, uv, nv12.step, rgb.data, rgb.step,
+                      kBenchmarkImageWidth, kBenchmarkImageHeight);
+    WarpRoiToTensorRows(GetSourceImage(rgb), BenchmarkRoi(),
+                        BorderMode::kReplicate, kBenchmarkTransform, kSize,
+                        kSize, 0, kSize, output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+
+BENCHMARK(BM_Nv12FullFrameConversionThenWarp);
+
+// Same, converting only the sampled pixels.
+void BM_FusedNv12Warp(benchmark::State& state) {
+  const YuvPlanes planes =
+      MakeTestYuvPlanes(kBenchmarkImageWidth, kBenchmarkImageHeight);
+  const cv::Mat nv12 = MakeNv12(planes);
+  const WarpSourceYuvImage source =
+      GetSourceNv12Image(nv12, kBenchmarkImageWidth, kBenchmarkImageHeight);
+  constexpr int kSize = 256;
+  std::vector<float> output(kSize * kSize * 3);
+  for (auto _ : state) {
+    WarpRoiToTensorRows(source, BenchmarkRoi(), BorderMode::kReplicate,
+                        kBenchmarkTransform, kSize, kSize, 0, kSize,
+                        output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+
+BENCHMARK(BM_FusedNv12Warp);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,87 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/inference_async_helper.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+namespace api2 {
+
+/* static */
+absl::Status InferenceAsyncHelper::UpdateContract(CalculatorContract* cc) {
+  if (cc->Options<mediapipe::InferenceCalculatorOptions>()
+          .has_async_inference()) {
+    // Overrides the default TimestampChange::Offset(0) of api2 nodes.
+    cc->SetTimestampOffset(TimestampDiff::Unset());
+    // Without an offset, the output bound only advances from Process(), which
+    // must then also run on input bound updates.
+    cc->SetProcessTimestampBounds(true);
+  }
+  return absl::OkStatus();
+}
+
+/* static */
+absl::StatusOr<std::unique_ptr<InferenceAsyncHelper>>
+InferenceAsyncHelper::Create(
+    const mediapipe::InferenceCalculatorOptions::AsyncInference& options,
+    std::unique_ptr<InferenceRunner> runner) {
+  RET_CHECK_GT(options.max_pending(), 0);
+  return absl::WrapUnique(
+      new InferenceAsyncHelper(std::move(runner), options.max_pending()));
+}
+
+InferenceAsyncHelper::InferenceAsyncHelper(
+    std::unique_ptr<InferenceRunner> runner, int max_pending)
+    : async_runner_(std::move(runner)), max_pending_(max_pending) {}
+
+absl::Status InferenceAsyncHelper::Process(CalculatorContext* cc) {
+  const auto& input_tensors = InferenceCalculator::kInTensors(cc);
+  // An empty input only advances the timestamp bound.
+  if (!input_tensors.IsEmpty()) {
+    RET_CHECK(!input_tensors->empty());
+    async_runner_.Enqueue(input_tensors);
+  }
+  MP_RETURN_IF_ERROR(SendOutputs(cc, max_pending_));
+  // Pending frames are sent later at their own timestamps, which the bound
+  // must not pass.
+  Timestamp bound = async_runner_.OldestPendingTimestamp();
+  if (bound == Timestamp::Unset()) {
+    bound = cc->InputTimestamp().NextAllowedInStream();
+  }
+  InferenceCalculator::kOutTensors(cc).SetNextTimestampBound(bound);
+  return absl::OkStatus();
+}
+
+absl::Status InferenceAsyncHelper::Close(CalculatorContext* cc) {
+  return SendOutputs(cc, /*max_pending=*/0);
+}
+
+absl::Status InferenceAsyncHelper::SendOutputs(CalculatorContext* cc,
+                                               int max_pending) {
+  for (auto& result : async_runner_.TakeResults(max_pending)) {
+    MP_RETURN_IF_ERROR(result.output_tensors.status());
+    InferenceCalculator::kOutTensors(cc).Send(
+        *std::move(result.output_tensors), result.timestamp);
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace api2
+}  // namespace mediapipe
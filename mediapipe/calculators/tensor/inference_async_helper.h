@@ -0,0 +1,72 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_INFERENCE_ASYNC_HELPER_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_INFERENCE_ASYNC_HELPER_H_
+
+#include <memory>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/inference_async_runner.h"
+#include "mediapipe/calculators/tensor/inference_calculator.h"
+#include "mediapipe/calculators/tensor/inference_calculator.pb.h"
+#include "mediapipe/calculators/tensor/inference_runner.h"
+#include "mediapipe/framework/calculator_framework.h"
+
+namespace mediapipe {
+namespace api2 {
+
+// Implements InferenceCalculatorOptions.async_inference for the CPU
+// InferenceCalculator implementations.
+//
+// Outputs are sent at the timestamps of earlier inputs, so the calculator
+// can't declare a timestamp offset: the timestamp bound of the output is
+// instead held at the oldest frame whose output hasn't been sent yet.
+class InferenceAsyncHelper {
+ public:
+  // Clears the timestamp offset of the contract and has Process() called on
+  // timestamp bound updates if async inference is enabled. To be called from
+  // the UpdateContract() of the calculator.
+  static absl::Status UpdateContract(CalculatorContract* cc);
+
+  // Takes over |runner|, which will run on a dedicated thread.
+  static absl::StatusOr<std::unique_ptr<InferenceAsyncHelper>> Create(
+      const mediapipe::InferenceCalculatorOptions::AsyncInference& options,
+      std::unique_ptr<InferenceRunner> runner);
+
+  // Enqueues the input tensors of |cc|, if any, sends the outputs that are
+  // ready and sets the timestamp bound to the oldest frame still pending, or
+  // past the input timestamp if none is.
+  absl::Status Process(CalculatorContext* cc);
+
+  // Waits for and sends the outputs of all the pending frames.
+  absl::Status Close(CalculatorContext* cc);
+
+ private:
+  InferenceAsyncHelper(std::unique_ptr<InferenceRunner> runner,
+                       int max_pending);
+
+  // Sends the outputs of the pending frames, leaving at most |max_pending| of
+  // them pending.
+  absl::Status SendOutputs(CalculatorContext* cc, int max_pending);
+
+  InferenceAsyncRunner async_runner_;
+  const int max_pending_;
+};
+
+}  // namespace api2
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_INFERENCE_ASYNC_HELPER_H_
@@ -0,0 +1,82 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/inference_async_runner.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace mediapipe {
+
+InferenceAsyncRunner::InferenceAsyncRunner(
+    std::unique_ptr<InferenceRunner> runner)
+    : runner_(std::move(runner)),
+      // The interpreter isn't thread-safe: a single thread runs it.
+      thread_pool_("inference", /*num_threads=*/1) {
+  thread_pool_.StartWorkers();
+}
+
+// Destroying thread_pool_ first runs the invocations left in its queue.
+InferenceAsyncRunner::~InferenceAsyncRunner() = default;
+
+void InferenceAsyncRunner::Enqueue(api2::Packet<std::vector<Tensor>> input) {
+  auto invocation = std::make_unique<Invocation>();
+  invocation->timestamp = input.timestamp();
+  invocation->input = std::move(input);
+  Invocation* invocation_ptr = invocation.get();
+  {
+    absl::MutexLock lock(&mutex_);
+    invocations_.push_back(std::move(invocation));
+  }
+  thread_pool_.Schedule([this, invocation_ptr]() { Run(invocation_ptr); });
+}
+
+void InferenceAsyncRunner::Run(Invocation* invocation) {
+  // Only this thread accesses the invocation until it is marked done.
+  absl::StatusOr<std::vector<Tensor>> output_tensors =
+      runner_->Run(invocation->input.Get());
+  absl::MutexLock lock(&mutex_);
+  invocation->output_tensors = std::move(output_tensors);
+  invocation->input = {};
+  invocation->done = true;
+}
+
+std::vector<InferenceAsyncRunner::Result> InferenceAsyncRunner::TakeResults(
+    int max_pending) {
+  std::vector<Result> results;
+  absl::MutexLock lock(&mutex_);
+  while (!invocations_.empty()) {
+    Invocation* oldest = invocations_.front().get();
+    if (static_cast<int>(invocations_.size()) > max_pending) {
+      mutex_.Await(absl::Condition(
+          +[](Invocation* invocation) { return invocation->done; }, oldest));
+    } else if (!oldest->done) {
+      break;
+    }
+    results.push_back({oldest->timestamp, std::move(oldest->output_tensors)});
+    invocations_.pop_front();
+  }
+  return results;
+}
+
+Timestamp InferenceAsyncRunner::OldestPendingTimestamp() {
+  absl::MutexLock lock(&mutex_);
+  if (invocations_.empty()) {
+    return Timestamp::Unset();
+  }
+  return invocations_.front()->timestamp;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,86 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_INFERENCE_ASYNC_RUNNER_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_INFERENCE_ASYNC_RUNNER_H_
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/calculators/tensor/inference_runner.h"
+#include "mediapipe/framework/api2/packet.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/framework/timestamp.h"
+
+namespace mediapipe {
+
+// Runs an InferenceRunner on a dedicated thread, so that the calculator owning
+// it can return from Process() while the model is being invoked, and the graph
+// executor can meanwhile run other nodes (e.g. pre-processing of the next
+// frame).
+//
+// Invocations run one at a time, in the order they are enqueued, and their
+// results are returned in that same order.
+class InferenceAsyncRunner {
+ public:
+  struct Result {
+    Timestamp timestamp;
+    absl::StatusOr<std::vector<Tensor>> output_tensors;
+  };
+
+  explicit InferenceAsyncRunner(std::unique_ptr<InferenceRunner> runner);
+  // Waits for the pending invocations to complete.
+  ~InferenceAsyncRunner();
+
+  // Schedules inference on the tensors of |input|, which is kept alive until
+  // the invocation completes.
+  void Enqueue(api2::Packet<std::vector<Tensor>> input);
+
+  // Returns the results of the oldest invocations, waiting until at most
+  // |max_pending| invocations are still pending. Results of completed
+  // invocations are returned without waiting, as long as they follow the
+  // returned ones in order.
+  std::vector<Result> TakeResults(int max_pending) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the timestamp of the oldest invocation whose result hasn't been
+  // taken yet, or Timestamp::Unset() if there is none.
+  Timestamp OldestPendingTimestamp() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Invocation {
+    Timestamp timestamp;
+    api2::Packet<std::vector<Tensor>> input;
+    bool done = false;
+    absl::StatusOr<std::vector<Tensor>> output_tensors;
+  };
+
+  void Run(Invocation* invocation) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::unique_ptr<InferenceRunner> runner_;
+  absl::Mutex mutex_;
+  // Invocations whose results haven't been taken yet, oldest first.
+  std::deque<std::unique_ptr<Invocation>> invocations_ ABSL_GUARDED_BY(mutex_);
+  // Declared last: its destructor joins the thread before the members above
+  // are destroyed.
+  ThreadPool thread_pool_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_INFERENCE_ASYNC_RUNNER_H_
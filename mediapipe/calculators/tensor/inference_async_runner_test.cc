@@ -0,0 +1,175 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/inference_async_runner.h"
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/status/statusor.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "mediapipe/framework/api2/packet.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/status_matchers.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr absl::Duration kStageDuration = absl::Milliseconds(5);
+
+// Adds 1 to a single float after blocking for |latency|, standing in for a
+// model invocation.
+class FakeInferenceRunner : public InferenceRunner {
+ public:
+  explicit FakeInferenceRunner(absl::Duration latency) : latency_(latency) {}
+
+  absl::StatusOr<std::vector<Tensor>> Run(
+      const std::vector<Tensor>& inputs) override {
+    absl::SleepFor(latency_);
+    std::vector<Tensor> outputs;
+    outputs.emplace_back(Tensor::ElementType::kFloat32, Tensor::Shape{1});
+    *outputs[0].GetCpuWriteView().buffer<float>() =
+        *inputs[0].GetCpuReadView().buffer<float>() + 1.0f;
+    return outputs;
+  }
+
+ private:
+  absl::Duration latency_;
+};
+
+// Adds 1 to a single float once released, standing in for a model invocation
+// that is still running while the test checks the state of the runner.
+class BlockingInferenceRunner : public InferenceRunner {
+ public:
+  absl::StatusOr<std::vector<Tensor>> Run(
+      const std::vector<Tensor>& inputs) override {
+    if (!started_.HasBeenNotified()) started_.Notify();
+    release_.WaitForNotification();
+    std::vector<Tensor> outputs;
+    outputs.emplace_back(Tensor::ElementType::kFloat32, Tensor::Shape{1});
+    *outputs[0].GetCpuWriteView().buffer<float>() =
+        *inputs[0].GetCpuReadView().buffer<float>() + 1.0f;
+    return outputs;
+  }
+
+  absl::Notification& started() { return started_; }
+  absl::Notification& release() { return release_; }
+
+ private:
+  absl::Notification started_;
+  absl::Notification release_;
+};
+
+api2::Packet<std::vector<Tensor>> MakeInput(float value, int64 timestamp) {
+  std::vector<Tensor> tensors;
+  tensors.emplace_back(Tensor::ElementType::kFloat32, Tensor::Shape{1});
+  *tensors[0].GetCpuWriteView().buffer<float>() = value;
+  return api2::MakePacket<std::vector<Tensor>>(std::move(tensors))
+      .At(Timestamp(timestamp));
+}
+
+float GetValue(const std::vector<Tensor>& tensors) {
+  return *tensors[0].GetCpuReadView().buffer<float>();
+}
+
+TEST(InferenceAsyncRunnerTest, ReturnsResultsInOrder) {
+  InferenceAsyncRunner runner(
+      std::make_unique<FakeInferenceRunner>(absl::Milliseconds(1)));
+  std::vector<InferenceAsyncRunner::Result> results;
+  for (int i = 0; i < 10; ++i) {
+    runner.Enqueue(MakeInput(i, i * 10));
+    auto taken = runner.TakeResults(/*max_pending=*/2);
+    for (auto& result : taken) results.push_back(std::move(result));
+    // At most 2 frames are pending after each call.
+    EXPECT_GE(static_cast<int>(results.size()), i + 1 - 2);
+  }
+  for (auto& result : runner.TakeResults(/*max_pending=*/0)) {
+    results.push_back(std::move(result));
+  }
+
+  ASSERT_EQ(results.size(), 10);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(results[i].timestamp, Timestamp(i * 10));
+    MP_ASSERT_OK(results[i].output_tensors);
+    EXPECT_EQ(GetValue(*results[i].output_tensors), i + 1.0f);
+  }
+}
+
+// The calling thread (e.g. the graph executor pre-processing the next frame)
+// isn't blocked by an invocation in progress, as long as no more than
+// max_pending frames are pending.
+TEST(InferenceAsyncRunnerTest, OverlapsPreprocessingAndInference) {
+  auto blocking_runner = std::make_unique<BlockingInferenceRunner>();
+  BlockingInferenceRunner* blocking_runner_ptr = blocking_runner.get();
+  InferenceAsyncRunner runner(std::move(blocking_runner));
+
+  runner.Enqueue(MakeInput(0, 0));
+  blocking_runner_ptr->started().WaitForNotification();
+  // Inference of frame 0 is in progress.
+  EXPECT_TRUE(runner.TakeResults(/*max_pending=*/1).empty());
+  EXPECT_EQ(runner.OldestPendingTimestamp(), Timestamp(0));
+  runner.Enqueue(MakeInput(1, 1));
+  EXPECT_EQ(runner.OldestPendingTimestamp(), Timestamp(0));
+
+  blocking_runner_ptr->release().Notify();
+  auto results = runner.TakeResults(/*max_pending=*/0);
+  ASSERT_EQ(results.size(), 2);
+  EXPECT_EQ(results[0].timestamp, Timestamp(0));
+  EXPECT_EQ(results[1].timestamp, Timestamp(1));
+  MP_ASSERT_OK(results[1].output_tensors);
+  EXPECT_EQ(GetValue(*results[1].output_tensors), 2.0f);
+  EXPECT_EQ(runner.OldestPendingTimestamp(), Timestamp::Unset());
+}
+
+// Simulates a two stage pipeline on one thread (e.g. a graph with a single
+// executor thread): pre-processing of a frame, then inference. In async mode,
+// pre-processing of frame t + 1 overlaps with inference of frame t.
+void RunPipeline(int num_frames, bool async) {
+  auto fake_runner = std::make_unique<FakeInferenceRunner>(kStageDuration);
+  FakeInferenceRunner* sync_runner = fake_runner.get();
+  InferenceAsyncRunner async_runner(std::move(fake_runner));
+  for (int i = 0; i < num_frames; ++i) {
+    absl::SleepFor(kStageDuration);  // Pre-processing.
+    auto input = MakeInput(i, i);
+    if (async) {
+      async_runner.Enqueue(std::move(input));
+      async_runner.TakeResults(/*max_pending=*/1);
+    } else {
+      sync_runner->Run(input.Get()).IgnoreError();
+    }
+  }
+  async_runner.TakeResults(/*max_pending=*/0);
+}
+
+// Sync takes ~2 stage durations per frame, async ~1.
+// Arg: 0 for synchronous inference, 1 for asynchronous.
+void BM_PipelineThroughput(benchmark::State& state) {
+  constexpr int kNumFrames = 10;
+  for (auto _ : state) {
+    RunPipeline(kNumFrames, state.range(0) != 0);
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+
+BENCHMARK(BM_PipelineThroughput)->Arg(0)->Arg(1)->UseRealTime();
+
+}  // namespace
+}  // namespace mediapipe
@@ -20,10 +20,12 @@
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/inference_async_helper.h"
 #include "mediapipe/calculators/tensor/inference_calculator.h"
 #include "mediapipe/calculators/tensor/inference_calculator_utils.h"
 #include "mediapipe/calculators/tensor/inference_interpreter_delegate_runner.h"
 #include "mediapipe/calculators/tensor/inference_runner.h"
+#include "mediapipe/calculators/tensor/xnnpack_weights_cache.h"
 #include "tensorflow/lite/interpreter.h"
 #if defined(MEDIAPIPE_ANDROID)
 #include "tensorflow/lite/delegates/nnapi/nnapi_delegate.h"
@@ -45,9 +47,14 @@ class InferenceCalculatorCpuImpl
  private:
   absl::StatusOr<std::unique_ptr<InferenceRunner>> CreateInferenceRunner(
       CalculatorContext* cc);
-  absl::StatusOr<TfLiteDelegatePtr> MaybeCreateDelegate(CalculatorContext* cc);
+  absl::StatusOr<TfLiteDelegatePtr> MaybeCreateDelegate(
+      CalculatorContext* cc, const Packet<TfLiteModelPtr>& model_packet);
 
+  // Declared before the runner, as it must outlive the runner's delegate.
+  std::shared_ptr<XnnpackWeightsCache> weights_cache_;
   std::unique_ptr<InferenceRunner> inference_runner_;
+  // Set in async mode, in which case it owns the runner.
+  std::unique_ptr<InferenceAsyncHelper> async_helper_;
 };
 
 absl::Status InferenceCalculatorCpuImpl::UpdateContract(
@@ -56,15 +63,25 @@ absl::Status InferenceCalculatorCpuImpl::UpdateContract(
   RET_CHECK(!options.model_path().empty() ^ kSideInModel(cc).IsConnected())
       << "Either model as side packet or model path in options is required.";
 
-  return absl::OkStatus();
+  return InferenceAsyncHelper::UpdateContract(cc);
 }
 
 absl::Status InferenceCalculatorCpuImpl::Open(CalculatorContext* cc) {
   ASSIGN_OR_RETURN(inference_runner_, CreateInferenceRunner(cc));
+  const auto& options = cc->Options<mediapipe::InferenceCalculatorOptions>();
+  if (options.has_async_inference()) {
+    ASSIGN_OR_RETURN(
+        async_helper_,
+        InferenceAsyncHelper::Create(options.async_inference(),
+                                     std::move(inference_runner_)));
+  }
   return absl::OkStatus();
 }
 
 absl::Status InferenceCalculatorCpuImpl::Process(CalculatorContext* cc) {
+  if (async_helper_) {
+    return async_helper_->Process(cc);
+  }
   if (kInTensors(cc).IsEmpty()) {
     return absl::OkStatus();
   }
@@ -78,24 +95,39 @@ absl::Status InferenceCalculatorCpuImpl::Process(CalculatorContext* cc) {
 }
 
 absl::Status InferenceCalculatorCpuImpl::Close(CalculatorContext* cc) {
+  absl::Status status;
+  if (async_helper_) {
+    status = async_helper_->Close(cc);
+    async_helper_ = nullptr;
+  }
   inference_runner_ = nullptr;
-  return absl::OkStatus();
+  weights_cache_ = nullptr;
+  return status;
 }
 
 absl::StatusOr<std::unique_ptr<InferenceRunner>>
 InferenceCalculatorCpuImpl::CreateInferenceRunner(CalculatorContext* cc) {
   ASSIGN_OR_RETURN(auto model_packet, GetModelAsPacket(cc));
   ASSIGN_OR_RETURN(auto op_resolver_packet, GetOpResolverAsPacket(cc));
-  const int interpreter_num_threads =
-      cc->Options<mediapipe::InferenceCalculatorOptions>().cpu_num_thread();
-  ASSIGN_OR_RETURN(TfLiteDelegatePtr delegate, MaybeCreateDelegate(cc));
-  return CreateInferenceInterpreterDelegateRunner(
-      std::move(model_packet), std::move(op_resolver_packet),
-      std::move(delegate), interpreter_num_threads);
+  const auto& options = cc->Options<mediapipe::InferenceCalculatorOptions>();
+  const int interpreter_num_threads = options.cpu_num_thread();
+  ASSIGN_OR_RETURN(TfLiteDelegatePtr delegate,
+                   MaybeCreateDelegate(cc, model_packet));
+  auto create_runner = [&]() {
+    return CreateInferenceInterpreterDelegateRunner(
+        std::move(model_packet), std::move(op_resolver_packet),
+        std::move(delegate), interpreter_num_threads,
+        options.num_warmup_invocations());
+  };
+  if (weights_cache_) {
+    return weights_cache_->CreateRunner(create_runner);
+  }
+  return create_runner();
 }
 
 absl::StatusOr<TfLiteDelegatePtr>
-InferenceCalculatorCpuImpl::MaybeCreateDelegate(CalculatorContext* cc) {
+InferenceCalculatorCpuImpl::MaybeCreateDelegate(
+    CalculatorContext* cc, const Packet<TfLiteModelPtr>& model_packet) {
   const auto& calculator_opts =
       cc->Options<mediapipe::InferenceCalculatorOptions>();
   auto opts_delegate = calculator_opts.delegate();
@@ -151,6 +183,10 @@ InferenceCalculatorCpuImpl::MaybeCreateDelegate(CalculatorContext* cc) {
     auto xnnpack_opts = TfLiteXNNPackDelegateOptionsDefault();
     xnnpack_opts.num_threads =
         GetXnnpackNumThreads(opts_has_delegate, opts_delegate);
+    if (opts_delegate.xnnpack().enable_weights_cache()) {
+      weights_cache_ = GetXnnpackWeightsCache(model_packet);
+      xnnpack_opts.weights_cache = weights_cache_->Get();
+    }
     return TfLiteDelegatePtr(TfLiteXNNPackDelegateCreate(&xnnpack_opts),
                              &TfLiteXNNPackDelegateDelete);
   }
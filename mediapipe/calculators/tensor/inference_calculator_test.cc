@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <cstdio>
 #include <memory>
 #include <string>
 #include <vector>
@@ -33,6 +34,8 @@
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"  // NOLINT
 #include "mediapipe/framework/tool/validate_type.h"
+#include "mediapipe/util/tflite/tflite_model_cache.h"
+#include "mediapipe/util/tflite/tflite_model_loader.h"
 #include "tensorflow/lite/error_reporter.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
@@ -41,6 +44,10 @@
 #include <CoreFoundation/CoreFoundation.h>
 #endif  // defined(__APPLE__)
 
+#if defined(__linux__)
+#include <unistd.h>
+#endif  // defined(__linux__)
+
 namespace mediapipe {
 namespace {
 
@@ -180,6 +187,238 @@ TEST(InferenceCalculatorTest, ModelAsInputSidePacketSmokeTest) {
   DoSmokeTest(kGraphWithModelAsInputSidePacket);
 }
 
+TEST(InferenceCalculatorTest, ModelLoadedFromPathIsShared) {
+  const std::string model_path =
+      "mediapipe/calculators/tensor/testdata/add.bin";
+  const int num_cached_models =
+      TfLiteModelCache::GetInstance().NumCachedModels();
+  {
+    MP_ASSERT_OK_AND_ASSIGN(auto model1,
+                            TfLiteModelLoader::LoadFromPath(model_path));
+    MP_ASSERT_OK_AND_ASSIGN(auto model2,
+                            TfLiteModelLoader::LoadFromPath(model_path));
+    EXPECT_EQ(model1.Get().get(), model2.Get().get());
+    EXPECT_EQ(TfLiteModelCache::GetInstance().NumCachedModels(),
+              num_cached_models + 1);
+  }
+  // The model is released with its last packet.
+  EXPECT_EQ(TfLiteModelCache::GetInstance().NumCachedModels(),
+            num_cached_models);
+}
+
+// Returns the resident set size of the process in bytes, or 0 if unknown.
+int64 GetResidentSetSize() {
+#if defined(__linux__)
+  FILE* statm = fopen("/proc/self/statm", "r");
+  if (statm == nullptr) return 0;
+  long total_pages = 0;
+  long resident_pages = 0;
+  const int num_read = fscanf(statm, "%ld %ld", &total_pages, &resident_pages);
+  fclose(statm);
+  if (num_read != 2) return 0;
+  return static_cast<int64>(resident_pages) * sysconf(_SC_PAGE_SIZE);
+#else
+  return 0;
+#endif  // defined(__linux__)
+}
+
+// Starts N graphs running the same model, as a service hosting many sessions
+// would, and reports the resident memory they take per graph.
+void BM_ModelMemoryForGraphs(benchmark::State& state) {
+  const int num_graphs = state.range(0);
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(
+          absl::StrReplaceAll(kGraphWithModelPathInOption,
+                              {{"$delegate", "delegate { tflite {} }"}}));
+  int64 rss_delta = 0;
+  for (auto _ : state) {
+    const int64 rss_before = GetResidentSetSize();
+    std::vector<std::unique_ptr<CalculatorGraph>> graphs;
+    for (int i = 0; i < num_graphs; ++i) {
+      graphs.push_back(std::make_unique<CalculatorGraph>(graph_config));
+      CHECK_OK(graphs.back()->StartRun({}));
+    }
+    rss_delta = GetResidentSetSize() - rss_before;
+    state.counters["cached_models"] =
+        TfLiteModelCache::GetInstance().NumCachedModels();
+    for (auto& graph : graphs) {
+      CHECK_OK(graph->CloseAllInputStreams());
+      CHECK_OK(graph->WaitUntilDone());
+    }
+  }
+  state.counters["rss_bytes_per_graph"] =
+      static_cast<double>(rss_delta) / num_graphs;
+}
+
+BENCHMARK(BM_ModelMemoryForGraphs)->Arg(1)->Arg(10)->Arg(200);
+
+CalculatorGraphConfig GetXnnpackGraphConfig(int num_warmup_invocations) {
+  return ParseTextProtoOrDie<CalculatorGraphConfig>(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate",
+        absl::StrCat("delegate { xnnpack { enable_weights_cache: true } } "
+                     "num_warmup_invocations: ",
+                     num_warmup_invocations)}}));
+}
+
+TEST(InferenceCalculatorTest, WarmupAndWeightsCacheSmokeTest) {
+  DoSmokeTest(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate",
+        "delegate { xnnpack { enable_weights_cache: true } } "
+        "num_warmup_invocations: 2"}}));
+  // Second graph looks up the weights packed by the first one.
+  DoSmokeTest(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate", "delegate { xnnpack { enable_weights_cache: true } }"}}));
+}
+
+TEST(InferenceCalculatorTest, AsyncInferenceSmokeTest) {
+  // The output is sent on Close(), as no later frame follows.
+  DoSmokeTest(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate", "delegate { tflite {} } async_inference {}"}}));
+  DoSmokeTest(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate",
+        "delegate { xnnpack {} } async_inference { max_pending: 2 }"}}));
+}
+
+// Outputs of earlier frames are sent from the Process() of later ones, at
+// their own timestamps, which the timestamp bound must not have passed.
+void DoAsyncMultipleFramesTest(const std::string& graph_proto) {
+  constexpr int kNumFrames = 5;
+  CalculatorGraphConfig graph_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig>(graph_proto);
+  std::vector<Packet> output_packets;
+  tool::AddVectorSink("tensor_out", &graph_config, &output_packets);
+  CalculatorGraph graph(graph_config);
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < kNumFrames; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in",
+        MakePacket<std::vector<Tensor>>(CreateInputs()).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.CloseInputStream("tensor_in"));
+  MP_ASSERT_OK(graph.WaitUntilDone());
+
+  ASSERT_EQ(output_packets.size(), kNumFrames);
+  for (int i = 0; i < kNumFrames; ++i) {
+    EXPECT_EQ(output_packets[i].Timestamp(), Timestamp(i));
+    const std::vector<Tensor>& result_vec =
+        output_packets[i].Get<std::vector<Tensor>>();
+    ASSERT_EQ(result_vec.size(), 1);
+    auto view = result_vec[0].GetCpuReadView();
+    EXPECT_EQ(view.buffer<float>()[0], 3);
+  }
+}
+
+TEST(InferenceCalculatorTest, AsyncInferenceMultipleFrames) {
+  DoAsyncMultipleFramesTest(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate", "delegate { tflite {} } async_inference {}"}}));
+  DoAsyncMultipleFramesTest(absl::StrReplaceAll(
+      kGraphWithModelPathInOption,
+      {{"$delegate",
+        "delegate { xnnpack {} } async_inference { max_pending: 2 }"}}));
+}
+
+// Frames dropped upstream still advance the timestamp bound of the output, so
+// that downstream nodes synchronizing with it aren't held back.
+TEST(InferenceCalculatorTest, AsyncInferencePropagatesTimestampBounds) {
+  CalculatorGraph graph(ParseTextProtoOrDie<CalculatorGraphConfig>(R"(
+    input_stream: "tensor_in"
+    input_stream: "allow"
+    node {
+      calculator: "GateCalculator"
+      input_stream: "tensor_in"
+      input_stream: "ALLOW:allow"
+      output_stream: "gated_tensor_in"
+    }
+    node {
+      calculator: "InferenceCalculator"
+      input_stream: "TENSORS:gated_tensor_in"
+      output_stream: "TENSORS:tensor_out"
+      options {
+        [mediapipe.InferenceCalculatorOptions.ext] {
+          model_path: "mediapipe/calculators/tensor/testdata/add.bin"
+          delegate { tflite {} }
+          async_inference {}
+        }
+      }
+    }
+  )"));
+  std::vector<Timestamp> bounds;
+  MP_ASSERT_OK(graph.ObserveOutputStream(
+      "tensor_out",
+      [&bounds](const Packet& packet) {
+        if (packet.IsEmpty()) {
+          bounds.push_back(packet.Timestamp());
+        }
+        return absl::OkStatus();
+      },
+      /*observe_timestamp_bounds=*/true));
+  MP_ASSERT_OK(graph.StartRun({}));
+  for (int i = 0; i < 3; ++i) {
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "tensor_in",
+        MakePacket<std::vector<Tensor>>(CreateInputs()).At(Timestamp(i))));
+    MP_ASSERT_OK(graph.AddPacketToInputStream(
+        "allow", MakePacket<bool>(false).At(Timestamp(i))));
+  }
+  MP_ASSERT_OK(graph.WaitUntilIdle());
+
+  ASSERT_FALSE(bounds.empty());
+  EXPECT_EQ(bounds.back(), Timestamp(2));
+  MP_ASSERT_OK(graph.CloseAllInputStreams());
+  MP_ASSERT_OK(graph.WaitUntilDone());
+}
+
+// Latency of the first frame after graph start.
+// Arg: number of warm-up invocations.
+void BM_FirstFrameLatency(benchmark::State& state) {
+  const CalculatorGraphConfig graph_config =
+      GetXnnpackGraphConfig(state.range(0));
+  for (auto _ : state) {
+    state.PauseTiming();
+    CalculatorGraph graph(graph_config);
+    CHECK_OK(graph.StartRun({}));
+    CHECK_OK(graph.WaitUntilIdle());
+    auto input_vec = CreateInputs();
+    state.ResumeTiming();
+
+    CHECK_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakePacket<std::vector<Tensor>>(std::move(input_vec))
+                         .At(Timestamp(0))));
+    CHECK_OK(graph.WaitUntilIdle());
+
+    state.PauseTiming();
+    CHECK_OK(graph.CloseAllInputStreams());
+    CHECK_OK(graph.WaitUntilDone());
+    state.ResumeTiming();
+  }
+}
+
+BENCHMARK(BM_FirstFrameLatency)->Arg(0)->Arg(1)->UseRealTime();
+
+// Latency of the frames following the first one, for comparison with
+// BM_FirstFrameLatency.
+void BM_SteadyStateLatency(benchmark::State& state) {
+  CalculatorGraph graph(GetXnnpackGraphConfig(/*num_warmup_invocations=*/0));
+  CHECK_OK(graph.StartRun({}));
+  int64 timestamp = 0;
+  for (auto _ : state) {
+    CHECK_OK(graph.AddPacketToInputStream(
+        "tensor_in", MakePacket<std::vector<Tensor>>(CreateInputs())
+                         .At(Timestamp(timestamp++))));
+    CHECK_OK(graph.WaitUntilIdle());
+  }
+  CHECK_OK(graph.CloseAllInputStreams());
+  CHECK_OK(graph.WaitUntilDone());
+}
+
+BENCHMARK(BM_SteadyStateLatency)->UseRealTime();
+
 void BM_InitializeCalculator(benchmark::State& state) {
   mediapipe::InferenceCalculatorOptions::Delegate delegate;
   delegate.mutable_tflite();
@@ -14,12 +14,14 @@
 
 #include "mediapipe/calculators/tensor/inference_interpreter_delegate_runner.h"
 
+#include <cstring>
 #include <memory>
 #include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/interpreter_builder.h"
@@ -28,6 +30,19 @@ namespace mediapipe {
 
 namespace {
 
+// Returns true if the elements of `tensor` are plain values, which the warmup
+// can zero-fill: not strings, resources or variants.
+bool HasPodElements(const TfLiteTensor& tensor) {
+  switch (tensor.type) {
+    case kTfLiteString:
+    case kTfLiteResource:
+    case kTfLiteVariant:
+      return false;
+    default:
+      return true;
+  }
+}
+
 template <typename T>
 void CopyTensorBufferToInterpreter(const Tensor& input_tensor,
                                    tflite::Interpreter* interpreter,
@@ -159,7 +174,7 @@ absl::StatusOr<std::unique_ptr<InferenceRunner>>
 CreateInferenceInterpreterDelegateRunner(
     api2::Packet<TfLiteModelPtr> model,
     api2::Packet<tflite::OpResolver> op_resolver, TfLiteDelegatePtr delegate,
-    int interpreter_num_threads) {
+    int interpreter_num_threads, int num_warmup_invocations) {
   tflite::InterpreterBuilder interpreter_builder(*model.Get(),
                                                  op_resolver.Get());
   if (delegate) {
@@ -174,6 +189,31 @@ CreateInferenceInterpreterDelegateRunner(
   RET_CHECK_EQ(interpreter_builder(&interpreter), kTfLiteOk);
   RET_CHECK(interpreter);
   RET_CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+  if (num_warmup_invocations > 0) {
+    // Inputs that can't be zero-filled are skipped, and so is the warmup:
+    // the model can't run on them uninitialized.
+    bool can_warm_up = true;
+    for (int input_index : interpreter->inputs()) {
+      TfLiteTensor* input = interpreter->tensor(input_index);
+      if (!HasPodElements(*input)) {
+        LOG(WARNING) << "Skipping the warmup of a model with an input of type "
+                     << TfLiteTypeGetName(input->type) << ".";
+        can_warm_up = false;
+        continue;
+      }
+      if (input->data.raw != nullptr) {
+        std::memset(input->data.raw, 0, input->bytes);
+      }
+    }
+    if (can_warm_up) {
+      for (int i = 0; i < num_warmup_invocations; ++i) {
+        RET_CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+      }
+      // Stateful models (e.g. LSTM or streaming models) start the first frame
+      // from their initial state rather than from the warmup's.
+      RET_CHECK_EQ(interpreter->ResetVariableTensors(), kTfLiteOk);
+    }
+  }
   return std::make_unique<InferenceInterpreterDelegateRunner>(
       std::move(model), std::move(interpreter), std::move(delegate));
 }
@@ -35,11 +35,16 @@ using TfLiteDelegatePtr =
 //
 // `delegate` can be nullptr, in that case newly initialized interpreter will
 // use what is available by default.
+//
+// The interpreter is invoked `num_warmup_invocations` times on zero-filled
+// inputs before the runner is returned, so that the first Run() has steady
+// state latency. Its variable tensors are then reset. Models with string,
+// resource or variant inputs aren't warmed up.
 absl::StatusOr<std::unique_ptr<InferenceRunner>>
 CreateInferenceInterpreterDelegateRunner(
     api2::Packet<TfLiteModelPtr> model,
     api2::Packet<tflite::OpResolver> op_resolver, TfLiteDelegatePtr delegate,
-    int interpreter_num_threads);
+    int interpreter_num_threads, int num_warmup_invocations = 0);
 
 }  // namespace mediapipe
 
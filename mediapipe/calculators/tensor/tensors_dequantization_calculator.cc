@@ -17,6 +17,7 @@
 
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
+#include "mediapipe/calculators/tensor/tensors_dequantization_utils.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/api2/port.h"
 #include "mediapipe/framework/calculator_context.h"
@@ -26,23 +27,6 @@
 
 namespace mediapipe {
 namespace api2 {
-namespace {
-
-template <typename T>
-void Dequantize(const Tensor& input, Tensor* output) {
-  auto input_view = input.GetCpuReadView();
-  auto input_buffer = input_view.buffer<T>();
-  auto output_view = output->GetCpuWriteView();
-  auto output_buffer = output_view.buffer<float>();
-  for (int i = 0; i < input.shape().num_elements(); ++i) {
-    output_buffer[i] = input.quantization_parameters().scale *
-                       (static_cast<int>(input_buffer[i]) -
-                        input.quantization_parameters().zero_point);
-  }
-}
-
-}  // namespace
-
 // Performs dequantization using the quantization parameters from the input
 // UInt8 or Int8 tensors. Each element of the input tensors is converted using:
 //
@@ -78,19 +62,21 @@ absl::Status TensorsDequantizationCalculator::Process(CalculatorContext* cc) {
   auto output_tensors = std::make_unique<std::vector<Tensor>>();
   output_tensors->reserve(input_tensors.size());
   for (const auto& input_tensor : input_tensors) {
+    if (input_tensor.element_type() != Tensor::ElementType::kUInt8 &&
+        input_tensor.element_type() != Tensor::ElementType::kInt8) {
+      return absl::InvalidArgumentError(absl::StrCat(
+          "Unsupported input tensor type: ", input_tensor.element_type()));
+    }
     output_tensors->emplace_back(Tensor::ElementType::kFloat32,
                                  input_tensor.shape());
-    switch (input_tensor.element_type()) {
-      case Tensor::ElementType::kUInt8:
-        Dequantize<uint8>(input_tensor, &output_tensors->back());
-        break;
-      case Tensor::ElementType::kInt8:
-        Dequantize<int8>(input_tensor, &output_tensors->back());
-        break;
-      default:
-        return absl::InvalidArgumentError(absl::StrCat(
-            "Unsupported input tensor type: ", input_tensor.element_type()));
-    }
+    auto output_view = output_tensors->back().GetCpuWriteView();
+    float* output_buffer = output_view.buffer<float>();
+    MP_RETURN_IF_ERROR(VisitDequantizedValues(
+        input_tensor, [&](const auto& values) -> absl::Status {
+          DequantizeValues(values, input_tensor.shape().num_elements(),
+                           output_buffer);
+          return absl::OkStatus();
+        }));
   }
   kOutTensors(cc).Send(std::move(output_tensors));
   return absl::OkStatus();
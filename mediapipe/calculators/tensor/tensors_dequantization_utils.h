@@ -0,0 +1,108 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_DEQUANTIZATION_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_DEQUANTIZATION_UTILS_H_
+
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+// Read-only array-like access to the elements of a CPU tensor buffer as
+// floats. Quantized (uint8/int8) elements are dequantized on access:
+//
+//   value = scale * (element - zero_point)
+//
+// which lets tensor decoders consume quantized model outputs directly instead
+// of materializing a float copy (e.g. with TensorsDequantizationCalculator).
+template <typename T>
+struct DequantizedValues {
+  const T* data;
+  float scale;
+  int zero_point;
+
+  float operator[](int i) const {
+    return scale * (static_cast<int>(data[i]) - zero_point);
+  }
+};
+
+template <>
+struct DequantizedValues<float> {
+  const float* data;
+
+  float operator[](int i) const { return data[i]; }
+};
+
+// Writes the |num_elements| first elements of |values|, a DequantizedValues,
+// to |output| as floats.
+template <typename Values>
+void DequantizeValues(const Values& values, int num_elements, float* output) {
+  for (int i = 0; i < num_elements; ++i) {
+    output[i] = values[i];
+  }
+}
+
+// Returns true if |tensor| can be read with VisitDequantizedValues.
+inline bool IsFloatOrQuantized(const Tensor& tensor) {
+  switch (tensor.element_type()) {
+    case Tensor::ElementType::kFloat32:
+    case Tensor::ElementType::kUInt8:
+    case Tensor::ElementType::kInt8:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Calls |fn| with the DequantizedValues<T> matching the element type of the
+// float32, uint8 or int8 |tensor|, so that the decoding loop in |fn| is
+// instantiated once per element type. |fn| must return absl::Status and must
+// not keep the values beyond the call, as the CPU read view is released on
+// return.
+//
+// Example:
+//   MP_RETURN_IF_ERROR(VisitDequantizedValues(
+//       tensor, [&](const auto& values) -> absl::Status {
+//         for (int i = 0; i < n; ++i) sum += values[i];
+//         return absl::OkStatus();
+//       }));
+template <typename Fn>
+absl::Status VisitDequantizedValues(const Tensor& tensor, Fn&& fn) {
+  auto view = tensor.GetCpuReadView();
+  const Tensor::QuantizationParameters& params =
+      tensor.quantization_parameters();
+  switch (tensor.element_type()) {
+    case Tensor::ElementType::kFloat32:
+      return fn(DequantizedValues<float>{view.buffer<float>()});
+    case Tensor::ElementType::kUInt8:
+      return fn(DequantizedValues<uint8>{view.buffer<uint8>(), params.scale,
+                                         params.zero_point});
+    case Tensor::ElementType::kInt8:
+      return fn(DequantizedValues<int8>{view.buffer<int8>(), params.scale,
+                                        params.zero_point});
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrCat("Unsupported input tensor type: ",
+                       static_cast<int>(tensor.element_type())));
+  }
+}
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_DEQUANTIZATION_UTILS_H_
@@ -12,13 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <algorithm>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/str_format.h"
 #include "absl/types/span.h"
+#include "mediapipe/calculators/tensor/tensors_dequantization_utils.h"
 #include "mediapipe/calculators/tensor/tensors_to_classification_calculator.pb.h"
+#include "mediapipe/calculators/tensor/tensors_to_classification_utils.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/classification.pb.h"
@@ -51,8 +54,10 @@ void SetClassificationLabel(const LabelMapItem label_map_item,
 // classifications.
 //
 // Input:
-//  TENSORS - Vector of Tensors of type kFloat32 containing one
-//            tensor, the size of which must be (1, * num_classes).
+//  TENSORS - Vector of Tensors of type kFloat32, kUInt8 or kInt8 containing
+//            one tensor, the size of which must be (1, * num_classes).
+//            Quantized scores are dequantized on the fly using the tensor's
+//            quantization parameters.
 // Output:
 //  CLASSIFICATIONS - Result MediaPipe ClassificationList. The score and index
 //                    fields of each classification are set, while the label
@@ -82,22 +87,12 @@ class TensorsToClassificationCalculator : public Node {
   absl::Status Close(CalculatorContext* cc) override;
 
  private:
-  int top_k_ = 0;
-  bool sort_by_descending_score_ = false;
   proto_ns::Map<int64, LabelMapItem> local_label_map_;
   bool label_map_loaded_ = false;
   bool is_binary_classification_ = false;
-  float min_score_threshold_ = std::numeric_limits<float>::lowest();
+  // Filters and sorts the output classification results.
+  std::unique_ptr<ClassificationSelector> selector_;
 
-  // Set of allowed or ignored class indices.
-  struct ClassIndexSet {
-    absl::flat_hash_set<int> values;
-    bool is_allowlist;
-  };
-  // Allowed or ignored class indices based on provided options.
-  // These are used to filter out the output classification results.
-  ClassIndexSet class_index_set_;
-  bool IsClassIndexAllowed(int class_index);
   const proto_ns::Map<int64, LabelMapItem>& GetLabelMap(CalculatorContext* cc);
 };
 MEDIAPIPE_REGISTER_NODE(TensorsToClassificationCalculator);
@@ -105,8 +100,6 @@ MEDIAPIPE_REGISTER_NODE(TensorsToClassificationCalculator);
 absl::Status TensorsToClassificationCalculator::Open(CalculatorContext* cc) {
   const auto& options = cc->Options<TensorsToClassificationCalculatorOptions>();
 
-  top_k_ = options.top_k();
-  sort_by_descending_score_ = options.sort_by_descending_score();
   if (options.has_label_map_path()) {
     std::string string_path;
     ASSIGN_OR_RETURN(string_path,
@@ -137,27 +130,13 @@ absl::Status TensorsToClassificationCalculator::Open(CalculatorContext* cc) {
     }
     label_map_loaded_ = true;
   }
-  if (options.has_min_score_threshold()) {
-    min_score_threshold_ = options.min_score_threshold();
-  }
   is_binary_classification_ = options.binary_classification();
 
   if (is_binary_classification_) {
     RET_CHECK(options.allow_classes().empty() &&
               options.ignore_classes().empty());
   }
-  if (!options.allow_classes().empty()) {
-    RET_CHECK(options.ignore_classes().empty());
-    class_index_set_.is_allowlist = true;
-    for (int i = 0; i < options.allow_classes_size(); ++i) {
-      class_index_set_.values.insert(options.allow_classes(i));
-    }
-  } else {
-    class_index_set_.is_allowlist = false;
-    for (int i = 0; i < options.ignore_classes_size(); ++i) {
-      class_index_set_.values.insert(options.ignore_classes(i));
-    }
-  }
+  ASSIGN_OR_RETURN(selector_, ClassificationSelector::Create(options));
 
   return absl::OkStatus();
 }
@@ -165,7 +144,7 @@ absl::Status TensorsToClassificationCalculator::Open(CalculatorContext* cc) {
 absl::Status TensorsToClassificationCalculator::Process(CalculatorContext* cc) {
   const auto& input_tensors = *kInTensors(cc);
   RET_CHECK_EQ(input_tensors.size(), 1);
-  RET_CHECK(input_tensors[0].element_type() == Tensor::ElementType::kFloat32);
+  RET_CHECK(IsFloatOrQuantized(input_tensors[0]));
 
   int num_classes = input_tensors[0].shape().num_elements();
 
@@ -177,62 +156,27 @@ absl::Status TensorsToClassificationCalculator::Process(CalculatorContext* cc) {
   if (label_map_loaded_) {
     RET_CHECK_EQ(num_classes, GetLabelMap(cc).size());
   }
-  auto view = input_tensors[0].GetCpuReadView();
-  auto raw_scores = view.buffer<float>();
+  std::vector<std::pair<int, float>> classes;
+  MP_RETURN_IF_ERROR(VisitDequantizedValues(
+      input_tensors[0], [&](const auto& raw_scores) -> absl::Status {
+        if (is_binary_classification_) {
+          classes = {{0, raw_scores[0]}, {1, 1.0f - raw_scores[0]}};
+        } else {
+          selector_->AddClasses(raw_scores, num_classes, &classes);
+        }
+        return absl::OkStatus();
+      }));
+  selector_->SortClasses(&classes);
 
   auto classification_list = absl::make_unique<ClassificationList>();
-  if (is_binary_classification_) {
-    Classification* class_first = classification_list->add_classification();
-    Classification* class_second = classification_list->add_classification();
-    class_first->set_index(0);
-    class_second->set_index(1);
-    class_first->set_score(raw_scores[0]);
-    class_second->set_score(1. - raw_scores[0]);
-
+  for (const auto& [index, score] : classes) {
+    Classification* classification = classification_list->add_classification();
+    classification->set_index(index);
+    classification->set_score(score);
     if (label_map_loaded_) {
-      SetClassificationLabel(GetLabelMap(cc).at(0), class_first);
-      SetClassificationLabel(GetLabelMap(cc).at(1), class_second);
-    }
-  } else {
-    for (int i = 0; i < num_classes; ++i) {
-      if (!IsClassIndexAllowed(i)) {
-        continue;
-      }
-      if (raw_scores[i] < min_score_threshold_) {
-        continue;
-      }
-      Classification* classification =
-          classification_list->add_classification();
-      classification->set_index(i);
-      classification->set_score(raw_scores[i]);
-      if (label_map_loaded_) {
-        SetClassificationLabel(GetLabelMap(cc).at(i), classification);
-      }
+      SetClassificationLabel(GetLabelMap(cc).at(index), classification);
     }
   }
-
-  auto raw_classification_list = classification_list->mutable_classification();
-  if (top_k_ > 0) {
-    int desired_size =
-        std::min(classification_list->classification_size(), top_k_);
-    std::partial_sort(raw_classification_list->begin(),
-                      raw_classification_list->begin() + desired_size,
-                      raw_classification_list->end(),
-                      [](const Classification a, const Classification b) {
-                        return a.score() > b.score();
-                      });
-
-    if (desired_size >= top_k_) {
-      // Resizes the underlying list to have only top_k_ classifications.
-      raw_classification_list->DeleteSubrange(
-          top_k_, raw_classification_list->size() - top_k_);
-    }
-  } else if (sort_by_descending_score_) {
-    std::sort(raw_classification_list->begin(), raw_classification_list->end(),
-              [](const Classification a, const Classification b) {
-                return a.score() > b.score();
-              });
-  }
   kOutClassificationList(cc).Send(std::move(classification_list));
   return absl::OkStatus();
 }
@@ -241,17 +185,6 @@ absl::Status TensorsToClassificationCalculator::Close(CalculatorContext* cc) {
   return absl::OkStatus();
 }
 
-bool TensorsToClassificationCalculator::IsClassIndexAllowed(int class_index) {
-  if (class_index_set_.values.empty()) {
-    return true;
-  }
-  if (class_index_set_.is_allowlist) {
-    return class_index_set_.values.contains(class_index);
-  } else {
-    return !class_index_set_.values.contains(class_index);
-  }
-}
-
 const proto_ns::Map<int64, LabelMapItem>&
 TensorsToClassificationCalculator::GetLabelMap(CalculatorContext* cc) {
   return !local_label_map_.empty()
@@ -23,6 +23,7 @@
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/formats/classification.pb.h"
 #include "mediapipe/framework/formats/tensor.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
@@ -55,6 +56,25 @@ class TensorsToClassificationCalculatorTest : public ::testing::Test {
         mediapipe::Adopt(tensors.release())
             .At(mediapipe::Timestamp(stream_timestamp++)));
   }
+
+  void BuildQuantizedGraph(mediapipe::CalculatorRunner* runner,
+                           const std::vector<int8>& quantized_scores,
+                           float scale, int zero_point) {
+    auto tensors = absl::make_unique<std::vector<Tensor>>();
+    tensors->emplace_back(
+        Tensor::ElementType::kInt8,
+        Tensor::Shape{1, 1, static_cast<int>(quantized_scores.size()), 1},
+        Tensor::QuantizationParameters(scale, zero_point));
+    auto view = tensors->back().GetCpuWriteView();
+    int8* tensor_buffer = view.buffer<int8>();
+    ASSERT_NE(tensor_buffer, nullptr);
+    for (int i = 0; i < quantized_scores.size(); ++i) {
+      tensor_buffer[i] = quantized_scores[i];
+    }
+
+    runner->MutableInputs()->Tag("TENSORS").packets.push_back(
+        mediapipe::Adopt(tensors.release()).At(mediapipe::Timestamp(0)));
+  }
 };
 
 TEST_F(TensorsToClassificationCalculatorTest, CorrectOutput) {
@@ -323,4 +343,78 @@ TEST_F(TensorsToClassificationCalculatorTest,
   ASSERT_TRUE(classification_list.classification(1).has_label());
 }
 
+TEST_F(TensorsToClassificationCalculatorTest, CorrectOutputWithInt8Scores) {
+  mediapipe::CalculatorRunner runner(ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "TensorsToClassificationCalculator"
+    input_stream: "TENSORS:tensors"
+    output_stream: "CLASSIFICATIONS:classifications"
+    options {
+      [mediapipe.TensorsToClassificationCalculatorOptions.ext] {
+        min_score_threshold: 0.4
+      }
+    }
+  )pb"));
+
+  // Dequantizes to {0, 0.5, 1}.
+  BuildQuantizedGraph(&runner, {-2, -1, 0}, /*scale=*/0.5f,
+                      /*zero_point=*/-2);
+  MP_ASSERT_OK(runner.Run());
+
+  const auto& output_packets_ = runner.Outputs().Tag("CLASSIFICATIONS").packets;
+
+  EXPECT_EQ(1, output_packets_.size());
+
+  const auto& classification_list =
+      output_packets_[0].Get<ClassificationList>();
+  EXPECT_EQ(2, classification_list.classification_size());
+  EXPECT_EQ(1, classification_list.classification(0).index());
+  EXPECT_EQ(0.5, classification_list.classification(0).score());
+  EXPECT_EQ(2, classification_list.classification(1).index());
+  EXPECT_EQ(1, classification_list.classification(1).score());
+}
+
+// Args: number of classes, whether scores are int8 (1) or float (0).
+void BM_TensorsToClassification(benchmark::State& state) {
+  const int num_classes = state.range(0);
+  const bool quantized = state.range(1);
+  Node node = ParseTextProtoOrDie<Node>(R"pb(
+    calculator: "TensorsToClassificationCalculator"
+    input_stream: "TENSORS:tensors"
+    output_stream: "CLASSIFICATIONS:classifications"
+    options {
+      [mediapipe.TensorsToClassificationCalculatorOptions.ext] { top_k: 5 }
+    }
+  )pb");
+  for (auto _ : state) {
+    state.PauseTiming();
+    mediapipe::CalculatorRunner runner(node);
+    auto tensors = absl::make_unique<std::vector<Tensor>>();
+    if (quantized) {
+      tensors->emplace_back(Tensor::ElementType::kInt8,
+                            Tensor::Shape{1, num_classes},
+                            Tensor::QuantizationParameters(1.0f / 256, -128));
+      auto view = tensors->back().GetCpuWriteView();
+      for (int i = 0; i < num_classes; ++i) {
+        view.buffer<int8>()[i] = static_cast<int8>(i % 256 - 128);
+      }
+    } else {
+      tensors->emplace_back(Tensor::ElementType::kFloat32,
+                            Tensor::Shape{1, num_classes});
+      auto view = tensors->back().GetCpuWriteView();
+      for (int i = 0; i < num_classes; ++i) {
+        view.buffer<float>()[i] = (i % 256) / 256.0f;
+      }
+    }
+    runner.MutableInputs()->Tag("TENSORS").packets.push_back(
+        mediapipe::Adopt(tensors.release()).At(mediapipe::Timestamp(0)));
+    state.ResumeTiming();
+    ASSERT_TRUE(runner.Run().ok());
+  }
+}
+BENCHMARK(BM_TensorsToClassification)
+    ->Args({1001, 0})
+    ->Args({1001, 1})
+    ->Args({21843, 0})
+    ->Args({21843, 1});
+
 }  // namespace mediapipe
@@ -0,0 +1,77 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_classification_utils.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/tensors_to_classification_calculator.pb.h"
+
+namespace mediapipe {
+
+/* static */
+absl::StatusOr<std::unique_ptr<ClassificationSelector>>
+ClassificationSelector::Create(
+    const TensorsToClassificationCalculatorOptions& options) {
+  if (!options.allow_classes().empty() && !options.ignore_classes().empty()) {
+    return absl::InvalidArgumentError(
+        "allow_classes and ignore_classes are mutually exclusive.");
+  }
+  auto selector = absl::WrapUnique(new ClassificationSelector());
+  selector->top_k_ = options.top_k();
+  selector->sort_by_descending_score_ = options.sort_by_descending_score();
+  if (options.has_min_score_threshold()) {
+    selector->min_score_threshold_ = options.min_score_threshold();
+  }
+  if (!options.allow_classes().empty()) {
+    selector->is_allowlist_ = true;
+    selector->class_indices_.insert(options.allow_classes().begin(),
+                                    options.allow_classes().end());
+  } else {
+    selector->class_indices_.insert(options.ignore_classes().begin(),
+                                    options.ignore_classes().end());
+  }
+  return selector;
+}
+
+void ClassificationSelector::SortClasses(
+    std::vector<std::pair<int, float>>* classes) const {
+  const auto by_descending_score = [](const std::pair<int, float>& a,
+                                      const std::pair<int, float>& b) {
+    return a.second > b.second;
+  };
+  if (top_k_ > 0) {
+    const int desired_size = std::min<int>(classes->size(), top_k_);
+    std::partial_sort(classes->begin(), classes->begin() + desired_size,
+                      classes->end(), by_descending_score);
+    classes->resize(desired_size);
+  } else if (sort_by_descending_score_) {
+    std::sort(classes->begin(), classes->end(), by_descending_score);
+  }
+}
+
+bool ClassificationSelector::IsClassIndexAllowed(int class_index) const {
+  if (class_indices_.empty()) {
+    return true;
+  }
+  return class_indices_.contains(class_index) == is_allowlist_;
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,82 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_CLASSIFICATION_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_CLASSIFICATION_UTILS_H_
+
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/tensors_to_classification_calculator.pb.h"
+
+namespace mediapipe {
+
+// Selects the classes to output from the scores of a classification model, as
+// configured by TensorsToClassificationCalculatorOptions: the classes allowed
+// by allow_classes or ignore_classes, scoring at least min_score_threshold,
+// then the top_k highest scoring ones or all of them sorted by descending
+// score if requested. Label maps and binary classification are left to the
+// caller.
+//
+// Example:
+//   ASSIGN_OR_RETURN(auto selector, ClassificationSelector::Create(options));
+//   std::vector<std::pair<int, float>> classes;
+//   selector->AddClasses(scores, num_classes, &classes);
+//   selector->SortClasses(&classes);
+class ClassificationSelector {
+ public:
+  // Returns an InvalidArgument error if both allow_classes and
+  // ignore_classes are set.
+  static absl::StatusOr<std::unique_ptr<ClassificationSelector>> Create(
+      const TensorsToClassificationCalculatorOptions& options);
+
+  // Appends to `classes` the (index, score) pairs of the allowed classes among
+  // the `num_classes` first `scores` whose score is at least
+  // min_score_threshold. `scores` is any array-like type of floats, such as
+  // DequantizedValues.
+  template <typename Scores>
+  void AddClasses(const Scores& scores, int num_classes,
+                  std::vector<std::pair<int, float>>* classes) const {
+    for (int i = 0; i < num_classes; ++i) {
+      if (IsClassIndexAllowed(i) && scores[i] >= min_score_threshold_) {
+        classes->emplace_back(i, scores[i]);
+      }
+    }
+  }
+
+  // Keeps the top_k highest scoring `classes` in descending score order if
+  // top_k is set, or sorts them all by descending score if
+  // sort_by_descending_score is set.
+  void SortClasses(std::vector<std::pair<int, float>>* classes) const;
+
+  bool IsClassIndexAllowed(int class_index) const;
+
+ private:
+  ClassificationSelector() = default;
+
+  int top_k_ = 0;
+  bool sort_by_descending_score_ = false;
+  float min_score_threshold_ = std::numeric_limits<float>::lowest();
+  // Allowed or ignored class indices.
+  absl::flat_hash_set<int> class_indices_;
+  bool is_allowlist_ = false;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_CLASSIFICATION_UTILS_H_
@@ -0,0 +1,82 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_classification_utils.h"
+
+#include <utility>
+#include <vector>
+
+#include "mediapipe/calculators/tensor/tensors_to_classification_calculator.pb.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
+
+namespace mediapipe {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+using ::testing::Pair;
+
+const std::vector<float> kScores = {0.3, 0.8, 0.1, 0.5};
+
+std::vector<std::pair<int, float>> SelectClasses(
+    const TensorsToClassificationCalculatorOptions& options) {
+  auto selector_or = ClassificationSelector::Create(options);
+  EXPECT_TRUE(selector_or.ok());
+  std::vector<std::pair<int, float>> classes;
+  selector_or.value()->AddClasses(kScores, kScores.size(), &classes);
+  selector_or.value()->SortClasses(&classes);
+  return classes;
+}
+
+TEST(ClassificationSelectorTest, KeepsAllClassesInOrderByDefault) {
+  EXPECT_THAT(SelectClasses(TensorsToClassificationCalculatorOptions()),
+              ElementsAre(Pair(0, 0.3f), Pair(1, 0.8f), Pair(2, 0.1f),
+                          Pair(3, 0.5f)));
+}
+
+TEST(ClassificationSelectorTest, FiltersAndKeepsTopK) {
+  EXPECT_THAT(
+      SelectClasses(
+          ParseTextProtoOrDie<TensorsToClassificationCalculatorOptions>(R"pb(
+            min_score_threshold: 0.2 top_k: 2 ignore_classes: 1
+          )pb")),
+      ElementsAre(Pair(3, 0.5f), Pair(0, 0.3f)));
+}
+
+TEST(ClassificationSelectorTest, SortsAllowedClasses) {
+  EXPECT_THAT(
+      SelectClasses(
+          ParseTextProtoOrDie<TensorsToClassificationCalculatorOptions>(R"pb(
+            sort_by_descending_score: true
+            allow_classes: [ 0, 2, 3 ]
+          )pb")),
+      ElementsAre(Pair(3, 0.5f), Pair(0, 0.3f), Pair(2, 0.1f)));
+}
+
+TEST(ClassificationSelectorTest, FailsWithAllowAndIgnoreClasses) {
+  auto selector_or = ClassificationSelector::Create(
+      ParseTextProtoOrDie<TensorsToClassificationCalculatorOptions>(R"pb(
+        allow_classes: 1 ignore_classes: 2
+      )pb"));
+
+  ASSERT_FALSE(selector_or.ok());
+  EXPECT_EQ(selector_or.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(selector_or.status().message(),
+              HasSubstr("mutually exclusive"));
+}
+
+}  // namespace
+}  // namespace mediapipe
@@ -12,11 +12,13 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
 #include "absl/strings/str_format.h"
 #include "absl/types/span.h"
+#include "mediapipe/calculators/tensor/tensors_dequantization_utils.h"
 #include "mediapipe/calculators/tensor/tensors_to_detections_calculator.pb.h"
 #include "mediapipe/framework/api2/node.h"
 #include "mediapipe/framework/calculator_framework.h"
@@ -139,6 +141,9 @@ absl::Status CheckCustomTensorMapping(
 //            for anchors (e.g. for SSD models) depend on the outputs of the
 //            detection model. The size of anchor tensor must be (num_boxes *
 //            4).
+//            On CPU, the raw box and score tensors may also be of type kUInt8
+//            or kInt8, in which case they are dequantized on the fly using
+//            their quantization parameters.
 //
 // Input side packet:
 //  ANCHORS (optional) - The anchors used for decoding the bounding boxes, as a
@@ -194,9 +199,13 @@ class TensorsToDetectionsCalculator : public Node {
 
   absl::Status LoadOptions(CalculatorContext* cc);
   absl::Status GpuInit(CalculatorContext* cc);
-  absl::Status DecodeBoxes(const float* raw_boxes,
+  template <typename Values>
+  absl::Status DecodeBoxes(const Values& raw_boxes,
                            const std::vector<Anchor>& anchors,
                            std::vector<float>* boxes);
+  template <typename Values>
+  void ScoreBoxes(const Values& raw_scores, float* detection_scores,
+                  int* detection_classes);
   absl::Status ConvertToDetections(const float* detection_boxes,
                                    const float* detection_scores,
                                    const int* detection_classes,
@@ -289,7 +298,12 @@ absl::Status TensorsToDetectionsCalculator::Process(CalculatorContext* cc) {
   }
   const auto& input_tensors = *kInTensors(cc);
   for (const auto& tensor : input_tensors) {
-    RET_CHECK(tensor.element_type() == Tensor::ElementType::kFloat32);
+    // Quantized raw box and score tensors are decoded directly on CPU.
+    if (gpu_processing) {
+      RET_CHECK(tensor.element_type() == Tensor::ElementType::kFloat32);
+    } else {
+      RET_CHECK(IsFloatOrQuantized(tensor));
+    }
   }
   const int num_input_tensors = input_tensors.size();
   if (!scores_tensor_index_is_set_) {
@@ -343,10 +357,6 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
     RET_CHECK_EQ(raw_score_tensor->shape().dims[0], 1);
     RET_CHECK_EQ(raw_score_tensor->shape().dims[1], num_boxes_);
     RET_CHECK_EQ(raw_score_tensor->shape().dims[2], num_classes_);
-    auto raw_box_view = raw_box_tensor->GetCpuReadView();
-    auto raw_boxes = raw_box_view.buffer<float>();
-    auto raw_scores_view = raw_score_tensor->GetCpuReadView();
-    auto raw_scores = raw_scores_view.buffer<float>();
 
     // TODO: Support other options to load anchors.
     if (!anchors_init_) {
@@ -356,6 +366,8 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
         RET_CHECK_EQ(anchor_tensor->shape().dims.size(), 2);
         RET_CHECK_EQ(anchor_tensor->shape().dims[0], num_boxes_);
         RET_CHECK_EQ(anchor_tensor->shape().dims[1], kNumCoordsPerBox);
+        RET_CHECK(anchor_tensor->element_type() ==
+                  Tensor::ElementType::kFloat32);
         auto anchor_view = anchor_tensor->GetCpuReadView();
         auto raw_anchors = anchor_view.buffer<float>();
         ConvertRawValuesToAnchors(raw_anchors, num_boxes_, &anchors_);
@@ -366,40 +378,22 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
       }
       anchors_init_ = true;
     }
+    // Raw boxes and scores may be quantized: they are dequantized on the fly
+    // while decoding, without an intermediate float tensor.
     std::vector<float> boxes(num_boxes_ * num_coords_);
-    MP_RETURN_IF_ERROR(DecodeBoxes(raw_boxes, anchors_, &boxes));
+    MP_RETURN_IF_ERROR(VisitDequantizedValues(
+        *raw_box_tensor, [&](const auto& raw_boxes) -> absl::Status {
+          return DecodeBoxes(raw_boxes, anchors_, &boxes);
+        }));
 
     std::vector<float> detection_scores(num_boxes_);
     std::vector<int> detection_classes(num_boxes_);
-
-    // Filter classes by scores.
-    for (int i = 0; i < num_boxes_; ++i) {
-      int class_id = -1;
-      float max_score = -std::numeric_limits<float>::max();
-      // Find the top score for box i.
-      for (int score_idx = 0; score_idx < num_classes_; ++score_idx) {
-        if (IsClassIndexAllowed(score_idx)) {
-          auto score = raw_scores[i * num_classes_ + score_idx];
-          if (options_.sigmoid_score()) {
-            if (options_.has_score_clipping_thresh()) {
-              score = score < -options_.score_clipping_thresh()
-                          ? -options_.score_clipping_thresh()
-                          : score;
-              score = score > options_.score_clipping_thresh()
-                          ? options_.score_clipping_thresh()
-                          : score;
-            }
-            score = 1.0f / (1.0f + std::exp(-score));
-          }
-          if (max_score < score) {
-            max_score = score;
-            class_id = score_idx;
-          }
-        }
-      }
-      detection_scores[i] = max_score;
-      detection_classes[i] = class_id;
-    }
+    MP_RETURN_IF_ERROR(VisitDequantizedValues(
+        *raw_score_tensor, [&](const auto& raw_scores) -> absl::Status {
+          ScoreBoxes(raw_scores, detection_scores.data(),
+                     detection_classes.data());
+          return absl::OkStatus();
+        }));
 
     MP_RETURN_IF_ERROR(
         ConvertToDetections(boxes.data(), detection_scores.data(),
@@ -408,6 +402,11 @@ absl::Status TensorsToDetectionsCalculator::ProcessCPU(
     // Postprocessing on CPU with postprocessing op (e.g. anchor decoding and
     // non-maximum suppression) within the model.
     RET_CHECK_EQ(input_tensors.size(), 4);
+    for (const auto& tensor : input_tensors) {
+      RET_CHECK(tensor.element_type() == Tensor::ElementType::kFloat32)
+          << "Quantized tensors are only supported for raw box and score "
+             "outputs.";
+    }
     auto num_boxes_tensor =
         &input_tensors[tensor_mapping_.num_detections_tensor_index()];
     RET_CHECK_EQ(num_boxes_tensor->shape().dims.size(), 1);
@@ -720,8 +719,9 @@ absl::Status TensorsToDetectionsCalculator::LoadOptions(CalculatorContext* cc) {
   return absl::OkStatus();
 }
 
+template <typename Values>
 absl::Status TensorsToDetectionsCalculator::DecodeBoxes(
-    const float* raw_boxes, const std::vector<Anchor>& anchors,
+    const Values& raw_boxes, const std::vector<Anchor>& anchors,
     std::vector<float>* boxes) {
   for (int i = 0; i < num_boxes_; ++i) {
     const int box_offset = i * num_coords_ + options_.box_coord_offset();
@@ -784,6 +784,40 @@ absl::Status TensorsToDetectionsCalculator::DecodeBoxes(
   return absl::OkStatus();
 }
 
+// Finds the top allowed class for each box. Clipping, sigmoid and
+// dequantization are all monotonic, so the maximum is searched over the
+// (clipped) raw values and the sigmoid is evaluated only once per box.
+template <typename Values>
+void TensorsToDetectionsCalculator::ScoreBoxes(const Values& raw_scores,
+                                               float* detection_scores,
+                                               int* detection_classes) {
+  const bool clip_scores =
+      options_.sigmoid_score() && options_.has_score_clipping_thresh();
+  const float clipping_thresh = options_.score_clipping_thresh();
+  for (int i = 0; i < num_boxes_; ++i) {
+    int class_id = -1;
+    float max_score = -std::numeric_limits<float>::max();
+    // Find the top score for box i.
+    for (int score_idx = 0; score_idx < num_classes_; ++score_idx) {
+      if (IsClassIndexAllowed(score_idx)) {
+        float score = raw_scores[i * num_classes_ + score_idx];
+        if (clip_scores) {
+          score = std::min(std::max(score, -clipping_thresh), clipping_thresh);
+        }
+        if (max_score < score) {
+          max_score = score;
+          class_id = score_idx;
+        }
+      }
+    }
+    if (options_.sigmoid_score() && class_id >= 0) {
+      max_score = 1.0f / (1.0f + std::exp(-max_score));
+    }
+    detection_scores[i] = max_score;
+    detection_classes[i] = class_id;
+  }
+}
+
 absl::Status TensorsToDetectionsCalculator::ConvertToDetections(
     const float* detection_boxes, const float* detection_scores,
     const int* detection_classes, std::vector<Detection>* output_detections) {
@@ -12,18 +12,25 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <memory>
 #include <vector>
 
+#include "absl/memory/memory.h"
 #include "absl/strings/str_format.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/types/span.h"
 #include "mediapipe/calculators/tensor/tensors_to_segmentation_calculator.pb.h"
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
 #include "mediapipe/framework/calculator_context.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image.h"
+#include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/framework/port.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/gpu/gpu_origin.pb.h"
 #include "mediapipe/util/resource_util.h"
 #include "tensorflow/lite/interpreter.h"
@@ -35,11 +42,6 @@
 #include "mediapipe/gpu/shader_util.h"
 #endif  // !MEDIAPIPE_DISABLE_GPU
 
-#if !MEDIAPIPE_DISABLE_OPENCV
-#include "mediapipe/framework/formats/image_opencv.h"
-#include "mediapipe/framework/port/opencv_imgproc_inc.h"
-#endif  // !MEDIAPIPE_DISABLE_OPENCV
-
 #if MEDIAPIPE_OPENGL_ES_VERSION >= MEDIAPIPE_OPENGL_ES_31
 #include "tensorflow/lite/delegates/gpu/gl/converters/util.h"
 #include "tensorflow/lite/delegates/gpu/gl/gl_program.h"
@@ -80,6 +82,9 @@ constexpr char kTensorsTag[] = "TENSORS";
 constexpr char kOutputSizeTag[] = "OUTPUT_SIZE";
 constexpr char kMaskTag[] = "MASK";
 
+// Minimum number of output rows worth handing to a separate CPU thread.
+constexpr int kMinRowsPerCpuChunk = 32;
+
 absl::StatusOr<std::tuple<int, int, int>> GetHwcFromDims(
     const std::vector<int>& dims) {
   if (dims.size() == 3) {
@@ -111,7 +116,10 @@ using ::tflite::gpu::gl::GlShader;
 // mask are both on CPU.
 //
 // On GPU, the mask is an RGBA image, in both the R & A channels, scaled 0-1.
-// On CPU, the mask is a ImageFormat::VEC32F1 image, with values scaled 0-1.
+// On CPU, the mask is a ImageFormat::VEC32F1 image, with values scaled 0-1, or
+// a ImageFormat::GRAY8 image scaled 0-255 if cpu_output_uint8 is set. The CPU
+// activation, upscale and quantization run as a single fused pass over the
+// output, optionally split by rows across cpu_num_threads threads.
 //
 //
 // Inputs:
@@ -123,7 +131,7 @@ using ::tflite::gpu::gl::GlShader;
 //                          If provided, the size to upscale mask to.
 //
 // Output:
-//   MASK: An Image output mask, RGBA(GPU) / VEC32F1(CPU).
+//   MASK: An Image output mask, RGBA(GPU) / VEC32F1 or GRAY8(CPU).
 //
 // Options:
 //   See tensors_to_segmentation_calculator.proto
@@ -163,11 +171,9 @@ class TensorsToSegmentationCalculator : public CalculatorBase {
     return options_.gpu_origin() != mediapipe::GpuOrigin_Mode_TOP_LEFT;
   }
 
-#if !MEDIAPIPE_DISABLE_OPENCV
-  template <class T>
-  absl::Status ApplyActivation(cv::Mat& tensor_mat, cv::Mat* small_mask_mat);
-#endif  // !MEDIAPIPE_DISABLE_OPENCV
   ::mediapipe::TensorsToSegmentationCalculatorOptions options_;
+  // Splits the CPU mask computation by rows when cpu_num_threads > 1.
+  std::unique_ptr<mediapipe::ThreadPool> cpu_thread_pool_;
 
 #if !MEDIAPIPE_DISABLE_GPU
   mediapipe::GlCalculatorHelper gpu_helper_;
@@ -229,6 +235,12 @@ absl::Status TensorsToSegmentationCalculator::Open(CalculatorContext* cc) {
 
   MP_RETURN_IF_ERROR(LoadOptions(cc));
 
+  if (options_.cpu_num_threads() > 1) {
+    cpu_thread_pool_ = absl::make_unique<mediapipe::ThreadPool>(
+        "SegmentationCpu", options_.cpu_num_threads());
+    cpu_thread_pool_->StartWorkers();
+  }
+
   if (use_gpu) {
 #if !MEDIAPIPE_DISABLE_GPU
     MP_RETURN_IF_ERROR(InitGpu(cc));
@@ -289,11 +301,7 @@ absl::Status TensorsToSegmentationCalculator::Process(CalculatorContext* cc) {
     RET_CHECK_FAIL() << "GPU processing disabled.";
 #endif  // !MEDIAPIPE_DISABLE_GPU
   } else {
-#if !MEDIAPIPE_DISABLE_OPENCV
     MP_RETURN_IF_ERROR(ProcessCpu(cc));
-#else
-    RET_CHECK_FAIL() << "OpenCV processing disabled.";
-#endif  // !MEDIAPIPE_DISABLE_OPENCV
   }
 
   return absl::OkStatus();
@@ -321,7 +329,6 @@ absl::Status TensorsToSegmentationCalculator::Close(CalculatorContext* cc) {
 
 absl::Status TensorsToSegmentationCalculator::ProcessCpu(
     CalculatorContext* cc) {
-#if !MEDIAPIPE_DISABLE_OPENCV
   // Get input streams, and dimensions.
   const auto& input_tensors =
       cc->Inputs().Tag(kTensorsTag).Get<std::vector<Tensor>>();
@@ -334,97 +341,76 @@ absl::Status TensorsToSegmentationCalculator::ProcessCpu(
     output_width = size.first;
     output_height = size.second;
   }
-
-  // Create initial working mask.
-  cv::Mat small_mask_mat(cv::Size(tensor_width, tensor_height), CV_32FC1);
+  RET_CHECK(tensor_channels == 1 || tensor_channels == 2)
+      << "Unsupported number of tensor channels " << tensor_channels;
 
   // Wrap input tensor.
-  auto raw_input_tensor = &input_tensors[0];
-  auto raw_input_view = raw_input_tensor->GetCpuReadView();
-  const float* raw_input_data = raw_input_view.buffer<float>();
-  cv::Mat tensor_mat(cv::Size(tensor_width, tensor_height),
-                     CV_MAKETYPE(CV_32F, tensor_channels),
-                     const_cast<float*>(raw_input_data));
-
-  // Process mask tensor and apply activation function.
-  if (tensor_channels == 2) {
-    MP_RETURN_IF_ERROR(ApplyActivation<cv::Vec2f>(tensor_mat, &small_mask_mat));
-  } else if (tensor_channels == 1) {
-    RET_CHECK(mediapipe::TensorsToSegmentationCalculatorOptions::SOFTMAX !=
-              options_.activation());  // Requires 2 channels.
-    if (mediapipe::TensorsToSegmentationCalculatorOptions::NONE ==
-        options_.activation())  // Pass-through optimization.
-      tensor_mat.copyTo(small_mask_mat);
-    else
-      MP_RETURN_IF_ERROR(ApplyActivation<float>(tensor_mat, &small_mask_mat));
-  } else {
-    RET_CHECK_FAIL() << "Unsupported number of tensor channels "
-                     << tensor_channels;
+  auto raw_input_view = input_tensors[0].GetCpuReadView();
+  SegmentationTensorSpec tensor_spec;
+  tensor_spec.data = raw_input_view.buffer<float>();
+  tensor_spec.width = tensor_width;
+  tensor_spec.height = tensor_height;
+  tensor_spec.channels = tensor_channels;
+  tensor_spec.output_layer_index = options_.output_layer_index();
+  typedef mediapipe::TensorsToSegmentationCalculatorOptions Options;
+  switch (options_.activation()) {
+    case Options::NONE:
+      tensor_spec.activation = SegmentationActivation::kNone;
+      break;
+    case Options::SIGMOID:
+      tensor_spec.activation = SegmentationActivation::kSigmoid;
+      break;
+    case Options::SOFTMAX:
+      RET_CHECK(tensor_spec.output_layer_index == 0 ||
+                tensor_spec.output_layer_index == 1);
+      tensor_spec.activation = SegmentationActivation::kSoftmax;
+      break;
   }
 
-  // Send out image as CPU packet.
-  std::shared_ptr<ImageFrame> mask_frame = std::make_shared<ImageFrame>(
-      ImageFormat::VEC32F1, output_width, output_height);
-  std::unique_ptr<Image> output_mask = absl::make_unique<Image>(mask_frame);
-  auto output_mat = formats::MatView(output_mask.get());
-  // Upsample small mask into output.
-  cv::resize(small_mask_mat, *output_mat,
-             cv::Size(output_width, output_height));
-  cc->Outputs().Tag(kMaskTag).Add(output_mask.release(), cc->InputTimestamp());
-#endif  // !MEDIAPIPE_DISABLE_OPENCV
-
-  return absl::OkStatus();
-}
-
-#if !MEDIAPIPE_DISABLE_OPENCV
-template <class T>
-absl::Status TensorsToSegmentationCalculator::ApplyActivation(
-    cv::Mat& tensor_mat, cv::Mat* small_mask_mat) {
-  // Configure activation function.
-  const int output_layer_index = options_.output_layer_index();
-  typedef mediapipe::TensorsToSegmentationCalculatorOptions Options;
-  const auto activation_fn = [&](const cv::Vec2f& mask_value) {
-    float new_mask_value = 0;
-    // TODO consider moving switch out of the loop,
-    // and also avoid float/Vec2f casting.
-    switch (options_.activation()) {
-      case Options::NONE: {
-        new_mask_value = mask_value[0];
-        break;
-      }
-      case Options::SIGMOID: {
-        const float pixel0 = mask_value[0];
-        new_mask_value = 1.0 / (std::exp(-pixel0) + 1.0);
-        break;
-      }
-      case Options::SOFTMAX: {
-        const float pixel0 = mask_value[0];
-        const float pixel1 = mask_value[1];
-        const float max_pixel = std::max(pixel0, pixel1);
-        const float min_pixel = std::min(pixel0, pixel1);
-        const float softmax_denom =
-            /*exp(max_pixel - max_pixel)=*/1.0f +
-            std::exp(min_pixel - max_pixel);
-        new_mask_value = std::exp(mask_value[output_layer_index] - max_pixel) /
-                         softmax_denom;
-        break;
-      }
+  // Activate, upsample and (optionally) quantize straight into the output.
+  const bool quantize = options_.cpu_output_uint8();
+  auto mask_frame = std::make_shared<ImageFrame>(
+      quantize ? ImageFormat::GRAY8 : ImageFormat::VEC32F1, output_width,
+      output_height, ImageFrame::kDefaultAlignmentBoundary);
+  uint8* mask_data = mask_frame->MutablePixelData();
+  const int width_step = mask_frame->WidthStep();
+  auto compute_rows = [&](int row_begin, int row_end) {
+    if (quantize) {
+      ComputeSegmentationMaskRows(tensor_spec, output_width, output_height,
+                                  row_begin, row_end, width_step, mask_data);
+    } else {
+      ComputeSegmentationMaskRows(tensor_spec, output_width, output_height,
+                                  row_begin, row_end,
+                                  width_step / sizeof(float),
+                                  reinterpret_cast<float*>(mask_data));
     }
-    return new_mask_value;
   };
 
-  // Process mask tensor.
-  for (int i = 0; i < tensor_mat.rows; ++i) {
-    for (int j = 0; j < tensor_mat.cols; ++j) {
-      const T& input_pix = tensor_mat.at<T>(i, j);
-      const float mask_value = activation_fn(input_pix);
-      small_mask_mat->at<float>(i, j) = mask_value;
+  const int num_chunks =
+      cpu_thread_pool_ ? std::min(cpu_thread_pool_->num_threads(),
+                                  output_height / kMinRowsPerCpuChunk)
+                       : 1;
+  if (num_chunks <= 1) {
+    compute_rows(0, output_height);
+  } else {
+    absl::BlockingCounter counter(num_chunks);
+    for (int i = 0; i < num_chunks; ++i) {
+      const int row_begin = output_height * i / num_chunks;
+      const int row_end = output_height * (i + 1) / num_chunks;
+      cpu_thread_pool_->Schedule([&compute_rows, &counter, row_begin,
+                                  row_end]() {
+        compute_rows(row_begin, row_end);
+        counter.DecrementCount();
+      });
     }
+    counter.Wait();
   }
 
+  // Send out image as CPU packet.
+  cc->Outputs().Tag(kMaskTag).Add(new Image(std::move(mask_frame)),
+                                  cc->InputTimestamp());
   return absl::OkStatus();
 }
-#endif  // !MEDIAPIPE_DISABLE_OPENCV
 
 // Steps:
 // 1. receive tensor
@@ -0,0 +1,175 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mediapipe {
+namespace {
+
+// Source sample positions for one output coordinate, following the
+// half-pixel-center convention used by cv::resize(INTER_LINEAR).
+struct LinearTap {
+  int index0;
+  int index1;
+  float weight1;
+};
+
+std::vector<LinearTap> ComputeLinearTaps(int src_size, int dst_size) {
+  std::vector<LinearTap> taps(dst_size);
+  const float scale = static_cast<float>(src_size) / dst_size;
+  for (int i = 0; i < dst_size; ++i) {
+    const float src = (i + 0.5f) * scale - 0.5f;
+    int index0 = static_cast<int>(std::floor(src));
+    float weight1 = src - index0;
+    if (index0 < 0) {
+      index0 = 0;
+      weight1 = 0.0f;
+    }
+    if (index0 >= src_size - 1) {
+      index0 = src_size - 1;
+      weight1 = 0.0f;
+    }
+    taps[i] = {index0, std::min(index0 + 1, src_size - 1), weight1};
+  }
+  return taps;
+}
+
+// Activates one tensor row into |dst| (tensor.width elements). The activation
+// switch is hoisted out of the per-pixel loops so each loop is branch free.
+void ActivateRow(const SegmentationTensorSpec& tensor, int row, float* dst) {
+  const int width = tensor.width;
+  const float* src = tensor.data + row * width * tensor.channels;
+  switch (tensor.activation) {
+    case SegmentationActivation::kNone:
+      if (tensor.channels == 1) {
+        std::copy(src, src + width, dst);
+      } else {
+        for (int x = 0; x < width; ++x) dst[x] = src[x * tensor.channels];
+      }
+      break;
+    case SegmentationActivation::kSigmoid:
+      for (int x = 0; x < width; ++x) {
+        dst[x] = 1.0f / (1.0f + std::exp(-src[x * tensor.channels]));
+      }
+      break;
+    case SegmentationActivation::kSoftmax: {
+      // Two-channel softmax reduces to a sigmoid of the channel difference.
+      const int keep = tensor.output_layer_index;
+      const int other = 1 - keep;
+      for (int x = 0; x < width; ++x) {
+        const float* pixel = src + x * 2;
+        dst[x] = 1.0f / (1.0f + std::exp(pixel[other] - pixel[keep]));
+      }
+      break;
+    }
+  }
+}
+
+template <typename T>
+inline T ConvertMaskValue(float value);
+
+template <>
+inline float ConvertMaskValue<float>(float value) {
+  return value;
+}
+
+template <>
+inline uint8_t ConvertMaskValue<uint8_t>(float value) {
+  const float scaled = value * 255.0f + 0.5f;
+  return static_cast<uint8_t>(std::min(std::max(scaled, 0.0f), 255.0f));
+}
+
+template <typename T>
+void ComputeRows(const SegmentationTensorSpec& tensor, int output_width,
+                 int output_height, int row_begin, int row_end,
+                 int output_row_stride, T* output) {
+  if (row_begin >= row_end) return;
+  const std::vector<LinearTap> x_taps =
+      ComputeLinearTaps(tensor.width, output_width);
+  const std::vector<LinearTap> y_taps =
+      ComputeLinearTaps(tensor.height, output_height);
+
+  // Scratch: one activated tensor row plus two horizontally resampled rows
+  // (the pair of tensor rows the current output row is interpolated from).
+  std::vector<float> activated(tensor.width);
+  std::vector<float> resampled0(output_width);
+  std::vector<float> resampled1(output_width);
+  float* top = resampled0.data();
+  float* bottom = resampled1.data();
+  int top_row = -1;
+  int bottom_row = -1;
+
+  auto resample_row = [&](int row, float* dst) {
+    ActivateRow(tensor, row, activated.data());
+    const float* src = activated.data();
+    for (int x = 0; x < output_width; ++x) {
+      const LinearTap& tap = x_taps[x];
+      const float v0 = src[tap.index0];
+      dst[x] = v0 + (src[tap.index1] - v0) * tap.weight1;
+    }
+  };
+
+  for (int y = row_begin; y < row_end; ++y) {
+    const LinearTap& tap = y_taps[y];
+    if (tap.index0 != top_row) {
+      if (tap.index0 == bottom_row) {
+        std::swap(top, bottom);
+        std::swap(top_row, bottom_row);
+      } else {
+        resample_row(tap.index0, top);
+        top_row = tap.index0;
+      }
+    }
+    if (tap.index1 != bottom_row) {
+      if (tap.index1 == top_row) {
+        std::copy(top, top + output_width, bottom);
+      } else {
+        resample_row(tap.index1, bottom);
+      }
+      bottom_row = tap.index1;
+    }
+
+    T* dst = output + static_cast<int64_t>(y) * output_row_stride;
+    const float weight1 = tap.weight1;
+    for (int x = 0; x < output_width; ++x) {
+      dst[x] = ConvertMaskValue<T>(top[x] + (bottom[x] - top[x]) * weight1);
+    }
+  }
+}
+
+}  // namespace
+
+void ComputeSegmentationMaskRows(const SegmentationTensorSpec& tensor,
+                                 int output_width, int output_height,
+                                 int row_begin, int row_end,
+                                 int output_row_stride, float* output) {
+  ComputeRows(tensor, output_width, output_height, row_begin, row_end,
+              output_row_stride, output);
+}
+
+void ComputeSegmentationMaskRows(const SegmentationTensorSpec& tensor,
+                                 int output_width, int output_height,
+                                 int row_begin, int row_end,
+                                 int output_row_stride, uint8_t* output) {
+  ComputeRows(tensor, output_width, output_height, row_begin, row_end,
+              output_row_stride, output);
+}
+
+}  // namespace mediapipe
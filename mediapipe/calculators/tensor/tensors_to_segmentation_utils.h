@@ -0,0 +1,62 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_UTILS_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_UTILS_H_
+
+#include <cstdint>
+
+namespace mediapipe {
+
+// Activation applied to the raw segmentation tensor values.
+enum class SegmentationActivation {
+  kNone,     // 1-channel tensor, values are passed through.
+  kSigmoid,  // 1-channel tensor.
+  kSoftmax,  // 2-channel tensor, see SegmentationTensorSpec.output_layer_index.
+};
+
+// Describes an HWC float segmentation tensor and how to turn it into a mask.
+struct SegmentationTensorSpec {
+  const float* data;
+  int width;
+  int height;
+  int channels;
+  SegmentationActivation activation;
+  // Channel to keep when activation is kSoftmax.
+  int output_layer_index;
+};
+
+// Fused CPU mask kernel: applies the activation to the tensor and bilinearly
+// resamples it to the output size (matching cv::resize with INTER_LINEAR) in
+// a single pass, producing rows [row_begin, row_end) of the output mask.
+//
+// Each tensor row is activated and horizontally resampled at most once per
+// call, and no intermediate full-size mask is allocated. Disjoint row ranges
+// may be computed concurrently.
+//
+// @output_row_stride is expressed in elements, not bytes.
+void ComputeSegmentationMaskRows(const SegmentationTensorSpec& tensor,
+                                 int output_width, int output_height,
+                                 int row_begin, int row_end,
+                                 int output_row_stride, float* output);
+
+// Same as above, but quantizes mask values from [0, 1] to [0, 255].
+void ComputeSegmentationMaskRows(const SegmentationTensorSpec& tensor,
+                                 int output_width, int output_height,
+                                 int row_begin, int row_end,
+                                 int output_row_stride, uint8_t* output);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_TENSORS_TO_SEGMENTATION_UTILS_H_
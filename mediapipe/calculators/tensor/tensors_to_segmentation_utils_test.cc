@@ -0,0 +1,227 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/tensors_to_segmentation_utils.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "absl/synchronization/blocking_counter.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/framework/port/threadpool.h"
+
+namespace mediapipe {
+namespace {
+
+std::vector<float> MakeRandomTensor(int width, int height, int channels) {
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> dist(-8.0f, 8.0f);
+  std::vector<float> tensor(width * height * channels);
+  for (float& value : tensor) value = dist(rng);
+  return tensor;
+}
+
+// Reference implementation: the previous two-pass CPU path, i.e. per-pixel
+// activation into a small mask followed by cv::resize.
+cv::Mat ReferenceMask(const SegmentationTensorSpec& spec, int output_width,
+                      int output_height) {
+  cv::Mat small_mask(spec.height, spec.width, CV_32FC1);
+  for (int y = 0; y < spec.height; ++y) {
+    for (int x = 0; x < spec.width; ++x) {
+      const float* pixel = spec.data + (y * spec.width + x) * spec.channels;
+      float value = pixel[0];
+      switch (spec.activation) {
+        case SegmentationActivation::kNone:
+          break;
+        case SegmentationActivation::kSigmoid:
+          value = 1.0 / (std::exp(-pixel[0]) + 1.0);
+          break;
+        case SegmentationActivation::kSoftmax: {
+          const float max_pixel = std::max(pixel[0], pixel[1]);
+          const float min_pixel = std::min(pixel[0], pixel[1]);
+          value = std::exp(pixel[spec.output_layer_index] - max_pixel) /
+                  (1.0f + std::exp(min_pixel - max_pixel));
+          break;
+        }
+      }
+      small_mask.at<float>(y, x) = value;
+    }
+  }
+  cv::Mat output;
+  cv::resize(small_mask, output, cv::Size(output_width, output_height));
+  return output;
+}
+
+struct FusedMaskTestCase {
+  int tensor_width;
+  int tensor_height;
+  int output_width;
+  int output_height;
+  SegmentationActivation activation;
+  int output_layer_index;
+};
+
+class FusedMaskTest : public testing::TestWithParam<FusedMaskTestCase> {};
+
+TEST_P(FusedMaskTest, MatchesTwoPassFloat) {
+  const FusedMaskTestCase& test_case = GetParam();
+  const int channels =
+      test_case.activation == SegmentationActivation::kSoftmax ? 2 : 1;
+  const std::vector<float> tensor = MakeRandomTensor(
+      test_case.tensor_width, test_case.tensor_height, channels);
+  const SegmentationTensorSpec spec = {
+      tensor.data(),          test_case.tensor_width,
+      test_case.tensor_height, channels,
+      test_case.activation,   test_case.output_layer_index};
+
+  const cv::Mat expected =
+      ReferenceMask(spec, test_case.output_width, test_case.output_height);
+  std::vector<float> output(test_case.output_width * test_case.output_height);
+  // Compute in two uneven chunks to exercise row ranges.
+  const int split = test_case.output_height / 3;
+  ComputeSegmentationMaskRows(spec, test_case.output_width,
+                              test_case.output_height, 0, split,
+                              test_case.output_width, output.data());
+  ComputeSegmentationMaskRows(spec, test_case.output_width,
+                              test_case.output_height, split,
+                              test_case.output_height, test_case.output_width,
+                              output.data());
+
+  for (int y = 0; y < test_case.output_height; ++y) {
+    for (int x = 0; x < test_case.output_width; ++x) {
+      ASSERT_NEAR(output[y * test_case.output_width + x],
+                  expected.at<float>(y, x), 1e-4f)
+          << "at (" << x << ", " << y << ")";
+    }
+  }
+}
+
+TEST_P(FusedMaskTest, MatchesTwoPassUint8) {
+  const FusedMaskTestCase& test_case = GetParam();
+  const int channels =
+      test_case.activation == SegmentationActivation::kSoftmax ? 2 : 1;
+  std::vector<float> tensor = MakeRandomTensor(
+      test_case.tensor_width, test_case.tensor_height, channels);
+  if (test_case.activation == SegmentationActivation::kNone) {
+    for (float& value : tensor) value = (value + 8.0f) / 16.0f;
+  }
+  const SegmentationTensorSpec spec = {
+      tensor.data(),          test_case.tensor_width,
+      test_case.tensor_height, channels,
+      test_case.activation,   test_case.output_layer_index};
+
+  const cv::Mat expected =
+      ReferenceMask(spec, test_case.output_width, test_case.output_height);
+  // Padded rows to exercise the output stride.
+  const int stride = test_case.output_width + 7;
+  std::vector<uint8_t> output(stride * test_case.output_height);
+  ComputeSegmentationMaskRows(spec, test_case.output_width,
+                              test_case.output_height, 0,
+                              test_case.output_height, stride, output.data());
+
+  for (int y = 0; y < test_case.output_height; ++y) {
+    for (int x = 0; x < test_case.output_width; ++x) {
+      ASSERT_NEAR(output[y * stride + x], expected.at<float>(y, x) * 255.0f,
+                  1.0f)
+          << "at (" << x << ", " << y << ")";
+    }
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    FusedMaskTests, FusedMaskTest,
+    testing::ValuesIn<FusedMaskTestCase>({
+        {16, 16, 16, 16, SegmentationActivation::kNone, 0},
+        {16, 12, 61, 47, SegmentationActivation::kNone, 0},
+        {16, 16, 64, 48, SegmentationActivation::kSigmoid, 0},
+        {32, 32, 13, 9, SegmentationActivation::kSigmoid, 0},
+        {16, 16, 100, 75, SegmentationActivation::kSoftmax, 1},
+        {20, 10, 33, 70, SegmentationActivation::kSoftmax, 0},
+    }));
+
+constexpr int kBenchmarkTensorSize = 256;
+constexpr int kBenchmarkOutputWidth = 1920;
+constexpr int kBenchmarkOutputHeight = 1080;
+
+SegmentationTensorSpec BenchmarkSpec(const std::vector<float>& tensor) {
+  return {tensor.data(),
+          kBenchmarkTensorSize,
+          kBenchmarkTensorSize,
+          2,
+          SegmentationActivation::kSoftmax,
+          1};
+}
+
+void BM_TwoPassOpenCvMask(benchmark::State& state) {
+  const std::vector<float> tensor =
+      MakeRandomTensor(kBenchmarkTensorSize, kBenchmarkTensorSize, 2);
+  const SegmentationTensorSpec spec = BenchmarkSpec(tensor);
+  for (auto _ : state) {
+    cv::Mat mask =
+        ReferenceMask(spec, kBenchmarkOutputWidth, kBenchmarkOutputHeight);
+    benchmark::DoNotOptimize(mask.data);
+  }
+}
+BENCHMARK(BM_TwoPassOpenCvMask);
+
+void BM_FusedFloatMask(benchmark::State& state) {
+  const std::vector<float> tensor =
+      MakeRandomTensor(kBenchmarkTensorSize, kBenchmarkTensorSize, 2);
+  const SegmentationTensorSpec spec = BenchmarkSpec(tensor);
+  std::vector<float> output(kBenchmarkOutputWidth * kBenchmarkOutputHeight);
+  for (auto _ : state) {
+    ComputeSegmentationMaskRows(spec, kBenchmarkOutputWidth,
+                                kBenchmarkOutputHeight, 0,
+                                kBenchmarkOutputHeight, kBenchmarkOutputWidth,
+                                output.data());
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+BENCHMARK(BM_FusedFloatMask);
+
+// Arg: number of threads the output rows are split between.
+void BM_FusedUint8Mask(benchmark::State& state) {
+  const int num_threads = state.range(0);
+  const std::vector<float> tensor =
+      MakeRandomTensor(kBenchmarkTensorSize, kBenchmarkTensorSize, 2);
+  const SegmentationTensorSpec spec = BenchmarkSpec(tensor);
+  std::vector<uint8_t> output(kBenchmarkOutputWidth * kBenchmarkOutputHeight);
+  ThreadPool pool("BM_FusedMask", num_threads);
+  pool.StartWorkers();
+  for (auto _ : state) {
+    absl::BlockingCounter counter(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      const int row_begin = kBenchmarkOutputHeight * i / num_threads;
+      const int row_end = kBenchmarkOutputHeight * (i + 1) / num_threads;
+      pool.Schedule([&, row_begin, row_end]() {
+        ComputeSegmentationMaskRows(spec, kBenchmarkOutputWidth,
+                                    kBenchmarkOutputHeight, row_begin,
+                                    row_end, kBenchmarkOutputWidth,
+                                    output.data());
+        counter.DecrementCount();
+      });
+    }
+    counter.Wait();
+    benchmark::DoNotOptimize(output.data());
+  }
+}
+BENCHMARK(BM_FusedUint8Mask)->Arg(1)->Arg(2)->Arg(4);
+
+}  // namespace
+}  // namespace mediapipe
@@ -0,0 +1,74 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/calculators/tensor/xnnpack_weights_cache.h"
+
+#include <memory>
+#include <utility>
+
+#include "absl/container/flat_hash_map.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+
+XnnpackWeightsCache::XnnpackWeightsCache(api2::Packet<TfLiteModelPtr> model)
+    : model_(std::move(model)),
+      weights_cache_(TfLiteXNNPackDelegateWeightsCacheCreate()) {}
+
+XnnpackWeightsCache::~XnnpackWeightsCache() {
+  TfLiteXNNPackDelegateWeightsCacheDelete(weights_cache_);
+}
+
+absl::StatusOr<std::unique_ptr<InferenceRunner>>
+XnnpackWeightsCache::CreateRunner(CreateRunnerFn create_runner) {
+  RET_CHECK(weights_cache_) << "Failed to create XNNPACK weights cache.";
+  // Concurrent first users wait for the weights to be packed, rather than
+  // packing them again.
+  absl::MutexLock lock(&mutex_);
+  ASSIGN_OR_RETURN(auto runner, create_runner());
+  if (!finalized_) {
+    RET_CHECK(TfLiteXNNPackDelegateWeightsCacheFinalizeHard(weights_cache_))
+        << "Failed to finalize XNNPACK weights cache.";
+    finalized_ = true;
+  }
+  return runner;
+}
+
+std::shared_ptr<XnnpackWeightsCache> GetXnnpackWeightsCache(
+    const api2::Packet<TfLiteModelPtr>& model) {
+  static absl::Mutex mutex(absl::kConstInit);
+  // Entries are keyed by the model address: a cache holds its model, so an
+  // address is only reused once its cache has expired.
+  static auto* caches ABSL_GUARDED_BY(mutex) =
+      new absl::flat_hash_map<const tflite::FlatBufferModel*,
+                              std::weak_ptr<XnnpackWeightsCache>>();
+  absl::MutexLock lock(&mutex);
+  for (auto it = caches->begin(); it != caches->end();) {
+    if (it->second.expired()) {
+      caches->erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  std::weak_ptr<XnnpackWeightsCache>& entry = (*caches)[model.Get().get()];
+  std::shared_ptr<XnnpackWeightsCache> cache = entry.lock();
+  if (cache == nullptr) {
+    cache = std::make_shared<XnnpackWeightsCache>(model);
+    entry = cache;
+  }
+  return cache;
+}
+
+}  // namespace mediapipe
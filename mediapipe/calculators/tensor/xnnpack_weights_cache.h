@@ -0,0 +1,69 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_CALCULATORS_TENSOR_XNNPACK_WEIGHTS_CACHE_H_
+#define MEDIAPIPE_CALCULATORS_TENSOR_XNNPACK_WEIGHTS_CACHE_H_
+
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/calculators/tensor/inference_runner.h"
+#include "mediapipe/framework/api2/packet.h"
+#include "mediapipe/util/tflite/tflite_model_loader.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+
+namespace mediapipe {
+
+// Weights of a model packed by XNNPACK, shared by all the XNNPACK delegates
+// running that model so that they are packed (and stored) only once. The
+// cache keeps the model alive, as the packed weights may point into it.
+class XnnpackWeightsCache {
+ public:
+  using CreateRunnerFn =
+      absl::FunctionRef<absl::StatusOr<std::unique_ptr<InferenceRunner>>()>;
+
+  explicit XnnpackWeightsCache(api2::Packet<TfLiteModelPtr> model);
+  ~XnnpackWeightsCache();
+  XnnpackWeightsCache(const XnnpackWeightsCache&) = delete;
+  XnnpackWeightsCache& operator=(const XnnpackWeightsCache&) = delete;
+
+  // To be set as TfLiteXNNPackDelegateOptions::weights_cache.
+  TfLiteXNNPackDelegateWeightsCache* Get() const { return weights_cache_; }
+
+  // Calls |create_runner|, which must create an inference runner applying an
+  // XNNPACK delegate with this cache to the model. The first runner created
+  // packs the weights into the cache, which is then finalized; the following
+  // ones only look them up.
+  absl::StatusOr<std::unique_ptr<InferenceRunner>> CreateRunner(
+      CreateRunnerFn create_runner) ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Released after the weights cache, which is deleted in the destructor.
+  const api2::Packet<TfLiteModelPtr> model_;
+  TfLiteXNNPackDelegateWeightsCache* const weights_cache_;
+  absl::Mutex mutex_;
+  bool finalized_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// Returns the XnnpackWeightsCache of the model held by |model|, which lives as
+// long as any of its users.
+std::shared_ptr<XnnpackWeightsCache> GetXnnpackWeightsCache(
+    const api2::Packet<TfLiteModelPtr>& model);
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_CALCULATORS_TENSOR_XNNPACK_WEIGHTS_CACHE_H_
@@ -14,14 +14,28 @@
 
 #include <stdlib.h>
 
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/calculators/video/opencv_video_decoder_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/video_stream_header.h"
 #include "mediapipe/framework/port/opencv_imgproc_inc.h"
 #include "mediapipe/framework/port/opencv_video_inc.h"
+#include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/framework/tool/status_util.h"
 
 namespace mediapipe {
@@ -53,6 +67,196 @@ ImageFormat::Format GetImageFormat(int num_channels) {
   }
   return format;
 }
+
+// Returns whether |cap| moves when seeking to |frame| (> 0), which it doesn't
+// for videos that can't seek. Leaves |cap| at an unspecified position.
+bool CanSeek(cv::VideoCapture* cap, int frame) {
+  return cap->set(cv::CAP_PROP_POS_FRAMES, frame) &&
+         cap->get(cv::CAP_PROP_POS_FRAMES) > 0;
+}
+
+// A decoded frame. A null image marks the end of the frames.
+struct DecodedFrame {
+  std::unique_ptr<ImageFrame> image;
+  Timestamp timestamp;
+};
+
+// Decodes frames [begin_frame, end_frame) of a video, where a negative
+// end_frame stands for the end of the video, keeping the frames whose index
+// minus stride_origin is a multiple of frame_stride.
+class FrameReader {
+ public:
+  struct Range {
+    int begin_frame = 0;
+    int end_frame = -1;
+    int stride_origin = 0;
+    int frame_stride = 1;
+  };
+
+  FrameReader(std::unique_ptr<cv::VideoCapture> cap, const Range& range,
+              ImageFormat::Format format, int width, int height,
+              CpuImageBufferPool* buffer_pool)
+      : cap_(std::move(cap)),
+        range_(range),
+        position_(range.begin_frame),
+        format_(format),
+        width_(width),
+        height_(height),
+        buffer_pool_(buffer_pool) {}
+
+  // Returns the next kept frame, in the order of the video.
+  DecodedFrame Next() {
+    if (!started_) {
+      // Seeking is deferred to the first frame, so that it happens on the
+      // decoding thread.
+      if (range_.begin_frame > 0) {
+        Seek();
+      }
+      started_ = true;
+    }
+    while (range_.end_frame < 0 || position_ < range_.end_frame) {
+      // Frames before begin_frame, which seeking may land on, are decoded
+      // but not kept.
+      const bool keep =
+          position_ >= range_.begin_frame &&
+          (position_ - range_.stride_origin) % range_.frame_stride == 0;
+      // Use microsecond as the unit of time.
+      Timestamp timestamp(cap_->get(cv::CAP_PROP_POS_MSEC) * 1000);
+      ++position_;
+      if (!keep) {
+        // Decodes the frame without converting it.
+        if (!cap_->grab() && !cap_->grab()) break;
+        continue;
+      }
+      std::unique_ptr<ImageFrame> image = ReadImage();
+      if (!image) break;
+      return {std::move(image), timestamp};
+    }
+    return {nullptr, Timestamp::Unset()};
+  }
+
+ private:
+  // Seeks to begin_frame, and sets position_ to the frame actually reached:
+  // seeking may land on an earlier frame (e.g. a key frame), or not move at
+  // all if the video can't seek.
+  void Seek() {
+    cap_->set(cv::CAP_PROP_POS_FRAMES, range_.begin_frame);
+    const int position =
+        static_cast<int>(cap_->get(cv::CAP_PROP_POS_FRAMES));
+    if (position < 0) {
+      // Unknown position: assumes that seeking was accurate.
+      return;
+    }
+    if (position > range_.begin_frame) {
+      LOG(WARNING) << "Seeking to frame " << range_.begin_frame
+                   << " reached frame " << position << ", the frames in "
+                   << "between are skipped.";
+    }
+    position_ = position;
+  }
+
+  std::unique_ptr<ImageFrame> ReadImage() {
+    auto image_frame = NewImageFrame(buffer_pool_, format_, width_, height_,
+                                     /*alignment_boundary=*/1);
+    if (format_ == ImageFormat::GRAY8) {
+      cv::Mat frame = formats::MatView(image_frame.get());
+      ReadFrame(frame);
+      if (frame.empty()) return nullptr;
+    } else {
+      ReadFrame(frame_);
+      if (frame_.empty()) return nullptr;
+      if (format_ == ImageFormat::SRGB) {
+        cv::cvtColor(frame_, formats::MatView(image_frame.get()),
+                     cv::COLOR_BGR2RGB);
+      } else if (format_ == ImageFormat::SRGBA) {
+        cv::cvtColor(frame_, formats::MatView(image_frame.get()),
+                     cv::COLOR_BGRA2RGBA);
+      }
+    }
+    return image_frame;
+  }
+
+  // Sometimes an empty frame is returned even though there are more frames.
+  void ReadFrame(cv::Mat& frame) {
+    cap_->read(frame);
+    if (frame.empty()) {
+      cap_->read(frame);  // Try again.
+    }
+  }
+
+  std::unique_ptr<cv::VideoCapture> cap_;
+  const Range range_;
+  // Index of the next frame of the video.
+  int position_;
+  bool started_ = false;
+  const ImageFormat::Format format_;
+  const int width_;
+  const int height_;
+  CpuImageBufferPool* const buffer_pool_;
+  // Decoded frame before color conversion, reused across frames.
+  cv::Mat frame_;
+};
+
+// Runs a FrameReader on a thread pool, keeping up to @capacity frames decoded
+// ahead of Next().
+class PrefetchingReader {
+ public:
+  PrefetchingReader(std::unique_ptr<FrameReader> reader, int capacity)
+      : reader_(std::move(reader)), capacity_(capacity) {}
+
+  void Start(ThreadPool* thread_pool) {
+    thread_pool->Schedule([this]() { Run(); });
+  }
+
+  // Waits for the next frame. Returns a null image after the last one.
+  DecodedFrame Next() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(
+        +[](std::deque<DecodedFrame>* frames) { return !frames->empty(); },
+        &frames_));
+    DecodedFrame frame = std::move(frames_.front());
+    frames_.pop_front();
+    if (!frame.image) {
+      // Returns the end again on subsequent calls.
+      frames_.push_front({nullptr, Timestamp::Unset()});
+    }
+    return frame;
+  }
+
+  // Makes the decoding thread return as soon as possible.
+  void Cancel() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    cancelled_ = true;
+  }
+
+ private:
+  bool CanDecode() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return cancelled_ || frames_.size() < capacity_;
+  }
+
+  void Run() ABSL_LOCKS_EXCLUDED(mutex_) {
+    while (true) {
+      {
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(this, &PrefetchingReader::CanDecode));
+        if (cancelled_) return;
+      }
+      DecodedFrame frame = reader_->Next();
+      const bool last = frame.image == nullptr;
+      absl::MutexLock lock(&mutex_);
+      frames_.push_back(std::move(frame));
+      if (last) return;
+    }
+  }
+
+  // Only accessed by the decoding thread.
+  std::unique_ptr<FrameReader> reader_;
+  const size_t capacity_;
+  absl::Mutex mutex_;
+  std::deque<DecodedFrame> frames_ ABSL_GUARDED_BY(mutex_);
+  bool cancelled_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
 }  // namespace
 
 // This Calculator takes no input streams and produces video packets.
@@ -90,8 +294,28 @@ ImageFormat::Format GetImageFormat(int num_channels) {
 //   output_stream: "VIDEO_PRESTREAM:video_header"
 // }
 //
+// For offline processing, frames can be decoded ahead of the graph on
+// background threads, in consecutive segments of the video decoded in
+// parallel, and a subset of the frames can be output. See
+// OpenCvVideoDecoderCalculatorOptions.
+//
+// Example config:
+// node {
+//   calculator: "OpenCvVideoDecoderCalculator"
+//   input_side_packet: "INPUT_FILE_PATH:input_file_path"
+//   output_stream: "VIDEO:video_frames"
+//   options {
+//     [mediapipe.OpenCvVideoDecoderCalculatorOptions.ext] {
+//       prefetch_frames: 16
+//       num_threads: 4
+//     }
+//   }
+// }
+//
 class OpenCvVideoDecoderCalculator : public CalculatorBase {
  public:
+  ~OpenCvVideoDecoderCalculator() override { StopPrefetching(); }
+
   static absl::Status GetContract(CalculatorContract* cc) {
     cc->InputSidePackets().Tag(kInputFilePathTag).Set<std::string>();
     cc->Outputs().Tag(kVideoTag).Set<ImageFrame>();
@@ -101,10 +325,22 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
     if (cc->OutputSidePackets().HasTag(kSavedAudioPathTag)) {
       cc->OutputSidePackets().Tag(kSavedAudioPathTag).Set<std::string>();
     }
+    cc->UseService(kCpuImageBufferPoolService).Optional();
     return absl::OkStatus();
   }
 
   absl::Status Open(CalculatorContext* cc) override {
+    const auto& options =
+        cc->Options<::mediapipe::OpenCvVideoDecoderCalculatorOptions>();
+    RET_CHECK_GE(options.prefetch_frames(), 0);
+    RET_CHECK_GE(options.num_threads(), 1);
+    RET_CHECK_GE(options.frame_stride(), 1);
+    RET_CHECK(options.num_threads() == 1 || options.prefetch_frames() > 0)
+        << "Parallel decoding requires prefetch_frames > 0.";
+    if (cc->Service(kCpuImageBufferPoolService).IsAvailable()) {
+      buffer_pool_ = &cc->Service(kCpuImageBufferPoolService).GetObject();
+    }
+
     const std::string& input_file_path =
         cc->InputSidePackets().Tag(kInputFilePathTag).Get<std::string>();
     cap_ = absl::make_unique<cv::VideoCapture>(input_file_path);
@@ -139,12 +375,32 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
                 "the video file at "
              << input_file_path;
     }
+
+    // Frames to output.
+    FrameReader::Range range;
+    range.begin_frame = std::max(
+        0, static_cast<int>(std::round(options.start_time_seconds() * fps)));
+    if (options.end_time_seconds() > 0) {
+      range.end_frame = std::min(
+          frame_count_,
+          static_cast<int>(std::round(options.end_time_seconds() * fps)));
+    }
+    range.stride_origin = range.begin_frame;
+    range.frame_stride = options.frame_stride();
+    const int num_frames =
+        (range.end_frame < 0 ? frame_count_ : range.end_frame) -
+        range.begin_frame;
+    RET_CHECK_GT(num_frames, 0)
+        << "Empty time range of the video file at " << input_file_path;
+    expected_frames_ =
+        (num_frames + range.frame_stride - 1) / range.frame_stride;
+
     auto header = absl::make_unique<VideoHeader>();
     header->format = format_;
     header->width = width_;
     header->height = height_;
-    header->frame_rate = fps;
-    header->duration = frame_count_ / fps;
+    header->frame_rate = fps / range.frame_stride;
+    header->duration = num_frames / fps;
 
     if (cc->Outputs().HasTag(kVideoPrestreamTag)) {
       cc->Outputs()
@@ -152,6 +408,20 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
           .Add(header.release(), Timestamp::PreStream());
       cc->Outputs().Tag(kVideoPrestreamTag).Close();
     }
+    // Splits the frames in segments of whole strides, each decoded from its
+    // own VideoCapture, if the video can seek to the segments.
+    const int num_strides = expected_frames_;
+    int num_segments = options.prefetch_frames() == 0
+                           ? 1
+                           : std::min(options.num_threads(), num_strides);
+    const int segment_length =
+        (num_strides + num_segments - 1) / num_segments * range.frame_stride;
+    if (num_segments > 1 &&
+        !CanSeek(cap_.get(), range.begin_frame + segment_length)) {
+      LOG(WARNING) << "The video file at " << input_file_path
+                   << " can't seek, decoding it as a single segment.";
+      num_segments = 1;
+    }
     // Rewind to the very first frame.
     cap_->set(cv::CAP_PROP_POS_AVI_RATIO, 0);
 
@@ -183,39 +453,48 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
                 "config.";
 #endif
     }
+
+    if (options.prefetch_frames() == 0) {
+      reader_ = absl::make_unique<FrameReader>(std::move(cap_), range, format_,
+                                               width_, height_, buffer_pool_);
+      return absl::OkStatus();
+    }
+    for (int i = 0; i < num_segments; ++i) {
+      FrameReader::Range segment = range;
+      segment.begin_frame = range.begin_frame + i * segment_length;
+      if (i + 1 < num_segments) {
+        segment.end_frame = segment.begin_frame + segment_length;
+      }
+      std::unique_ptr<cv::VideoCapture> cap = std::move(cap_);
+      if (i > 0) {
+        cap = absl::make_unique<cv::VideoCapture>(input_file_path);
+        RET_CHECK(cap->isOpened())
+            << "Fail to open video file at " << input_file_path;
+      }
+      prefetching_readers_.push_back(absl::make_unique<PrefetchingReader>(
+          absl::make_unique<FrameReader>(std::move(cap), segment, format_,
+                                         width_, height_, buffer_pool_),
+          options.prefetch_frames()));
+    }
+    thread_pool_ = absl::make_unique<ThreadPool>("opencv_video_decoder",
+                                                 num_segments);
+    thread_pool_->StartWorkers();
+    for (auto& reader : prefetching_readers_) {
+      reader->Start(thread_pool_.get());
+    }
     return absl::OkStatus();
   }
 
   absl::Status Process(CalculatorContext* cc) override {
-    auto image_frame = absl::make_unique<ImageFrame>(format_, width_, height_,
-                                                     /*alignment_boundary=*/1);
-    // Use microsecond as the unit of time.
-    Timestamp timestamp(cap_->get(cv::CAP_PROP_POS_MSEC) * 1000);
-    if (format_ == ImageFormat::GRAY8) {
-      cv::Mat frame = formats::MatView(image_frame.get());
-      ReadFrame(frame);
-      if (frame.empty()) {
-        return tool::StatusStop();
-      }
-    } else {
-      cv::Mat tmp_frame;
-      ReadFrame(tmp_frame);
-      if (tmp_frame.empty()) {
-        return tool::StatusStop();
-      }
-      if (format_ == ImageFormat::SRGB) {
-        cv::cvtColor(tmp_frame, formats::MatView(image_frame.get()),
-                     cv::COLOR_BGR2RGB);
-      } else if (format_ == ImageFormat::SRGBA) {
-        cv::cvtColor(tmp_frame, formats::MatView(image_frame.get()),
-                     cv::COLOR_BGRA2RGBA);
-      }
+    DecodedFrame frame = NextFrame();
+    if (!frame.image) {
+      return tool::StatusStop();
     }
     // If the timestamp of the current frame is not greater than the one of the
     // previous frame, the new frame will be discarded.
-    if (prev_timestamp_ < timestamp) {
-      cc->Outputs().Tag(kVideoTag).Add(image_frame.release(), timestamp);
-      prev_timestamp_ = timestamp;
+    if (prev_timestamp_ < frame.timestamp) {
+      cc->Outputs().Tag(kVideoTag).Add(frame.image.release(), frame.timestamp);
+      prev_timestamp_ = frame.timestamp;
       decoded_frames_++;
     }
 
@@ -223,13 +502,15 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
   }
 
   absl::Status Close(CalculatorContext* cc) override {
+    StopPrefetching();
+    reader_.reset();
     if (cap_ && cap_->isOpened()) {
       cap_->release();
     }
-    if (decoded_frames_ != frame_count_) {
+    if (decoded_frames_ != expected_frames_) {
       LOG(WARNING) << "Not all the frames are decoded (total frames: "
-                   << frame_count_ << " vs decoded frames: " << decoded_frames_
-                   << ").";
+                   << expected_frames_
+                   << " vs decoded frames: " << decoded_frames_ << ").";
     }
     return absl::OkStatus();
   }
@@ -243,13 +524,41 @@ class OpenCvVideoDecoderCalculator : public CalculatorBase {
   }
 
  private:
+  // Returns the next frame to output, with a null image after the last one.
+  DecodedFrame NextFrame() {
+    if (reader_) return reader_->Next();
+    while (current_segment_ < prefetching_readers_.size()) {
+      DecodedFrame frame = prefetching_readers_[current_segment_]->Next();
+      if (frame.image) return frame;
+      ++current_segment_;
+    }
+    return {nullptr, Timestamp::Unset()};
+  }
+
+  void StopPrefetching() {
+    for (auto& reader : prefetching_readers_) {
+      reader->Cancel();
+    }
+    // Joins the decoding threads.
+    thread_pool_.reset();
+    prefetching_readers_.clear();
+  }
+
   std::unique_ptr<cv::VideoCapture> cap_;
   int width_;
   int height_;
   int frame_count_;
+  int expected_frames_ = 0;
   int decoded_frames_ = 0;
   ImageFormat::Format format_;
   Timestamp prev_timestamp_ = Timestamp::Unset();
+  CpuImageBufferPool* buffer_pool_ = nullptr;
+  // Decodes the frames in Process(), without prefetching.
+  std::unique_ptr<FrameReader> reader_;
+  // Decode consecutive segments of the frames when prefetching.
+  std::vector<std::unique_ptr<PrefetchingReader>> prefetching_readers_;
+  size_t current_segment_ = 0;
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 REGISTER_CALCULATOR(OpenCvVideoDecoderCalculator);
@@ -12,11 +12,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/video_stream_header.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -168,5 +173,140 @@ TEST(OpenCvVideoDecoderCalculatorTest, TestMkvVp8Video) {
   }
 }
 
+// Decodes the 720p test video with the given calculator options, and returns
+// the video packets. Sets @header if not null.
+std::vector<Packet> DecodeTestVideo(const std::string& options,
+                                    VideoHeader* header = nullptr) {
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(absl::StrCat(
+          R"pb(
+            calculator: "OpenCvVideoDecoderCalculator"
+            input_side_packet: "INPUT_FILE_PATH:input_file_path"
+            output_stream: "VIDEO:video"
+            output_stream: "VIDEO_PRESTREAM:video_prestream"
+            options {
+              [mediapipe.OpenCvVideoDecoderCalculatorOptions.ext] {)pb",
+          options, "}}"));
+  CalculatorRunner runner(node_config);
+  runner.MutableSidePackets()->Tag(kInputFilePathTag) =
+      MakePacket<std::string>(file::JoinPath(GetTestDataDir(kTestPackageRoot),
+                                             "format_MP4_AVC720P_AAC.video"));
+  MP_EXPECT_OK(runner.Run());
+  if (header) {
+    *header =
+        runner.Outputs().Tag(kVideoPrestreamTag).packets[0].Get<VideoHeader>();
+  }
+  return runner.Outputs().Tag(kVideoTag).packets;
+}
+
+void ExpectSameFrames(const std::vector<Packet>& actual,
+                      const std::vector<Packet>& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  for (int i = 0; i < actual.size(); ++i) {
+    EXPECT_EQ(actual[i].Timestamp(), expected[i].Timestamp());
+    const cv::Mat actual_mat = formats::MatView(&actual[i].Get<ImageFrame>());
+    const cv::Mat expected_mat =
+        formats::MatView(&expected[i].Get<ImageFrame>());
+    EXPECT_EQ(cv::norm(actual_mat, expected_mat, cv::NORM_INF), 0)
+        << "at frame " << i;
+  }
+}
+
+TEST(OpenCvVideoDecoderCalculatorTest, PrefetchingMatchesDecodingInProcess) {
+  const std::vector<Packet> expected = DecodeTestVideo("");
+  ExpectSameFrames(DecodeTestVideo("prefetch_frames: 1"), expected);
+  ExpectSameFrames(DecodeTestVideo("prefetch_frames: 8"), expected);
+}
+
+TEST(OpenCvVideoDecoderCalculatorTest, ParallelDecoding) {
+  const std::vector<Packet> expected = DecodeTestVideo("");
+  const std::vector<Packet> packets =
+      DecodeTestVideo("prefetch_frames: 4 num_threads: 3");
+  // Seeking to the segments may not be frame-accurate with some OpenCV
+  // backends: allow a missing frame per segment boundary.
+  EXPECT_GE(packets.size(), expected.size() - 2);
+  EXPECT_LE(packets.size(), expected.size());
+  // The frames are in order, and each one matches the frame decoded
+  // sequentially with the same timestamp.
+  int j = 0;
+  for (int i = 0; i < packets.size(); ++i) {
+    while (j < expected.size() &&
+           expected[j].Timestamp() < packets[i].Timestamp()) {
+      ++j;
+    }
+    ASSERT_LT(j, expected.size());
+    ASSERT_EQ(expected[j].Timestamp(), packets[i].Timestamp());
+    EXPECT_EQ(cv::norm(formats::MatView(&packets[i].Get<ImageFrame>()),
+                       formats::MatView(&expected[j].Get<ImageFrame>()),
+                       cv::NORM_INF),
+              0)
+        << "at frame " << i;
+  }
+}
+
+TEST(OpenCvVideoDecoderCalculatorTest, FrameStride) {
+  for (const std::string& options :
+       {"frame_stride: 3",
+        "frame_stride: 3 prefetch_frames: 4 num_threads: 2"}) {
+    VideoHeader header;
+    const std::vector<Packet> packets = DecodeTestVideo(options, &header);
+    EXPECT_FLOAT_EQ(10.0f, header.frame_rate) << options;
+    EXPECT_NEAR(packets.size(), 60, 1) << options;
+    for (int i = 1; i < packets.size(); ++i) {
+      EXPECT_LT(packets[i - 1].Timestamp(), packets[i].Timestamp());
+    }
+  }
+}
+
+TEST(OpenCvVideoDecoderCalculatorTest, TimeRange) {
+  VideoHeader header;
+  const std::vector<Packet> packets = DecodeTestVideo(
+      "start_time_seconds: 1 end_time_seconds: 3", &header);
+  EXPECT_FLOAT_EQ(2.0f, header.duration);
+  EXPECT_NEAR(packets.size(), 60, 1);
+  ASSERT_FALSE(packets.empty());
+  // Frames are stamped with the position of the video before decoding them.
+  EXPECT_GE(packets.front().Timestamp().Seconds(), 0.9);
+  EXPECT_LT(packets.back().Timestamp().Seconds(), 3.0);
+}
+
+TEST(OpenCvVideoDecoderCalculatorTest, RejectsParallelDecodingWithoutPrefetch) {
+  CalculatorGraphConfig::Node node_config =
+      ParseTextProtoOrDie<CalculatorGraphConfig::Node>(R"pb(
+        calculator: "OpenCvVideoDecoderCalculator"
+        input_side_packet: "INPUT_FILE_PATH:input_file_path"
+        output_stream: "VIDEO:video"
+        options {
+          [mediapipe.OpenCvVideoDecoderCalculatorOptions.ext] {
+            num_threads: 2
+          }
+        })pb");
+  CalculatorRunner runner(node_config);
+  runner.MutableSidePackets()->Tag(kInputFilePathTag) =
+      MakePacket<std::string>(file::JoinPath(GetTestDataDir(kTestPackageRoot),
+                                             "format_MP4_AVC720P_AAC.video"));
+  EXPECT_FALSE(runner.Run().ok());
+}
+
+// Decoding throughput of the 720p test video, reported as frames per second.
+// Args: prefetch_frames, num_threads.
+void BM_DecodeVideo(benchmark::State& state) {
+  const std::string options =
+      absl::StrCat("prefetch_frames: ", state.range(0),
+                   " num_threads: ", state.range(1));
+  int64 frames = 0;
+  for (auto _ : state) {
+    frames += DecodeTestVideo(options).size();
+  }
+  state.SetItemsProcessed(frames);
+}
+
+BENCHMARK(BM_DecodeVideo)
+    ->Args({0, 1})
+    ->Args({8, 1})
+    ->Args({8, 2})
+    ->Args({8, 4})
+    ->Unit(benchmark::kMillisecond);
+
 }  // namespace
 }  // namespace mediapipe
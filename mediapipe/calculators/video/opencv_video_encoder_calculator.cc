@@ -14,11 +14,15 @@
 
 #include <stdlib.h>
 
+#include <deque>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/str_split.h"
+#include "absl/synchronization/mutex.h"
 #include "mediapipe/calculators/video/opencv_video_encoder_calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/image_frame.h"
@@ -32,6 +36,7 @@
 #include "mediapipe/framework/port/source_location.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/framework/tool/status_util.h"
 
 namespace mediapipe {
@@ -41,6 +46,100 @@ constexpr char kOutputFilePathTag[] = "OUTPUT_FILE_PATH";
 constexpr char kVideoPrestreamTag[] = "VIDEO_PRESTREAM";
 constexpr char kVideoTag[] = "VIDEO";
 
+namespace {
+
+// Writes frames to a cv::VideoWriter on a dedicated thread, in the order they
+// are queued, keeping at most max_queued_frames frames waiting.
+class AsyncFrameWriter {
+ public:
+  AsyncFrameWriter(cv::VideoWriter* writer, int max_queued_frames)
+      : writer_(writer),
+        max_queued_frames_(max_queued_frames),
+        thread_pool_("opencv_video_encoder", /*num_threads=*/1) {
+    thread_pool_.StartWorkers();
+    thread_pool_.Schedule([this]() { Run(); });
+  }
+
+  // Writes the queued frames.
+  ~AsyncFrameWriter() {
+    {
+      absl::MutexLock lock(&mutex_);
+      done_ = true;
+    }
+    // Joins the thread once it has written all the frames.
+  }
+
+  // Returns a buffer to convert the next frame into, reused from the frames
+  // already written. Waits while the queue is full.
+  cv::Mat GetBuffer() ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &AsyncFrameWriter::HasRoom));
+    if (free_buffers_.empty()) return cv::Mat();
+    cv::Mat buffer = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    return buffer;
+  }
+
+  // Queues @frame, waiting while the queue is full. If @frame is a view of
+  // the pixels of @packet, the packet is kept until it is written. Otherwise
+  // @frame is reused by GetBuffer() once written.
+  void Write(cv::Mat frame, Packet packet) ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    mutex_.Await(absl::Condition(this, &AsyncFrameWriter::HasRoom));
+    queue_.push_back({std::move(frame), std::move(packet)});
+    ++pending_frames_;
+  }
+
+ private:
+  struct QueuedFrame {
+    cv::Mat frame;
+    Packet packet;
+  };
+
+  bool HasRoom() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return pending_frames_ < max_queued_frames_;
+  }
+
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return done_ || !queue_.empty();
+  }
+
+  void Run() ABSL_LOCKS_EXCLUDED(mutex_) {
+    while (true) {
+      QueuedFrame queued;
+      {
+        absl::MutexLock lock(&mutex_);
+        mutex_.Await(absl::Condition(this, &AsyncFrameWriter::HasWork));
+        if (queue_.empty()) return;
+        queued = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      writer_->write(queued.frame);
+      absl::MutexLock lock(&mutex_);
+      if (queued.packet.IsEmpty()) {
+        free_buffers_.push_back(std::move(queued.frame));
+      }
+      // Counted until written, so that the frame being encoded takes room in
+      // the queue.
+      --pending_frames_;
+    }
+  }
+
+  cv::VideoWriter* const writer_;
+  const int max_queued_frames_;
+  absl::Mutex mutex_;
+  std::deque<QueuedFrame> queue_ ABSL_GUARDED_BY(mutex_);
+  // Number of frames queued or being written.
+  int pending_frames_ ABSL_GUARDED_BY(mutex_) = 0;
+  std::vector<cv::Mat> free_buffers_ ABSL_GUARDED_BY(mutex_);
+  bool done_ ABSL_GUARDED_BY(mutex_) = false;
+  // Declared last: its destructor joins the thread before the members above
+  // are destroyed.
+  ThreadPool thread_pool_;
+};
+
+}  // namespace
+
 // Encodes the input video stream and produces a media file.
 // The media file can be output to the output_file_path specified as a side
 // packet. Currently, the calculator only supports one video stream (in
@@ -79,6 +178,9 @@ constexpr char kVideoTag[] = "VIDEO";
 //   }
 // }
 //
+// With max_queued_frames set, frames are encoded on a background thread while
+// the graph converts the next ones.
+//
 class OpenCvVideoEncoderCalculator : public CalculatorBase {
  public:
   static absl::Status GetContract(CalculatorContract* cc);
@@ -91,7 +193,13 @@ class OpenCvVideoEncoderCalculator : public CalculatorBase {
 
   std::string output_file_path_;
   int four_cc_;
+  int max_queued_frames_ = 0;
   std::unique_ptr<cv::VideoWriter> writer_;
+  // Writes the frames if max_queued_frames_ > 0. Declared after writer_,
+  // which must outlive it.
+  std::unique_ptr<AsyncFrameWriter> async_writer_;
+  // Color conversion buffer, reused across frames without async_writer_.
+  cv::Mat conversion_buffer_;
 };
 
 absl::Status OpenCvVideoEncoderCalculator::GetContract(CalculatorContract* cc) {
@@ -114,6 +222,8 @@ absl::Status OpenCvVideoEncoderCalculator::Open(CalculatorContext* cc) {
   RET_CHECK(options.has_codec() && options.codec().length() == 4)
       << "A 4-character codec code must be specified in "
          "OpenCvVideoEncoderCalculatorOptions";
+  RET_CHECK_GE(options.max_queued_frames(), 0);
+  max_queued_frames_ = options.max_queued_frames();
   const char* codec_array = options.codec().c_str();
   four_cc_ = mediapipe::fourcc(codec_array[0], codec_array[1], codec_array[2],
                                codec_array[3]);
@@ -145,8 +255,8 @@ absl::Status OpenCvVideoEncoderCalculator::Process(CalculatorContext* cc) {
                             video_header.height);
   }
 
-  const ImageFrame& image_frame =
-      cc->Inputs().Tag(kVideoTag).Value().Get<ImageFrame>();
+  const Packet& packet = cc->Inputs().Tag(kVideoTag).Value();
+  const ImageFrame& image_frame = packet.Get<ImageFrame>();
   ImageFormat::Format format = image_frame.Format();
   cv::Mat frame;
   if (format == ImageFormat::GRAY8) {
@@ -165,6 +275,7 @@ absl::Status OpenCvVideoEncoderCalculator::Process(CalculatorContext* cc) {
              << cc->Inputs().Tag(kVideoTag).Value().Timestamp()
              << " in OpenCvVideoEncoderCalculator::Process()";
     }
+    frame = async_writer_ ? async_writer_->GetBuffer() : conversion_buffer_;
     if (format == ImageFormat::SRGB) {
       cv::cvtColor(tmp_frame, frame, cv::COLOR_RGB2BGR);
     } else if (format == ImageFormat::SRGBA) {
@@ -174,11 +285,20 @@ absl::Status OpenCvVideoEncoderCalculator::Process(CalculatorContext* cc) {
              << "Unsupported image format: " << format;
     }
   }
-  writer_->write(frame);
+  if (async_writer_) {
+    // Gray frames are views of the input packet.
+    async_writer_->Write(frame,
+                         format == ImageFormat::GRAY8 ? packet : Packet());
+  } else {
+    if (format != ImageFormat::GRAY8) conversion_buffer_ = frame;
+    writer_->write(frame);
+  }
   return absl::OkStatus();
 }
 
 absl::Status OpenCvVideoEncoderCalculator::Close(CalculatorContext* cc) {
+  // Writes the queued frames.
+  async_writer_.reset();
   if (writer_ && writer_->isOpened()) {
     writer_->release();
   }
@@ -224,6 +344,10 @@ absl::Status OpenCvVideoEncoderCalculator::SetUpVideoWriter(float frame_rate,
     return mediapipe::InvalidArgumentErrorBuilder(MEDIAPIPE_LOC)
            << "Fail to open file at " << output_file_path_;
   }
+  if (max_queued_frames_ > 0) {
+    async_writer_ =
+        absl::make_unique<AsyncFrameWriter>(writer_.get(), max_queued_frames_);
+  }
   return absl::OkStatus();
 }
 
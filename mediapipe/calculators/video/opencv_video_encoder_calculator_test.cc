@@ -12,13 +12,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/calculator_runner.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/deleting_file.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/formats/video_stream_header.h"
 #include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/integral_types.h"
@@ -35,6 +43,8 @@ namespace mediapipe {
 namespace {
 
 constexpr char kTestPackageRoot[] = "mediapipe/calculators/video";
+constexpr char kOutputFilePathTag[] = "OUTPUT_FILE_PATH";
+constexpr char kVideoTag[] = "VIDEO";
 
 // Temporarily disable the test.
 // TODO: Investigate the “Could not open codec 'libx264'” error with
@@ -221,5 +231,90 @@ TEST(OpenCvVideoEncoderCalculatorTest, TestMkvVp8Video) {
                                         cap.get(cv::CAP_PROP_FPS))));
 }
 
+// Returns @num_frames RGB frames of the given size, with moving content.
+std::vector<Packet> MakeFrames(int width, int height, int num_frames) {
+  std::vector<Packet> frames;
+  for (int i = 0; i < num_frames; ++i) {
+    auto frame =
+        absl::make_unique<ImageFrame>(ImageFormat::SRGB, width, height);
+    cv::Mat mat = formats::MatView(frame.get());
+    mat.setTo(cv::Scalar(40, 80, 120));
+    cv::rectangle(mat,
+                  cv::Rect(i * 8 % width, height / 4, width / 4, height / 2),
+                  cv::Scalar(255, i * 4 % 256, 0), -1);
+    frames.push_back(Adopt(frame.release()).At(Timestamp(i * 33333)));
+  }
+  return frames;
+}
+
+// Encodes @frames with MJPG into @output_file_path.
+absl::Status EncodeFrames(const std::vector<Packet>& frames,
+                          const std::string& output_file_path,
+                          int max_queued_frames) {
+  const ImageFrame& first_frame = frames[0].Get<ImageFrame>();
+  CalculatorRunner runner(ParseTextProtoOrDie<CalculatorGraphConfig::Node>(
+      absl::StrCat(R"pb(
+                     calculator: "OpenCvVideoEncoderCalculator"
+                     input_stream: "VIDEO:video"
+                     input_side_packet: "OUTPUT_FILE_PATH:output_file_path"
+                     options {
+                       [mediapipe.OpenCvVideoEncoderCalculatorOptions.ext] {
+                         codec: "MJPG"
+                         video_format: "avi"
+                         fps: 30)pb",
+                   " width: ", first_frame.Width(),
+                   " height: ", first_frame.Height(),
+                   " max_queued_frames: ", max_queued_frames, "}}")));
+  runner.MutableSidePackets()->Tag(kOutputFilePathTag) =
+      MakePacket<std::string>(output_file_path);
+  runner.MutableInputs()->Tag(kVideoTag).packets = frames;
+  return runner.Run();
+}
+
+TEST(OpenCvVideoEncoderCalculatorTest, AsyncEncodingMatchesSyncEncoding) {
+  const std::vector<Packet> frames = MakeFrames(320, 240, 40);
+  const std::string sync_file_path = "/tmp/tmp_video_sync.avi";
+  const std::string async_file_path = "/tmp/tmp_video_async.avi";
+  DeletingFile deleting_sync_file(sync_file_path, true);
+  DeletingFile deleting_async_file(async_file_path, true);
+  MP_ASSERT_OK(EncodeFrames(frames, sync_file_path, 0));
+  MP_ASSERT_OK(EncodeFrames(frames, async_file_path, 4));
+
+  cv::VideoCapture sync_cap(sync_file_path);
+  cv::VideoCapture async_cap(async_file_path);
+  ASSERT_TRUE(sync_cap.isOpened());
+  ASSERT_TRUE(async_cap.isOpened());
+  cv::Mat sync_frame;
+  cv::Mat async_frame;
+  int num_frames = 0;
+  while (sync_cap.read(sync_frame)) {
+    ASSERT_TRUE(async_cap.read(async_frame)) << "at frame " << num_frames;
+    EXPECT_EQ(cv::norm(sync_frame, async_frame, cv::NORM_INF), 0)
+        << "at frame " << num_frames;
+    ++num_frames;
+  }
+  EXPECT_FALSE(async_cap.read(async_frame));
+  EXPECT_EQ(num_frames, frames.size());
+}
+
+// 1080p encoding throughput, reported as frames per second.
+// Arg: max_queued_frames.
+void BM_Encode1080pVideo(benchmark::State& state) {
+  const std::vector<Packet> frames = MakeFrames(1920, 1080, 60);
+  const std::string output_file_path =
+      absl::StrCat("/tmp/bm_video_", state.range(0), ".avi");
+  DeletingFile deleting_file(output_file_path, true);
+  for (auto _ : state) {
+    CHECK(EncodeFrames(frames, output_file_path, state.range(0)).ok());
+  }
+  state.SetItemsProcessed(state.iterations() * frames.size());
+}
+
+BENCHMARK(BM_Encode1080pVideo)
+    ->Arg(0)
+    ->Arg(4)
+    ->Arg(16)
+    ->Unit(benchmark::kMillisecond);
+
 }  // namespace
 }  // namespace mediapipe
@@ -20,4 +20,19 @@ TaskQueue::~TaskQueue() {}
 
 Executor::~Executor() {}
 
+namespace {
+
+thread_local Executor* current_executor = nullptr;
+
+}  // namespace
+
+Executor* Executor::Current() { return current_executor; }
+
+Executor::ScopedCurrent::ScopedCurrent(Executor* executor)
+    : saved_(current_executor) {
+  current_executor = executor;
+}
+
+Executor::ScopedCurrent::~ScopedCurrent() { current_executor = saved_; }
+
 }  // namespace mediapipe
@@ -62,6 +62,25 @@ class Executor {
 
   // Schedule the specified "task" for execution in this executor.
   virtual void Schedule(std::function<void()> task) = 0;
+
+  // Returns the executor whose task the calling thread is running, i.e. the
+  // executor of the calculator whose Open, Process or Close method is being
+  // run, or nullptr outside of such a task. Calculators can use it to run
+  // their own parallel work on the threads of the graph.
+  static Executor* Current();
+
+  // ScopedCurrent is a RAII helper making `executor` the Current() executor
+  // of the calling thread in the current scope, and restoring the previous
+  // value when leaving the scope.
+  class ScopedCurrent {
+   public:
+    explicit ScopedCurrent(Executor* executor);
+    ~ScopedCurrent();
+
+   private:
+    // The value to restore after exiting this scope.
+    Executor* saved_;
+  };
 };
 
 using ExecutorRegistry =
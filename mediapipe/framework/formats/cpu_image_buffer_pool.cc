@@ -0,0 +1,352 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
+
+#include <array>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/numeric/bits.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/port/aligned_malloc_and_free.h"
+
+namespace mediapipe {
+
+const GraphService<CpuImageBufferPool> kCpuImageBufferPoolService(
+    "kCpuImageBufferPoolService", GraphServiceBase::kAllowDefaultInitialization);
+
+namespace internal {
+namespace {
+
+// Buffers start with a header holding their size class, so that they can be
+// returned to the right bucket. Its size is also the alignment of the pixel
+// data, which covers every alignment used for ImageFrames.
+constexpr size_t kHeaderSize = 64;
+
+// Size classes: kMinClassSize, then four classes per power of two up to
+// 2^kMaxClassLog2.
+constexpr int kMinClassLog2 = 12;
+constexpr int kMaxClassLog2 = 31;
+constexpr size_t kMinClassSize = size_t{1} << kMinClassLog2;
+constexpr int kClassesPerPowerOfTwo = 4;
+constexpr int kNumClasses =
+    1 + (kMaxClassLog2 - kMinClassLog2) * kClassesPerPowerOfTwo;
+
+// Number of buffers each thread keeps for itself.
+constexpr int kThreadCacheSlots = 2;
+
+// Returns the smallest class whose size is at least @size, which must not
+// exceed ClassSize(kNumClasses - 1).
+int SizeClass(size_t size) {
+  if (size <= kMinClassSize) return 0;
+  // 2^log2 < size <= 2^(log2 + 1).
+  const int log2 = absl::bit_width(size - 1) - 1;
+  const size_t step = size_t{1} << (log2 - 2);
+  const size_t k = (size - (size_t{1} << log2) + step - 1) / step;
+  return (log2 - kMinClassLog2) * kClassesPerPowerOfTwo + static_cast<int>(k);
+}
+
+size_t ClassSize(int size_class) {
+  if (size_class == 0) return kMinClassSize;
+  const int log2 = kMinClassLog2 + (size_class - 1) / kClassesPerPowerOfTwo;
+  const int k = (size_class - 1) % kClassesPerPowerOfTwo + 1;
+  return (size_t{1} << log2) + k * (size_t{1} << (log2 - 2));
+}
+
+int BufferClass(const uint8* data) {
+  return *reinterpret_cast<const int*>(data - kHeaderSize);
+}
+
+uint8* AllocateBuffer(int size_class) {
+  uint8* base = static_cast<uint8*>(
+      aligned_malloc(kHeaderSize + ClassSize(size_class), kHeaderSize));
+  if (!base) return nullptr;
+  *reinterpret_cast<int*>(base) = size_class;
+  return base + kHeaderSize;
+}
+
+void FreeBuffer(uint8* data) { aligned_free(data - kHeaderSize); }
+
+}  // namespace
+
+// Shared by the pool, the frames it allocated and the thread caches holding
+// its buffers, so that these can outlive the pool.
+class CpuImageBufferPoolState {
+ public:
+  explicit CpuImageBufferPoolState(const CpuImageBufferPool::Options& options)
+      : options_(options) {}
+
+  ~CpuImageBufferPoolState() {
+    for (Bucket& bucket : buckets_) {
+      for (uint8* data : bucket.buffers) FreeBuffer(data);
+    }
+  }
+
+  void Ref() { refs_.fetch_add(1, std::memory_order_relaxed); }
+
+  void Unref() {
+    if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+  }
+
+  // Called by the pool on destruction: buffers are no longer kept.
+  void Shutdown() {
+    alive_.store(false, std::memory_order_release);
+    Trim();
+    Unref();
+  }
+
+  uint8* Acquire(int size_class);
+  // Returns a buffer obtained from Acquire to the pool.
+  void Release(uint8* data);
+  void Trim();
+  CpuImageBufferPool::Stats GetStats() const;
+
+  bool alive() const { return alive_.load(std::memory_order_acquire); }
+  uint64 trim_generation() const {
+    return trim_generation_.load(std::memory_order_acquire);
+  }
+
+  // Frees a buffer accounted in cached_bytes_.
+  void FreeCachedBuffer(uint8* data) {
+    cached_bytes_.fetch_sub(ClassSize(BufferClass(data)),
+                            std::memory_order_relaxed);
+    FreeBuffer(data);
+  }
+
+  void PushToBucket(uint8* data) {
+    Bucket& bucket = buckets_[BufferClass(data)];
+    absl::MutexLock lock(&bucket.mutex);
+    bucket.buffers.push_back(data);
+  }
+
+ private:
+  struct Bucket {
+    absl::Mutex mutex;
+    std::vector<uint8*> buffers ABSL_GUARDED_BY(mutex);
+  };
+
+  const CpuImageBufferPool::Options options_;
+  // Held by the pool, each frame allocated from it and each thread cache
+  // bound to it.
+  std::atomic<int> refs_{1};
+  std::atomic<bool> alive_{true};
+  // Incremented by Trim, which invalidates the buffers kept by threads.
+  std::atomic<uint64> trim_generation_{0};
+  std::atomic<int64> allocations_{0};
+  std::atomic<int64> reuses_{0};
+  // Size of the buffers in the buckets and thread caches.
+  std::atomic<size_t> cached_bytes_{0};
+  std::array<Bucket, kNumClasses> buckets_;
+};
+
+namespace {
+
+// Buffers kept by a thread, for one pool at a time.
+struct ThreadCache {
+  ~ThreadCache();
+
+  // Binds the cache to @state, if not already bound to it. Buffers kept
+  // before a Trim are freed.
+  void Bind(CpuImageBufferPoolState* state) {
+    const uint64 generation = state->trim_generation();
+    if (owner == state && owner_generation == generation) return;
+    Unbind();
+    state->Ref();
+    owner = state;
+    owner_generation = generation;
+  }
+
+  // Returns the kept buffers to their pool, or frees them if the pool is
+  // gone or has been trimmed since.
+  void Unbind() {
+    if (!owner) return;
+    const bool keep =
+        owner->alive() && owner->trim_generation() == owner_generation;
+    for (uint8*& data : slots) {
+      if (!data) continue;
+      if (keep) {
+        owner->PushToBucket(data);
+      } else {
+        owner->FreeCachedBuffer(data);
+      }
+      data = nullptr;
+    }
+    owner->Unref();
+    owner = nullptr;
+  }
+
+  CpuImageBufferPoolState* owner = nullptr;
+  uint64 owner_generation = 0;
+  std::array<uint8*, kThreadCacheSlots> slots = {};
+};
+
+thread_local ThreadCache thread_cache;
+// Set once thread_cache is destroyed, as frames may still be released later
+// on this thread, e.g. by the destructors of static objects.
+thread_local bool thread_cache_destroyed = false;
+
+ThreadCache::~ThreadCache() {
+  Unbind();
+  thread_cache_destroyed = true;
+}
+
+// Returns the cache of the calling thread, bound to @state, or null if
+// already destroyed.
+ThreadCache* GetThreadCache(CpuImageBufferPoolState* state) {
+  if (thread_cache_destroyed) return nullptr;
+  thread_cache.Bind(state);
+  return &thread_cache;
+}
+
+}  // namespace
+
+uint8* CpuImageBufferPoolState::Acquire(int size_class) {
+  const size_t size = ClassSize(size_class);
+  if (ThreadCache* cache = GetThreadCache(this)) {
+    for (uint8*& data : cache->slots) {
+      if (data && BufferClass(data) == size_class) {
+        uint8* result = std::exchange(data, nullptr);
+        cached_bytes_.fetch_sub(size, std::memory_order_relaxed);
+        reuses_.fetch_add(1, std::memory_order_relaxed);
+        return result;
+      }
+    }
+  }
+  {
+    Bucket& bucket = buckets_[size_class];
+    absl::MutexLock lock(&bucket.mutex);
+    if (!bucket.buffers.empty()) {
+      uint8* result = bucket.buffers.back();
+      bucket.buffers.pop_back();
+      cached_bytes_.fetch_sub(size, std::memory_order_relaxed);
+      reuses_.fetch_add(1, std::memory_order_relaxed);
+      return result;
+    }
+  }
+  allocations_.fetch_add(1, std::memory_order_relaxed);
+  return AllocateBuffer(size_class);
+}
+
+void CpuImageBufferPoolState::Release(uint8* data) {
+  const size_t size = ClassSize(BufferClass(data));
+  if (!alive() ||
+      cached_bytes_.fetch_add(size, std::memory_order_relaxed) + size >
+          options_.max_cached_bytes) {
+    if (alive()) cached_bytes_.fetch_sub(size, std::memory_order_relaxed);
+    FreeBuffer(data);
+    return;
+  }
+  if (ThreadCache* cache = GetThreadCache(this)) {
+    for (uint8*& slot : cache->slots) {
+      if (!slot) {
+        slot = data;
+        return;
+      }
+    }
+    // The thread cache is full: keep the most recent buffer, which is more
+    // likely to be in the CPU caches.
+    std::swap(data, cache->slots[0]);
+  }
+  PushToBucket(data);
+}
+
+void CpuImageBufferPoolState::Trim() {
+  trim_generation_.fetch_add(1, std::memory_order_acq_rel);
+  if (!thread_cache_destroyed && thread_cache.owner == this) {
+    thread_cache.Unbind();
+  }
+  for (Bucket& bucket : buckets_) {
+    std::vector<uint8*> buffers;
+    {
+      absl::MutexLock lock(&bucket.mutex);
+      buffers.swap(bucket.buffers);
+    }
+    // Free without holding the lock.
+    for (uint8* data : buffers) FreeCachedBuffer(data);
+  }
+}
+
+CpuImageBufferPool::Stats CpuImageBufferPoolState::GetStats() const {
+  CpuImageBufferPool::Stats stats;
+  stats.allocations = allocations_.load(std::memory_order_relaxed);
+  stats.reuses = reuses_.load(std::memory_order_relaxed);
+  stats.cached_bytes = cached_bytes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+}  // namespace internal
+
+CpuImageBufferPool::CpuImageBufferPool() : CpuImageBufferPool(Options()) {}
+
+CpuImageBufferPool::CpuImageBufferPool(const Options& options)
+    : state_(new internal::CpuImageBufferPoolState(options)) {}
+
+CpuImageBufferPool::~CpuImageBufferPool() { state_->Shutdown(); }
+
+std::unique_ptr<ImageFrame> CpuImageBufferPool::NewImageFrame(
+    ImageFormat::Format format, int width, int height,
+    uint32 alignment_boundary) {
+  const bool power_of_two_alignment =
+      alignment_boundary > 0 &&
+      (alignment_boundary & (alignment_boundary - 1)) == 0;
+  if (!power_of_two_alignment || alignment_boundary > internal::kHeaderSize ||
+      format == ImageFormat::UNKNOWN) {
+    // Let ImageFrame handle these.
+    return absl::make_unique<ImageFrame>(format, width, height,
+                                         alignment_boundary);
+  }
+  // Same row layout as ImageFrame::Reset.
+  int width_step = width * ImageFrame::NumberOfChannelsForFormat(format) *
+                   ImageFrame::ByteDepthForFormat(format);
+  if (alignment_boundary > 1) {
+    width_step = ((width_step - 1) | (alignment_boundary - 1)) + 1;
+  }
+  const size_t size = static_cast<size_t>(height) * width_step;
+  if (size == 0 || size > internal::ClassSize(internal::kNumClasses - 1)) {
+    return absl::make_unique<ImageFrame>(format, width, height,
+                                         alignment_boundary);
+  }
+  uint8* data = state_->Acquire(internal::SizeClass(size));
+  if (!data) return nullptr;
+  internal::CpuImageBufferPoolState* state = state_;
+  state->Ref();
+  // Capturing a single pointer lets std::function store the deleter inline.
+  return absl::make_unique<ImageFrame>(format, width, height, width_step, data,
+                                       [state](uint8* data) {
+                                         state->Release(data);
+                                         state->Unref();
+                                       });
+}
+
+void CpuImageBufferPool::Trim() { state_->Trim(); }
+
+CpuImageBufferPool::Stats CpuImageBufferPool::GetStats() const {
+  return state_->GetStats();
+}
+
+std::unique_ptr<ImageFrame> NewImageFrame(CpuImageBufferPool* pool,
+                                          ImageFormat::Format format,
+                                          int width, int height,
+                                          uint32 alignment_boundary) {
+  if (pool) {
+    return pool->NewImageFrame(format, width, height, alignment_boundary);
+  }
+  return absl::make_unique<ImageFrame>(format, width, height,
+                                       alignment_boundary);
+}
+
+}  // namespace mediapipe
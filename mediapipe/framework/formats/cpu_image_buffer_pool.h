@@ -0,0 +1,103 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_FRAMEWORK_FORMATS_CPU_IMAGE_BUFFER_POOL_H_
+#define MEDIAPIPE_FRAMEWORK_FORMATS_CPU_IMAGE_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/graph_service.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+
+namespace internal {
+class CpuImageBufferPoolState;
+}  // namespace internal
+
+// Recycles the pixel buffers of CPU ImageFrames, so that calculators producing
+// a new frame per input don't allocate (and page in) several megabytes per
+// frame.
+//
+// Unlike ImageFramePool, which serves a single size and format, buffers are
+// grouped in size classes (four per power of two, i.e. at most 25% larger
+// than requested), so frames of any format and similar sizes share buffers.
+// Each size class has its own lock, and every thread keeps the last few
+// buffers it released for its next allocations, without locking.
+//
+// Released buffers are kept as long as the pool holds less than
+// max_cached_bytes; Trim() releases them all, e.g. under memory pressure.
+// Frames may outlive the pool: their buffers are then freed on release.
+//
+// This class is thread-safe. Calculators get the instance of their graph
+// through kCpuImageBufferPoolService.
+class CpuImageBufferPool {
+ public:
+  struct Options {
+    // Maximum total size of the buffers kept for reuse.
+    size_t max_cached_bytes = 64 << 20;
+  };
+
+  struct Stats {
+    // Number of buffers allocated from the heap, and served from the pool.
+    int64 allocations = 0;
+    int64 reuses = 0;
+    // Total size of the buffers kept for reuse.
+    size_t cached_bytes = 0;
+  };
+
+  CpuImageBufferPool();
+  explicit CpuImageBufferPool(const Options& options);
+  ~CpuImageBufferPool();
+
+  CpuImageBufferPool(const CpuImageBufferPool&) = delete;
+  CpuImageBufferPool& operator=(const CpuImageBufferPool&) = delete;
+
+  // Same as ImageFrame(format, width, height, alignment_boundary), with pixel
+  // data from the pool. The pixel data is not initialized. Alignments larger
+  // than 64 bytes are served from the heap.
+  std::unique_ptr<ImageFrame> NewImageFrame(
+      ImageFormat::Format format, int width, int height,
+      uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+  // Frees all the buffers kept for reuse. Buffers kept by other threads are
+  // freed the next time these threads use the pool.
+  void Trim();
+
+  Stats GetStats() const;
+
+ private:
+  internal::CpuImageBufferPoolState* state_;
+};
+
+// Allocates an ImageFrame from @pool, or from the heap if @pool is null.
+std::unique_ptr<ImageFrame> NewImageFrame(
+    CpuImageBufferPool* pool, ImageFormat::Format format, int width,
+    int height,
+    uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+// The CPU image buffer pool of a graph, created on first use. Calculators
+// request it with:
+//   cc->UseService(kCpuImageBufferPoolService).Optional();
+// and get it in Open() with:
+//   cc->Service(kCpuImageBufferPoolService).GetObject().
+extern const GraphService<CpuImageBufferPool> kCpuImageBufferPoolService;
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_FRAMEWORK_FORMATS_CPU_IMAGE_BUFFER_POOL_H_
@@ -0,0 +1,188 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/framework/formats/cpu_image_buffer_pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kWidth = 1920;
+constexpr int kHeight = 1080;
+
+TEST(CpuImageBufferPoolTest, MatchesImageFrameLayout) {
+  CpuImageBufferPool pool;
+  for (ImageFormat::Format format :
+       {ImageFormat::SRGB, ImageFormat::SRGBA, ImageFormat::GRAY8,
+        ImageFormat::VEC32F1}) {
+    for (uint32 alignment : {1u, ImageFrame::kGlDefaultAlignmentBoundary,
+                             ImageFrame::kDefaultAlignmentBoundary}) {
+      const ImageFrame expected(format, 301, 17, alignment);
+      const auto frame = pool.NewImageFrame(format, 301, 17, alignment);
+      ASSERT_NE(frame, nullptr);
+      EXPECT_EQ(frame->Format(), format);
+      EXPECT_EQ(frame->Width(), 301);
+      EXPECT_EQ(frame->Height(), 17);
+      EXPECT_EQ(frame->WidthStep(), expected.WidthStep());
+      EXPECT_TRUE(frame->IsAligned(alignment));
+    }
+  }
+}
+
+TEST(CpuImageBufferPoolTest, ReusesReleasedBuffers) {
+  CpuImageBufferPool pool;
+  uint8* pixel_data;
+  {
+    auto frame = pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+    pixel_data = frame->MutablePixelData();
+  }
+  EXPECT_EQ(pool.GetStats().allocations, 1);
+  EXPECT_GT(pool.GetStats().cached_bytes, 0);
+
+  auto frame = pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+  EXPECT_EQ(frame->MutablePixelData(), pixel_data);
+  EXPECT_EQ(pool.GetStats().allocations, 1);
+  EXPECT_EQ(pool.GetStats().reuses, 1);
+  EXPECT_EQ(pool.GetStats().cached_bytes, 0);
+}
+
+TEST(CpuImageBufferPoolTest, SharesBuffersOfSimilarSizes) {
+  CpuImageBufferPool pool;
+  // 1920 * 1080 * 4 bytes, and 1920 * 1088 * 4 bytes: both in the size class
+  // (7 * 2^20, 2^23].
+  pool.NewImageFrame(ImageFormat::SRGBA, kWidth, kHeight);
+  pool.NewImageFrame(ImageFormat::SRGBA, kWidth, 1088);
+  // 1920 * 1080 * 3 bytes, in another size class.
+  pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+  EXPECT_EQ(pool.GetStats().allocations, 2);
+  EXPECT_EQ(pool.GetStats().reuses, 1);
+}
+
+TEST(CpuImageBufferPoolTest, NoAllocationsPerFrameAfterWarmUp) {
+  CpuImageBufferPool pool;
+  // A pipeline keeping an input, an intermediate and an output frame alive at
+  // the same time.
+  auto run_frame = [&pool]() {
+    auto input = pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+    auto rgba = pool.NewImageFrame(ImageFormat::SRGBA, kWidth, kHeight);
+    auto cropped = pool.NewImageFrame(ImageFormat::SRGBA, 640, 480);
+    input.reset();
+    auto output = pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+  };
+  run_frame();
+  const int64 warm_up_allocations = pool.GetStats().allocations;
+  EXPECT_EQ(warm_up_allocations, 3);
+  for (int i = 0; i < 100; ++i) run_frame();
+  EXPECT_EQ(pool.GetStats().allocations, warm_up_allocations);
+  EXPECT_EQ(pool.GetStats().reuses, 100 * 4 + 1);
+}
+
+TEST(CpuImageBufferPoolTest, SharesBuffersBetweenThreads) {
+  CpuImageBufferPool pool;
+  std::vector<std::unique_ptr<ImageFrame>> frames;
+  for (int i = 0; i < 8; ++i) {
+    frames.push_back(pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight));
+  }
+  // Frames are often released on another thread than the one allocating
+  // them. They go back to the shared buckets, including those kept by the
+  // releasing thread once it exits.
+  std::thread([&frames]() { frames.clear(); }).join();
+  for (int i = 0; i < 8; ++i) {
+    frames.push_back(pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight));
+  }
+  EXPECT_EQ(pool.GetStats().allocations, 8);
+  EXPECT_EQ(pool.GetStats().reuses, 8);
+}
+
+TEST(CpuImageBufferPoolTest, TrimFreesCachedBuffers) {
+  CpuImageBufferPool pool;
+  {
+    std::vector<std::unique_ptr<ImageFrame>> frames;
+    for (int i = 0; i < 4; ++i) {
+      frames.push_back(pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight));
+    }
+  }
+  EXPECT_GT(pool.GetStats().cached_bytes, 0);
+  pool.Trim();
+  EXPECT_EQ(pool.GetStats().cached_bytes, 0);
+  pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+  EXPECT_EQ(pool.GetStats().allocations, 5);
+}
+
+TEST(CpuImageBufferPoolTest, LimitsCachedBytes) {
+  CpuImageBufferPool::Options options;
+  options.max_cached_bytes = 10 << 20;
+  CpuImageBufferPool pool(options);
+  {
+    std::vector<std::unique_ptr<ImageFrame>> frames;
+    for (int i = 0; i < 4; ++i) {
+      frames.push_back(pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight));
+    }
+  }
+  // Only one 1080p RGB buffer fits.
+  EXPECT_GT(pool.GetStats().cached_bytes, 0);
+  EXPECT_LE(pool.GetStats().cached_bytes, options.max_cached_bytes);
+}
+
+TEST(CpuImageBufferPoolTest, FramesMayOutliveThePool) {
+  auto pool = absl::make_unique<CpuImageBufferPool>();
+  auto frame = pool->NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+  pool.reset();
+  frame->SetToZero();
+  frame.reset();
+}
+
+TEST(CpuImageBufferPoolTest, NewImageFrameWithoutPool) {
+  auto frame = NewImageFrame(nullptr, ImageFormat::SRGB, kWidth, kHeight);
+  ASSERT_NE(frame, nullptr);
+  EXPECT_EQ(frame->Width(), kWidth);
+  EXPECT_EQ(frame->Height(), kHeight);
+}
+
+void BM_HeapImageFrame(benchmark::State& state) {
+  for (auto _ : state) {
+    auto frame = absl::make_unique<ImageFrame>(ImageFormat::SRGB, kWidth,
+                                               kHeight);
+    // Touch the pixels, as a calculator would.
+    frame->SetToZero();
+    benchmark::DoNotOptimize(frame->PixelData());
+  }
+}
+
+BENCHMARK(BM_HeapImageFrame);
+
+void BM_PooledImageFrame(benchmark::State& state) {
+  CpuImageBufferPool pool;
+  for (auto _ : state) {
+    auto frame = pool.NewImageFrame(ImageFormat::SRGB, kWidth, kHeight);
+    frame->SetToZero();
+    benchmark::DoNotOptimize(frame->PixelData());
+  }
+}
+
+BENCHMARK(BM_PooledImageFrame);
+
+}  // namespace
+}  // namespace mediapipe
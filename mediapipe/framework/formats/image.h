@@ -76,11 +76,26 @@ class Image {
     use_gpu_ = false;
   }
 
+  // Creates an Image backed by a CPU storage other than ImageFrame, e.g.
+  // GpuBufferStorageYuvImage, and retaining shared ownership. The storage is
+  // only converted to an ImageFrame when the image is accessed as one, by a
+  // converter registered along with the storage type.
+  explicit Image(std::shared_ptr<internal::GpuBufferStorage> cpu_storage)
+      : gpu_buffer_(std::move(cpu_storage)) {
+    use_gpu_ = false;
+  }
+
   // CPU getters.
   ImageFrameSharedPtr GetImageFrameSharedPtr() const {
     // Write view currently because the return type does not point to const IF.
     return gpu_buffer_.GetWriteView<ImageFrame>();
   }
+  // Returns the storage of type T backing this image, or nullptr if it has
+  // none. Unlike GetImageFrameSharedPtr(), this never converts the image.
+  template <class T>
+  std::shared_ptr<T> internal_storage() const {
+    return gpu_buffer_.internal_storage<T>();
+  }
 
   // Creates an Image representing the same image content as the input GPU
   // buffer in platform-specific representations.
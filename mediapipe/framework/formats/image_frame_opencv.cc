@@ -14,7 +14,12 @@
 
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 
+#include <cstdint>
+#include <utility>
+
+#include "absl/memory/memory.h"
 #include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/port/logging.h"
 
 namespace {
 // Maps ImageFrame format to OpenCV Mat type.
@@ -72,6 +77,43 @@ int GetMatType(const mediapipe::ImageFormat::Format format) {
   }
   return type;
 }
+
+#if CV_VERSION_MAJOR >= 4
+using AccessFlags = cv::AccessFlag;
+#else
+using AccessFlags = int;
+#endif
+
+// Allocator of the Mats returned by MatWithOwner(). Their UMatData holds a
+// reference to the owner of the pixels, which is dropped with the last Mat
+// using them. Mats reallocated by create() get their new buffers from the
+// standard allocator.
+class OwnerReferenceAllocator : public cv::MatAllocator {
+ public:
+  cv::UMatData* allocate(int dims, const int* sizes, int type, void* data,
+                         size_t* step, AccessFlags flags,
+                         cv::UMatUsageFlags usage_flags) const override {
+    return cv::Mat::getStdAllocator()->allocate(dims, sizes, type, data, step,
+                                                flags, usage_flags);
+  }
+
+  bool allocate(cv::UMatData* data, AccessFlags access_flags,
+                cv::UMatUsageFlags usage_flags) const override {
+    return cv::Mat::getStdAllocator()->allocate(data, access_flags,
+                                                usage_flags);
+  }
+
+  void deallocate(cv::UMatData* data) const override {
+    if (!data) return;
+    delete static_cast<std::shared_ptr<void>*>(data->userdata);
+    delete data;
+  }
+};
+
+cv::MatAllocator* GetOwnerReferenceAllocator() {
+  static OwnerReferenceAllocator* allocator = new OwnerReferenceAllocator();
+  return allocator;
+}
 }  // namespace
 
 namespace mediapipe {
@@ -89,5 +131,57 @@ cv::Mat MatView(const ImageFrame* image) {
                  steps);
 }
 
+cv::Mat SharedMatView(std::shared_ptr<ImageFrame> image) {
+  const int type =
+      CV_MAKETYPE(GetMatType(image->Format()), image->NumberOfChannels());
+  uint8* data = image->MutablePixelData();
+  const int rows = image->Height();
+  const int cols = image->Width();
+  const size_t step = image->WidthStep();
+  return internal::MatWithOwner(rows, cols, type, data, step,
+                                std::move(image));
+}
+
+std::unique_ptr<ImageFrame> MatToImageFrame(ImageFormat::Format format,
+                                            const cv::Mat& mat,
+                                            uint32 alignment_boundary) {
+  CHECK_LE(mat.dims, 2);
+  CHECK_EQ(mat.type(),
+           CV_MAKETYPE(GetMatType(format),
+                       ImageFrame::NumberOfChannelsForFormat(format)));
+  auto frame = absl::make_unique<ImageFrame>();
+  const bool aligned =
+      reinterpret_cast<uintptr_t>(mat.data) % alignment_boundary == 0 &&
+      mat.step[0] % alignment_boundary == 0;
+  if (mat.u != nullptr && aligned) {
+    // The deleter holds a reference to the buffer of the Mat.
+    frame->AdoptPixelData(format, mat.cols, mat.rows, mat.step[0], mat.data,
+                          [buffer = mat](uint8*) mutable { buffer.release(); });
+  } else {
+    frame->Reset(format, mat.cols, mat.rows, alignment_boundary);
+    mat.copyTo(MatView(frame.get()));
+  }
+  return frame;
+}
+
+namespace internal {
+
+cv::Mat MatWithOwner(int rows, int cols, int type, uint8* data, size_t step,
+                     std::shared_ptr<void> owner) {
+  cv::Mat mat(rows, cols, type, data, step);
+  cv::MatAllocator* allocator = GetOwnerReferenceAllocator();
+  // Makes the Mat reference counted, as if allocated by @allocator.
+  cv::UMatData* u = new cv::UMatData(allocator);
+  u->data = u->origdata = data;
+  u->size = mat.dataend - mat.datastart;
+  u->userdata = new std::shared_ptr<void>(std::move(owner));
+  u->refcount = 1;
+  mat.u = u;
+  mat.allocator = allocator;
+  return mat;
+}
+
+}  // namespace internal
+
 }  // namespace formats
 }  // namespace mediapipe
@@ -16,7 +16,11 @@
 #ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_OPENCV_H_
 #define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_FRAME_OPENCV_H_
 
+#include <memory>
+
+#include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 
 namespace mediapipe {
@@ -30,6 +34,31 @@ namespace formats {
 // even though the returned data is mutable.
 cv::Mat MatView(const ImageFrame* image);
 
+// Same as MatView(), but the returned Mat and its copies share the ownership
+// of @image: the frame is destroyed with the last of them. Use it to hand an
+// ImageFrame to code keeping a cv::Mat beyond the lifetime of the frame.
+cv::Mat SharedMatView(std::shared_ptr<ImageFrame> image);
+
+// OpenCV to ImageFrame helper conversion function.
+// Returns an ImageFrame of @format holding the pixels of @mat, whose type must
+// match @format. If @mat owns its reference-counted buffer, and both its data
+// and its rows are aligned to @alignment_boundary, the frame holds a reference
+// to the buffer (zero copy), and the pixels must not be modified through @mat
+// afterwards. Otherwise, e.g. for a MatView of another ImageFrame, the pixels
+// are copied into a new frame aligned to @alignment_boundary.
+std::unique_ptr<ImageFrame> MatToImageFrame(
+    ImageFormat::Format format, const cv::Mat& mat,
+    uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
+namespace internal {
+
+// Returns a Mat of the given pixel data, which keeps @owner alive as long as
+// the Mat or one of its copies.
+cv::Mat MatWithOwner(int rows, int cols, int type, uint8* data, size_t step,
+                     std::shared_ptr<void> owner);
+
+}  // namespace internal
+
 }  // namespace formats
 }  // namespace mediapipe
 
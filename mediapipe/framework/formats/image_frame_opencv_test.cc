@@ -14,6 +14,8 @@
 
 #include "mediapipe/framework/formats/image_frame_opencv.h"
 
+#include <memory>
+
 #include "mediapipe/framework/formats/image_format.pb.h"
 #include "mediapipe/framework/formats/image_frame.h"
 #include "mediapipe/framework/port/gtest.h"
@@ -131,5 +133,95 @@ TEST(ImageFrameOpencvTest, ImageFormats) {
   EXPECT_EQ(mat_c4.type(), CV_8UC4);
 }
 
+TEST(ImageFrameOpencvTest, MatToImageFrameSharesBuffer) {
+  // OpenCV buffers are aligned, as well as rows of 64 * 3 bytes.
+  cv::Mat mat(45, 64, CV_8UC3, cv::Scalar(1, 2, 3));
+  uint8* const data = mat.data;
+  std::unique_ptr<ImageFrame> frame =
+      formats::MatToImageFrame(ImageFormat::SRGB, mat);
+
+  // No copy: the frame holds a reference to the buffer of the Mat.
+  EXPECT_EQ(frame->PixelData(), data);
+  EXPECT_EQ(frame->WidthStep(), static_cast<int>(mat.step[0]));
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+  EXPECT_EQ(mat.u->refcount, 2);
+
+  // The buffer outlives the Mat.
+  mat.release();
+  EXPECT_EQ(frame->PixelData()[0], 1);
+  EXPECT_EQ(frame->PixelData()[frame->WidthStep() * 44 + 63 * 3 + 2], 3);
+
+  // And is released with the frame.
+  cv::Mat other(45, 64, CV_8UC3);
+  std::unique_ptr<ImageFrame> other_frame =
+      formats::MatToImageFrame(ImageFormat::SRGB, other);
+  other_frame.reset();
+  EXPECT_EQ(other.u->refcount, 1);
+}
+
+TEST(ImageFrameOpencvTest, MatToImageFrameCopiesUnalignedRows) {
+  // Rows of 33 * 3 bytes.
+  cv::Mat mat(45, 33, CV_8UC3, cv::Scalar(1, 2, 3));
+  std::unique_ptr<ImageFrame> frame =
+      formats::MatToImageFrame(ImageFormat::SRGB, mat);
+
+  EXPECT_NE(frame->PixelData(), mat.data);
+  EXPECT_TRUE(frame->IsAligned(ImageFrame::kDefaultAlignmentBoundary));
+  EXPECT_EQ(mat.u->refcount, 1);
+  EXPECT_EQ(cv::norm(formats::MatView(frame.get()), mat, cv::NORM_INF), 0);
+
+  // The same rows are aligned enough for other frames.
+  frame = formats::MatToImageFrame(ImageFormat::SRGB, mat, 1);
+  EXPECT_EQ(frame->PixelData(), mat.data);
+}
+
+TEST(ImageFrameOpencvTest, MatToImageFrameCopiesViews) {
+  ImageFrame source(ImageFormat::GRAY8, 64, 45);
+  source.SetToZero();
+  const cv::Mat view = formats::MatView(&source);
+  std::unique_ptr<ImageFrame> frame =
+      formats::MatToImageFrame(ImageFormat::GRAY8, view);
+
+  // The view doesn't keep the pixels of @source alive.
+  EXPECT_NE(frame->PixelData(), source.PixelData());
+  EXPECT_EQ(cv::norm(formats::MatView(frame.get()), view, cv::NORM_INF), 0);
+}
+
+TEST(ImageFrameOpencvTest, SharedMatViewKeepsFrameAlive) {
+  auto frame = std::make_shared<ImageFrame>(ImageFormat::SRGBA, 123, 45);
+  const uint8* data = frame->PixelData();
+  std::weak_ptr<ImageFrame> weak_frame = frame;
+
+  cv::Mat mat = formats::SharedMatView(std::move(frame));
+  EXPECT_EQ(mat.data, data);
+  EXPECT_EQ(mat.type(), CV_8UC4);
+  EXPECT_EQ(mat.cols, 123);
+  EXPECT_EQ(mat.rows, 45);
+  EXPECT_EQ(static_cast<int>(mat.step[0]), weak_frame.lock()->WidthStep());
+
+  cv::Mat copy = mat;
+  mat.release();
+  EXPECT_FALSE(weak_frame.expired());
+  // A frame made from the Mat shares the same pixels.
+  std::unique_ptr<ImageFrame> adopted =
+      formats::MatToImageFrame(ImageFormat::SRGBA, copy);
+  EXPECT_EQ(adopted->PixelData(), data);
+  copy.release();
+  EXPECT_FALSE(weak_frame.expired());
+  adopted.reset();
+  EXPECT_TRUE(weak_frame.expired());
+}
+
+TEST(ImageFrameOpencvTest, SharedMatViewCanBeReallocated) {
+  auto frame = std::make_shared<ImageFrame>(ImageFormat::GRAY8, 64, 45);
+  std::weak_ptr<ImageFrame> weak_frame = frame;
+  cv::Mat mat = formats::SharedMatView(std::move(frame));
+
+  mat.create(10, 10, CV_8UC3);
+  EXPECT_TRUE(weak_frame.expired());
+  mat.setTo(cv::Scalar(1, 2, 3));
+  EXPECT_EQ(mat.at<cv::Vec3b>(9, 9), cv::Vec3b(1, 2, 3));
+}
+
 }  // namespace
 }  // namespace mediapipe
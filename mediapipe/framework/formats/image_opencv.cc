@@ -14,7 +14,10 @@
 
 #include "mediapipe/framework/formats/image_opencv.h"
 
+#include <utility>
+
 #include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame_opencv.h"
 #include "mediapipe/framework/port/logging.h"
 
 namespace {
@@ -111,5 +114,30 @@ std::shared_ptr<cv::Mat> MatView(const mediapipe::Image* image) {
   // MatWithPixelLock alive.
   return std::shared_ptr<cv::Mat>(owner, &owner->mat);
 }
+
+cv::Mat SharedMatView(const mediapipe::Image& image) {
+  // Keeps a reference to the pixels, and the lock, as long as the Mat or one
+  // of its copies.
+  struct ImageWithPixelLock {
+    explicit ImageWithPixelLock(const mediapipe::Image& image)
+        : image(image), lock(&this->image) {}
+    mediapipe::Image image;
+    mediapipe::PixelWriteLock lock;
+  };
+
+  auto owner = std::make_shared<ImageWithPixelLock>(image);
+  uint8* data_ptr = owner->lock.Pixels();
+  CHECK(data_ptr != nullptr);
+  const int type =
+      CV_MAKETYPE(GetMatType(image.image_format()), image.channels());
+  return internal::MatWithOwner(image.height(), image.width(), type, data_ptr,
+                                image.step(), std::move(owner));
+}
+
+mediapipe::Image MatToImage(ImageFormat::Format format, const cv::Mat& mat,
+                            uint32 alignment_boundary) {
+  return mediapipe::Image(std::shared_ptr<ImageFrame>(
+      MatToImageFrame(format, mat, alignment_boundary)));
+}
 }  // namespace formats
 }  // namespace mediapipe
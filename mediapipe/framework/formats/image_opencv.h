@@ -16,7 +16,12 @@
 #ifndef MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_OPENCV_H_
 #define MEDIAPIPE_FRAMEWORK_FORMATS_IMAGE_OPENCV_H_
 
+#include <memory>
+
 #include "mediapipe/framework/formats/image.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/opencv_core_inc.h"
 
 namespace mediapipe {
@@ -33,6 +38,17 @@ namespace formats {
 // by the Mat alive.
 std::shared_ptr<cv::Mat> MatView(const mediapipe::Image* image);
 
+// Same as MatView(), but returns a plain Mat which, with its copies, shares the
+// ownership of the pixels of @image and keeps them locked for CPU access.
+cv::Mat SharedMatView(const mediapipe::Image& image);
+
+// OpenCV to Image helper conversion function.
+// Returns an Image holding the pixels of @mat, without copying them when
+// possible. See MatToImageFrame() in image_frame_opencv.h.
+mediapipe::Image MatToImage(
+    ImageFormat::Format format, const cv::Mat& mat,
+    uint32 alignment_boundary = ImageFrame::kDefaultAlignmentBoundary);
+
 }  // namespace formats
 }  // namespace mediapipe
 
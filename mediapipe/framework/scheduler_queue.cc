@@ -204,6 +204,10 @@ void SchedulerQueue::RunNextTask() {
         << "Scheduled a node that was closed. This should not happen.";
   }
 
+  // Calculators may dispatch their own parallel work onto the executor that
+  // runs them, see Executor::Current().
+  Executor::ScopedCurrent scoped_executor(executor_);
+
   // On iOS, calculators may rely on the existence of an autorelease pool
   // (either directly, or because system code they call does). We do not
   // want to rely on executors setting up an autorelease pool for us (e.g.
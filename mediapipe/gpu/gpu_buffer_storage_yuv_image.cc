@@ -0,0 +1,136 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/gpu/gpu_buffer_storage_yuv_image.h"
+
+#include <memory>
+#include <utility>
+
+#include "libyuv/convert_argb.h"
+#include "libyuv/video_common.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_frame.h"
+#include "mediapipe/framework/port/integral_types.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/gpu/gpu_buffer_storage_image_frame.h"
+
+namespace mediapipe {
+
+namespace {
+
+// Allocates an I420 YUVImage with tightly packed rows.
+std::shared_ptr<YUVImage> AllocateI420Image(int width, int height) {
+  const int uv_width = (width + 1) / 2;
+  const int uv_height = (height + 1) / 2;
+  // Y plane followed by the U and V planes.
+  auto data =
+      std::make_unique<uint8[]>(width * height + 2 * uv_width * uv_height);
+  uint8* y = data.get();
+  uint8* u = y + width * height;
+  uint8* v = u + uv_width * uv_height;
+  return std::make_shared<YUVImage>(libyuv::FOURCC_I420, std::move(data), y,
+                                    width, u, uv_width, v, uv_width, width,
+                                    height);
+}
+
+// Returns the libyuv constants converting |yuv_image| to RGB, according to its
+// matrix coefficients and range. These are the "Yvu" constants, which swap the
+// U and V planes: libyuv's RGB24 is BGR in memory, so converting with U and V
+// swapped yields RGB in memory, i.e. SRGB (which libyuv calls RAW).
+const libyuv::YuvConstants* GetYvuConstants(const YUVImage& yuv_image) {
+  const bool full_range = yuv_image.full_range();
+  switch (yuv_image.matrix_coefficients()) {
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_BT709:
+      return full_range ? &libyuv::kYvuF709Constants
+                        : &libyuv::kYvuH709Constants;
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_BT2020_NCL:
+    case YUVImage::COLOR_MATRIX_COEFFICIENTS_BT2020_CL:
+      return full_range ? &libyuv::kYvuV2020Constants
+                        : &libyuv::kYvu2020Constants;
+    default:
+      // BT.601, which is also assumed when unspecified.
+      return full_range ? &libyuv::kYvuJPEGConstants
+                        : &libyuv::kYvuI601Constants;
+  }
+}
+
+std::shared_ptr<GpuBufferStorageImageFrame> ConvertToImageFrame(
+    std::shared_ptr<GpuBufferStorageYuvImage> storage) {
+  const YUVImage& yuv_image = *storage->yuv_image();
+  auto image_frame =
+      std::make_shared<ImageFrame>(ImageFormat::SRGB, yuv_image.width(),
+                                   yuv_image.height(),
+                                   ImageFrame::kDefaultAlignmentBoundary);
+  const libyuv::YuvConstants* yvu_constants = GetYvuConstants(yuv_image);
+  // As the constants swap U and V, each format is converted as the one with
+  // the chroma planes the other way around.
+  int result = -1;
+  switch (yuv_image.fourcc()) {
+    case libyuv::FOURCC_NV12:
+      result = libyuv::NV21ToRGB24Matrix(
+          yuv_image.data(0), yuv_image.stride(0), yuv_image.data(1),
+          yuv_image.stride(1), image_frame->MutablePixelData(),
+          image_frame->WidthStep(), yvu_constants, yuv_image.width(),
+          yuv_image.height());
+      break;
+    case libyuv::FOURCC_NV21:
+      result = libyuv::NV12ToRGB24Matrix(
+          yuv_image.data(0), yuv_image.stride(0), yuv_image.data(1),
+          yuv_image.stride(1), image_frame->MutablePixelData(),
+          image_frame->WidthStep(), yvu_constants, yuv_image.width(),
+          yuv_image.height());
+      break;
+    case libyuv::FOURCC_I420:
+      // The V plane is passed as U and vice versa.
+      result = libyuv::I420ToRGB24Matrix(
+          yuv_image.data(0), yuv_image.stride(0), yuv_image.data(2),
+          yuv_image.stride(2), yuv_image.data(1), yuv_image.stride(1),
+          image_frame->MutablePixelData(), image_frame->WidthStep(),
+          yvu_constants, yuv_image.width(), yuv_image.height());
+      break;
+    case libyuv::FOURCC_YV12:
+      // YV12 has the V plane first, which is passed as U.
+      result = libyuv::I420ToRGB24Matrix(
+          yuv_image.data(0), yuv_image.stride(0), yuv_image.data(1),
+          yuv_image.stride(1), yuv_image.data(2), yuv_image.stride(2),
+          image_frame->MutablePixelData(), image_frame->WidthStep(),
+          yvu_constants, yuv_image.width(), yuv_image.height());
+      break;
+    default:
+      break;
+  }
+  CHECK_EQ(result, 0) << "Failed to convert YUVImage with fourcc "
+                      << yuv_image.fourcc() << " to ImageFrame";
+  return std::make_shared<GpuBufferStorageImageFrame>(std::move(image_frame));
+}
+
+}  // namespace
+
+static auto kConverterRegistration =
+    internal::GpuBufferStorageRegistry::Get()
+        .RegisterConverter<GpuBufferStorageYuvImage,
+                           GpuBufferStorageImageFrame>(ConvertToImageFrame);
+
+GpuBufferStorageYuvImage::GpuBufferStorageYuvImage(
+    std::shared_ptr<YUVImage> yuv_image)
+    : yuv_image_(std::move(yuv_image)) {
+  CHECK(yuv_image_);
+  CHECK_EQ(yuv_image_->bit_depth(), 8) << "Only 8-bit YUVImage is supported";
+}
+
+GpuBufferStorageYuvImage::GpuBufferStorageYuvImage(int width, int height,
+                                                   GpuBufferFormat format)
+    : yuv_image_(AllocateI420Image(width, height)) {}
+
+}  // namespace mediapipe
@@ -0,0 +1,87 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_GPU_GPU_BUFFER_STORAGE_YUV_IMAGE_H_
+#define MEDIAPIPE_GPU_GPU_BUFFER_STORAGE_YUV_IMAGE_H_
+
+#include <memory>
+
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/gpu/gpu_buffer_format.h"
+#include "mediapipe/gpu/gpu_buffer_storage.h"
+
+namespace mediapipe {
+namespace internal {
+
+template <>
+class ViewProvider<YUVImage> {
+ public:
+  virtual ~ViewProvider() = default;
+  virtual std::shared_ptr<const YUVImage> GetReadView(
+      types<YUVImage>, std::shared_ptr<GpuBuffer> gpu_buffer) const = 0;
+  virtual std::shared_ptr<YUVImage> GetWriteView(
+      types<YUVImage>, std::shared_ptr<GpuBuffer> gpu_buffer) = 0;
+};
+
+}  // namespace internal
+
+// Implements support for 8-bit YUVImage (NV12, NV21, I420 or YV12) as a
+// backing storage of GpuBuffer, so that camera and decoder frames can be
+// passed around as an Image without a color conversion:
+//
+//   Image image(std::make_shared<GpuBufferStorageYuvImage>(yuv_image));
+//
+// An ImageFrame view is available through a converter to
+// GpuBufferStorageImageFrame, which converts the whole frame to SRGB with
+// libyuv, following the matrix coefficients and range of the YUVImage, the
+// first time it is requested. Consumers that only need a part of the frame,
+// e.g. the CPU image-to-tensor converter, should rather read the YUVImage
+// held by image.internal_storage<GpuBufferStorageYuvImage>().
+class GpuBufferStorageYuvImage
+    : public internal::GpuBufferStorageImpl<
+          GpuBufferStorageYuvImage, internal::ViewProvider<YUVImage>> {
+ public:
+  explicit GpuBufferStorageYuvImage(std::shared_ptr<YUVImage> yuv_image);
+  // Allocates an I420 image. YUVImage layouts have no GpuBufferFormat, so
+  // |format| is ignored.
+  GpuBufferStorageYuvImage(int width, int height, GpuBufferFormat format);
+
+  int width() const override { return yuv_image_->width(); }
+  int height() const override { return yuv_image_->height(); }
+  // Returns kRGB24, the format of the ImageFrame view, so that the format,
+  // channels and row size reported by an Image wrapping this storage describe
+  // the pixels it gives CPU access to.
+  GpuBufferFormat format() const override { return GpuBufferFormat::kRGB24; }
+
+  std::shared_ptr<const YUVImage> yuv_image() const { return yuv_image_; }
+  std::shared_ptr<YUVImage> yuv_image() { return yuv_image_; }
+
+  std::shared_ptr<const YUVImage> GetReadView(
+      internal::types<YUVImage>,
+      std::shared_ptr<GpuBuffer> gpu_buffer) const override {
+    return yuv_image_;
+  }
+  std::shared_ptr<YUVImage> GetWriteView(
+      internal::types<YUVImage>,
+      std::shared_ptr<GpuBuffer> gpu_buffer) override {
+    return yuv_image_;
+  }
+
+ private:
+  std::shared_ptr<YUVImage> yuv_image_;
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_GPU_GPU_BUFFER_STORAGE_YUV_IMAGE_H_
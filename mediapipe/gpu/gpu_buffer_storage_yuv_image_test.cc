@@ -0,0 +1,85 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/gpu/gpu_buffer_storage_yuv_image.h"
+
+#include <cstring>
+#include <memory>
+
+#include "libyuv/video_common.h"
+#include "mediapipe/framework/formats/image.h"
+#include "mediapipe/framework/formats/image_format.pb.h"
+#include "mediapipe/framework/formats/image_opencv.h"
+#include "mediapipe/framework/formats/yuv_image.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/integral_types.h"
+
+namespace mediapipe {
+namespace {
+
+constexpr int kWidth = 6;
+constexpr int kHeight = 4;
+
+// Returns a video range BT.601 NV12 image filled with |y|, |u| and |v|.
+std::shared_ptr<YUVImage> MakeNv12Image(uint8 y, uint8 u, uint8 v) {
+  const int uv_width = kWidth / 2;
+  const int uv_height = kHeight / 2;
+  auto data = std::make_unique<uint8[]>(kWidth * kHeight +
+                                        2 * uv_width * uv_height);
+  uint8* y_plane = data.get();
+  uint8* uv_plane = y_plane + kWidth * kHeight;
+  std::memset(y_plane, y, kWidth * kHeight);
+  for (int i = 0; i < uv_width * uv_height; ++i) {
+    uv_plane[2 * i] = u;
+    uv_plane[2 * i + 1] = v;
+  }
+  return std::make_shared<YUVImage>(libyuv::FOURCC_NV12, std::move(data),
+                                    y_plane, kWidth, uv_plane, 2 * uv_width,
+                                    nullptr, 0, kWidth, kHeight);
+}
+
+TEST(GpuBufferStorageYuvImageTest, ImageDescribesSrgbView) {
+  auto storage = std::make_shared<GpuBufferStorageYuvImage>(
+      MakeNv12Image(/*y=*/235, /*u=*/128, /*v=*/128));
+  Image image(storage);
+
+  EXPECT_EQ(image.width(), kWidth);
+  EXPECT_EQ(image.height(), kHeight);
+  EXPECT_FALSE(image.UsesGpu());
+  EXPECT_EQ(image.image_format(), ImageFormat::SRGB);
+  EXPECT_EQ(image.channels(), 3);
+  EXPECT_GE(image.step(), kWidth * 3);
+  // The YUVImage is still available after the conversion.
+  EXPECT_EQ(image.internal_storage<GpuBufferStorageYuvImage>(), storage);
+}
+
+TEST(GpuBufferStorageYuvImageTest, MatViewReadsConvertedPixels) {
+  // Video range white.
+  Image image(std::make_shared<GpuBufferStorageYuvImage>(
+      MakeNv12Image(/*y=*/235, /*u=*/128, /*v=*/128)));
+
+  auto mat = formats::MatView(&image);
+  ASSERT_EQ(mat->rows, kHeight);
+  ASSERT_EQ(mat->cols, kWidth);
+  ASSERT_EQ(mat->channels(), 3);
+  for (int y = 0; y < kHeight; ++y) {
+    const uint8* row = mat->ptr<uint8>(y);
+    for (int x = 0; x < kWidth * 3; ++x) {
+      EXPECT_NEAR(row[x], 255, 2) << "at (" << x / 3 << ", " << y << ")";
+    }
+  }
+}
+
+}  // namespace
+}  // namespace mediapipe
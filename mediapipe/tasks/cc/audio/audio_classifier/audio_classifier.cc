@@ -85,6 +85,9 @@ ConvertAudioClassifierOptionsToProto(AudioClassifierOptions* options) {
   if (options->sample_rate > 0) {
     options_proto->set_default_input_audio_sample_rate(options->sample_rate);
   }
+  if (options->voice_activity_gating) {
+    options_proto->mutable_voice_activity_gating_options();
+  }
   return options_proto;
 }
 
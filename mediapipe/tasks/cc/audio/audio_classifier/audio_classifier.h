@@ -56,6 +56,12 @@ struct AudioClassifierOptions {
   // set to RunningMode::AUDIO_STREAM.
   double sample_rate = -1.0;
 
+  // If true, the audio frames in which a VoiceActivityDetectionCalculator
+  // with the default options detects no voice activity are not classified,
+  // which saves the inference on silence: the classification results have no
+  // entries for them.
+  bool voice_activity_gating = false;
+
   // The user-defined result callback for processing audio stream data.
   // The result callback should only be specified when the running mode is set
   // to RunningMode::AUDIO_STREAM.
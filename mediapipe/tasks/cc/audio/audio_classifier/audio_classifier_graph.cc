@@ -16,11 +16,13 @@ limitations under the License.
 #include <stdint.h>
 
 #include <utility>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "absl/types/optional.h"
 #include "flatbuffers/flatbuffers.h"
+#include "mediapipe/calculators/audio/voice_activity_detection_calculator.pb.h"
 #include "mediapipe/calculators/core/constant_side_packet_calculator.pb.h"
 #include "mediapipe/calculators/tensor/audio_to_tensor_calculator.pb.h"
 #include "mediapipe/framework/api2/builder.h"
@@ -28,6 +30,7 @@ limitations under the License.
 #include "mediapipe/framework/calculator.pb.h"
 #include "mediapipe/framework/calculator_framework.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/tensor.h"
 #include "mediapipe/tasks/cc/audio/audio_classifier/proto/audio_classifier_graph_options.pb.h"
 #include "mediapipe/tasks/cc/audio/utils/audio_tensor_specs.h"
 #include "mediapipe/tasks/cc/common.h"
@@ -54,6 +57,7 @@ using ::mediapipe::api2::builder::GenericNode;
 using ::mediapipe::api2::builder::Graph;
 using ::mediapipe::api2::builder::Source;
 
+constexpr char kAllowTag[] = "ALLOW";
 constexpr char kAtPrestreamTag[] = "AT_PRESTREAM";
 constexpr char kAudioTag[] = "AUDIO";
 constexpr char kClassificationResultTag[] = "CLASSIFICATION_RESULT";
@@ -61,6 +65,7 @@ constexpr char kPacketTag[] = "PACKET";
 constexpr char kSampleRateTag[] = "SAMPLE_RATE";
 constexpr char kTensorsTag[] = "TENSORS";
 constexpr char kTimestampsTag[] = "TIMESTAMPS";
+constexpr char kVoiceActivityTag[] = "VOICE_ACTIVITY";
 
 absl::Status SanityCheckOptions(
     const proto::AudioClassifierGraphOptions& options) {
@@ -230,11 +235,34 @@ class AudioClassifierGraph : public core::ModelTaskGraph {
           audio_to_tensor.In(kSampleRateTag);
     }
 
+    // With voice activity gating, only the tensors of the audio frames with
+    // voice activity are sent to the model. The GateCalculator still
+    // propagates the timestamp bounds of the others, so that the downstream
+    // calculators do not wait for them.
+    Source<std::vector<Tensor>> audio_tensors =
+        audio_to_tensor[Output<std::vector<Tensor>>(kTensorsTag)];
+    if (task_options.has_voice_activity_gating_options()) {
+      auto& voice_activity_detection =
+          graph.AddNode("VoiceActivityDetectionCalculator");
+      auto& voice_activity_detection_options =
+          voice_activity_detection
+              .GetOptions<VoiceActivityDetectionCalculatorOptions>();
+      voice_activity_detection_options.CopyFrom(
+          task_options.voice_activity_gating_options());
+      voice_activity_detection_options.set_sample_rate(
+          audio_tensor_specs.sample_rate);
+      audio_tensors >> voice_activity_detection.In(kTensorsTag);
+      auto& gate = graph.AddNode("GateCalculator");
+      audio_tensors >> gate.In(0);
+      voice_activity_detection.Out(kVoiceActivityTag) >> gate.In(kAllowTag);
+      audio_tensors = gate.Out(0).Cast<std::vector<Tensor>>();
+    }
+
     // Adds inference subgraph and connects its input stream to the output
     // tensors produced by the AudioToTensorCalculator.
     auto& inference = AddInference(
         model_resources, task_options.base_options().acceleration(), graph);
-    audio_to_tensor.Out(kTensorsTag) >> inference.In(kTensorsTag);
+    audio_tensors >> inference.In(kTensorsTag);
 
     // Adds postprocessing calculators and connects them to the graph output.
     auto& postprocessing = graph.AddNode(
@@ -30,8 +30,10 @@ limitations under the License.
 #include "absl/strings/string_view.h"
 #include "mediapipe/framework/deps/file_path.h"
 #include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gmock.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/parse_text_proto.h"
 #include "mediapipe/framework/port/status_matchers.h"
 #include "mediapipe/tasks/cc/audio/core/running_mode.h"
@@ -72,6 +74,20 @@ Matrix GetAudioData(absl::string_view filename) {
   return matrix_mapping.matrix();
 }
 
+// Returns the audio of @filename, preceded by @num_samples_before and
+// followed by @num_samples_after samples of silence at about -70 dBFS.
+Matrix GetAudioDataInSilence(absl::string_view filename,
+                             int num_samples_before, int num_samples_after) {
+  const Matrix audio_data = GetAudioData(filename);
+  Matrix padded_audio_data =
+      Matrix::Random(1, num_samples_before + audio_data.cols() +
+                            num_samples_after) *
+      5e-4f;
+  padded_audio_data.middleCols(num_samples_before, audio_data.cols()) =
+      audio_data;
+  return padded_audio_data;
+}
+
 void CheckSpeechClassificationResult(const ClassificationResult& result) {
   EXPECT_THAT(result.classifications_size(), testing::Eq(1));
   EXPECT_EQ(result.classifications(0).head_name(), "scores");
@@ -493,6 +509,37 @@ TEST_F(ClassifyTest, SucceedsWithCategoryDenylist) {
                                        })pb"));
 }
 
+TEST_F(ClassifyTest, SucceedsWithVoiceActivityGating) {
+  // Two frames of silence, the speech, and two frames of silence.
+  auto audio_buffer =
+      GetAudioDataInSilence(k16kTestWavFilename, 2 * kYamnetNumOfAudioSamples,
+                            2 * kYamnetNumOfAudioSamples);
+  const int64 audio_duration_ms =
+      audio_buffer.cols() * kMilliSecondsPerSecond / 16000;
+  auto options = std::make_unique<AudioClassifierOptions>();
+  options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, kModelWithMetadata);
+  options->voice_activity_gating = true;
+  MP_ASSERT_OK_AND_ASSIGN(std::unique_ptr<AudioClassifier> audio_classifier,
+                          AudioClassifier::Create(std::move(options)));
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto result, audio_classifier->Classify(std::move(audio_buffer),
+                                              /*audio_sample_rate=*/16000));
+  MP_ASSERT_OK(audio_classifier->Close());
+  // Only the frames of the speech are classified.
+  ASSERT_THAT(result.classifications_size(), testing::Eq(1));
+  const auto& entries = result.classifications(0).entries();
+  ASSERT_GE(entries.size(), 4);
+  std::vector<int64> timestamps_ms = {1950, 2925, 3900, 4875};
+  for (int i = 0; i < timestamps_ms.size(); ++i) {
+    EXPECT_EQ(entries[i].timestamp_ms(), timestamps_ms[i]);
+    EXPECT_THAT(entries[i].categories(0).category_name(),
+                testing::Eq("Speech"));
+  }
+  // The last frame of silence is not classified.
+  EXPECT_LT(entries.rbegin()->timestamp_ms(), audio_duration_ms - 975);
+}
+
 class ClassifyAsyncTest : public tflite_shims::testing::Test {};
 
 TEST_F(ClassifyAsyncTest, Succeeds) {
@@ -557,6 +604,33 @@ TEST_F(ClassifyAsyncTest, SucceedsWithNonDeterministicNumAudioSamples) {
   CheckStreamingModeClassificationResult(outputs);
 }
 
+// Classifies the 16 kHz speech test file surrounded by nine times as much
+// silence, as in a call, to measure the CPU saved by the voice activity
+// gating. Arg: whether voice_activity_gating is enabled.
+void BM_ClassifySilenceHeavyAudio(benchmark::State& state) {
+  const Matrix audio_data = GetAudioData(k16kTestWavFilename);
+  const Matrix audio_buffer = GetAudioDataInSilence(
+      k16kTestWavFilename, 4 * audio_data.cols(), 5 * audio_data.cols());
+  auto options = std::make_unique<AudioClassifierOptions>();
+  options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, kModelWithMetadata);
+  options->voice_activity_gating = state.range(0);
+  auto audio_classifier_or = AudioClassifier::Create(std::move(options));
+  CHECK(audio_classifier_or.ok());
+  auto& audio_classifier = audio_classifier_or.value();
+  int num_entries = 0;
+  for (auto _ : state) {
+    auto result_or =
+        audio_classifier->Classify(audio_buffer, /*audio_sample_rate=*/16000);
+    CHECK(result_or.ok());
+    num_entries = result_or->classifications(0).entries_size();
+  }
+  CHECK(audio_classifier->Close().ok());
+  state.SetItemsProcessed(state.iterations() * audio_buffer.cols());
+  state.counters["classified_frames"] = num_entries;
+}
+BENCHMARK(BM_ClassifySilenceHeavyAudio)->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace audio_classifier
 }  // namespace audio
@@ -0,0 +1,541 @@
+/* Copyright 2022 The MediaPipe Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/audio_classifier/batch_audio_classifier.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/str_format.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "audio/dsp/resampler_q.h"
+#include "mediapipe/calculators/tensor/tensors_dequantization_utils.h"
+#include "mediapipe/calculators/tensor/tensors_to_classification_calculator.pb.h"
+#include "mediapipe/calculators/tensor/tensors_to_classification_utils.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/formats/time_series_header.pb.h"
+#include "mediapipe/framework/packet.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+#include "mediapipe/framework/timestamp.h"
+#include "mediapipe/framework/tool/status_util.h"
+#include "mediapipe/tasks/cc/common.h"
+#include "mediapipe/tasks/cc/components/calculators/score_calibration_calculator.pb.h"
+#include "mediapipe/tasks/cc/components/calculators/score_calibration_utils.h"
+#include "mediapipe/tasks/cc/components/classification_postprocessing.h"
+#include "mediapipe/tasks/cc/components/containers/category.pb.h"
+#include "mediapipe/tasks/cc/core/proto/external_file.pb.h"
+#include "mediapipe/util/audio_decoder.h"
+#include "mediapipe/util/audio_decoder.pb.h"
+#include "tensorflow/lite/interpreter_builder.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace audio_classifier {
+
+namespace {
+
+constexpr char kModelResourcesTag[] = "batch_audio_classifier";
+
+// Builds the AudioTensorSpecs of the model input, as AudioClassifierGraph
+// does for its AudioToTensorCalculator.
+absl::StatusOr<AudioTensorSpecs> BuildPreprocessingSpecs(
+    const tasks::core::ModelResources& model_resources) {
+  const auto* metadata_extractor = model_resources.GetMetadataExtractor();
+  if (metadata_extractor->GetModelMetadata() == nullptr ||
+      metadata_extractor->GetModelMetadata()->subgraph_metadata() == nullptr) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "Audio classifier models require TFLite Model Metadata but none was "
+        "found",
+        MediaPipeTasksStatus::kMetadataNotFoundError);
+  }
+  const tflite::Model& model = *model_resources.GetTfLiteModel();
+  if (model.subgraphs()->size() != 1 ||
+      (*model.subgraphs())[0]->inputs()->size() != 1) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "Audio classification tflite models are "
+                                   "assumed to have a single subgraph and a "
+                                   "single input.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  const auto* primary_subgraph = (*model.subgraphs())[0];
+  const auto* input_tensor =
+      (*primary_subgraph->tensors())[(*primary_subgraph->inputs())[0]];
+  ASSIGN_OR_RETURN(const auto* audio_tensor_metadata,
+                   GetAudioTensorMetadataIfAny(*metadata_extractor, 0));
+  return BuildInputAudioTensorSpecs(*input_tensor, audio_tensor_metadata);
+}
+
+// Returns the scores of the output tensor `tensor`, dequantized, as
+// TensorsDequantizationCalculator does.
+absl::Status GetScores(const TfLiteTensor& tensor, std::vector<float>* scores) {
+  int num_scores = 1;
+  for (int i = 0; i < tensor.dims->size; ++i) {
+    num_scores *= tensor.dims->data[i];
+  }
+  scores->resize(num_scores);
+  switch (tensor.type) {
+    case kTfLiteFloat32:
+      std::memcpy(scores->data(), tensor.data.f, num_scores * sizeof(float));
+      break;
+    case kTfLiteUInt8:
+      DequantizeValues(
+          DequantizedValues<uint8>{tensor.data.uint8, tensor.params.scale,
+                                   tensor.params.zero_point},
+          num_scores, scores->data());
+      break;
+    case kTfLiteInt8:
+      DequantizeValues(
+          DequantizedValues<int8>{tensor.data.int8, tensor.params.scale,
+                                  tensor.params.zero_point},
+          num_scores, scores->data());
+      break;
+    default:
+      return absl::InvalidArgumentError(
+          absl::StrFormat("Unsupported output tensor type: %s",
+                          TfLiteTypeGetName(tensor.type)));
+  }
+  return absl::OkStatus();
+}
+
+// Checks the options of the ClassificationPostprocessing subgraph that
+// BatchAudioClassifier::Postprocess() implements.
+absl::Status CheckPostprocessingOptions(
+    const components::ClassificationPostprocessingOptions& options) {
+  for (const auto& calculator_options :
+       options.tensors_to_classifications_options()) {
+    // The ClassificationPostprocessing subgraph labels the classes from the
+    // label_items of the model metadata only.
+    if (calculator_options.binary_classification() ||
+        calculator_options.has_label_map_path() ||
+        calculator_options.has_label_map()) {
+      return CreateStatusWithPayload(
+          absl::StatusCode::kInvalidArgument,
+          "Binary classification and label maps are not supported.",
+          MediaPipeTasksStatus::kInvalidArgumentError);
+    }
+  }
+  for (const auto& item : options.score_calibration_options()) {
+    MP_RETURN_IF_ERROR(ValidateScoreCalibrationOptions(item.second));
+  }
+  return absl::OkStatus();
+}
+
+// Returns the error of an audio input without any sample.
+absl::Status EmptyAudioError() {
+  return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                 "The audio clip is empty.",
+                                 MediaPipeTasksStatus::kInvalidArgumentError);
+}
+
+}  // namespace
+
+/* static */
+absl::StatusOr<std::unique_ptr<BatchAudioClassifier>>
+BatchAudioClassifier::Create(
+    std::unique_ptr<BatchAudioClassifierOptions> options) {
+  if (options->frames_per_batch <= 0) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        "The number of audio frames per batch must be positive.",
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  const auto base_options_proto =
+      tasks::core::ConvertBaseOptionsToProto(&options->base_options);
+  ASSIGN_OR_RETURN(
+      auto model_resources,
+      tasks::core::ModelResources::Create(
+          kModelResourcesTag,
+          std::make_unique<tasks::core::proto::ExternalFile>(
+              base_options_proto.model_asset()),
+          std::move(options->base_options.op_resolver)));
+  auto classifier =
+      absl::WrapUnique(new BatchAudioClassifier(std::move(model_resources)));
+  classifier->frames_per_batch_ = options->frames_per_batch;
+  ASSIGN_OR_RETURN(classifier->audio_tensor_specs_,
+                   BuildPreprocessingSpecs(*classifier->model_resources_));
+  const AudioTensorSpecs& specs = classifier->audio_tensor_specs_;
+  classifier->frame_duration_us_ =
+      std::round(static_cast<double>(specs.num_samples) / specs.sample_rate *
+                 Timestamp::kTimestampUnitsPerSecond);
+  MP_RETURN_IF_ERROR(components::ConfigureClassificationPostprocessing(
+      *classifier->model_resources_,
+      components::ConvertClassifierOptionsToProto(
+          &options->classifier_options),
+      &classifier->postprocessing_options_));
+  MP_RETURN_IF_ERROR(
+      CheckPostprocessingOptions(classifier->postprocessing_options_));
+  for (const auto& calculator_options :
+       classifier->postprocessing_options_
+           .tensors_to_classifications_options()) {
+    auto selector_or = ClassificationSelector::Create(calculator_options);
+    if (!selector_or.ok()) {
+      return CreateStatusWithPayload(
+          absl::StatusCode::kInvalidArgument, selector_or.status().message(),
+          MediaPipeTasksStatus::kInvalidArgumentError);
+    }
+    classifier->class_selectors_.push_back(std::move(selector_or).value());
+  }
+
+  const int num_interpreters =
+      options->num_interpreters > 0
+          ? options->num_interpreters
+          : std::max<int>(1, std::thread::hardware_concurrency());
+  const auto& model = *classifier->model_resources_->GetModelPacket().Get();
+  const auto& op_resolver =
+      classifier->model_resources_->GetOpResolverPacket().Get();
+  for (int i = 0; i < num_interpreters; ++i) {
+    tflite::InterpreterBuilder interpreter_builder(model, op_resolver);
+    // The frames are run in parallel across the interpreters instead.
+    interpreter_builder.SetNumThreads(1);
+    std::unique_ptr<tflite::Interpreter> interpreter;
+    RET_CHECK_EQ(interpreter_builder(&interpreter), kTfLiteOk);
+    RET_CHECK(interpreter);
+    RET_CHECK_EQ(interpreter->AllocateTensors(), kTfLiteOk);
+    const TfLiteTensor* input = interpreter->input_tensor(0);
+    const int num_input_samples = specs.num_channels * specs.num_samples;
+    if (input->type != kTfLiteFloat32 ||
+        input->bytes != num_input_samples * sizeof(float)) {
+      return CreateStatusWithPayload(
+          absl::StatusCode::kInvalidArgument,
+          absl::StrFormat("Expected a float32 input tensor of %d samples.",
+                          num_input_samples),
+          MediaPipeTasksStatus::kInvalidInputTensorTypeError);
+    }
+    RET_CHECK_EQ(interpreter->outputs().size(),
+                 classifier->postprocessing_options_
+                     .tensors_to_classifications_options_size());
+    classifier->interpreters_.push_back(std::move(interpreter));
+  }
+  classifier->thread_pool_ =
+      absl::make_unique<ThreadPool>("BatchAudioClassifier", num_interpreters);
+  classifier->thread_pool_->StartWorkers();
+  return classifier;
+}
+
+BatchAudioClassifier::BatchAudioClassifier(
+    std::unique_ptr<tasks::core::ModelResources> model_resources)
+    : model_resources_(std::move(model_resources)) {}
+
+absl::StatusOr<ClassificationResult> BatchAudioClassifier::Classify(
+    const Matrix& audio_clip, double audio_sample_rate) {
+  MP_RETURN_IF_ERROR(ValidateAudioFormat(audio_clip.rows(), audio_sample_rate));
+  const int num_channels = audio_tensor_specs_.num_channels;
+  if (audio_clip.rows() != num_channels) {
+    // Mono mixdown.
+    return Classify(audio_clip.colwise().mean(), audio_sample_rate);
+  }
+  if (audio_clip.cols() == 0) {
+    return EmptyAudioError();
+  }
+  ClassificationResult result = CreateResult();
+  if (audio_sample_rate != audio_tensor_specs_.sample_rate) {
+    std::vector<float> resampled = audio_dsp::QResampleSignal<float>(
+        audio_sample_rate, audio_tensor_specs_.sample_rate, num_channels,
+        audio_dsp::QResamplerParams(), audio_clip);
+    MP_RETURN_IF_ERROR(ClassifyFrames(
+        Eigen::Map<const Matrix>(resampled.data(), num_channels,
+                                 resampled.size() / num_channels),
+        &result));
+  } else {
+    MP_RETURN_IF_ERROR(ClassifyFrames(
+        Eigen::Map<const Matrix>(audio_clip.data(), audio_clip.rows(),
+                                 audio_clip.cols()),
+        &result));
+  }
+  return result;
+}
+
+absl::Status BatchAudioClassifier::ValidateAudioFormat(
+    int num_channels, double audio_sample_rate) const {
+  // The special case of a mono model is automatic mixdown to mono, as in
+  // AudioToTensorCalculator.
+  if (audio_tensor_specs_.num_channels != 1 &&
+      num_channels != audio_tensor_specs_.num_channels) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        absl::StrFormat(
+            "Audio input has %d channel(s) but the model requires %d "
+            "channel(s).",
+            num_channels, audio_tensor_specs_.num_channels),
+        MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  if (audio_sample_rate <= 0) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "The audio sample rate must be positive.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  return absl::OkStatus();
+}
+
+ClassificationResult BatchAudioClassifier::CreateResult() const {
+  const auto& head_names =
+      postprocessing_options_.classification_aggregation_options().head_names();
+  ClassificationResult result;
+  for (int head = 0;
+       head < postprocessing_options_.tensors_to_classifications_options_size();
+       ++head) {
+    auto* classifications = result.add_classifications();
+    if (!head_names.empty()) {
+      classifications->set_head_index(head);
+      classifications->set_head_name(head_names[head]);
+    }
+  }
+  return result;
+}
+
+absl::Status BatchAudioClassifier::ClassifyFrames(
+    const Eigen::Map<const Matrix>& audio, ClassificationResult* result) {
+  if (audio.cols() == 0) {
+    return absl::OkStatus();
+  }
+
+  // Appends the entries of the frames, which are then filled in parallel.
+  const int num_samples = audio_tensor_specs_.num_samples;
+  const int num_frames = (audio.cols() + num_samples - 1) / num_samples;
+  const int first_entry = result->classifications(0).entries_size();
+  for (auto& classifications : *result->mutable_classifications()) {
+    classifications.mutable_entries()->Reserve(first_entry + num_frames);
+    for (int frame = first_entry; frame < first_entry + num_frames; ++frame) {
+      classifications.add_entries()->set_timestamp_ms(
+          frame * frame_duration_us_ / 1000);
+    }
+  }
+
+  // Each interpreter classifies the next batch of frames until there are
+  // none left.
+  const int num_batches =
+      (num_frames + frames_per_batch_ - 1) / frames_per_batch_;
+  const int num_tasks = std::min<int>(interpreters_.size(), num_batches);
+  std::atomic<int> next_batch(0);
+  std::vector<absl::Status> statuses(num_tasks);
+  absl::BlockingCounter counter(num_tasks);
+  for (int i = 0; i < num_tasks; ++i) {
+    thread_pool_->Schedule([this, i, num_batches, first_entry, &audio,
+                            &next_batch, &statuses, result, &counter]() {
+      int batch;
+      while ((batch = next_batch++) < num_batches) {
+        statuses[i] = ClassifyBatch(audio, batch, first_entry,
+                                    interpreters_[i].get(), result);
+        if (!statuses[i].ok()) {
+          break;
+        }
+      }
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+  for (const absl::Status& status : statuses) {
+    MP_RETURN_IF_ERROR(status);
+  }
+  return absl::OkStatus();
+}
+
+absl::StatusOr<ClassificationResult> BatchAudioClassifier::ClassifyFile(
+    const std::string& file_path, int audio_stream_index,
+    int num_decoding_threads) {
+  AudioDecoderOptions decoder_options;
+  decoder_options.add_audio_stream()->set_stream_index(audio_stream_index);
+  decoder_options.set_num_threads(num_decoding_threads);
+  AudioDecoder decoder;
+  MP_RETURN_IF_ERROR(decoder.Initialize(file_path, decoder_options));
+  TimeSeriesHeader header;
+  MP_RETURN_IF_ERROR(
+      decoder.FillAudioHeader(decoder_options.audio_stream(0), &header));
+  MP_RETURN_IF_ERROR(
+      ValidateAudioFormat(header.num_channels(), header.sample_rate()));
+
+  // The decoded chunks are mixed down, resampled and buffered as they arrive,
+  // as AudioToTensorCalculator does in streaming mode. Whenever the buffer
+  // holds a batch of frames for every interpreter, its complete frames are
+  // classified and only the remaining samples are kept.
+  const int num_channels = audio_tensor_specs_.num_channels;
+  const int num_samples = audio_tensor_specs_.num_samples;
+  std::unique_ptr<audio_dsp::QResampler<float>> resampler;
+  if (header.sample_rate() != audio_tensor_specs_.sample_rate) {
+    resampler = absl::make_unique<audio_dsp::QResampler<float>>(
+        header.sample_rate(), audio_tensor_specs_.sample_rate, num_channels,
+        audio_dsp::QResamplerParams());
+  }
+  const int block_samples =
+      interpreters_.size() * frames_per_batch_ * num_samples;
+  Matrix buffer(num_channels, block_samples);
+  int num_buffered_samples = 0;
+  auto append_samples = [&buffer,
+                         &num_buffered_samples](const Matrix& samples) {
+    if (num_buffered_samples + samples.cols() > buffer.cols()) {
+      buffer.conservativeResize(Eigen::NoChange,
+                                num_buffered_samples + samples.cols());
+    }
+    buffer.middleCols(num_buffered_samples, samples.cols()) = samples;
+    num_buffered_samples += samples.cols();
+  };
+  ClassificationResult result = CreateResult();
+  Matrix mixed_down;
+  Matrix resampled(num_channels, 0);
+  while (true) {
+    int options_index = -1;
+    Packet chunk;
+    const absl::Status status = decoder.GetData(&options_index, &chunk);
+    if (status == tool::StatusStop()) {
+      break;
+    }
+    MP_RETURN_IF_ERROR(status);
+    const Matrix* samples = &chunk.Get<Matrix>();
+    if (samples->rows() != num_channels) {
+      // Mono mixdown.
+      mixed_down = samples->colwise().mean();
+      samples = &mixed_down;
+    }
+    if (resampler) {
+      resampler->ProcessSamples(*samples, &resampled);
+      samples = &resampled;
+    }
+    append_samples(*samples);
+    if (num_buffered_samples >= block_samples) {
+      const int num_frame_samples =
+          num_buffered_samples / num_samples * num_samples;
+      MP_RETURN_IF_ERROR(ClassifyFrames(
+          Eigen::Map<const Matrix>(buffer.data(), num_channels,
+                                   num_frame_samples),
+          &result));
+      num_buffered_samples -= num_frame_samples;
+      std::memmove(buffer.data(),
+                   buffer.data() + num_frame_samples * num_channels,
+                   num_buffered_samples * num_channels * sizeof(float));
+    }
+  }
+  MP_RETURN_IF_ERROR(decoder.Close());
+  if (resampler) {
+    resampler->Flush(&resampled);
+    append_samples(resampled);
+  }
+  MP_RETURN_IF_ERROR(ClassifyFrames(
+      Eigen::Map<const Matrix>(buffer.data(), num_channels,
+                               num_buffered_samples),
+      &result));
+  if (result.classifications(0).entries().empty()) {
+    return EmptyAudioError();
+  }
+  return result;
+}
+
+absl::Status BatchAudioClassifier::ClassifyBatch(
+    const Eigen::Map<const Matrix>& audio, int batch, int first_entry,
+    tflite::Interpreter* interpreter, ClassificationResult* result) const {
+  const int num_channels = audio_tensor_specs_.num_channels;
+  const int num_samples = audio_tensor_specs_.num_samples;
+  const int num_frames = (audio.cols() + num_samples - 1) / num_samples;
+  const int end_frame = std::min(num_frames, (batch + 1) * frames_per_batch_);
+  float* input = interpreter->typed_input_tensor<float>(0);
+  std::vector<float> scores;
+  for (int frame = batch * frames_per_batch_; frame < end_frame; ++frame) {
+    // The column major frame has interleaved channels, as the model expects.
+    const int first_sample = frame * num_samples;
+    const int frame_samples =
+        std::min<int>(num_samples, audio.cols() - first_sample);
+    std::memcpy(input, audio.data() + first_sample * num_channels,
+                num_channels * frame_samples * sizeof(float));
+    // Zero-pads the last frame.
+    std::fill(input + num_channels * frame_samples,
+              input + num_channels * num_samples, 0.0f);
+    RET_CHECK_EQ(interpreter->Invoke(), kTfLiteOk);
+    for (int head = 0; head < result->classifications_size(); ++head) {
+      MP_RETURN_IF_ERROR(
+          GetScores(*interpreter->output_tensor(head), &scores));
+      MP_RETURN_IF_ERROR(Postprocess(
+          head, &scores,
+          result->mutable_classifications(head)->mutable_entries(
+              first_entry + frame)));
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status BatchAudioClassifier::Postprocess(
+    int head_index, std::vector<float>* scores,
+    ClassificationEntry* entry) const {
+  const int num_classes = scores->size();
+  // Score calibration.
+  const auto calibration_options =
+      postprocessing_options_.score_calibration_options().find(head_index);
+  if (calibration_options !=
+      postprocessing_options_.score_calibration_options().end()) {
+    if (num_classes != calibration_options->second.sigmoids_size()) {
+      return CreateStatusWithPayload(
+          absl::StatusCode::kInvalidArgument,
+          absl::StrFormat("Mismatch between number of sigmoids (%d) and number "
+                          "of elements in the input scores tensor (%d).",
+                          calibration_options->second.sigmoids_size(),
+                          num_classes),
+          MediaPipeTasksStatus::kMetadataInconsistencyError);
+    }
+    for (int i = 0; i < num_classes; ++i) {
+      (*scores)[i] =
+          ComputeCalibratedScore(calibration_options->second, i, (*scores)[i]);
+    }
+  }
+
+  // Filtering, sorting and labeling, as TensorsToClassificationCalculator
+  // does.
+  const auto& options =
+      postprocessing_options_.tensors_to_classifications_options(head_index);
+  const auto& label_items = options.label_items();
+  if (!label_items.empty() && label_items.size() != num_classes) {
+    return CreateStatusWithPayload(
+        absl::StatusCode::kInvalidArgument,
+        absl::StrFormat("Mismatch between number of labels (%d) and number "
+                        "of elements in the output scores tensor (%d).",
+                        label_items.size(), num_classes),
+        MediaPipeTasksStatus::kMetadataInconsistencyError);
+  }
+  std::vector<std::pair<int, float>> classes;
+  classes.reserve(num_classes);
+  class_selectors_[head_index]->AddClasses(*scores, num_classes, &classes);
+  class_selectors_[head_index]->SortClasses(&classes);
+
+  auto* categories = entry->mutable_categories();
+  categories->Reserve(classes.size());
+  for (const auto& [index, score] : classes) {
+    auto* category = categories->Add();
+    category->set_index(index);
+    category->set_score(score);
+    if (!label_items.empty()) {
+      const auto& label_item = label_items.at(index);
+      category->set_category_name(label_item.name());
+      if (label_item.has_display_name()) {
+        category->set_display_name(label_item.display_name());
+      }
+    }
+  }
+  return absl::OkStatus();
+}
+
+}  // namespace audio_classifier
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
@@ -0,0 +1,154 @@
+/* Copyright 2022 The MediaPipe Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_CLASSIFIER_BATCH_AUDIO_CLASSIFIER_H_
+#define MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_CLASSIFIER_BATCH_AUDIO_CLASSIFIER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/status/status.h"
+#include "absl/status/statusor.h"
+#include "mediapipe/calculators/tensor/tensors_to_classification_utils.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/threadpool.h"
+#include "mediapipe/tasks/cc/audio/utils/audio_tensor_specs.h"
+#include "mediapipe/tasks/cc/components/classification_postprocessing_options.pb.h"
+#include "mediapipe/tasks/cc/components/classifier_options.h"
+#include "mediapipe/tasks/cc/components/containers/classifications.pb.h"
+#include "mediapipe/tasks/cc/core/base_options.h"
+#include "mediapipe/tasks/cc/core/model_resources.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace audio_classifier {
+
+// The options for configuring a mediapipe batch audio classifier.
+struct BatchAudioClassifierOptions {
+  // Base options for configuring Task library, such as specifying the TfLite
+  // model file with metadata, op resolver, etc. Only the CPU delegate is
+  // supported.
+  tasks::core::BaseOptions base_options;
+
+  // Options for configuring the classifier behavior, such as score threshold,
+  // number of results, etc.
+  components::ClassifierOptions classifier_options;
+
+  // The number of TFLite interpreters of the model, each running on its own
+  // thread with a single TFLite thread. If <= 0, one interpreter per hardware
+  // thread is created.
+  int num_interpreters = 0;
+
+  // The number of consecutive audio frames that a thread classifies with its
+  // interpreter at once. Larger batches amortize the scheduling of the
+  // frames, smaller batches balance the frames better across the threads.
+  int frames_per_batch = 32;
+};
+
+// Performs audio classification on long audio clips or audio files offline,
+// e.g. for bulk audio tagging.
+//
+// The results are the same as those of AudioClassifier::Classify() with the
+// audio clips running mode, for the same model and ClassifierOptions, but the
+// audio frames are classified in parallel by a pool of TFLite interpreters,
+// directly from the audio buffer: no MediaPipe graph is run, and no packet or
+// Tensor is created per frame.
+//
+// The model requirements are those of AudioClassifier. The methods of a
+// BatchAudioClassifier must not be called concurrently, as they share its
+// interpreters.
+class BatchAudioClassifier {
+ public:
+  // Creates a BatchAudioClassifier from the provided options.
+  static absl::StatusOr<std::unique_ptr<BatchAudioClassifier>> Create(
+      std::unique_ptr<BatchAudioClassifierOptions> options);
+
+  // Performs audio classification on the provided audio clip, which has the
+  // number of channels rows and the number of samples per channel columns, at
+  // the sample rate `audio_sample_rate`.
+  //
+  // The audio clip is resampled to the sample rate of the model and framed
+  // into the non-overlapping frames of samples that the model takes, the last
+  // one zero-padded. The ClassificationResult has one entry per frame and
+  // classification head, whose timestamp is the start time (in milliseconds)
+  // of the frame, as AudioClassifier::Classify() returns.
+  absl::StatusOr<ClassificationResult> Classify(const Matrix& audio_clip,
+                                                double audio_sample_rate);
+
+  // Decodes the audio stream `audio_stream_index` of the media file
+  // `file_path` with an AudioDecoder, on `num_decoding_threads` threads, and
+  // performs audio classification on it as Classify() does.
+  //
+  // The decoded audio is classified as it arrives, so only a few batches of
+  // frames per interpreter are held in memory rather than the whole stream.
+  absl::StatusOr<ClassificationResult> ClassifyFile(
+      const std::string& file_path, int audio_stream_index = 0,
+      int num_decoding_threads = 1);
+
+ private:
+  explicit BatchAudioClassifier(
+      std::unique_ptr<tasks::core::ModelResources> model_resources);
+
+  // Returns an error if audio with `num_channels` channels at the sample rate
+  // `audio_sample_rate` can't be fed to the model.
+  absl::Status ValidateAudioFormat(int num_channels,
+                                   double audio_sample_rate) const;
+
+  // Returns a ClassificationResult with the classification heads of the model
+  // and no entries yet.
+  ClassificationResult CreateResult() const;
+
+  // Classifies the audio frames of `audio`, at the sample rate of the model,
+  // and appends their entries to `result`, after the frames classified so
+  // far. A trailing partial frame is zero-padded.
+  absl::Status ClassifyFrames(const Eigen::Map<const Matrix>& audio,
+                              ClassificationResult* result);
+
+  // Runs the model on the audio frames of `batch` with `interpreter` and
+  // postprocesses the output tensors into the entries of `result`, the first
+  // frame of `audio` being that of the entry `first_entry`.
+  absl::Status ClassifyBatch(const Eigen::Map<const Matrix>& audio, int batch,
+                             int first_entry, tflite::Interpreter* interpreter,
+                             ClassificationResult* result) const;
+
+  // Fills `entry` with the categories of the classification head
+  // `head_index` from its dequantized `scores`, as the
+  // ClassificationPostprocessing subgraph does.
+  absl::Status Postprocess(int head_index, std::vector<float>* scores,
+                           ClassificationEntry* entry) const;
+
+  std::unique_ptr<tasks::core::ModelResources> model_resources_;
+  AudioTensorSpecs audio_tensor_specs_;
+  components::ClassificationPostprocessingOptions postprocessing_options_;
+  // The class filtering and sorting of each classification head.
+  std::vector<std::unique_ptr<ClassificationSelector>> class_selectors_;
+  int frames_per_batch_;
+  // The duration of an audio frame in microseconds, as the timestamps of the
+  // AudioToTensorCalculator.
+  int64 frame_duration_us_;
+
+  std::vector<std::unique_ptr<tflite::Interpreter>> interpreters_;
+  std::unique_ptr<ThreadPool> thread_pool_;
+};
+
+}  // namespace audio_classifier
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_TASKS_CC_AUDIO_AUDIO_CLASSIFIER_BATCH_AUDIO_CLASSIFIER_H_
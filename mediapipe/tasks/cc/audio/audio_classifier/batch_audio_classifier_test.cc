@@ -0,0 +1,303 @@
+/* Copyright 2022 The MediaPipe Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "mediapipe/tasks/cc/audio/audio_classifier/batch_audio_classifier.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/status/status.h"
+#include "absl/strings/string_view.h"
+#include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/formats/matrix.h"
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/status_matchers.h"
+#include "mediapipe/tasks/cc/audio/audio_classifier/audio_classifier.h"
+#include "mediapipe/tasks/cc/audio/utils/test_utils.h"
+#include "mediapipe/tasks/cc/components/containers/classifications.pb.h"
+#include "tensorflow/lite/core/shims/cc/shims_test_util.h"
+
+namespace mediapipe {
+namespace tasks {
+namespace audio {
+namespace audio_classifier {
+namespace {
+
+using ::mediapipe::file::JoinPath;
+using ::testing::EqualsProto;
+using ::testing::HasSubstr;
+using ::testing::proto::Approximately;
+
+constexpr char kTestDataDirectory[] = "/mediapipe/tasks/testdata/audio";
+constexpr char kModelWithMetadata[] =
+    "yamnet_audio_classifier_with_metadata.tflite";
+constexpr char kModelWithoutMetadata[] = "model_without_metadata.tflite";
+constexpr char kTwoHeadsModelWithMetadata[] = "two_heads.tflite";
+constexpr char k16kTestWavFilename[] = "speech_16000_hz_mono.wav";
+constexpr char k48kTestWavFilename[] = "speech_48000_hz_mono.wav";
+constexpr char k44kTestWavForTwoHeadsFilename[] = "two_heads_44100_hz_mono.wav";
+
+Matrix GetAudioData(absl::string_view filename) {
+  std::string wav_file_path = JoinPath("./", kTestDataDirectory, filename);
+  int buffer_size;
+  auto audio_data = internal::ReadWavFile(wav_file_path, &buffer_size);
+  Eigen::Map<Matrix> matrix_mapping(audio_data->get(), 1, buffer_size);
+  return matrix_mapping.matrix();
+}
+
+// Returns the results of AudioClassifier::Classify() for the same options.
+ClassificationResult ClassifyWithAudioClassifier(
+    absl::string_view model_file, const components::ClassifierOptions& options,
+    const Matrix& audio_clip, double audio_sample_rate) {
+  auto audio_classifier_options = std::make_unique<AudioClassifierOptions>();
+  audio_classifier_options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, model_file);
+  audio_classifier_options->classifier_options = options;
+  auto audio_classifier =
+      AudioClassifier::Create(std::move(audio_classifier_options));
+  CHECK(audio_classifier.ok()) << audio_classifier.status();
+  auto result = (*audio_classifier)->Classify(audio_clip, audio_sample_rate);
+  CHECK(result.ok()) << result.status();
+  CHECK((*audio_classifier)->Close().ok());
+  return *result;
+}
+
+std::unique_ptr<BatchAudioClassifier> CreateBatchAudioClassifier(
+    absl::string_view model_file, const components::ClassifierOptions& options,
+    int num_interpreters, int frames_per_batch) {
+  auto batch_options = std::make_unique<BatchAudioClassifierOptions>();
+  batch_options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, model_file);
+  batch_options->classifier_options = options;
+  batch_options->num_interpreters = num_interpreters;
+  batch_options->frames_per_batch = frames_per_batch;
+  auto batch_audio_classifier =
+      BatchAudioClassifier::Create(std::move(batch_options));
+  CHECK(batch_audio_classifier.ok()) << batch_audio_classifier.status();
+  return std::move(batch_audio_classifier).value();
+}
+
+class CreateFromOptionsTest : public tflite_shims::testing::Test {};
+
+TEST_F(CreateFromOptionsTest, FailsWithMissingModel) {
+  auto batch_audio_classifier_or = BatchAudioClassifier::Create(
+      std::make_unique<BatchAudioClassifierOptions>());
+  EXPECT_EQ(batch_audio_classifier_or.status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(
+      batch_audio_classifier_or.status().message(),
+      HasSubstr("ExternalFile must specify at least one of 'file_content', "
+                "'file_name' or 'file_descriptor_meta'."));
+}
+
+TEST_F(CreateFromOptionsTest, FailsWithMissingMetadata) {
+  auto options = std::make_unique<BatchAudioClassifierOptions>();
+  options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, kModelWithoutMetadata);
+  auto batch_audio_classifier_or =
+      BatchAudioClassifier::Create(std::move(options));
+  EXPECT_EQ(batch_audio_classifier_or.status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(batch_audio_classifier_or.status().message(),
+              HasSubstr("require TFLite Model Metadata"));
+}
+
+TEST_F(CreateFromOptionsTest, FailsWithInvalidFramesPerBatch) {
+  auto options = std::make_unique<BatchAudioClassifierOptions>();
+  options->base_options.model_asset_path =
+      JoinPath("./", kTestDataDirectory, kModelWithMetadata);
+  options->frames_per_batch = 0;
+  auto batch_audio_classifier_or =
+      BatchAudioClassifier::Create(std::move(options));
+  EXPECT_EQ(batch_audio_classifier_or.status().code(),
+            absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(batch_audio_classifier_or.status().message(),
+              HasSubstr("number of audio frames per batch"));
+}
+
+class ClassifyTest : public tflite_shims::testing::Test {};
+
+TEST_F(ClassifyTest, MatchesAudioClassifier) {
+  const Matrix audio_buffer = GetAudioData(k16kTestWavFilename);
+  const ClassificationResult expected = ClassifyWithAudioClassifier(
+      kModelWithMetadata, {}, audio_buffer, /*audio_sample_rate=*/16000);
+  // A single interpreter, and more interpreters than batches, with the last
+  // batch incomplete.
+  for (int num_interpreters : {1, 2, 8}) {
+    auto batch_audio_classifier = CreateBatchAudioClassifier(
+        kModelWithMetadata, {}, num_interpreters, /*frames_per_batch=*/2);
+    MP_ASSERT_OK_AND_ASSIGN(auto result, batch_audio_classifier->Classify(
+                                             audio_buffer,
+                                             /*audio_sample_rate=*/16000));
+    EXPECT_THAT(result, Approximately(EqualsProto(expected)))
+        << "with " << num_interpreters << " interpreters";
+  }
+}
+
+TEST_F(ClassifyTest, MatchesAudioClassifierWithResampling) {
+  const Matrix audio_buffer = GetAudioData(k48kTestWavFilename);
+  components::ClassifierOptions options;
+  options.max_results = 3;
+  options.score_threshold = 0.01f;
+  auto batch_audio_classifier =
+      CreateBatchAudioClassifier(kModelWithMetadata, options,
+                                 /*num_interpreters=*/4,
+                                 /*frames_per_batch=*/1);
+  MP_ASSERT_OK_AND_ASSIGN(auto result,
+                          batch_audio_classifier->Classify(
+                              audio_buffer, /*audio_sample_rate=*/48000));
+  EXPECT_THAT(result, Approximately(EqualsProto(ClassifyWithAudioClassifier(
+                          kModelWithMetadata, options, audio_buffer,
+                          /*audio_sample_rate=*/48000))));
+}
+
+TEST_F(ClassifyTest, MatchesAudioClassifierWithTwoHeads) {
+  const Matrix audio_buffer = GetAudioData(k44kTestWavForTwoHeadsFilename);
+  components::ClassifierOptions options;
+  options.category_allowlist = {"Silence", "Environmental noise",
+                                "Chestnut-crowned Antpitta"};
+  auto batch_audio_classifier =
+      CreateBatchAudioClassifier(kTwoHeadsModelWithMetadata, options,
+                                 /*num_interpreters=*/2,
+                                 /*frames_per_batch=*/1);
+  MP_ASSERT_OK_AND_ASSIGN(auto result,
+                          batch_audio_classifier->Classify(
+                              audio_buffer, /*audio_sample_rate=*/44100));
+  ASSERT_EQ(result.classifications_size(), 2);
+  EXPECT_EQ(result.classifications(1).head_name(), "bird_classification");
+  EXPECT_THAT(result, Approximately(EqualsProto(ClassifyWithAudioClassifier(
+                          kTwoHeadsModelWithMetadata, options, audio_buffer,
+                          /*audio_sample_rate=*/44100))));
+}
+
+TEST_F(ClassifyTest, MixesDownMultichannelAudio) {
+  const Matrix audio_buffer = GetAudioData(k16kTestWavFilename);
+  Matrix stereo_audio_buffer(2, audio_buffer.cols());
+  stereo_audio_buffer << audio_buffer, audio_buffer;
+  auto batch_audio_classifier = CreateBatchAudioClassifier(
+      kModelWithMetadata, {}, /*num_interpreters=*/2, /*frames_per_batch=*/2);
+  MP_ASSERT_OK_AND_ASSIGN(auto mono_result,
+                          batch_audio_classifier->Classify(
+                              audio_buffer, /*audio_sample_rate=*/16000));
+  MP_ASSERT_OK_AND_ASSIGN(auto stereo_result,
+                          batch_audio_classifier->Classify(
+                              stereo_audio_buffer,
+                              /*audio_sample_rate=*/16000));
+  EXPECT_THAT(stereo_result, EqualsProto(mono_result));
+}
+
+TEST_F(ClassifyTest, ClassifiesFile) {
+  auto batch_audio_classifier = CreateBatchAudioClassifier(
+      kModelWithMetadata, {}, /*num_interpreters=*/2, /*frames_per_batch=*/2);
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto result,
+      batch_audio_classifier->ClassifyFile(
+          JoinPath("./", kTestDataDirectory, k16kTestWavFilename)));
+  MP_ASSERT_OK_AND_ASSIGN(auto expected,
+                          batch_audio_classifier->Classify(
+                              GetAudioData(k16kTestWavFilename),
+                              /*audio_sample_rate=*/16000));
+  EXPECT_THAT(result, Approximately(EqualsProto(expected)));
+}
+
+TEST_F(ClassifyTest, ClassifiesFileWithResampling) {
+  // Single frame batches, so that the decoded audio is classified over many
+  // blocks of frames.
+  auto batch_audio_classifier = CreateBatchAudioClassifier(
+      kModelWithMetadata, {}, /*num_interpreters=*/2, /*frames_per_batch=*/1);
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto result,
+      batch_audio_classifier->ClassifyFile(
+          JoinPath("./", kTestDataDirectory, k48kTestWavFilename)));
+  MP_ASSERT_OK_AND_ASSIGN(auto expected,
+                          batch_audio_classifier->Classify(
+                              GetAudioData(k48kTestWavFilename),
+                              /*audio_sample_rate=*/48000));
+  EXPECT_THAT(result, Approximately(EqualsProto(expected)));
+}
+
+TEST_F(ClassifyTest, FailsWithEmptyAudio) {
+  auto batch_audio_classifier = CreateBatchAudioClassifier(
+      kModelWithMetadata, {}, /*num_interpreters=*/1, /*frames_per_batch=*/1);
+  auto result_or = batch_audio_classifier->Classify(
+      Matrix(1, 0), /*audio_sample_rate=*/16000);
+  EXPECT_EQ(result_or.status().code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(result_or.status().message(), HasSubstr("empty"));
+}
+
+// Classifies an hour of audio at 16 kHz, the speech test clip repeated.
+// Args: the number of interpreters, 0 for AudioClassifier::Classify(), and
+// the number of frames per batch.
+void BM_ClassifyOneHour(benchmark::State& state) {
+  constexpr int kSampleRate = 16000;
+  constexpr int kNumSamples = 3600 * kSampleRate;
+  const Matrix audio_data = GetAudioData(k16kTestWavFilename);
+  Matrix audio_buffer(1, kNumSamples);
+  for (int i = 0; i < kNumSamples; i += audio_data.cols()) {
+    const int num_samples = std::min<int>(audio_data.cols(), kNumSamples - i);
+    audio_buffer.middleCols(i, num_samples) = audio_data.leftCols(num_samples);
+  }
+  const int num_interpreters = state.range(0);
+  std::unique_ptr<AudioClassifier> audio_classifier;
+  std::unique_ptr<BatchAudioClassifier> batch_audio_classifier;
+  if (num_interpreters == 0) {
+    auto options = std::make_unique<AudioClassifierOptions>();
+    options->base_options.model_asset_path =
+        JoinPath("./", kTestDataDirectory, kModelWithMetadata);
+    auto audio_classifier_or = AudioClassifier::Create(std::move(options));
+    CHECK(audio_classifier_or.ok());
+    audio_classifier = std::move(audio_classifier_or).value();
+  } else {
+    batch_audio_classifier = CreateBatchAudioClassifier(
+        kModelWithMetadata, {}, num_interpreters, state.range(1));
+  }
+  int num_entries = 0;
+  for (auto _ : state) {
+    auto result_or =
+        audio_classifier
+            ? audio_classifier->Classify(audio_buffer, kSampleRate)
+            : batch_audio_classifier->Classify(audio_buffer, kSampleRate);
+    CHECK(result_or.ok());
+    num_entries = result_or->classifications(0).entries_size();
+  }
+  if (audio_classifier) {
+    CHECK(audio_classifier->Close().ok());
+  }
+  state.SetItemsProcessed(state.iterations() * kNumSamples);
+  state.counters["classified_frames"] = num_entries;
+  // Seconds of audio classified per second.
+  state.counters["realtime_factor"] = benchmark::Counter(
+      state.iterations() * 3600.0, benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_ClassifyOneHour)
+    ->Args({0, 1})
+    ->Args({1, 32})
+    ->Args({2, 32})
+    ->Args({4, 32})
+    ->Args({8, 32})
+    ->Args({8, 1})
+    ->Args({8, 256})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace
+}  // namespace audio_classifier
+}  // namespace audio
+}  // namespace tasks
+}  // namespace mediapipe
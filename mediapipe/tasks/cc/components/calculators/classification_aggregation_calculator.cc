@@ -46,7 +46,8 @@ using ::mediapipe::tasks::Classifications;
 //     The collection of the timestamps that a single ClassificationResult
 //     should aggragate. This stream is optional, and the timestamp information
 //     will only be populated to the ClassificationResult proto when this stream
-//     is connected.
+//     is connected. The timestamps without CLASSIFICATIONS have no entries in
+//     the ClassificationResult.
 //
 // Outputs:
 //   CLASSIFICATION_RESULT - ClassificationResult
@@ -116,14 +117,22 @@ absl::Status ClassificationAggregationCalculator::Open(CalculatorContext* cc) {
 
 absl::Status ClassificationAggregationCalculator::Process(
     CalculatorContext* cc) {
-  std::vector<ClassificationList> classification_lists;
-  classification_lists.resize(kClassificationListIn(cc).Count());
-  std::transform(
+  // The classifications are missing at the timestamps whose inference was
+  // skipped, e.g. by a GateCalculator, and the aggregated result has no
+  // entries for them.
+  const bool has_classifications = std::none_of(
       kClassificationListIn(cc).begin(), kClassificationListIn(cc).end(),
-      classification_lists.begin(),
-      [](const auto& elem) -> ClassificationList { return elem.Get(); });
-  cached_classifications_[cc->InputTimestamp().Value()] =
-      std::move(classification_lists);
+      [](const auto& elem) { return elem.IsEmpty(); });
+  if (has_classifications) {
+    std::vector<ClassificationList> classification_lists;
+    classification_lists.resize(kClassificationListIn(cc).Count());
+    std::transform(
+        kClassificationListIn(cc).begin(), kClassificationListIn(cc).end(),
+        classification_lists.begin(),
+        [](const auto& elem) -> ClassificationList { return elem.Get(); });
+    cached_classifications_[cc->InputTimestamp().Value()] =
+        std::move(classification_lists);
+  }
   if (time_aggregation_enabled_ && kTimestampsIn(cc).IsEmpty()) {
     return absl::OkStatus();
   }
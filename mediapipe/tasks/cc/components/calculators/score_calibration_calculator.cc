@@ -12,7 +12,6 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <functional>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -27,6 +26,7 @@
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/tasks/cc/common.h"
 #include "mediapipe/tasks/cc/components/calculators/score_calibration_calculator.pb.h"
+#include "mediapipe/tasks/cc/components/calculators/score_calibration_utils.h"
 
 namespace mediapipe {
 namespace api2 {
@@ -36,26 +36,6 @@ using ::mediapipe::tasks::CreateStatusWithPayload;
 using ::mediapipe::tasks::MediaPipeTasksStatus;
 using ::mediapipe::tasks::ScoreCalibrationCalculatorOptions;
 
-namespace {
-// Used to prevent log(<=0.0) in ClampedLog() calls.
-constexpr float kLogScoreMinimum = 1e-16;
-
-// Returns the following, depending on x:
-//   x => threshold: log(x)
-//   x < threshold: 2 * log(thresh) - log(2 * thresh - x)
-// This form (a) is anti-symmetric about the threshold and (b) has continuous
-// value and first derivative. This is done to prevent taking the log of values
-// close to 0 which can lead to floating point errors and is better than simple
-// clamping since it preserves order for scores less than the threshold.
-float ClampedLog(float x, float threshold) {
-  if (x < threshold) {
-    return 2.0 * std::log(static_cast<double>(threshold)) -
-           log(2.0 * threshold - x);
-  }
-  return std::log(static_cast<double>(x));
-}
-}  // namespace
-
 // Applies score calibration to a tensor of score predictions, typically applied
 // to the output of a classification or object detection model.
 //
@@ -91,59 +71,15 @@ class ScoreCalibrationCalculator : public Node {
 
  private:
   ScoreCalibrationCalculatorOptions options_;
-  std::function<float(float)> score_transformation_;
 
-  // Computes the calibrated score for the provided index. Does not check for
+  // Computes the calibrated score for the provided index, checking for
   // out-of-bounds index.
-  float ComputeCalibratedScore(int index, float score);
-  // Same as above, but does check for out-of-bounds index.
   absl::StatusOr<float> SafeComputeCalibratedScore(int index, float score);
 };
 
 absl::Status ScoreCalibrationCalculator::Open(CalculatorContext* cc) {
   options_ = cc->Options<ScoreCalibrationCalculatorOptions>();
-  // Sanity checks.
-  if (options_.sigmoids_size() == 0) {
-    return CreateStatusWithPayload(StatusCode::kInvalidArgument,
-                                   "Expected at least one sigmoid, found none.",
-                                   MediaPipeTasksStatus::kInvalidArgumentError);
-  }
-  for (const auto& sigmoid : options_.sigmoids()) {
-    if (sigmoid.has_scale() && sigmoid.scale() < 0.0) {
-      return CreateStatusWithPayload(
-          StatusCode::kInvalidArgument,
-          absl::StrFormat("The scale parameter of the sigmoids must be "
-                          "positive, found %f.",
-                          sigmoid.scale()),
-          MediaPipeTasksStatus::kInvalidArgumentError);
-    }
-  }
-  // Set score transformation function once and for all.
-  switch (options_.score_transformation()) {
-    case tasks::ScoreCalibrationCalculatorOptions::IDENTITY:
-      score_transformation_ = [](float x) { return x; };
-      break;
-    case tasks::ScoreCalibrationCalculatorOptions::LOG:
-      score_transformation_ = [](float x) {
-        return ClampedLog(x, kLogScoreMinimum);
-      };
-      break;
-    case tasks::ScoreCalibrationCalculatorOptions::INVERSE_LOGISTIC:
-      score_transformation_ = [](float x) {
-        return (ClampedLog(x, kLogScoreMinimum) -
-                ClampedLog(1.0 - x, kLogScoreMinimum));
-      };
-      break;
-    default:
-      return CreateStatusWithPayload(
-          StatusCode::kInvalidArgument,
-          absl::StrFormat(
-              "Unsupported ScoreTransformation type: %s",
-              ScoreCalibrationCalculatorOptions::ScoreTransformation_Name(
-                  options_.score_transformation())),
-          MediaPipeTasksStatus::kInvalidArgumentError);
-  }
-  return absl::OkStatus();
+  return tasks::ValidateScoreCalibrationOptions(options_);
 }
 
 absl::Status ScoreCalibrationCalculator::Process(CalculatorContext* cc) {
@@ -194,46 +130,14 @@ absl::Status ScoreCalibrationCalculator::Process(CalculatorContext* cc) {
     for (int i = 0; i < num_scores; ++i) {
       // Use the "unsafe" flavor as we have already checked for out-of-bounds
       // issues.
-      raw_calibrated_scores[i] = ComputeCalibratedScore(i, raw_scores[i]);
+      raw_calibrated_scores[i] =
+          tasks::ComputeCalibratedScore(options_, i, raw_scores[i]);
     }
   }
   kScoresOut(cc).Send(std::move(output_tensors));
   return absl::OkStatus();
 }
 
-float ScoreCalibrationCalculator::ComputeCalibratedScore(int index,
-                                                         float score) {
-  const auto& sigmoid = options_.sigmoids(index);
-
-  bool is_empty =
-      !sigmoid.has_scale() || !sigmoid.has_offset() || !sigmoid.has_slope();
-  bool is_below_min_score =
-      sigmoid.has_min_score() && score < sigmoid.min_score();
-  if (is_empty || is_below_min_score) {
-    return options_.default_score();
-  }
-
-  float transformed_score = score_transformation_(score);
-  float scale_shifted_score =
-      transformed_score * sigmoid.slope() + sigmoid.offset();
-  // For numerical stability use 1 / (1+exp(-x)) when scale_shifted_score >= 0
-  // and exp(x) / (1+exp(x)) when scale_shifted_score < 0.
-  float calibrated_score;
-  if (scale_shifted_score >= 0.0) {
-    calibrated_score =
-        sigmoid.scale() /
-        (1.0 + std::exp(static_cast<double>(-scale_shifted_score)));
-  } else {
-    float score_exp = std::exp(static_cast<double>(scale_shifted_score));
-    calibrated_score = sigmoid.scale() * score_exp / (1.0 + score_exp);
-  }
-  // Scale is non-negative (checked in SigmoidFromLabelAndLine),
-  // thus calibrated_score should be in the range of [0, scale]. However, due to
-  // numberical stability issue, it may fall out of the boundary. Cap the value
-  // to [0, scale] instead.
-  return std::max(std::min(calibrated_score, sigmoid.scale()), 0.0f);
-}
-
 absl::StatusOr<float> ScoreCalibrationCalculator::SafeComputeCalibratedScore(
     int index, float score) {
   if (index < 0) {
@@ -250,7 +154,7 @@ absl::StatusOr<float> ScoreCalibrationCalculator::SafeComputeCalibratedScore(
                         index, options_.sigmoids_size()),
         MediaPipeTasksStatus::kMetadataInconsistencyError);
   }
-  return ComputeCalibratedScore(index, score);
+  return tasks::ComputeCalibratedScore(options_, index, score);
 }
 
 MEDIAPIPE_REGISTER_NODE(ScoreCalibrationCalculator);
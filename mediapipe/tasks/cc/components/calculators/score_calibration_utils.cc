@@ -14,6 +14,8 @@
 
 #include "mediapipe/tasks/cc/components/calculators/score_calibration_utils.h"
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include "absl/status/status.h"
@@ -30,6 +32,24 @@ namespace mediapipe {
 namespace tasks {
 
 namespace {
+// Used to prevent log(<=0.0) in ClampedLog() calls.
+constexpr float kLogScoreMinimum = 1e-16;
+
+// Returns the following, depending on x:
+//   x => threshold: log(x)
+//   x < threshold: 2 * log(thresh) - log(2 * thresh - x)
+// This form (a) is anti-symmetric about the threshold and (b) has continuous
+// value and first derivative. This is done to prevent taking the log of values
+// close to 0 which can lead to floating point errors and is better than simple
+// clamping since it preserves order for scores less than the threshold.
+float ClampedLog(float x, float threshold) {
+  if (x < threshold) {
+    return 2.0 * std::log(static_cast<double>(threshold)) -
+           log(2.0 * threshold - x);
+  }
+  return std::log(static_cast<double>(x));
+}
+
 // Converts ScoreTransformation type from TFLite Metadata to calculator options.
 ScoreCalibrationCalculatorOptions::ScoreTransformation
 ConvertScoreTransformationType(tflite::ScoreTransformationType type) {
@@ -111,5 +131,82 @@ absl::Status ConfigureScoreCalibration(
   return absl::OkStatus();
 }
 
+absl::Status ValidateScoreCalibrationOptions(
+    const ScoreCalibrationCalculatorOptions& options) {
+  if (options.sigmoids_size() == 0) {
+    return CreateStatusWithPayload(absl::StatusCode::kInvalidArgument,
+                                   "Expected at least one sigmoid, found none.",
+                                   MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+  for (const auto& sigmoid : options.sigmoids()) {
+    if (sigmoid.has_scale() && sigmoid.scale() < 0.0) {
+      return CreateStatusWithPayload(
+          absl::StatusCode::kInvalidArgument,
+          absl::StrFormat("The scale parameter of the sigmoids must be "
+                          "positive, found %f.",
+                          sigmoid.scale()),
+          MediaPipeTasksStatus::kInvalidArgumentError);
+    }
+  }
+  switch (options.score_transformation()) {
+    case ScoreCalibrationCalculatorOptions::IDENTITY:
+    case ScoreCalibrationCalculatorOptions::LOG:
+    case ScoreCalibrationCalculatorOptions::INVERSE_LOGISTIC:
+      return absl::OkStatus();
+    default:
+      return CreateStatusWithPayload(
+          absl::StatusCode::kInvalidArgument,
+          absl::StrFormat(
+              "Unsupported ScoreTransformation type: %s",
+              ScoreCalibrationCalculatorOptions::ScoreTransformation_Name(
+                  options.score_transformation())),
+          MediaPipeTasksStatus::kInvalidArgumentError);
+  }
+}
+
+float ComputeCalibratedScore(const ScoreCalibrationCalculatorOptions& options,
+                             int index, float score) {
+  const auto& sigmoid = options.sigmoids(index);
+
+  bool is_empty =
+      !sigmoid.has_scale() || !sigmoid.has_offset() || !sigmoid.has_slope();
+  bool is_below_min_score =
+      sigmoid.has_min_score() && score < sigmoid.min_score();
+  if (is_empty || is_below_min_score) {
+    return options.default_score();
+  }
+
+  float transformed_score;
+  switch (options.score_transformation()) {
+    case ScoreCalibrationCalculatorOptions::LOG:
+      transformed_score = ClampedLog(score, kLogScoreMinimum);
+      break;
+    case ScoreCalibrationCalculatorOptions::INVERSE_LOGISTIC:
+      transformed_score = ClampedLog(score, kLogScoreMinimum) -
+                          ClampedLog(1.0 - score, kLogScoreMinimum);
+      break;
+    default:
+      transformed_score = score;
+  }
+  float scale_shifted_score =
+      transformed_score * sigmoid.slope() + sigmoid.offset();
+  // For numerical stability use 1 / (1+exp(-x)) when scale_shifted_score >= 0
+  // and exp(x) / (1+exp(x)) when scale_shifted_score < 0.
+  float calibrated_score;
+  if (scale_shifted_score >= 0.0) {
+    calibrated_score =
+        sigmoid.scale() /
+        (1.0 + std::exp(static_cast<double>(-scale_shifted_score)));
+  } else {
+    float score_exp = std::exp(static_cast<double>(scale_shifted_score));
+    calibrated_score = sigmoid.scale() * score_exp / (1.0 + score_exp);
+  }
+  // Scale is non-negative (checked in ValidateScoreCalibrationOptions),
+  // thus calibrated_score should be in the range of [0, scale]. However, due to
+  // numberical stability issue, it may fall out of the boundary. Cap the value
+  // to [0, scale] instead.
+  return std::max(std::min(calibrated_score, sigmoid.scale()), 0.0f);
+}
+
 }  // namespace tasks
 }  // namespace mediapipe
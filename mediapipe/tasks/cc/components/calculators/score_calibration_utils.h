@@ -32,6 +32,17 @@ absl::Status ConfigureScoreCalibration(
     absl::string_view score_calibration_file,
     ScoreCalibrationCalculatorOptions* options);
 
+// Checks that `options` has at least one sigmoid, no negative sigmoid scale
+// and a supported score transformation, as ScoreCalibrationCalculator
+// requires.
+absl::Status ValidateScoreCalibrationOptions(
+    const ScoreCalibrationCalculatorOptions& options);
+
+// Returns the calibrated score of `score` using the sigmoid at `index` in the
+// validated `options`. Does not check for out-of-bounds index.
+float ComputeCalibratedScore(const ScoreCalibrationCalculatorOptions& options,
+                             int index, float score);
+
 }  // namespace tasks
 }  // namespace mediapipe
 
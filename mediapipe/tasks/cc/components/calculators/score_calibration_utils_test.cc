@@ -125,6 +125,47 @@ TEST(ConfigureScoreCalibrationTest, FailsWithNegativeScaleParameter) {
       HasSubstr("The scale parameter of the sigmoids must be positive"));
 }
 
+TEST(ValidateScoreCalibrationOptionsTest, FailsWithNoSigmoid) {
+  auto status = ValidateScoreCalibrationOptions(
+      ParseTextProtoOrDie<ScoreCalibrationCalculatorOptions>(R"pb(
+        score_transformation: IDENTITY
+      )pb"));
+
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(),
+              HasSubstr("Expected at least one sigmoid, found none"));
+}
+
+TEST(ValidateScoreCalibrationOptionsTest, FailsWithUnspecifiedTransformation) {
+  auto status = ValidateScoreCalibrationOptions(
+      ParseTextProtoOrDie<ScoreCalibrationCalculatorOptions>(R"pb(
+        sigmoids { scale: 0.9 slope: 0.5 offset: 0.1 }
+        score_transformation: UNSPECIFIED
+      )pb"));
+
+  EXPECT_EQ(status.code(), absl::StatusCode::kInvalidArgument);
+  EXPECT_THAT(status.message(),
+              HasSubstr("Unsupported ScoreTransformation type"));
+}
+
+TEST(ComputeCalibratedScoreTest, SucceedsWithInverseLogistic) {
+  const auto options =
+      ParseTextProtoOrDie<ScoreCalibrationCalculatorOptions>(R"pb(
+        sigmoids { scale: 0.9 slope: 0.5 offset: 0.1 }
+        sigmoids { scale: 0.9 slope: 0.5 offset: 0.1 min_score: 0.3 }
+        sigmoids {}
+        score_transformation: INVERSE_LOGISTIC
+        default_score: 0.2
+      )pb");
+  MP_ASSERT_OK(ValidateScoreCalibrationOptions(options));
+
+  EXPECT_NEAR(ComputeCalibratedScore(options, 0, 0.2), 0.3203217641, 1e-6);
+  // Below min_score.
+  EXPECT_FLOAT_EQ(ComputeCalibratedScore(options, 1, 0.2), 0.2);
+  // Empty sigmoid.
+  EXPECT_FLOAT_EQ(ComputeCalibratedScore(options, 2, 0.5), 0.2);
+}
+
 }  // namespace
 }  // namespace tasks
 }  // namespace mediapipe
@@ -473,6 +473,18 @@ class PostprocessingTest : public tflite_shims::testing::Test {
     return absl::OkStatus();
   }
 
+  // Only sends the aggregation timestamps, as when the inference of the
+  // tensors at @timestamp was skipped.
+  absl::Status RunWithoutTensors(
+      const std::vector<int>& aggregation_timestamps, int timestamp) {
+    auto packet = absl::make_unique<std::vector<Timestamp>>();
+    for (const auto& aggregation_timestamp : aggregation_timestamps) {
+      packet->emplace_back(Timestamp(aggregation_timestamp));
+    }
+    return calculator_graph_.AddPacketToInputStream(
+        kTimestampsName, Adopt(packet.release()).At(Timestamp(timestamp)));
+  }
+
   absl::StatusOr<ClassificationResult> GetClassificationResult(
       OutputStreamPoller& poller) {
     MP_RETURN_IF_ERROR(calculator_graph_.WaitUntilIdle());
@@ -728,6 +740,44 @@ TEST_F(PostprocessingTest, SucceedsWithTimestamps) {
                })pb"));
 }
 
+TEST_F(PostprocessingTest, SucceedsWithTimestampsAndSkippedInferences) {
+  // Build graph.
+  ClassifierOptions options;
+  options.set_max_results(1);
+  MP_ASSERT_OK_AND_ASSIGN(
+      auto poller, BuildGraph(kQuantizedImageClassifierWithMetadata, options,
+                              /*connect_timestamps=*/true));
+  // Build input tensors.
+  std::vector<uint8> tensor_0(kMobileNetNumClasses, 0);
+  tensor_0[3] = 16;
+
+  // Send tensors only at the first timestamp, and get results.
+  AddTensor(tensor_0, Tensor::ElementType::kUInt8,
+            /*quantization_parameters=*/{0.1, 10});
+  MP_ASSERT_OK(Run());
+  MP_ASSERT_OK(RunWithoutTensors(
+      /*aggregation_timestamps=*/{0, 1000, 2000}, /*timestamp=*/2000));
+
+  MP_ASSERT_OK_AND_ASSIGN(auto results, GetClassificationResult(poller));
+
+  // Validate results: there are no entries for the skipped inferences.
+  EXPECT_THAT(
+      results,
+      EqualsProto(
+          R"pb(classifications {
+                 entries {
+                   categories {
+                     index: 3
+                     score: 0.6
+                     category_name: "great white shark"
+                   }
+                   timestamp_ms: 0
+                 }
+                 head_index: 0
+                 head_name: "probability"
+               })pb"));
+}
+
 }  // namespace
 }  // namespace components
 }  // namespace tasks
@@ -34,6 +34,7 @@ limitations under the License.
 #include "mediapipe/tasks/cc/metadata/metadata_extractor.h"
 #include "mediapipe/util/resource_util.h"
 #include "mediapipe/util/tflite/error_reporter.h"
+#include "mediapipe/util/tflite/tflite_model_cache.h"
 #include "tensorflow/lite/core/api/error_reporter.h"
 #include "tensorflow/lite/core/api/op_resolver.h"
 #include "tensorflow/lite/core/shims/cc/model_builder.h"
@@ -105,18 +106,15 @@ absl::Status ModelResources::BuildModelFromExternalFileProto() {
                      mediapipe::PathToResourceAsFile(model_file_->file_name()));
     model_file_->set_file_name(path_to_resource);
   }
-  ASSIGN_OR_RETURN(
-      model_file_handler_,
-      ExternalFileHandler::CreateFromExternalFile(model_file_.get()));
-  const char* buffer_data = model_file_handler_->GetFileContent().data();
-  size_t buffer_size = model_file_handler_->GetFileContent().size();
-  // Verifies that the supplied buffer refers to a valid flatbuffer model,
-  // and that it uses only operators that are supported by the OpResolver
-  // that was passed to the ModelResources constructor, and then builds
-  // the model from the buffer.
-  auto model = tflite_shims::FlatBufferModel::VerifyAndBuildFromBuffer(
-      buffer_data, buffer_size, &verifier_, &error_reporter_);
-  if (model == nullptr) {
+  // Verifies that the supplied buffer refers to a valid flatbuffer model, and
+  // then builds the model from the buffer.
+  auto build_model = [&](absl::string_view buffer)
+      -> absl::StatusOr<std::unique_ptr<tflite_shims::FlatBufferModel>> {
+    auto model = tflite_shims::FlatBufferModel::VerifyAndBuildFromBuffer(
+        buffer.data(), buffer.size(), &verifier_, &error_reporter_);
+    if (model != nullptr) {
+      return model;
+    }
     static constexpr char kInvalidFlatbufferMessage[] =
         "The model is not a valid Flatbuffer";
     // To be replaced with a proper switch-case when TFLite model builder
@@ -138,11 +136,72 @@ absl::Status ModelResources::BuildModelFromExternalFileProto() {
               "Could not build model from the provided pre-loaded flatbuffer: ",
               error_reporter_.message()));
     }
-  }
+  };
 
+#if !TFLITE_IN_GMSCORE
+  // Shares the model with every other graph of the process running it. The
+  // cache entry keeps the file handler, and the proto it reads from, alive.
+  auto make_content_owner = [this]() {
+    return std::make_shared<std::pair<std::shared_ptr<proto::ExternalFile>,
+                                      std::shared_ptr<ExternalFileHandler>>>(
+        model_file_, model_file_handler_);
+  };
+  // Model files are identified without being read, so that a cache hit
+  // doesn't read the file at all. Files that can't be identified are read
+  // and identified by their content, which also reports the errors of
+  // ExternalFileHandler.
+  absl::StatusOr<TfLiteModelCache::FileIdentity> file =
+      absl::NotFoundError("The model file is not a file.");
+  if (model_file_->has_file_name()) {
+    file = TfLiteModelCache::GetFileIdentity(model_file_->file_name());
+  } else if (model_file_->has_file_descriptor_meta()) {
+    const auto& file_descriptor_meta = model_file_->file_descriptor_meta();
+    file = TfLiteModelCache::GetFileIdentity(file_descriptor_meta.fd(),
+                                             file_descriptor_meta.offset(),
+                                             file_descriptor_meta.length());
+  }
+  if (file.ok()) {
+    ASSIGN_OR_RETURN(
+        model_packet_,
+        TfLiteModelCache::GetInstance().GetOrBuildModelFromFile(
+            *file,
+            [&](std::shared_ptr<const void>* content_owner)
+                -> absl::StatusOr<
+                    std::unique_ptr<tflite_shims::FlatBufferModel>> {
+              ASSIGN_OR_RETURN(model_file_handler_,
+                               ExternalFileHandler::CreateFromExternalFile(
+                                   model_file_.get()));
+              *content_owner = make_content_owner();
+              return build_model(model_file_handler_->GetFileContent());
+            }));
+  } else {
+    ASSIGN_OR_RETURN(
+        model_file_handler_,
+        ExternalFileHandler::CreateFromExternalFile(model_file_.get()));
+    const absl::string_view buffer = model_file_handler_->GetFileContent();
+    ASSIGN_OR_RETURN(model_packet_,
+                     TfLiteModelCache::GetInstance().GetOrBuildModel(
+                         model_file_->file_name(), buffer,
+                         make_content_owner(),
+                         [&]() { return build_model(buffer); }));
+  }
+  // The model may have been built by another ModelResources, from a file
+  // handler this one doesn't have: its buffer is the model's allocation.
+  const char* buffer_data =
+      static_cast<const char*>(model_packet_.Get()->allocation()->base());
+  size_t buffer_size = model_packet_.Get()->allocation()->bytes();
+#else
+  ASSIGN_OR_RETURN(
+      model_file_handler_,
+      ExternalFileHandler::CreateFromExternalFile(model_file_.get()));
+  const char* buffer_data = model_file_handler_->GetFileContent().data();
+  size_t buffer_size = model_file_handler_->GetFileContent().size();
+  ASSIGN_OR_RETURN(auto model,
+                   build_model(absl::string_view(buffer_data, buffer_size)));
   model_packet_ = MakePacket<ModelPtr>(
       model.release(),
       [](tflite_shims::FlatBufferModel* model) { delete model; });
+#endif  // !TFLITE_IN_GMSCORE
   ASSIGN_OR_RETURN(auto model_metadata_extractor,
                    metadata::ModelMetadataExtractor::CreateFromModelBuffer(
                        buffer_data, buffer_size));
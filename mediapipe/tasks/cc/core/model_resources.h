@@ -124,13 +124,15 @@ class ModelResources {
 
   // The model resources tag.
   const std::string tag_;
-  // The model file.
-  std::unique_ptr<proto::ExternalFile> model_file_;
+  // The model file. Shared with the TfLiteModelCache entry of the model, which
+  // may outlive this object.
+  std::shared_ptr<proto::ExternalFile> model_file_;
   // The packet stores the TFLite op resolver.
   api2::Packet<tflite::OpResolver> op_resolver_packet_;
 
-  // The ExternalFileHandler for the model.
-  std::unique_ptr<ExternalFileHandler> model_file_handler_;
+  // The ExternalFileHandler for the model. Null if the model was found in the
+  // TfLiteModelCache without reading the model file.
+  std::shared_ptr<ExternalFileHandler> model_file_handler_;
   // The packet stores the TFLite model for actual inference.
   api2::Packet<ModelPtr> model_packet_;
   // The packet stores the TFLite Metadata extractor built from the model.
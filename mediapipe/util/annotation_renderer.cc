@@ -17,8 +17,14 @@
 #include <math.h>
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
 #include "mediapipe/framework/port/logging.h"
 #include "mediapipe/framework/port/vector.h"
 #include "mediapipe/util/color.pb.h"
@@ -85,10 +91,262 @@ void cv_line2(cv::Mat& img, const cv::Point& start, const cv::Point& end,
   }
 }
 
+// Rounds @value / 255 to nearest, for @value in [0, 255 * 255].
+inline int DivideBy255(int value) {
+  value += 128;
+  return (value + (value >> 8)) >> 8;
+}
+
+// Blends a tile of the overlay onto @image: each pixel is interpolated
+// between the image and the color of the overlay by its coverage. The alpha
+// channel of RGBA images goes to 0 where covered, as when drawing with a
+// cv::Scalar of three components.
+template <int kChannels>
+void BlendTile(const uint8* tile, int tile_stride, int width, int height,
+               uint8* image, size_t image_stride) {
+  for (int y = 0; y < height; ++y) {
+    const uint8* src = tile + y * tile_stride;
+    uint8* dst = image + y * image_stride;
+    for (int x = 0; x < width; ++x) {
+      const int coverage = src[4 * x + 3];
+      const int inverse = 255 - coverage;
+      for (int c = 0; c < 3; ++c) {
+        dst[kChannels * x + c] = DivideBy255(dst[kChannels * x + c] * inverse +
+                                             src[4 * x + c] * coverage);
+      }
+      if (kChannels == 4) {
+        dst[4 * x + 3] = DivideBy255(dst[4 * x + 3] * inverse);
+      }
+    }
+  }
+}
+
 }  // namespace
 
+// Overlay of the annotations of a batch, made of the tiles of the image they
+// touch. Each pixel of a tile holds the color of the last annotation covering
+// it, and its coverage (0 or 255) in a fourth channel. Tiles are drawn with the
+// same OpenCV functions as the image, translated to their origin, which gives
+// the same pixels.
+class AnnotationRenderer::TiledOverlay {
+ public:
+  static constexpr int kTileSize = 64;
+
+  // Starts a batch on @image, of type CV_8UC3 or CV_8UC4.
+  void Begin(const cv::Mat& image) {
+    image_ = image;
+    const int tiles_x = (image.cols + kTileSize - 1) / kTileSize;
+    const int tiles_y = (image.rows + kTileSize - 1) / kTileSize;
+    if (tiles_x != tiles_x_ || tiles_y != tiles_y_) {
+      tiles_x_ = tiles_x;
+      tiles_y_ = tiles_y;
+      tiles_.assign(tiles_x * tiles_y, nullptr);
+    }
+  }
+
+  // Same as cv::circle(image, center, radius, color, -1).
+  void DrawFilledCircle(const cv::Point& center, int radius,
+                        const cv::Scalar& color) {
+    if (radius > kTileSize) {
+      const cv::Rect bounds(center.x - radius, center.y - radius,
+                            2 * radius + 1, 2 * radius + 1);
+      DrawOnTiles(bounds, [&](cv::Mat& tile, const cv::Point& offset) {
+        cv::circle(tile, center + offset, radius, ToTileColor(color), -1);
+      });
+      return;
+    }
+    // Small discs, e.g. landmarks, are stamped row by row.
+    const Pixel pixel = ToPixel(color);
+    const std::vector<std::pair<int, int>>& disc = GetDisc(radius);
+    for (int dy = -radius; dy <= radius; ++dy) {
+      const auto& span = disc[dy + radius];
+      if (span.first > span.second) continue;
+      FillSpan(center.y + dy, center.x + span.first, center.x + span.second,
+               pixel);
+    }
+  }
+
+  // Same as cv::line(image, start, end, color, thickness).
+  void DrawLine(const cv::Point& start, const cv::Point& end, int thickness,
+                const cv::Scalar& color) {
+    if (thickness <= 1) {
+      // Iterates over the pixels of the line exactly as cv::line does, on the
+      // image since clipping the line to a tile may shift its pixels.
+      const Pixel pixel = ToPixel(color);
+      cv::LineIterator iterator(image_, start, end, /*connectivity=*/8,
+                                /*leftToRight=*/true);
+      for (int i = 0; i < iterator.count; ++i, ++iterator) {
+        const cv::Point position = iterator.pos();
+        FillSpan(position.y, position.x, position.x, pixel);
+      }
+      return;
+    }
+    // Thick lines extend by less than their thickness around their ends.
+    const cv::Rect bounds(std::min(start.x, end.x) - thickness,
+                          std::min(start.y, end.y) - thickness,
+                          std::abs(end.x - start.x) + 2 * thickness + 1,
+                          std::abs(end.y - start.y) + 2 * thickness + 1);
+    DrawOnTiles(bounds, [&](cv::Mat& tile, const cv::Point& offset) {
+      cv::line(tile, start + offset, end + offset, ToTileColor(color),
+               thickness);
+    });
+  }
+
+  // Blends the touched tiles onto the image, and clears them. Ends the batch.
+  void Composite() {
+    for (int index : touched_) {
+      uint8* tile = tiles_[index];
+      const int x = (index % tiles_x_) * kTileSize;
+      const int y = (index / tiles_x_) * kTileSize;
+      const int width = std::min(kTileSize, image_.cols - x);
+      const int height = std::min(kTileSize, image_.rows - y);
+      uint8* image = image_.ptr<uint8>(y) + x * image_.channels();
+      if (image_.channels() == 4) {
+        BlendTile<4>(tile, kTileStride, width, height, image, image_.step);
+      } else {
+        BlendTile<3>(tile, kTileStride, width, height, image, image_.step);
+      }
+      std::memset(tile, 0, kTileStride * kTileSize);
+      free_tiles_.push_back(tile);
+      tiles_[index] = nullptr;
+    }
+    touched_.clear();
+    image_.release();
+  }
+
+ private:
+  static constexpr int kTileStride = 4 * kTileSize;
+  using Pixel = std::array<uint8, 4>;
+
+  static Pixel ToPixel(const cv::Scalar& color) {
+    return {cv::saturate_cast<uint8>(color[0]),
+            cv::saturate_cast<uint8>(color[1]),
+            cv::saturate_cast<uint8>(color[2]), 255};
+  }
+
+  static cv::Scalar ToTileColor(const cv::Scalar& color) {
+    const Pixel pixel = ToPixel(color);
+    return cv::Scalar(pixel[0], pixel[1], pixel[2], pixel[3]);
+  }
+
+  // Returns the tile at (tile_x, tile_y), cleared on first use in the batch.
+  uint8* GetTile(int tile_x, int tile_y) {
+    const int index = tile_y * tiles_x_ + tile_x;
+    uint8*& tile = tiles_[index];
+    if (!tile) {
+      if (free_tiles_.empty()) {
+        buffers_.push_back(absl::make_unique<uint8[]>(kTileStride * kTileSize));
+        free_tiles_.push_back(buffers_.back().get());
+      }
+      tile = free_tiles_.back();
+      free_tiles_.pop_back();
+      touched_.push_back(index);
+    }
+    return tile;
+  }
+
+  // Sets pixels [x_begin, x_end] of row y, clipped to the image.
+  void FillSpan(int y, int x_begin, int x_end, const Pixel& pixel) {
+    if (y < 0 || y >= image_.rows) return;
+    x_begin = std::max(x_begin, 0);
+    x_end = std::min(x_end, image_.cols - 1);
+    const int tile_y = y / kTileSize;
+    const int row = y % kTileSize;
+    while (x_begin <= x_end) {
+      const int tile_x = x_begin / kTileSize;
+      const int last = std::min(x_end, (tile_x + 1) * kTileSize - 1);
+      uint8* dst = GetTile(tile_x, tile_y) + row * kTileStride +
+                   (x_begin - tile_x * kTileSize) * 4;
+      for (int x = x_begin; x <= last; ++x, dst += 4) {
+        std::memcpy(dst, pixel.data(), 4);
+      }
+      x_begin = last + 1;
+    }
+  }
+
+  // Calls draw(tile, offset) on each tile intersecting @bounds, where tile is
+  // clipped to the image and offset translates image coordinates to tile
+  // coordinates.
+  template <typename DrawFunction>
+  void DrawOnTiles(const cv::Rect& bounds, const DrawFunction& draw) {
+    const cv::Rect clipped = bounds & cv::Rect(0, 0, image_.cols, image_.rows);
+    if (clipped.empty()) return;
+    for (int tile_y = clipped.y / kTileSize;
+         tile_y <= (clipped.br().y - 1) / kTileSize; ++tile_y) {
+      for (int tile_x = clipped.x / kTileSize;
+           tile_x <= (clipped.br().x - 1) / kTileSize; ++tile_x) {
+        const int x = tile_x * kTileSize;
+        const int y = tile_y * kTileSize;
+        cv::Mat tile(std::min(kTileSize, image_.rows - y),
+                     std::min(kTileSize, image_.cols - x), CV_8UC4,
+                     GetTile(tile_x, tile_y), kTileStride);
+        draw(tile, cv::Point(-x, -y));
+      }
+    }
+  }
+
+  // Returns the first and last column of each row of the disc drawn by
+  // cv::circle with @radius, relative to its center.
+  const std::vector<std::pair<int, int>>& GetDisc(int radius) {
+    auto& disc = discs_[radius];
+    if (disc.empty()) {
+      const int size = 2 * radius + 1;
+      cv::Mat mask(size, size, CV_8UC1, cv::Scalar(0));
+      cv::circle(mask, cv::Point(radius, radius), radius, cv::Scalar(255), -1);
+      for (int y = 0; y < size; ++y) {
+        const uint8* row = mask.ptr<uint8>(y);
+        int first = size;
+        int last = -1;
+        for (int x = 0; x < size; ++x) {
+          if (row[x]) {
+            first = std::min(first, x);
+            last = x;
+          }
+        }
+        disc.emplace_back(first - radius, last - radius);
+      }
+    }
+    return disc;
+  }
+
+  cv::Mat image_;
+  int tiles_x_ = 0;
+  int tiles_y_ = 0;
+  // Tiles of the batch, or null where not touched.
+  std::vector<uint8*> tiles_;
+  // Indices of the non-null tiles.
+  std::vector<int> touched_;
+  // Cleared tiles, reused across batches.
+  std::vector<uint8*> free_tiles_;
+  std::vector<std::unique_ptr<uint8[]>> buffers_;
+  absl::flat_hash_map<int, std::vector<std::pair<int, int>>> discs_;
+};
+
+AnnotationRenderer::AnnotationRenderer() {}
+
+AnnotationRenderer::AnnotationRenderer(const cv::Mat& mat_image)
+    : image_width_(mat_image.cols),
+      image_height_(mat_image.rows),
+      mat_image_(mat_image.clone()) {}
+
+AnnotationRenderer::~AnnotationRenderer() = default;
+
 void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
+  const bool batched =
+      batched_rendering_ &&
+      (mat_image_.type() == CV_8UC3 || mat_image_.type() == CV_8UC4);
   for (const auto& annotation : render_data.render_annotations()) {
+    const bool batchable =
+        annotation.data_case() == RenderAnnotation::kPoint ||
+        annotation.data_case() == RenderAnnotation::kLine;
+    if (!batchable) {
+      // Keeps the drawing order.
+      FlushBatch();
+    } else if (batched && !batch_) {
+      if (!overlay_) overlay_ = absl::make_unique<TiledOverlay>();
+      overlay_->Begin(mat_image_);
+      batch_ = overlay_.get();
+    }
     if (annotation.data_case() == RenderAnnotation::kRectangle) {
       DrawRectangle(annotation);
     } else if (annotation.data_case() == RenderAnnotation::kRoundedRectangle) {
@@ -116,6 +374,13 @@ void AnnotationRenderer::RenderDataOnImage(const RenderData& render_data) {
       LOG(FATAL) << "Unknown annotation type: " << annotation.data_case();
     }
   }
+  FlushBatch();
+}
+
+void AnnotationRenderer::FlushBatch() {
+  if (!batch_) return;
+  batch_->Composite();
+  batch_ = nullptr;
 }
 
 void AnnotationRenderer::AdoptImage(cv::Mat* input_image) {
@@ -137,6 +402,10 @@ void AnnotationRenderer::SetScaleFactor(float scale_factor) {
   if (scale_factor > 0.0f) scale_factor_ = std::min(scale_factor, 1.0f);
 }
 
+void AnnotationRenderer::SetBatchedRendering(bool batched) {
+  batched_rendering_ = batched;
+}
+
 void AnnotationRenderer::DrawRectangle(const RenderAnnotation& annotation) {
   int left = -1;
   int top = -1;
@@ -457,7 +726,11 @@ void AnnotationRenderer::DrawPoint(const RenderAnnotation& annotation) {
   const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
   const int thickness =
       ClampThickness(round(annotation.thickness() * scale_factor_));
-  cv::circle(mat_image_, point_to_draw, thickness, color, -1);
+  if (batch_) {
+    batch_->DrawFilledCircle(point_to_draw, thickness, color);
+  } else {
+    cv::circle(mat_image_, point_to_draw, thickness, color, -1);
+  }
 }
 
 void AnnotationRenderer::DrawLine(const RenderAnnotation& annotation) {
@@ -485,7 +758,11 @@ void AnnotationRenderer::DrawLine(const RenderAnnotation& annotation) {
   const cv::Scalar color = MediapipeColorToOpenCVColor(annotation.color());
   const int thickness =
       ClampThickness(round(annotation.thickness() * scale_factor_));
-  cv::line(mat_image_, start, end, color, thickness);
+  if (batch_) {
+    batch_->DrawLine(start, end, thickness, color);
+  } else {
+    cv::line(mat_image_, start, end, color, thickness);
+  }
 }
 
 void AnnotationRenderer::DrawGradientLine(const RenderAnnotation& annotation) {
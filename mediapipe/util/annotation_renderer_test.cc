@@ -0,0 +1,208 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/annotation_renderer.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include "mediapipe/framework/port/benchmark.h"
+#include "mediapipe/framework/port/gmock.h"
+#include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/opencv_core_inc.h"
+#include "mediapipe/framework/port/opencv_imgproc_inc.h"
+#include "mediapipe/util/color.pb.h"
+#include "mediapipe/util/render_data.pb.h"
+
+namespace mediapipe {
+namespace {
+
+void SetColor(int r, int g, int b, RenderAnnotation* annotation) {
+  annotation->mutable_color()->set_r(r);
+  annotation->mutable_color()->set_g(g);
+  annotation->mutable_color()->set_b(b);
+}
+
+void AddPoint(float x, float y, bool normalized, double thickness,
+              RenderData* render_data) {
+  auto* annotation = render_data->add_render_annotations();
+  annotation->set_thickness(thickness);
+  SetColor(255, 0, 0, annotation);
+  auto* point = annotation->mutable_point();
+  point->set_normalized(normalized);
+  point->set_x(x);
+  point->set_y(y);
+}
+
+void AddLine(float x_start, float y_start, float x_end, float y_end,
+             bool normalized, double thickness, RenderData* render_data) {
+  auto* annotation = render_data->add_render_annotations();
+  annotation->set_thickness(thickness);
+  SetColor(0, 255, 0, annotation);
+  auto* line = annotation->mutable_line();
+  line->set_normalized(normalized);
+  line->set_x_start(x_start);
+  line->set_y_start(y_start);
+  line->set_x_end(x_end);
+  line->set_y_end(y_end);
+}
+
+// Render data of the size of a face mesh: 468 landmarks, connected to their
+// neighbors by about 1300 lines.
+RenderData FaceMeshRenderData() {
+  constexpr int kRows = 18;
+  constexpr int kColumns = 26;
+  auto landmark = [](int row, int column, float* x, float* y) {
+    // Landmarks on an ellipse-shaped grid around the center of the image.
+    const float u = (column + 0.5f) / kColumns * 2.f - 1.f;
+    const float v = (row + 0.5f) / kRows * 2.f - 1.f;
+    *x = 0.5f + 0.2f * u * std::sqrt(1.f - 0.5f * v * v);
+    *y = 0.5f + 0.3f * v;
+  };
+  RenderData render_data;
+  for (int row = 0; row < kRows; ++row) {
+    for (int column = 0; column < kColumns; ++column) {
+      float x0, y0, x1, y1;
+      landmark(row, column, &x0, &y0);
+      if (column + 1 < kColumns) {
+        landmark(row, column + 1, &x1, &y1);
+        AddLine(x0, y0, x1, y1, /*normalized=*/true, 1, &render_data);
+      }
+      if (row + 1 < kRows) {
+        landmark(row + 1, column, &x1, &y1);
+        AddLine(x0, y0, x1, y1, /*normalized=*/true, 1, &render_data);
+        if (column + 1 < kColumns) {
+          landmark(row + 1, column + 1, &x1, &y1);
+          AddLine(x0, y0, x1, y1, /*normalized=*/true, 1, &render_data);
+        }
+      }
+    }
+  }
+  for (int row = 0; row < kRows; ++row) {
+    for (int column = 0; column < kColumns; ++column) {
+      float x, y;
+      landmark(row, column, &x, &y);
+      AddPoint(x, y, /*normalized=*/true, 2, &render_data);
+    }
+  }
+  return render_data;
+}
+
+cv::Mat MakeImage(int width, int height, int type) {
+  cv::Mat image(height, width, type);
+  cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+  return image;
+}
+
+cv::Mat Render(const cv::Mat& image, const RenderData& render_data,
+               bool batched) {
+  cv::Mat result = image.clone();
+  AnnotationRenderer renderer;
+  renderer.SetBatchedRendering(batched);
+  renderer.AdoptImage(&result);
+  renderer.RenderDataOnImage(render_data);
+  return result;
+}
+
+void ExpectSameImage(const cv::Mat& actual, const cv::Mat& expected) {
+  ASSERT_EQ(actual.size(), expected.size());
+  ASSERT_EQ(actual.type(), expected.type());
+  EXPECT_EQ(cv::norm(actual, expected, cv::NORM_INF), 0.0);
+}
+
+class BatchedRenderingTest : public testing::TestWithParam<int> {};
+
+TEST_P(BatchedRenderingTest, MatchesUnbatchedPointsAndLines) {
+  // Not a multiple of the tile size, so that tiles are clipped.
+  const cv::Mat image = MakeImage(203, 141, GetParam());
+  std::mt19937 random(1234);
+  std::uniform_real_distribution<float> coordinate(-30.f, 240.f);
+  std::uniform_int_distribution<int> thickness(1, 12);
+  RenderData render_data;
+  for (int i = 0; i < 200; ++i) {
+    AddLine(coordinate(random), coordinate(random), coordinate(random),
+            coordinate(random), /*normalized=*/false, thickness(random),
+            &render_data);
+    AddPoint(coordinate(random), coordinate(random), /*normalized=*/false,
+             thickness(random), &render_data);
+  }
+  // Larger than a tile.
+  AddPoint(100, 70, /*normalized=*/false, 90, &render_data);
+  AddLine(-50, 20, 260, 130, /*normalized=*/false, 70, &render_data);
+
+  ExpectSameImage(Render(image, render_data, /*batched=*/true),
+                  Render(image, render_data, /*batched=*/false));
+}
+
+TEST_P(BatchedRenderingTest, MatchesUnbatchedFaceMesh) {
+  const cv::Mat image = MakeImage(640, 480, GetParam());
+  const RenderData render_data = FaceMeshRenderData();
+  ExpectSameImage(Render(image, render_data, /*batched=*/true),
+                  Render(image, render_data, /*batched=*/false));
+}
+
+TEST_P(BatchedRenderingTest, KeepsDrawingOrderWithOtherAnnotations) {
+  const cv::Mat image = MakeImage(200, 100, GetParam());
+  RenderData render_data;
+  AddLine(10, 10, 190, 90, /*normalized=*/false, 5, &render_data);
+  // Covers part of the line, and is covered by the point.
+  auto* annotation = render_data.add_render_annotations();
+  SetColor(0, 0, 255, annotation);
+  auto* rectangle = annotation->mutable_filled_rectangle()->mutable_rectangle();
+  rectangle->set_left(50);
+  rectangle->set_top(20);
+  rectangle->set_right(150);
+  rectangle->set_bottom(80);
+  AddPoint(100, 50, /*normalized=*/false, 10, &render_data);
+
+  const cv::Mat rendered = Render(image, render_data, /*batched=*/true);
+  ExpectSameImage(rendered, Render(image, render_data, /*batched=*/false));
+  auto pixel = [&rendered](int x, int y) {
+    return rendered.ptr<uint8_t>(y) + x * rendered.channels();
+  };
+  // The rectangle is above the line.
+  EXPECT_EQ(pixel(60, 32)[1], 0);
+  EXPECT_EQ(pixel(60, 32)[2], 255);
+  // The point is above the rectangle.
+  EXPECT_EQ(pixel(100, 50)[0], 255);
+  EXPECT_EQ(pixel(100, 50)[2], 0);
+}
+
+INSTANTIATE_TEST_SUITE_P(BatchedRenderingTests, BatchedRenderingTest,
+                         testing::Values(CV_8UC3, CV_8UC4));
+
+// Args: image width, image height, whether rendering is batched.
+void BM_RenderFaceMesh(benchmark::State& state) {
+  const cv::Mat image = MakeImage(state.range(0), state.range(1), CV_8UC3);
+  const RenderData render_data = FaceMeshRenderData();
+  cv::Mat target = image.clone();
+  AnnotationRenderer renderer;
+  renderer.SetBatchedRendering(state.range(2));
+  for (auto _ : state) {
+    image.copyTo(target);
+    renderer.AdoptImage(&target);
+    renderer.RenderDataOnImage(render_data);
+    benchmark::DoNotOptimize(target.data);
+  }
+}
+
+BENCHMARK(BM_RenderFaceMesh)
+    ->Args({1920, 1080, false})
+    ->Args({1920, 1080, true})
+    ->Args({3840, 2160, false})
+    ->Args({3840, 2160, true});
+
+}  // namespace
+}  // namespace mediapipe
@@ -17,20 +17,28 @@
 #include <algorithm>
 #include <cstdint>  // required by avutil.h
 #include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "Eigen/Core"
 #include "absl/base/internal/endian.h"
 #include "absl/strings/numbers.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/blocking_counter.h"
 #include "absl/time/time.h"
 #include "mediapipe/framework/deps/cleanup.h"
 #include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/port/map_util.h"
 #include "mediapipe/framework/port/ret_check.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/status_builder.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/framework/tool/status_util.h"
 
 extern "C" {
@@ -57,6 +65,11 @@ const int64 kMpegPtsEpoch = 1LL << 33;
 // Maximum PTS change between frames. Larger changes are considered to indicate
 // the MPEG PTS has rolled over. Unit is PTS ticks.
 const int64 kMpegPtsMaxDelta = kMpegPtsEpoch / 2;
+// Time decoding starts at before a time seeked to, so that codecs depending on
+// previous frames (through overlapping transforms, or the MP3 bit reservoir)
+// output the same samples as when decoding from the start, and to make up
+// for imprecise seeking. Unit is microseconds.
+const int64 kSeekPrerollUs = 500000;
 
 // BasePacketProcessor
 namespace {
@@ -235,6 +248,13 @@ absl::Status BasePacketProcessor::GetData(Packet* packet) {
   return absl::OkStatus();
 }
 
+void BasePacketProcessor::TakeData(BasePacketProcessor* other) {
+  CHECK(other);
+  std::move(other->buffer_.begin(), other->buffer_.end(),
+            std::back_inserter(buffer_));
+  other->buffer_.clear();
+}
+
 absl::Status BasePacketProcessor::Flush() {
   int64 last_num_frames_processed;
   do {
@@ -251,6 +271,7 @@ absl::Status BasePacketProcessor::Flush() {
     MP_RETURN_IF_ERROR(ProcessPacket(av_packet.get()));
   } while (last_num_frames_processed != num_frames_processed_);
 
+  OutputBufferedData();
   flushed_ = true;
   return absl::OkStatus();
 }
@@ -464,18 +485,15 @@ absl::Status AudioPacketProcessor::ProcessDecodedFrame(const AVPacket& packet) {
     }
   }
 
-  MP_RETURN_IF_ERROR(AddAudioDataToBuffer(
-      Timestamp(av_rescale_q(expected_sample_number_, sample_time_base_,
-                             output_time_base_)),
-      data_ptr, buf_size_bytes));
+  MP_RETURN_IF_ERROR(
+      AddAudioDataToBuffer(expected_sample_number_, data_ptr, buf_size_bytes));
 
   ++num_frames_processed_;
   return absl::OkStatus();
 }
 
 absl::Status AudioPacketProcessor::AddAudioDataToBuffer(
-    const Timestamp output_timestamp, uint8* const* raw_audio,
-    int buf_size_bytes) {
+    int64 sample_number, uint8* const* raw_audio, int buf_size_bytes) {
   if (buf_size_bytes == 0) {
     return absl::OkStatus();
   }
@@ -487,35 +505,94 @@ absl::Status AudioPacketProcessor::AddAudioDataToBuffer(
   const int64 num_samples = buf_size_bytes / bytes_per_sample_ / num_channels_;
   VLOG(3) << "Adding " << num_samples << " audio samples in " << num_channels_
           << " channels to output.";
-  auto current_frame = absl::make_unique<Matrix>(num_channels_, num_samples);
 
+  // The samples of the frame within the output range.
+  int64 begin = 0;
+  int64 end = num_samples;
+  if (first_output_sample_ > sample_number) {
+    begin = std::min(num_samples, first_output_sample_ - sample_number);
+  }
+  if (end_output_sample_ < sample_number + num_samples) {
+    end = std::max(begin, end_output_sample_ - sample_number);
+  }
+  expected_sample_number_ += num_samples;
+  if (begin == end) {
+    return absl::OkStatus();
+  }
+
+  if (options_.output_chunk_samples() <= 0) {
+    auto current_frame = absl::make_unique<Matrix>(num_channels_, end - begin);
+    MP_RETURN_IF_ERROR(
+        ConvertSamples(raw_audio, begin, end - begin, current_frame.get(), 0));
+    OutputAudio(std::move(current_frame), sample_number + begin);
+    return absl::OkStatus();
+  }
+
+  if (chunk_ && chunk_first_sample_ + chunk_num_samples_ !=
+                    sample_number + begin) {
+    // The samples are not contiguous to those of the chunk, as the timestamps
+    // were reset.
+    OutputChunk();
+  }
+  for (int64 sample = begin; sample < end;) {
+    if (!chunk_) {
+      chunk_ = absl::make_unique<Matrix>(num_channels_,
+                                         options_.output_chunk_samples());
+      chunk_first_sample_ = sample_number + sample;
+      chunk_num_samples_ = 0;
+    }
+    const int64 num_chunk_samples =
+        std::min(end - sample, chunk_->cols() - chunk_num_samples_);
+    MP_RETURN_IF_ERROR(ConvertSamples(raw_audio, sample, num_chunk_samples,
+                                      chunk_.get(), chunk_num_samples_));
+    chunk_num_samples_ += num_chunk_samples;
+    sample += num_chunk_samples;
+    if (chunk_num_samples_ == chunk_->cols()) {
+      OutputChunk();
+    }
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AudioPacketProcessor::ConvertSamples(uint8* const* raw_audio,
+                                                  int64 first_sample,
+                                                  int64 num_samples,
+                                                  Matrix* output,
+                                                  int64 first_column) const {
+  // Interleaved formats store the samples of all channels in raw_audio[0],
+  // planar formats those of each channel in raw_audio[channel].
+  const int64 interleaved_offset =
+      first_sample * num_channels_ * bytes_per_sample_;
+  const int64 planar_offset = first_sample * bytes_per_sample_;
+  const int64 end_column = first_column + num_samples;
   const char* sample_ptr = nullptr;
   switch (avcodec_ctx_->sample_fmt) {
     case AV_SAMPLE_FMT_S16:
-      sample_ptr = reinterpret_cast<const char*>(raw_audio[0]);
-      for (int64 sample_index = 0; sample_index < num_samples; ++sample_index) {
+      sample_ptr =
+          reinterpret_cast<const char*>(raw_audio[0]) + interleaved_offset;
+      for (int64 column = first_column; column < end_column; ++column) {
         for (int channel = 0; channel < num_channels_; ++channel) {
-          (*current_frame)(channel, sample_index) =
-              PcmEncodedSampleToFloat(sample_ptr);
+          (*output)(channel, column) = PcmEncodedSampleToFloat(sample_ptr);
           sample_ptr += bytes_per_sample_;
         }
       }
       break;
     case AV_SAMPLE_FMT_S32:
-      sample_ptr = reinterpret_cast<const char*>(raw_audio[0]);
-      for (int64 sample_index = 0; sample_index < num_samples; ++sample_index) {
+      sample_ptr =
+          reinterpret_cast<const char*>(raw_audio[0]) + interleaved_offset;
+      for (int64 column = first_column; column < end_column; ++column) {
         for (int channel = 0; channel < num_channels_; ++channel) {
-          (*current_frame)(channel, sample_index) =
-              PcmEncodedSampleInt32ToFloat(sample_ptr);
+          (*output)(channel, column) = PcmEncodedSampleInt32ToFloat(sample_ptr);
           sample_ptr += bytes_per_sample_;
         }
       }
       break;
     case AV_SAMPLE_FMT_FLT:
-      sample_ptr = reinterpret_cast<const char*>(raw_audio[0]);
-      for (int64 sample_index = 0; sample_index < num_samples; ++sample_index) {
+      sample_ptr =
+          reinterpret_cast<const char*>(raw_audio[0]) + interleaved_offset;
+      for (int64 column = first_column; column < end_column; ++column) {
         for (int channel = 0; channel < num_channels_; ++channel) {
-          (*current_frame)(channel, sample_index) =
+          (*output)(channel, column) =
               Uint32ToFloat(absl::little_endian::Load32(sample_ptr));
           sample_ptr += bytes_per_sample_;
         }
@@ -523,21 +600,20 @@ absl::Status AudioPacketProcessor::AddAudioDataToBuffer(
       break;
     case AV_SAMPLE_FMT_S16P:
       for (int channel = 0; channel < num_channels_; ++channel) {
-        sample_ptr = reinterpret_cast<const char*>(raw_audio[channel]);
-        for (int64 sample_index = 0; sample_index < num_samples;
-             ++sample_index) {
-          (*current_frame)(channel, sample_index) =
-              PcmEncodedSampleToFloat(sample_ptr);
+        sample_ptr =
+            reinterpret_cast<const char*>(raw_audio[channel]) + planar_offset;
+        for (int64 column = first_column; column < end_column; ++column) {
+          (*output)(channel, column) = PcmEncodedSampleToFloat(sample_ptr);
           sample_ptr += bytes_per_sample_;
         }
       }
       break;
     case AV_SAMPLE_FMT_FLTP:
       for (int channel = 0; channel < num_channels_; ++channel) {
-        sample_ptr = reinterpret_cast<const char*>(raw_audio[channel]);
-        for (int64 sample_index = 0; sample_index < num_samples;
-             ++sample_index) {
-          (*current_frame)(channel, sample_index) =
+        sample_ptr =
+            reinterpret_cast<const char*>(raw_audio[channel]) + planar_offset;
+        for (int64 column = first_column; column < end_column; ++column) {
+          (*output)(channel, column) =
               Uint32ToFloat(absl::little_endian::Load32(sample_ptr));
           sample_ptr += bytes_per_sample_;
         }
@@ -547,11 +623,17 @@ absl::Status AudioPacketProcessor::AddAudioDataToBuffer(
       return mediapipe::UnimplementedErrorBuilder(MEDIAPIPE_LOC)
              << "sample_fmt = " << avcodec_ctx_->sample_fmt;
   }
+  return absl::OkStatus();
+}
 
+void AudioPacketProcessor::OutputAudio(std::unique_ptr<Matrix> audio,
+                                       int64 sample_number) {
+  const Timestamp output_timestamp(
+      av_rescale_q(sample_number, sample_time_base_, output_time_base_));
   if (options_.output_regressing_timestamps() ||
       last_timestamp_ == Timestamp::Unset() ||
       output_timestamp > last_timestamp_) {
-    buffer_.push_back(Adopt(current_frame.release()).At(output_timestamp));
+    buffer_.push_back(Adopt(audio.release()).At(output_timestamp));
     last_timestamp_ = output_timestamp;
     if (last_frame_time_regression_detected_) {
       last_frame_time_regression_detected_ = false;
@@ -564,11 +646,21 @@ absl::Status AudioPacketProcessor::AddAudioDataToBuffer(
                   "regressed.  Was "
                << last_timestamp_ << " but got " << output_timestamp;
   }
-  expected_sample_number_ += num_samples;
+}
 
-  return absl::OkStatus();
+void AudioPacketProcessor::OutputChunk() {
+  if (!chunk_) {
+    return;
+  }
+  if (chunk_num_samples_ < chunk_->cols()) {
+    chunk_->conservativeResize(Eigen::NoChange, chunk_num_samples_);
+  }
+  OutputAudio(std::move(chunk_), chunk_first_sample_);
+  chunk_.reset();
 }
 
+void AudioPacketProcessor::OutputBufferedData() { OutputChunk(); }
+
 absl::Status AudioPacketProcessor::FillHeader(TimeSeriesHeader* header) const {
   CHECK(header);
   header->set_sample_rate(sample_rate_);
@@ -576,12 +668,148 @@ absl::Status AudioPacketProcessor::FillHeader(TimeSeriesHeader* header) const {
   return absl::OkStatus();
 }
 
+void AudioPacketProcessor::SetOutputRange(Timestamp begin, Timestamp end) {
+  CHECK_GT(sample_rate_, 0) << "SetOutputRange called before Open.";
+  // The first samples at or after @begin and @end.
+  if (begin != Timestamp::Min()) {
+    first_output_sample_ =
+        av_rescale_q_rnd(begin.Value(), output_time_base_, sample_time_base_,
+                         AV_ROUND_UP);
+  }
+  if (end != Timestamp::Max()) {
+    end_output_sample_ = av_rescale_q_rnd(end.Value(), output_time_base_,
+                                          sample_time_base_, AV_ROUND_UP);
+  }
+}
+
+bool AudioPacketProcessor::HasOutputRange() const {
+  return first_output_sample_ != std::numeric_limits<int64>::min() ||
+         end_output_sample_ != std::numeric_limits<int64>::max();
+}
+
+bool AudioPacketProcessor::OutputRangeDecoded() const {
+  return num_frames_processed_ > 0 &&
+         expected_sample_number_ >= end_output_sample_;
+}
+
 int64 AudioPacketProcessor::MaybeCorrectPtsForRollover(int64 media_pts) {
   return options_.correct_pts_for_rollover() ? CorrectPtsForRollover(media_pts)
                                              : media_pts;
 }
 
 // AudioDecoder
+namespace {
+
+// Opens @input_file into a new @avformat_ctx and reads its stream information.
+absl::Status OpenInputFile(const std::string& input_file,
+                           AVFormatContext** avformat_ctx) {
+  *avformat_ctx = avformat_alloc_context();
+  if (avformat_open_input(avformat_ctx, input_file.c_str(), NULL, NULL) < 0) {
+    return absl::InvalidArgumentError(
+        absl::StrCat("Could not open file: ", input_file));
+  }
+
+  if (avformat_find_stream_info(*avformat_ctx, NULL) < 0) {
+    return absl::InvalidArgumentError(absl::StrCat(
+        "Could not find stream information of file: ", input_file));
+  }
+  return absl::OkStatus();
+}
+
+// Seeks @avformat_ctx to kSeekPrerollUs before @timestamp.
+absl::Status SeekBefore(AVFormatContext* avformat_ctx, Timestamp timestamp) {
+  // AV_TIME_BASE is in microseconds, as Timestamp.
+  const int64 target = timestamp.Value() - kSeekPrerollUs;
+  if (target <= 0) {
+    return absl::OkStatus();
+  }
+  const int ret = avformat_seek_file(
+      avformat_ctx, -1, std::numeric_limits<int64>::min(), target, target, 0);
+  if (ret < 0) {
+    return UnknownError(absl::StrCat("Failed to seek to ", target,
+                                     " microseconds: ", AvErrorToString(ret)));
+  }
+  return absl::OkStatus();
+}
+
+// Returns true if the processors which are still open have decoded their
+// output range.
+bool OutputRangesDecoded(
+    const std::map<int, std::unique_ptr<AudioPacketProcessor>>& processors) {
+  for (const auto& item : processors) {
+    if (item.second && !item.second->OutputRangeDecoded()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Reads the next packet of @avformat_ctx and processes it with the processor
+// of its stream, if any. Sets @eof once the end of the file is reached. If
+// @is_first_packet is set, it tells whether the streams have been read from,
+// to report failures to read the first packet.
+absl::Status ReadAndProcessPacket(
+    AVFormatContext* avformat_ctx,
+    const std::map<int, std::unique_ptr<AudioPacketProcessor>>& processors,
+    const std::vector<bool>* is_first_packet, bool* eof) {
+  std::unique_ptr<AVPacket, AVPacketDeleter> av_packet(new AVPacket());
+  av_init_packet(av_packet.get());
+  av_packet->size = 0;
+  av_packet->data = nullptr;
+  int ret = av_read_frame(avformat_ctx, av_packet.get());
+  if (ret >= 0) {
+    CHECK(av_packet->data) << "AVPacket does not include any data but "
+                              "av_read_frame was successful.";
+    const int stream_id = av_packet->stream_index;
+    auto audio_iterator = processors.find(stream_id);
+    if (audio_iterator != processors.end()) {
+      // This stream_id is belongs to an audio stream we care about.
+      if (audio_iterator->second) {
+        MP_RETURN_IF_ERROR(
+            audio_iterator->second->ProcessPacket(av_packet.get()));
+      } else {
+        VLOG(3) << "processor for stream " << stream_id << " is nullptr.";
+      }
+    } else {
+      VLOG(3) << "Ignoring packet for stream " << stream_id;
+    }
+    return absl::OkStatus();
+  }
+  VLOG(1) << "Demuxing returned error (or EOF): " << AvErrorToString(ret);
+  if (ret == AVERROR(EAGAIN)) {
+    // EAGAIN is used to signify that the av_packet should be skipped
+    // (maybe the demuxer is trying to re-sync).  This definitely
+    // occurs in the FLV and MpegT demuxers.
+    return absl::OkStatus();
+  }
+
+  // Unrecoverable demuxing error with details in avformat_ctx->pb->error.
+  int demuxing_error =
+      avformat_ctx->pb ? avformat_ctx->pb->error : 0 /* no error */;
+  if (ret == AVERROR_EOF && !demuxing_error) {
+    VLOG(1) << "Reached EOF.";
+    *eof = true;
+    return absl::OkStatus();
+  }
+
+  RET_CHECK(!demuxing_error) << absl::Substitute(
+      "Failed to read a frame: retval = $0 ($1), avformat_ctx_->pb->error = "
+      "$2 ($3)",
+      ret, AvErrorToString(ret), demuxing_error,
+      AvErrorToString(demuxing_error));
+
+  if (is_first_packet && (*is_first_packet)[av_packet->stream_index]) {
+    RET_CHECK_FAIL() << "Couldn't even read the first frame; maybe a partial "
+                        "file with only metadata?";
+  }
+
+  // Unrecoverable demuxing error without details.
+  RET_CHECK_FAIL() << absl::Substitute(
+      "Failed to read a frame: retval = $0 ($1)", ret, AvErrorToString(ret));
+}
+
+}  // namespace
+
 AudioDecoder::AudioDecoder() { av_register_all(); }
 
 AudioDecoder::~AudioDecoder() {
@@ -615,16 +843,7 @@ absl::Status AudioDecoder::Initialize(
     }
   });
 
-  avformat_ctx_ = avformat_alloc_context();
-  if (avformat_open_input(&avformat_ctx_, input_file.c_str(), NULL, NULL) < 0) {
-    return absl::InvalidArgumentError(
-        absl::StrCat("Could not open file: ", input_file));
-  }
-
-  if (avformat_find_stream_info(avformat_ctx_, NULL) < 0) {
-    return absl::InvalidArgumentError(absl::StrCat(
-        "Could not find stream information of file: ", input_file));
-  }
+  MP_RETURN_IF_ERROR(OpenInputFile(input_file, &avformat_ctx_));
 
   std::map<int, int> audio_options_index_to_stream_id;
   for (int current_audio_index = 0, stream_id = 0;
@@ -682,10 +901,92 @@ absl::Status AudioDecoder::Initialize(
   }
   is_first_packet_.resize(avformat_ctx_->nb_streams, true);
 
+  input_file_ = input_file;
+  options_ = options;
+  MP_RETURN_IF_ERROR(InitializeSegments(options));
+  // Chunked and segmented outputs are cut at the start and end times.
+  bool seek_to_start_time = options.num_threads() > 1;
+  for (auto& item : audio_processor_) {
+    const int options_index =
+        FindOrDie(stream_id_to_audio_options_index_, item.first);
+    const bool chunked =
+        options.audio_stream(options_index).output_chunk_samples() > 0;
+    if (num_segments_ > 0 || chunked) {
+      item.second->SetOutputRange(SegmentBegin(0),
+                                  SegmentEnd(std::max(0, num_segments_ - 1)));
+    }
+    seek_to_start_time |= chunked;
+  }
+  // Segments seek on their own. Otherwise only seek in the multithreaded and
+  // chunked modes, so that the default mode decodes the file from its start
+  // as it always did.
+  if (num_segments_ == 0 && seek_to_start_time &&
+      start_time_ != Timestamp::Unset()) {
+    const absl::Status status = SeekBefore(avformat_ctx_, start_time_);
+    if (!status.ok()) {
+      LOG(WARNING) << status.message() << " Decoding from the start.";
+    }
+  }
+
   decoder_closer.release();
   return absl::OkStatus();
 }
 
+absl::Status AudioDecoder::InitializeSegments(
+    const AudioDecoderOptions& options) {
+  RET_CHECK_GE(options.num_threads(), 1);
+  if (options.num_threads() == 1) {
+    return absl::OkStatus();
+  }
+  RET_CHECK_GT(options.segment_duration(), 0.0);
+  if (!avformat_ctx_->pb || !avformat_ctx_->pb->seekable) {
+    LOG(WARNING) << "File \"" << input_file_
+                 << "\" is not seekable, decoding it sequentially.";
+    return absl::OkStatus();
+  }
+  Timestamp end = end_time_;
+  if (end == Timestamp::Unset()) {
+    if (avformat_ctx_->duration == AV_NOPTS_VALUE) {
+      LOG(WARNING) << "Duration of file \"" << input_file_
+                   << "\" is unknown, decoding it sequentially.";
+      return absl::OkStatus();
+    }
+    // AV_TIME_BASE is in microseconds, as Timestamp.
+    end = Timestamp(avformat_ctx_->duration);
+  }
+  segments_begin_ =
+      start_time_ != Timestamp::Unset() ? start_time_ : Timestamp(0);
+  segment_duration_us_ =
+      Timestamp::FromSeconds(options.segment_duration()).Value();
+  const int num_segments = static_cast<int>(
+      (std::max<int64>(0, end.Value() - segments_begin_.Value()) +
+       segment_duration_us_ - 1) /
+      segment_duration_us_);
+  if (num_segments <= 1) {
+    return absl::OkStatus();
+  }
+  num_segments_ = num_segments;
+  thread_pool_ = absl::make_unique<ThreadPool>(
+      "AudioDecoder", std::min(options.num_threads(), num_segments_));
+  thread_pool_->StartWorkers();
+  return absl::OkStatus();
+}
+
+Timestamp AudioDecoder::SegmentBegin(int segment) const {
+  if (segment == 0) {
+    return start_time_ != Timestamp::Unset() ? start_time_ : Timestamp::Min();
+  }
+  return Timestamp(segments_begin_.Value() + segment * segment_duration_us_);
+}
+
+Timestamp AudioDecoder::SegmentEnd(int segment) const {
+  if (segment >= num_segments_ - 1) {
+    // The end time is inclusive.
+    return end_time_ != Timestamp::Unset() ? end_time_ + 1 : Timestamp::Max();
+  }
+  return SegmentBegin(segment + 1);
+}
+
 absl::Status AudioDecoder::GetData(int* options_index, Packet* data) {
   while (true) {
     for (auto& item : audio_processor_) {
@@ -697,7 +998,9 @@ absl::Status AudioDecoder::GetData(int* options_index, Packet* data) {
         absl::Status status = item.second->GetData(data);
         // Ignore packets which are out of the requested timestamp range.
         if (start_time_ != Timestamp::Unset()) {
-          if (is_first_packet && data->Timestamp() > start_time_) {
+          // Output cut at the start time starts at the first sample after it.
+          if (is_first_packet && data->Timestamp() > start_time_ &&
+              !item.second->HasOutputRange()) {
             LOG(ERROR) << "First packet in audio stream " << *options_index
                        << " has timestamp " << data->Timestamp()
                        << " which is after start time of " << start_time_
@@ -730,7 +1033,14 @@ absl::Status AudioDecoder::GetData(int* options_index, Packet* data) {
       MP_RETURN_IF_ERROR(Close());
       return tool::StatusStop();
     }
-    MP_RETURN_IF_ERROR(ProcessPacket());
+    if (num_segments_ > 0) {
+      MP_RETURN_IF_ERROR(DecodeNextSegments());
+    } else if (OutputRangesDecoded(audio_processor_)) {
+      // Nothing left to output, without reading the rest of the file.
+      MP_RETURN_IF_ERROR(Flush());
+    } else {
+      MP_RETURN_IF_ERROR(ProcessPacket());
+    }
   }
   return absl::OkStatus();
 }
@@ -761,59 +1071,10 @@ absl::Status AudioDecoder::FillAudioHeader(
 }
 
 absl::Status AudioDecoder::ProcessPacket() {
-  std::unique_ptr<AVPacket, AVPacketDeleter> av_packet(new AVPacket());
-  av_init_packet(av_packet.get());
-  av_packet->size = 0;
-  av_packet->data = nullptr;
-  int ret = av_read_frame(avformat_ctx_, av_packet.get());
-  if (ret >= 0) {
-    CHECK(av_packet->data) << "AVPacket does not include any data but "
-                              "av_read_frame was successful.";
-    const int stream_id = av_packet->stream_index;
-    auto audio_iterator = audio_processor_.find(stream_id);
-    if (audio_iterator != audio_processor_.end()) {
-      // This stream_id is belongs to an audio stream we care about.
-      if (audio_iterator->second) {
-        MP_RETURN_IF_ERROR(
-            audio_iterator->second->ProcessPacket(av_packet.get()));
-      } else {
-        VLOG(3) << "processor for stream " << stream_id << " is nullptr.";
-      }
-    } else {
-      VLOG(3) << "Ignoring packet for stream " << stream_id;
-    }
-    return absl::OkStatus();
-  }
-  VLOG(1) << "Demuxing returned error (or EOF): " << AvErrorToString(ret);
-  if (ret == AVERROR(EAGAIN)) {
-    // EAGAIN is used to signify that the av_packet should be skipped
-    // (maybe the demuxer is trying to re-sync).  This definitely
-    // occurs in the FLV and MpegT demuxers.
-    return absl::OkStatus();
-  }
-
-  // Unrecoverable demuxing error with details in avformat_ctx_->pb->error.
-  int demuxing_error =
-      avformat_ctx_->pb ? avformat_ctx_->pb->error : 0 /* no error */;
-  if (ret == AVERROR_EOF && !demuxing_error) {
-    VLOG(1) << "Reached EOF.";
-    return Flush();
-  }
-
-  RET_CHECK(!demuxing_error) << absl::Substitute(
-      "Failed to read a frame: retval = $0 ($1), avformat_ctx_->pb->error = "
-      "$2 ($3)",
-      ret, AvErrorToString(ret), demuxing_error,
-      AvErrorToString(demuxing_error));
-
-  if (is_first_packet_[av_packet->stream_index]) {
-    RET_CHECK_FAIL() << "Couldn't even read the first frame; maybe a partial "
-                        "file with only metadata?";
-  }
-
-  // Unrecoverable demuxing error without details.
-  RET_CHECK_FAIL() << absl::Substitute(
-      "Failed to read a frame: retval = $0 ($1)", ret, AvErrorToString(ret));
+  bool eof = false;
+  MP_RETURN_IF_ERROR(ReadAndProcessPacket(avformat_ctx_, audio_processor_,
+                                          &is_first_packet_, &eof));
+  return eof ? Flush() : absl::OkStatus();
 }
 
 absl::Status AudioDecoder::Flush() {
@@ -827,4 +1088,87 @@ absl::Status AudioDecoder::Flush() {
   return tool::CombinedStatus("Error while flushing codecs: ", statuses);
 }
 
+absl::Status AudioDecoder::DecodeNextSegments() {
+  const int first_segment = next_segment_;
+  const int num_segments =
+      std::min(thread_pool_->num_threads(), num_segments_ - first_segment);
+  std::vector<std::map<int, std::unique_ptr<AudioPacketProcessor>>> processors(
+      num_segments);
+  std::vector<absl::Status> statuses(num_segments);
+  absl::BlockingCounter counter(num_segments);
+  for (int i = 0; i < num_segments; ++i) {
+    thread_pool_->Schedule([this, first_segment, i, &processors, &statuses,
+                            &counter]() {
+      statuses[i] = DecodeSegment(first_segment + i, &processors[i]);
+      counter.DecrementCount();
+    });
+  }
+  counter.Wait();
+
+  for (int i = 0; i < num_segments; ++i) {
+    if (!statuses[i].ok()) {
+      return mediapipe::StatusBuilder(std::move(statuses[i]), MEDIAPIPE_LOC)
+                 .SetPrepend()
+             << "Segment " << first_segment + i << " of file \""
+             << input_file_ << "\": ";
+    }
+  }
+  // Stitches the segments in order.
+  for (int i = 0; i < num_segments; ++i) {
+    for (auto& item : processors[i]) {
+      auto& output = audio_processor_[item.first];
+      if (output) {
+        output->TakeData(item.second.get());
+      }
+    }
+  }
+  next_segment_ = first_segment + num_segments;
+  if (next_segment_ == num_segments_) {
+    flushed_ = true;
+  }
+  return absl::OkStatus();
+}
+
+absl::Status AudioDecoder::DecodeSegment(
+    int segment,
+    std::map<int, std::unique_ptr<AudioPacketProcessor>>* processors) const {
+  AVFormatContext* avformat_ctx = nullptr;
+  auto avformat_closer = MakeCleanup([&avformat_ctx]() {
+    if (avformat_ctx) {
+      avformat_close_input(&avformat_ctx);
+    }
+  });
+  MP_RETURN_IF_ERROR(OpenInputFile(input_file_, &avformat_ctx));
+
+  const Timestamp begin = SegmentBegin(segment);
+  const Timestamp end = SegmentEnd(segment);
+  for (const auto& item : stream_id_to_audio_options_index_) {
+    const auto output = audio_processor_.find(item.first);
+    if (output == audio_processor_.end() || !output->second) {
+      continue;
+    }
+    RET_CHECK_LT(item.first, avformat_ctx->nb_streams);
+    auto processor = absl::make_unique<AudioPacketProcessor>(
+        options_.audio_stream(item.second));
+    MP_RETURN_IF_ERROR(
+        processor->Open(item.first, avformat_ctx->streams[item.first]));
+    processor->SetOutputRange(begin, end);
+    processors->emplace(item.first, std::move(processor));
+  }
+
+  if (begin != Timestamp::Min()) {
+    MP_RETURN_IF_ERROR(SeekBefore(avformat_ctx, begin));
+  }
+  bool eof = false;
+  while (!eof && !OutputRangesDecoded(*processors)) {
+    MP_RETURN_IF_ERROR(
+        ReadAndProcessPacket(avformat_ctx, *processors, nullptr, &eof));
+  }
+  std::vector<absl::Status> statuses;
+  for (auto& item : *processors) {
+    statuses.push_back(item.second->Flush());
+  }
+  return tool::CombinedStatus("Error while flushing codecs: ", statuses);
+}
+
 }  // namespace mediapipe
@@ -17,15 +17,20 @@
 
 #include <cstdint>  // required by avutil.h
 #include <deque>
+#include <limits>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/time/time.h"
+#include "mediapipe/framework/formats/matrix.h"
 #include "mediapipe/framework/formats/time_series_header.pb.h"
 #include "mediapipe/framework/packet.h"
 #include "mediapipe/framework/port/integral_types.h"
 #include "mediapipe/framework/port/status.h"
+#include "mediapipe/framework/port/threadpool.h"
 #include "mediapipe/framework/timestamp.h"
 #include "mediapipe/util/audio_decoder.pb.h"
 
@@ -63,6 +68,10 @@ class BasePacketProcessor {
   // if there is nothing to return.
   absl::Status GetData(Packet* packet);
 
+  // Moves the frames of data of @other to the end of the frames of data of
+  // this processor.
+  void TakeData(BasePacketProcessor* other);
+
   // Once no more AVPackets are available in the file, each stream must
   // be flushed to get any remaining frames which the codec is buffering.
   absl::Status Flush();
@@ -80,6 +89,9 @@ class BasePacketProcessor {
   // Processes a decoded frame.
   virtual absl::Status ProcessDecodedFrame(const AVPacket& packet) = 0;
 
+  // Outputs the data held back by the processor, once the codec is flushed.
+  virtual void OutputBufferedData() {}
+
   // Corrects the given PTS for MPEG PTS rollover. Assumed to be called with
   // the PTS of each frame in decode order. We detect a rollover whenever the
   // PTS timestamp changes by more than 2^33/2 (half the timestamp space). For
@@ -138,12 +150,39 @@ class AudioPacketProcessor : public BasePacketProcessor {
 
   absl::Status FillHeader(TimeSeriesHeader* header) const;
 
+  // Only outputs the samples with a timestamp in [begin, end). Timestamp::Min()
+  // and Timestamp::Max() leave the range open. Must be called after Open().
+  void SetOutputRange(Timestamp begin, Timestamp end);
+
+  // Returns true if an output range was set.
+  bool HasOutputRange() const;
+
+  // Returns true if all the samples before the end of the output range have
+  // been decoded.
+  bool OutputRangeDecoded() const;
+
  private:
-  // Appends audio in buffer(s) to the output buffer (buffer_).
-  absl::Status AddAudioDataToBuffer(const Timestamp output_timestamp,
+  // Appends audio in buffer(s), starting at @sample_number, to the output
+  // buffer (buffer_).
+  absl::Status AddAudioDataToBuffer(int64 sample_number,
                                     uint8* const* raw_audio,
                                     int buf_size_bytes);
 
+  // Converts @num_samples samples of @raw_audio, starting at @first_sample,
+  // into the columns of @output starting at @first_column.
+  absl::Status ConvertSamples(uint8* const* raw_audio, int64 first_sample,
+                              int64 num_samples, Matrix* output,
+                              int64 first_column) const;
+
+  // Appends @audio, starting at @sample_number, to the output buffer unless
+  // its timestamp regressed.
+  void OutputAudio(std::unique_ptr<Matrix> audio, int64 sample_number);
+
+  // Outputs the chunk being filled, if any.
+  void OutputChunk();
+
+  void OutputBufferedData() override;
+
   // Converts a number of samples into an approximate stream timestamp value.
   int64 SampleNumberToTimestamp(const int64 sample_number);
   int64 TimestampToSampleNumber(const int64 timestamp);
@@ -182,6 +221,17 @@ class AudioPacketProcessor : public BasePacketProcessor {
   // The expected sample number based on counting samples.
   int64 expected_sample_number_ = 0;
 
+  // The range [first_output_sample_, end_output_sample_) of sample numbers
+  // to output.
+  int64 first_output_sample_ = std::numeric_limits<int64>::min();
+  int64 end_output_sample_ = std::numeric_limits<int64>::max();
+
+  // The chunk being filled, for output_chunk_samples > 0, its first sample
+  // number and its number of samples so far.
+  std::unique_ptr<Matrix> chunk_;
+  int64 chunk_first_sample_ = 0;
+  int64 chunk_num_samples_ = 0;
+
   // Options for the processor.
   AudioStreamOptions options_;
 };
@@ -208,6 +258,23 @@ class AudioDecoder {
   absl::Status ProcessPacket();
   absl::Status Flush();
 
+  // Splits the time range to decode into segments to decode in parallel, if
+  // requested and possible.
+  absl::Status InitializeSegments(const AudioDecoderOptions& options);
+
+  // Returns the time range [begin, end) of @segment.
+  Timestamp SegmentBegin(int segment) const;
+  Timestamp SegmentEnd(int segment) const;
+
+  // Decodes the next segments in parallel, and appends their data to the
+  // output of audio_processor_.
+  absl::Status DecodeNextSegments();
+
+  // Decodes @segment from a new context of the file, with @processors.
+  absl::Status DecodeSegment(
+      int segment,
+      std::map<int, std::unique_ptr<AudioPacketProcessor>>* processors) const;
+
   std::map<int, int> stream_id_to_audio_options_index_;
   std::map<int, int> stream_index_to_stream_id_;
   std::map<int, std::unique_ptr<AudioPacketProcessor>> audio_processor_;
@@ -221,6 +288,17 @@ class AudioDecoder {
   Timestamp end_time_ = Timestamp::Unset();
 
   AVFormatContext* avformat_ctx_ = nullptr;
+
+  // For segment-parallel decoding: the file, the options of its audio
+  // streams, and the segments. num_segments_ is 0 if the file is decoded
+  // sequentially.
+  std::string input_file_;
+  AudioDecoderOptions options_;
+  int num_segments_ = 0;
+  int next_segment_ = 0;
+  Timestamp segments_begin_ = Timestamp::Unset();
+  int64 segment_duration_us_ = 0;
+  std::unique_ptr<ThreadPool> thread_pool_;
 };
 
 }  // namespace mediapipe
@@ -13,6 +13,9 @@ typedef std::function<absl::Status(const std::string&, std::string*)>
 // Overrides the behavior of GetResourceContents.
 void SetCustomGlobalResourceProvider(ResourceProviderFn fn);
 
+// Returns true if a custom resource provider has been set.
+bool HasCustomGlobalResourceProvider();
+
 }  // namespace mediapipe
 
 #endif  // MEDIAPIPE_UTIL_RESOURCE_UTIL_CUSTOM_H_
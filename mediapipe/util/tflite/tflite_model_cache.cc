@@ -0,0 +1,195 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mediapipe/util/tflite/tflite_model_cache.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/hash/hash.h"
+#include "absl/status/status.h"
+#include "absl/strings/str_cat.h"
+#include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/framework/port/status_macros.h"
+
+namespace mediapipe {
+namespace {
+
+TfLiteModelCache::FileIdentity GetIdentityFromStat(const struct stat& stat,
+                                                   int64_t offset,
+                                                   int64_t length) {
+  TfLiteModelCache::FileIdentity file;
+  file.device = stat.st_dev;
+  file.inode = stat.st_ino;
+#if defined(__APPLE__)
+  file.modification_time_ns =
+      stat.st_mtimespec.tv_sec * int64_t{1000000000} +
+      stat.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+  file.modification_time_ns =
+      stat.st_mtim.tv_sec * int64_t{1000000000} + stat.st_mtim.tv_nsec;
+#else
+  file.modification_time_ns = stat.st_mtime * int64_t{1000000000};
+#endif
+  file.size = stat.st_size;
+  file.offset = offset;
+  file.length = length;
+  return file;
+}
+
+}  // namespace
+
+struct TfLiteModelCache::Entry {
+  // Keeps the content of the model alive for as long as |model| refers to it.
+  std::shared_ptr<const void> content_owner;
+  // The content of the model, for the entries of GetOrBuildModel() only.
+  absl::string_view content;
+  std::unique_ptr<tflite::FlatBufferModel> model;
+};
+
+/* static */
+TfLiteModelCache& TfLiteModelCache::GetInstance() {
+  static TfLiteModelCache* instance = new TfLiteModelCache();
+  return *instance;
+}
+
+/* static */
+api2::Packet<TfLiteModelPtr> TfLiteModelCache::MakeModelPacket(
+    std::shared_ptr<Entry> entry) {
+  tflite::FlatBufferModel* model = entry->model.get();
+  // The model is owned by the entry: the packet only drops its reference.
+  return api2::MakePacket<TfLiteModelPtr>(
+      model, [entry = std::move(entry)](tflite::FlatBufferModel*) {});
+}
+
+/* static */
+absl::StatusOr<TfLiteModelCache::FileIdentity>
+TfLiteModelCache::GetFileIdentity(const std::string& path) {
+  struct stat file_stat;
+  if (stat(path.c_str(), &file_stat) != 0) {
+    return absl::NotFoundError(
+        absl::StrCat("Unable to stat ", path, ": ", strerror(errno)));
+  }
+  return GetIdentityFromStat(file_stat, /*offset=*/0, /*length=*/0);
+}
+
+/* static */
+absl::StatusOr<TfLiteModelCache::FileIdentity>
+TfLiteModelCache::GetFileIdentity(int fd, int64_t offset, int64_t length) {
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0) {
+    return absl::NotFoundError(absl::StrCat("Unable to stat file descriptor ",
+                                            fd, ": ", strerror(errno)));
+  }
+  return GetIdentityFromStat(file_stat, offset, length);
+}
+
+std::shared_ptr<TfLiteModelCache::Entry> TfLiteModelCache::FindEntry(
+    const std::string& key) {
+  auto it = entries_.find(key);
+  if (it == entries_.end()) {
+    return nullptr;
+  }
+  std::shared_ptr<Entry> entry = it->second.lock();
+  if (entry == nullptr) {
+    entries_.erase(it);
+  }
+  return entry;
+}
+
+absl::StatusOr<api2::Packet<TfLiteModelPtr>>
+TfLiteModelCache::GetOrBuildModelFromFile(const FileIdentity& file,
+                                          FileModelBuilder build_model) {
+  const std::string key =
+      absl::StrCat("file#", file.device, "#", file.inode, "#",
+                   file.modification_time_ns, "#", file.size, "#",
+                   file.offset, "#", file.length);
+  {
+    absl::MutexLock lock(&mutex_);
+    std::shared_ptr<Entry> entry = FindEntry(key);
+    if (entry != nullptr) {
+      return MakeModelPacket(std::move(entry));
+    }
+  }
+
+  // Builds outside of the lock, as in GetOrBuildModel().
+  auto entry = std::make_shared<Entry>();
+  ASSIGN_OR_RETURN(entry->model, build_model(&entry->content_owner));
+  RET_CHECK(entry->model) << "Failed to build model";
+
+  absl::MutexLock lock(&mutex_);
+  std::shared_ptr<Entry> existing = FindEntry(key);
+  if (existing != nullptr) {
+    // Another graph built the same model concurrently.
+    return MakeModelPacket(std::move(existing));
+  }
+  entries_[key] = entry;
+  return MakeModelPacket(std::move(entry));
+}
+
+absl::StatusOr<api2::Packet<TfLiteModelPtr>> TfLiteModelCache::GetOrBuildModel(
+    absl::string_view path, absl::string_view content,
+    std::shared_ptr<const void> content_owner, ModelBuilder build_model) {
+  const std::string key =
+      absl::StrCat("content#", path, "#", content.size(), "#",
+                   absl::Hash<absl::string_view>{}(content));
+  {
+    absl::MutexLock lock(&mutex_);
+    std::shared_ptr<Entry> entry = FindEntry(key);
+    if (entry != nullptr && entry->content == content) {
+      return MakeModelPacket(std::move(entry));
+    }
+  }
+
+  // Builds outside of the lock, so that loading one model doesn't stall the
+  // graphs loading other ones.
+  auto entry = std::make_shared<Entry>();
+  ASSIGN_OR_RETURN(entry->model, build_model());
+  RET_CHECK(entry->model) << "Failed to build model " << path;
+  entry->content_owner = std::move(content_owner);
+  entry->content = content;
+
+  absl::MutexLock lock(&mutex_);
+  std::weak_ptr<Entry>& cached = entries_[key];
+  std::shared_ptr<Entry> existing = cached.lock();
+  if (existing != nullptr) {
+    // Another graph built the same model concurrently (or a hash collision
+    // with a different model, which is then left uncached).
+    if (existing->content == content) {
+      return MakeModelPacket(std::move(existing));
+    }
+  } else {
+    cached = entry;
+  }
+  return MakeModelPacket(std::move(entry));
+}
+
+int TfLiteModelCache::NumCachedModels() {
+  absl::MutexLock lock(&mutex_);
+  for (auto it = entries_.begin(); it != entries_.end();) {
+    if (it->second.expired()) {
+      entries_.erase(it++);
+    } else {
+      ++it;
+    }
+  }
+  return entries_.size();
+}
+
+}  // namespace mediapipe
@@ -0,0 +1,139 @@
+// Copyright 2022 The MediaPipe Authors.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef MEDIAPIPE_UTIL_TFLITE_TFLITE_MODEL_CACHE_H_
+#define MEDIAPIPE_UTIL_TFLITE_TFLITE_MODEL_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/functional/function_ref.h"
+#include "absl/status/statusor.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/api2/packet.h"
+#include "tensorflow/lite/model.h"
+
+namespace mediapipe {
+
+// Represents a TfLite model as a FlatBuffer.
+using TfLiteModelPtr =
+    std::unique_ptr<tflite::FlatBufferModel,
+                    std::function<void(tflite::FlatBufferModel*)>>;
+
+// Process-wide cache of read-only TfLite models, keyed by the identity of the
+// model file (see FileIdentity), or by path and content hash for models that
+// don't come from a file.
+//
+// A FlatBufferModel is immutable once built, so every graph running the same
+// model can share one instance (and the one buffer it was built from) rather
+// than each holding its own copy. Entries are reference counted: a model stays
+// cached as long as at least one packet returned for it is alive, and is
+// released together with its buffer when the last one goes away.
+//
+// Example:
+//   ASSIGN_OR_RETURN(auto file, TfLiteModelCache::GetFileIdentity(path));
+//   ASSIGN_OR_RETURN(
+//       auto model,
+//       TfLiteModelCache::GetInstance().GetOrBuildModelFromFile(
+//           file, [&](std::shared_ptr<const void>* content_owner) {
+//             return MapAndBuildModel(path, content_owner);
+//           }));
+class TfLiteModelCache {
+ public:
+  // Identifies the content of a model file without reading it: a file that is
+  // replaced, or modified in place, gets a new identity. For a file descriptor
+  // with an offset and length, only that region is identified.
+  struct FileIdentity {
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t modification_time_ns = 0;
+    int64_t size = 0;
+    int64_t offset = 0;
+    int64_t length = 0;
+  };
+
+  // Builds a model from the content passed to GetOrBuildModel().
+  using ModelBuilder = absl::FunctionRef<
+      absl::StatusOr<std::unique_ptr<tflite::FlatBufferModel>>()>;
+
+  // Reads a model file and builds a model from its content, which
+  // |content_owner| must be set to keep alive.
+  using FileModelBuilder = absl::FunctionRef<
+      absl::StatusOr<std::unique_ptr<tflite::FlatBufferModel>>(
+          std::shared_ptr<const void>* content_owner)>;
+
+  // Returns the identity of the file at |path|, with stat(2).
+  static absl::StatusOr<FileIdentity> GetFileIdentity(const std::string& path);
+
+  // Returns the identity of the region of |length| bytes at |offset| (or up
+  // to the end of the file if |length| is 0) of the file open as |fd|, with
+  // fstat(2).
+  static absl::StatusOr<FileIdentity> GetFileIdentity(int fd, int64_t offset,
+                                                      int64_t length);
+
+  // Returns the process-wide cache instance.
+  static TfLiteModelCache& GetInstance();
+
+  TfLiteModelCache() = default;
+  TfLiteModelCache(const TfLiteModelCache&) = delete;
+  TfLiteModelCache& operator=(const TfLiteModelCache&) = delete;
+
+  // Returns a packet with the cached model for |path| whose flatbuffer has the
+  // same bytes as |content|, or builds the model with |build_model| and caches
+  // it if there is none.
+  //
+  // |content_owner| must keep |content| alive; it is retained with the model
+  // when the model is built from |content|, and released otherwise. |path| may
+  // be empty for models that don't come from a file.
+  absl::StatusOr<api2::Packet<TfLiteModelPtr>> GetOrBuildModel(
+      absl::string_view path, absl::string_view content,
+      std::shared_ptr<const void> content_owner, ModelBuilder build_model);
+
+  // Returns a packet with the cached model for the file identified by |file|,
+  // or builds the model with |build_model| and caches it if there is none. The
+  // file is only read by |build_model|, i.e. not at all on a cache hit.
+  //
+  // Callers applying their own checks to the model (e.g. op resolver support)
+  // must apply them to the returned model, as it may have been built by
+  // another caller.
+  absl::StatusOr<api2::Packet<TfLiteModelPtr>> GetOrBuildModelFromFile(
+      const FileIdentity& file, FileModelBuilder build_model);
+
+  // Returns the number of distinct models currently alive in the cache.
+  int NumCachedModels() ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct Entry;
+
+  // Returns a packet sharing the ownership of |entry|.
+  static api2::Packet<TfLiteModelPtr> MakeModelPacket(
+      std::shared_ptr<Entry> entry);
+
+  // Returns the live entry cached for |key|, or nullptr.
+  std::shared_ptr<Entry> FindEntry(const std::string& key)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, std::weak_ptr<Entry>> entries_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace mediapipe
+
+#endif  // MEDIAPIPE_UTIL_TFLITE_TFLITE_MODEL_CACHE_H_
@@ -14,38 +14,102 @@
 
 #include "mediapipe/util/tflite/tflite_model_loader.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
 #include "mediapipe/framework/port/ret_check.h"
+#include "mediapipe/tasks/cc/core/external_file_handler.h"
+#include "mediapipe/tasks/cc/core/proto/external_file.pb.h"
 #include "mediapipe/util/resource_util.h"
+#include "mediapipe/util/resource_util_custom.h"
 
 namespace mediapipe {
+namespace {
 
-absl::StatusOr<api2::Packet<TfLiteModelPtr>> TfLiteModelLoader::LoadFromPath(
+using ::mediapipe::tasks::core::ExternalFileHandler;
+using ::mediapipe::tasks::core::proto::ExternalFile;
+
+// A model file mapped into memory. The mapping is read-only and backed by the
+// page cache, so it is shared with any other process mapping the same file.
+struct MappedModelFile {
+  ExternalFile file;
+  std::unique_ptr<ExternalFileHandler> handler;
+};
+
+absl::StatusOr<std::shared_ptr<MappedModelFile>> MapModelFile(
     const std::string& path) {
-  std::string model_path = path;
+  auto mapped_file = std::make_shared<MappedModelFile>();
+  mapped_file->file.set_file_name(path);
+  ASSIGN_OR_RETURN(mapped_file->handler,
+                   ExternalFileHandler::CreateFromExternalFile(
+                       &mapped_file->file));
+  return mapped_file;
+}
 
-  std::string model_blob;
+absl::StatusOr<std::shared_ptr<std::string>> ReadModelFile(
+    const std::string& path) {
+  auto model_blob = std::make_shared<std::string>();
   auto status_or_content =
-      mediapipe::GetResourceContents(model_path, &model_blob);
+      mediapipe::GetResourceContents(path, model_blob.get());
   // TODO: get rid of manual resolving with PathToResourceAsFile
   // as soon as it's incorporated into GetResourceContents.
   if (!status_or_content.ok()) {
     ASSIGN_OR_RETURN(auto resolved_path,
-                     mediapipe::PathToResourceAsFile(model_path));
+                     mediapipe::PathToResourceAsFile(path));
     VLOG(2) << "Loading the model from " << resolved_path;
     MP_RETURN_IF_ERROR(
-        mediapipe::GetResourceContents(resolved_path, &model_blob));
+        mediapipe::GetResourceContents(resolved_path, model_blob.get()));
   }
+  return model_blob;
+}
 
+absl::StatusOr<std::unique_ptr<tflite::FlatBufferModel>> BuildModel(
+    absl::string_view content, const std::string& path) {
   auto model = tflite::FlatBufferModel::VerifyAndBuildFromBuffer(
-      model_blob.data(), model_blob.size());
-  RET_CHECK(model) << "Failed to load model from path " << model_path;
-  return api2::MakePacket<TfLiteModelPtr>(
-      model.release(),
-      [model_blob = std::move(model_blob)](tflite::FlatBufferModel* model) {
-        // It's required that model_blob is deleted only after
-        // model is deleted, hence capturing model_blob.
-        delete model;
-      });
+      content.data(), content.size());
+  RET_CHECK(model) << "Failed to load model from path " << path;
+  return model;
+}
+
+}  // namespace
+
+absl::StatusOr<api2::Packet<TfLiteModelPtr>> TfLiteModelLoader::LoadFromPath(
+    const std::string& path) {
+  std::string model_path = path;
+
+  // A custom resource provider may serve paths that aren't files, in which
+  // case its contents are used as before.
+  if (!HasCustomGlobalResourceProvider()) {
+    auto file = TfLiteModelCache::GetFileIdentity(model_path);
+    if (!file.ok()) {
+      auto resolved_path = mediapipe::PathToResourceAsFile(model_path);
+      if (resolved_path.ok()) {
+        file = TfLiteModelCache::GetFileIdentity(*resolved_path);
+        if (file.ok()) model_path = *resolved_path;
+      }
+    }
+    if (file.ok()) {
+      // The file is only mapped and verified when it isn't cached yet.
+      return TfLiteModelCache::GetInstance().GetOrBuildModelFromFile(
+          *file,
+          [&](std::shared_ptr<const void>* content_owner)
+              -> absl::StatusOr<std::unique_ptr<tflite::FlatBufferModel>> {
+            ASSIGN_OR_RETURN(auto mapped_file, MapModelFile(model_path));
+            absl::string_view content = mapped_file->handler->GetFileContent();
+            *content_owner = std::move(mapped_file);
+            return BuildModel(content, model_path);
+          });
+    }
+    VLOG(2) << "Unable to stat " << model_path << ": " << file.status();
+  }
+
+  ASSIGN_OR_RETURN(auto model_blob, ReadModelFile(model_path));
+  absl::string_view content = *model_blob;
+  return TfLiteModelCache::GetInstance().GetOrBuildModel(
+      model_path, content, std::move(model_blob),
+      [&]() { return BuildModel(content, model_path); });
 }
 
 }  // namespace mediapipe
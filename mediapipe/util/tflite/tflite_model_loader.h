@@ -18,18 +18,20 @@
 #include "mediapipe/framework/api2/packet.h"
 #include "mediapipe/framework/port/status.h"
 #include "mediapipe/framework/port/statusor.h"
+#include "mediapipe/util/tflite/tflite_model_cache.h"
 #include "tensorflow/lite/model.h"
 
 namespace mediapipe {
-// Represents a TfLite model as a FlatBuffer.
-using TfLiteModelPtr =
-    std::unique_ptr<tflite::FlatBufferModel,
-                    std::function<void(tflite::FlatBufferModel*)>>;
 
 class TfLiteModelLoader {
  public:
   // Returns a Packet containing a TfLiteModelPtr, pointing to a model loaded
   // from the specified file path.
+  //
+  // The file is memory-mapped when it can be resolved to a file on disk, and
+  // read into memory otherwise (e.g. for Android assets). The model is shared
+  // through the TfLiteModelCache, so loading the same model from several
+  // graphs returns the same read-only instance.
   static absl::StatusOr<api2::Packet<TfLiteModelPtr>> LoadFromPath(
       const std::string& path);
 };
@@ -14,6 +14,13 @@
 
 #include "mediapipe/util/tracking/parallel_invoker.h"
 
+#include <algorithm>
+#include <utility>
+
+#if defined(PARALLEL_INVOKER_ACTIVE)
+#include "mediapipe/framework/executor.h"
+#endif
+
 // Choose between ThreadPool, OpenMP and serial execution.
 // Note only one parallel_using_* directive can be active.
 int flags_parallel_invoker_mode = PARALLEL_INVOKER_MAX_VALUE;
@@ -31,6 +38,71 @@ ThreadPool* ParallelInvokerThreadPool() {
   }();
   return pool;
 }
+
+void ScheduleParallelInvokerTask(std::function<void()> task) {
+  Executor* executor = Executor::Current();
+  if (executor != nullptr) {
+    executor->Schedule(std::move(task));
+  } else {
+    ParallelInvokerThreadPool()->Schedule(std::move(task));
+  }
+}
+
+namespace {
+
+thread_local bool in_parallel_invoker_loop = false;
+
+}  // namespace
+
+ParallelInvokerLoopScope::ParallelInvokerLoopScope()
+    : saved_(in_parallel_invoker_loop) {
+  in_parallel_invoker_loop = true;
+}
+
+ParallelInvokerLoopScope::~ParallelInvokerLoopScope() {
+  in_parallel_invoker_loop = saved_;
+}
+
+bool ParallelInvokerLoopScope::InLoop() { return in_parallel_invoker_loop; }
+
+ParallelInvokerExecutorLoop::ParallelInvokerExecutorLoop(
+    const BlockedRange& range, int num_threads)
+    : range_(range) {
+  const int num_iterations = range.end() - range.begin();
+  const int max_blocks = std::max(num_threads, 1) * kBlocksPerThread;
+  block_size_ = std::max(std::max(range.grain_size(), 1),
+                         (num_iterations + max_blocks - 1) / max_blocks);
+  num_blocks_ = (num_iterations + block_size_ - 1) / block_size_;
+}
+
+bool ParallelInvokerExecutorLoop::ClaimBlock(BlockedRange* block) {
+  // Do not increment past num_blocks_, so that late helper tasks cannot
+  // overflow the counter.
+  int index = next_block_.load(std::memory_order_relaxed);
+  do {
+    if (index >= num_blocks_) {
+      return false;
+    }
+  } while (!next_block_.compare_exchange_weak(index, index + 1,
+                                              std::memory_order_relaxed));
+  const int begin = range_.begin() + index * block_size_;
+  *block = BlockedRange(begin, std::min(range_.end(), begin + block_size_),
+                        range_.grain_size());
+  return true;
+}
+
+void ParallelInvokerExecutorLoop::BlockDone() {
+  if (num_blocks_done_.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+      num_blocks_) {
+    absl::MutexLock lock(&mutex_);
+    done_ = true;
+  }
+}
+
+void ParallelInvokerExecutorLoop::WaitUntilDone() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(&done_));
+}
 #endif
 
 }  // namespace mediapipe
@@ -69,6 +69,9 @@
 
 #include <stddef.h>
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
 
 #include "absl/synchronization/mutex.h"
@@ -90,7 +93,8 @@ enum PARALLEL_INVOKER_MODE {
   PARALLEL_INVOKER_THREAD_POOL = 1,  // Uses //thread/threadpool
   PARALLEL_INVOKER_OPENMP = 2,       // Uses OpenMP (requires compiler support)
   PARALLEL_INVOKER_GCD = 3,          // Uses GCD (Apple)
-  PARALLEL_INVOKER_MAX_VALUE = 4,    // Increase when adding more modes
+  PARALLEL_INVOKER_EXECUTOR = 4,     // Uses the executor of the calculator
+  PARALLEL_INVOKER_MAX_VALUE = 5,    // Increase when adding more modes
 };
 
 extern int flags_parallel_invoker_mode;
@@ -140,6 +144,121 @@ class BlockedRange2D {
 // Singleton ThreadPool for parallel invoker.
 ThreadPool* ParallelInvokerThreadPool();
 
+// In PARALLEL_INVOKER_EXECUTOR mode, the iterations are scheduled on the
+// executor of the calculator calling ParallelFor (see Executor::Current()),
+// so that they share the threads of the graph instead of competing with them
+// for the cores. Outside of a calculator, the ParallelInvokerThreadPool() is
+// used instead.
+//
+// The range is split into blocks of at least grain_size iterations, which
+// are claimed one at a time by the calling thread and up to
+// flags_parallel_invoker_max_threads - 1 helper tasks, so that the blocks are
+// balanced across the threads that are actually available. As the calling
+// thread runs all the blocks that no helper task has claimed, the loop never
+// waits on an executor busy with other calculators, nor on a helper task
+// queued behind the calling task itself. A ParallelFor or ParallelFor2D
+// called by an iteration of such a loop runs serially.
+
+// Schedules `task` on Executor::Current(), or on the
+// ParallelInvokerThreadPool() if the calling thread is not running a task of
+// an executor.
+void ScheduleParallelInvokerTask(std::function<void()> task);
+
+// RAII helper marking the calling thread as running the iterations of a loop
+// in PARALLEL_INVOKER_EXECUTOR mode, in the current scope.
+class ParallelInvokerLoopScope {
+ public:
+  ParallelInvokerLoopScope();
+  ~ParallelInvokerLoopScope();
+
+  // Returns true if the calling thread is running the iterations of a loop.
+  static bool InLoop();
+
+ private:
+  bool saved_;
+};
+
+// Shared state of a loop in PARALLEL_INVOKER_EXECUTOR mode. It outlives the
+// ParallelFor call, as helper tasks can run after all blocks are done.
+class ParallelInvokerExecutorLoop {
+ public:
+  // Splits `range` into num_blocks blocks for up to num_threads threads.
+  ParallelInvokerExecutorLoop(const BlockedRange& range, int num_threads);
+
+  int num_blocks() const { return num_blocks_; }
+
+  // Claims the next block of the loop into `block`. Returns false if all
+  // blocks have been claimed.
+  bool ClaimBlock(BlockedRange* block);
+
+  // Marks a claimed block as done.
+  void BlockDone();
+
+  // Blocks until all blocks of the loop are done.
+  void WaitUntilDone();
+
+ private:
+  // Number of blocks per thread. Over-partitioning lets threads that start
+  // late or run faster take over the blocks of the others.
+  static constexpr int kBlocksPerThread = 4;
+
+  const BlockedRange range_;
+  int block_size_;
+  int num_blocks_;
+  std::atomic<int> next_block_{0};
+  std::atomic<int> num_blocks_done_{0};
+  absl::Mutex mutex_;
+  bool done_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// Runs run_block(invoker, block) for all blocks of `range` as described
+// above. Helper tasks run the blocks with their local copy of invoker.
+template <class Invoker, class RunBlock>
+void ParallelForOnExecutor(const BlockedRange& range, const Invoker& invoker,
+                           const RunBlock& run_block) {
+  if (ParallelInvokerLoopScope::InLoop()) {
+    // Nested loop, execute invoker serially.
+    run_block(invoker, range);
+    return;
+  }
+  auto loop = std::make_shared<ParallelInvokerExecutorLoop>(
+      range, flags_parallel_invoker_max_threads);
+  if (loop->num_blocks() == 1) {
+    // Execute invoker serially.
+    run_block(invoker, range);
+    return;
+  }
+
+  const int num_helpers =
+      std::min(loop->num_blocks(), flags_parallel_invoker_max_threads) - 1;
+  for (int i = 0; i < num_helpers; ++i) {
+    // invoker and run_block are only accessed while a block is claimed and
+    // not done, i.e. while the calling thread waits for the loop.
+    ScheduleParallelInvokerTask([loop, &invoker, &run_block]() {
+      BlockedRange block(0, 0, 1);
+      if (!loop->ClaimBlock(&block)) {
+        return;
+      }
+      const Invoker local_invoker(invoker);
+      ParallelInvokerLoopScope loop_scope;
+      do {
+        run_block(local_invoker, block);
+        loop->BlockDone();
+      } while (loop->ClaimBlock(&block));
+    });
+  }
+
+  {
+    ParallelInvokerLoopScope loop_scope;
+    BlockedRange block(0, 0, 1);
+    while (loop->ClaimBlock(&block)) {
+      run_block(invoker, block);
+      loop->BlockDone();
+    }
+  }
+  loop->WaitUntilDone();
+}
+
 #ifdef __APPLE__
 // Enable to allow GCD as an option beside ThreadPool.
 #define USE_PARALLEL_INVOKER_GCD 1
@@ -231,7 +350,8 @@ inline void CheckAndSetInvokerOptions() {
   // ThreadPool otherwise.
   if (flags_parallel_invoker_mode != PARALLEL_INVOKER_NONE &&
       flags_parallel_invoker_mode != PARALLEL_INVOKER_THREAD_POOL &&
-      flags_parallel_invoker_mode != PARALLEL_INVOKER_OPENMP) {
+      flags_parallel_invoker_mode != PARALLEL_INVOKER_OPENMP &&
+      flags_parallel_invoker_mode != PARALLEL_INVOKER_EXECUTOR) {
 #if defined(_OPENMP)
     LOG(WARNING) << "Unsupported invoker mode selected on Android. "
                  << "OpenMP linkage detected, so falling back to OpenMP";
@@ -252,7 +372,8 @@ inline void CheckAndSetInvokerOptions() {
 #if defined(USE_PARALLEL_INVOKER_GCD)
       flags_parallel_invoker_mode != PARALLEL_INVOKER_GCD &&
 #endif  // USE_PARALLEL_INVOKER_GCD
-      flags_parallel_invoker_mode != PARALLEL_INVOKER_THREAD_POOL) {
+      flags_parallel_invoker_mode != PARALLEL_INVOKER_THREAD_POOL &&
+      flags_parallel_invoker_mode != PARALLEL_INVOKER_EXECUTOR) {
     LOG(WARNING) << "Unsupported invoker mode selected on iOS. "
                  << "Falling back to ThreadPool mode";
     flags_parallel_invoker_mode = PARALLEL_INVOKER_THREAD_POOL;
@@ -260,7 +381,9 @@ inline void CheckAndSetInvokerOptions() {
 #endif  // __APPLE__ || __EMSCRIPTEN__
 
 #if !defined(__APPLE__) && !defined(__EMSCRIPTEN__) && !defined(__ANDROID__)
-  flags_parallel_invoker_mode = PARALLEL_INVOKER_THREAD_POOL;
+  if (flags_parallel_invoker_mode != PARALLEL_INVOKER_EXECUTOR) {
+    flags_parallel_invoker_mode = PARALLEL_INVOKER_THREAD_POOL;
+  }
 #endif  // !__APPLE__ && !__EMSCRIPTEN__ && !__ANDROID__
 
   // If OpenMP is requested, make sure we can actually use it, and fall back
@@ -368,6 +491,16 @@ void ParallelFor(size_t start, size_t end, size_t grain_size,
       break;
     }
 
+    case PARALLEL_INVOKER_EXECUTOR: {
+      CHECK_LT(start, end);
+      ParallelForOnExecutor(
+          BlockedRange(start, end, grain_size), invoker,
+          [](const Invoker& block_invoker, const BlockedRange& block) {
+            block_invoker(BlockedRange(block.begin(), block.end(), 1));
+          });
+      break;
+    }
+
     case PARALLEL_INVOKER_OPENMP: {
       // Use thread-local copy of invoker.
       Invoker local_invoker(invoker);
@@ -475,6 +608,19 @@ void ParallelFor2D(size_t start_row, size_t end_row, size_t start_col,
       break;
     }
 
+    case PARALLEL_INVOKER_EXECUTOR: {
+      CHECK_LT(start_row, end_row);
+      ParallelForOnExecutor(
+          BlockedRange(start_row, end_row, grain_size), invoker,
+          [start_col, end_col](const Invoker& block_invoker,
+                               const BlockedRange& rows) {
+            block_invoker(
+                BlockedRange2D(BlockedRange(rows.begin(), rows.end(), 1),
+                               BlockedRange(start_col, end_col, 1)));
+          });
+      break;
+    }
+
     case PARALLEL_INVOKER_OPENMP: {
       // Use thread-local copy of invoker.
       Invoker local_invoker(invoker);
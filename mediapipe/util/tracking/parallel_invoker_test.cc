@@ -15,10 +15,20 @@
 #include "mediapipe/util/tracking/parallel_invoker.h"
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
 #include <numeric>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
+#include "absl/strings/substitute.h"
 #include "absl/synchronization/mutex.h"
+#include "mediapipe/framework/calculator_framework.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/gtest.h"
+#include "mediapipe/framework/port/logging.h"
+#include "mediapipe/framework/port/parse_text_proto.h"
 
 namespace mediapipe {
 namespace {
@@ -56,5 +66,192 @@ TEST(ParallelInvokerTest, ThreadPoolTest) {
   RunParallelTest();
 }
 
+TEST(ParallelInvokerTest, ExecutorTest) {
+  flags_parallel_invoker_mode = PARALLEL_INVOKER_EXECUTOR;
+
+  // Outside of a graph, falls back to the ParallelInvokerThreadPool().
+  RunParallelTest();
+}
+
+TEST(ParallelInvokerTest, Executor2DTest) {
+  flags_parallel_invoker_mode = PARALLEL_INVOKER_EXECUTOR;
+  const int kRows = 100;
+  const int kCols = 30;
+  std::vector<std::atomic<int>> visits(kRows * kCols);
+
+  ParallelFor2D(0, kRows, 0, kCols, 3, [&visits](const BlockedRange2D& b) {
+    for (int r = b.rows().begin(); r != b.rows().end(); ++r) {
+      for (int c = b.cols().begin(); c != b.cols().end(); ++c) {
+        ++visits[r * kCols + c];
+      }
+    }
+  });
+
+  for (int i = 0; i < kRows * kCols; ++i) {
+    EXPECT_EQ(visits[i], 1) << "at " << i;
+  }
+}
+
+TEST(ParallelInvokerTest, ExecutorNestedLoopsRunSerially) {
+  flags_parallel_invoker_mode = PARALLEL_INVOKER_EXECUTOR;
+  const int kOuterSize = 64;
+  const int kInnerSize = 64;
+  std::vector<std::atomic<int>> visits(kOuterSize * kInnerSize);
+  std::atomic<int> parallel_inner_loops(0);
+
+  ParallelFor(0, kOuterSize, 1, [&](const BlockedRange& outer) {
+    for (int i = outer.begin(); i != outer.end(); ++i) {
+      const std::thread::id outer_thread = std::this_thread::get_id();
+      ParallelFor(0, kInnerSize, 1, [&](const BlockedRange& inner) {
+        if (std::this_thread::get_id() != outer_thread ||
+            inner.end() - inner.begin() != kInnerSize) {
+          ++parallel_inner_loops;
+        }
+        for (int j = inner.begin(); j != inner.end(); ++j) {
+          ++visits[i * kInnerSize + j];
+        }
+      });
+    }
+  });
+
+  EXPECT_EQ(parallel_inner_loops, 0);
+  for (int i = 0; i < kOuterSize * kInnerSize; ++i) {
+    EXPECT_EQ(visits[i], 1) << "at " << i;
+  }
+}
+
+// The number of threads running calculator or loop work, and its maximum.
+std::atomic<int> num_busy_threads(0);
+std::atomic<int> max_busy_threads(0);
+
+// Marks the calling thread as busy in the current scope.
+class ScopedBusyThread {
+ public:
+  ScopedBusyThread() {
+    const int busy = ++num_busy_threads;
+    int max_busy = max_busy_threads.load();
+    while (busy > max_busy &&
+           !max_busy_threads.compare_exchange_weak(max_busy, busy)) {
+    }
+  }
+  ~ScopedBusyThread() { --num_busy_threads; }
+};
+
+// Keeps a core busy for about `iterations` floating point operations.
+void BusyWork(int iterations) {
+  float x = 1.0f;
+  for (int i = 0; i < iterations; ++i) {
+    x = std::sqrt(x + i);
+  }
+  benchmark::DoNotOptimize(x);
+}
+
+// Stands in for a tracking calculator, as MotionAnalysisCalculator or
+// BoxTrackerCalculator, whose per-feature work runs in a ParallelFor.
+class ParallelTrackingCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).SetSameAs(&cc->Inputs().Index(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    ParallelFor(0, 256, 1, [](const BlockedRange& range) {
+      ScopedBusyThread busy;
+      BusyWork(2000 * (range.end() - range.begin()));
+    });
+    cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+    return absl::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(ParallelTrackingCalculator);
+
+// Stands in for a single threaded inference calculator.
+class SerialInferenceCalculator : public CalculatorBase {
+ public:
+  static absl::Status GetContract(CalculatorContract* cc) {
+    cc->Inputs().Index(0).SetAny();
+    cc->Outputs().Index(0).SetSameAs(&cc->Inputs().Index(0));
+    return absl::OkStatus();
+  }
+
+  absl::Status Process(CalculatorContext* cc) override {
+    ScopedBusyThread busy;
+    BusyWork(200000);
+    cc->Outputs().Index(0).AddPacket(cc->Inputs().Index(0).Value());
+    return absl::OkStatus();
+  }
+};
+REGISTER_CALCULATOR(SerialInferenceCalculator);
+
+// The number of threads of the default executor of the graph.
+constexpr int kNumGraphThreads = 4;
+
+// Runs `num_frames` frames through a graph with a ParallelTrackingCalculator
+// and three SerialInferenceCalculators, and returns the maximum number of
+// threads that were busy at once.
+int RunTrackingAndInferenceGraph(int num_frames) {
+  std::string config_text = absl::Substitute(R"pb(
+    input_stream: "frame"
+    num_threads: $0
+    node {
+      calculator: "ParallelTrackingCalculator"
+      input_stream: "frame"
+      output_stream: "motion"
+    }
+  )pb",
+                                             kNumGraphThreads);
+  for (int i = 0; i < 3; ++i) {
+    config_text += absl::Substitute(R"pb(
+      node {
+        calculator: "SerialInferenceCalculator"
+        input_stream: "frame"
+        output_stream: "detections_$0"
+      }
+    )pb",
+                                    i);
+  }
+  const auto config = ParseTextProtoOrDie<CalculatorGraphConfig>(config_text);
+  CalculatorGraph graph;
+  CHECK(graph.Initialize(config).ok());
+  num_busy_threads = 0;
+  max_busy_threads = 0;
+  CHECK(graph.StartRun({}).ok());
+  for (int i = 0; i < num_frames; ++i) {
+    const Packet frame = MakePacket<int>(i).At(Timestamp(i));
+    CHECK(graph.AddPacketToInputStream("frame", frame).ok());
+  }
+  CHECK(graph.CloseAllInputStreams().ok());
+  CHECK(graph.WaitUntilDone().ok());
+  return max_busy_threads;
+}
+
+TEST(ParallelInvokerTest, ExecutorSharesGraphThreads) {
+  flags_parallel_invoker_mode = PARALLEL_INVOKER_EXECUTOR;
+
+  // All the loop iterations run on the threads of the graph.
+  EXPECT_LE(RunTrackingAndInferenceGraph(10), kNumGraphThreads);
+}
+
+// Runs a tracking + inference graph with the invoker mode of Arg 0, and
+// reports the maximum number of busy threads, which exceeds the
+// kNumGraphThreads threads of the graph when the graph and the parallel
+// invoker oversubscribe the cores.
+void BM_TrackingAndInferenceGraph(benchmark::State& state) {
+  flags_parallel_invoker_mode = state.range(0);
+  constexpr int kNumFrames = 30;
+  int max_busy = 0;
+  for (auto _ : state) {
+    max_busy = std::max(max_busy, RunTrackingAndInferenceGraph(kNumFrames));
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+  state.counters["max_busy_threads"] = max_busy;
+}
+BENCHMARK(BM_TrackingAndInferenceGraph)
+    ->Arg(PARALLEL_INVOKER_THREAD_POOL)
+    ->Arg(PARALLEL_INVOKER_EXECUTOR)
+    ->UseRealTime();
+
 }  // namespace
 }  // namespace mediapipe
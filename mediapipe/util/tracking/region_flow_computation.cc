@@ -2601,10 +2601,17 @@ void RegionFlowComputation::TrackFeatures(FrameTrackingData* from_data_ptr,
   if (use_cv_tracking_) {
 #if CV_MAJOR_VERSION >= 3
     if (gain_correction) {
+      // The frame pyramids are built once per frame in InitFrame. Build the
+      // one of the gain corrected frame here, with the same settings, instead
+      // of passing the image and letting cv::calcOpticalFlowPyrLK rebuild its
+      // pyramid for the tracking and again for the verification below.
+      cv::buildOpticalFlowPyramid(*gain_image_, gain_image_pyramid_,
+                                  cv_window_size, pyramid_levels_,
+                                  options_.compute_derivative_in_pyramid());
       if (!frame1_gain_reference) {
-        input_frame1 = cv::_InputArray(*gain_image_);
+        input_frame1 = cv::_InputArray(gain_image_pyramid_);
       } else {
-        input_frame2 = cv::_InputArray(*gain_image_);
+        input_frame2 = cv::_InputArray(gain_image_pyramid_);
       }
     }
 
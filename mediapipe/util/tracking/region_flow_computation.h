@@ -418,6 +418,9 @@ class RegionFlowComputation {
   // Gain adapted version.
   std::unique_ptr<cv::Mat> gain_image_;
   std::unique_ptr<cv::Mat> gain_pyramid_;
+  // Tracking pyramid of gain_image_ for cv tracking, built once per tracked
+  // frame pair and shared by feature tracking and verification.
+  std::vector<cv::Mat> gain_image_pyramid_;
 
   // Temporary buffers.
   std::unique_ptr<cv::Mat> corner_values_;
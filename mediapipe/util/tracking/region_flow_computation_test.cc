@@ -20,10 +20,12 @@
 #include <memory>
 #include <random>
 #include <string>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/time/clock.h"
 #include "mediapipe/framework/deps/file_path.h"
+#include "mediapipe/framework/port/benchmark.h"
 #include "mediapipe/framework/port/file_helpers.h"
 #include "mediapipe/framework/port/gtest.h"
 #include "mediapipe/framework/port/logging.h"
@@ -251,6 +253,13 @@ TEST_P(RegionFlowComputationTest, FramePairTest) {
   RunFramePairTest(RegionFlowComputationOptions::FORMAT_BGRA);
 }
 
+TEST_P(RegionFlowComputationTest, GainCorrectionFramePairTest) {
+  // Tracks and verifies the features against the gain corrected frame.
+  base_options_.set_gain_correction(true);
+  base_options_.set_verify_features(true);
+  RunFramePairTest(RegionFlowComputationOptions::FORMAT_RGB);
+}
+
 TEST_P(RegionFlowComputationTest, ResolutionTests) {
   // Test all kinds of resolutions (disregard resulting flow).
   // Square test, synthetic tracks.
@@ -300,5 +309,47 @@ TEST_P(RegionFlowComputationTest, ResolutionTests) {
   }
 }
 
+// Tracks a movie of 30 frames of the test image, displaced along a zig-zag,
+// with the verification of the features by backward tracking. Arg: whether
+// gain correction is enabled. Reports the frames per second as items per
+// second.
+void BM_RegionFlowComputation(benchmark::State& state) {
+  std::string png_data;
+  MEDIAPIPE_CHECK_OK(file::GetContents(
+      file::JoinPath("./", "/mediapipe/util/tracking/testdata/",
+                     "stabilize_test.png"),
+      &png_data));
+  std::vector<char> buffer(png_data.begin(), png_data.end());
+  const cv::Mat original_frame = cv::imdecode(cv::Mat(buffer), 1);
+  CHECK(!original_frame.empty());
+
+  constexpr int kNumFrames = 30;
+  const int border = 40;
+  const int frame_width = original_frame.cols - 2 * border;
+  const int frame_height = original_frame.rows - 2 * border;
+  std::vector<cv::Mat> movie(kNumFrames);
+  for (int f = 0; f < kNumFrames; ++f) {
+    const int x = border + (3 * f) % 21 - 10;
+    const int y = border + (7 * f) % 21 - 10;
+    original_frame(cv::Rect(x, y, frame_width, frame_height)).copyTo(movie[f]);
+  }
+
+  RegionFlowComputationOptions options;
+  options.set_image_format(RegionFlowComputationOptions::FORMAT_RGB);
+  options.set_verify_features(true);
+  options.set_gain_correction(state.range(0));
+  for (auto _ : state) {
+    RegionFlowComputation flow_computation(options, frame_width, frame_height);
+    for (int f = 0; f < kNumFrames; ++f) {
+      flow_computation.AddImage(movie[f], f * 33333);
+      std::unique_ptr<RegionFlowFrame> region_flow_frame(
+          flow_computation.RetrieveRegionFlow());
+      benchmark::DoNotOptimize(region_flow_frame);
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kNumFrames);
+}
+BENCHMARK(BM_RegionFlowComputation)->Arg(0)->Arg(1);
+
 }  // namespace
 }  // namespace mediapipe